@@ -0,0 +1,52 @@
+// AllocationCounter.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+/// The allocations of one thread counted between AllocationCounterStart and AllocationCounterStop.
+typedef struct {
+    /// The number of allocations including reallocations.
+    NSUInteger count;
+    /// The sum of the sizes of the allocated blocks in bytes.
+    unsigned long long bytes;
+    /// The highest sum of the sizes of the blocks allocated while counting and not freed yet or 0 if the blocks couldn't be tracked.
+    unsigned long long peakBytes;
+} AllocationCount;
+
+
+/**
+ Starts counting the allocations of the calling thread in the default malloc zone, used by the benchmarks and the tests.
+ 
+ The zone's functions are replaced until AllocationCounterStop is called, the calls of other threads are passed through without being counted.
+ The blocks allocated while counting are tracked, so freeing a block allocated before doesn't lower the bytes in use.
+ A block freed by another thread stays counted as in use.
+ 
+ @return True if counting has started, false if allocations can't be counted on this platform.
+ */
+BOOL AllocationCounterStart(void);
+
+/**
+ Stops counting and restores the zone's functions.
+ 
+ @return The counted allocations.
+ */
+AllocationCount AllocationCounterStop(void);
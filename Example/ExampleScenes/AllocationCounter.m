@@ -0,0 +1,210 @@
+// AllocationCounter.m
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "AllocationCounter.h"
+#if defined(__APPLE__)
+#import <malloc/malloc.h>
+#import <mach/mach.h>
+#import <pthread.h>
+#endif
+
+
+#if defined(__APPLE__)
+
+// The number of slots of the tracked blocks' hash set.
+static NSUInteger const AllocationCounterBlockCapacity = 1 << 20;
+// The marker of a slot whose block has been freed.
+static uintptr_t const AllocationCounterFreedBlock = 1;
+
+// The thread whose allocations are counted.
+static pthread_t AllocationCounterThread;
+// The allocations counted so far, only the counting thread writes them.
+static AllocationCount AllocationCounterCount;
+// The sizes of the tracked blocks not freed yet.
+static unsigned long long AllocationCounterBytesInUse = 0;
+// The blocks allocated while counting as hash set with linear probing, the memory isn't taken from the counted zone.
+static uintptr_t *AllocationCounterBlocks = NULL;
+// The number of used slots including the ones of freed blocks.
+static NSUInteger AllocationCounterUsedSlots = 0;
+// True if the hash set is too full and the bytes in use aren't valid anymore.
+static BOOL AllocationCounterBlocksOverflowed = NO;
+// The default zone's original functions.
+static void *(*AllocationCounterOriginalMalloc)(malloc_zone_t *zone, size_t size);
+static void *(*AllocationCounterOriginalCalloc)(malloc_zone_t *zone, size_t count, size_t size);
+static void *(*AllocationCounterOriginalRealloc)(malloc_zone_t *zone, void *pointer, size_t size);
+static void (*AllocationCounterOriginalFree)(malloc_zone_t *zone, void *pointer);
+static void (*AllocationCounterOriginalFreeDefiniteSize)(malloc_zone_t *zone, void *pointer, size_t size);
+
+// Returns the first slot to probe for a block.
+static inline NSUInteger AllocationCounterSlotOfBlock(uintptr_t block) {
+    return (NSUInteger)(((uint64_t)block >> 4) * 0x9E3779B97F4A7C15ull >> 44) & (AllocationCounterBlockCapacity - 1);
+}
+
+// Adds a block to the tracked blocks, returns false if the set is full.
+static BOOL AllocationCounterInsertBlock(uintptr_t block) {
+    if (AllocationCounterUsedSlots >= AllocationCounterBlockCapacity / 4 * 3) {
+        AllocationCounterBlocksOverflowed = YES;
+        return NO;
+    }
+    NSUInteger slot = AllocationCounterSlotOfBlock(block);
+    while (AllocationCounterBlocks[slot] > AllocationCounterFreedBlock) {
+        slot = (slot + 1) & (AllocationCounterBlockCapacity - 1);
+    }
+    if (AllocationCounterBlocks[slot] == 0) {
+        ++AllocationCounterUsedSlots;
+    }
+    AllocationCounterBlocks[slot] = block;
+    return YES;
+}
+
+// Removes a block from the tracked blocks, returns false if it hasn't been allocated while counting.
+static BOOL AllocationCounterRemoveBlock(uintptr_t block) {
+    NSUInteger slot = AllocationCounterSlotOfBlock(block);
+    while (AllocationCounterBlocks[slot] != 0) {
+        if (AllocationCounterBlocks[slot] == block) {
+            AllocationCounterBlocks[slot] = AllocationCounterFreedBlock;
+            return YES;
+        }
+        slot = (slot + 1) & (AllocationCounterBlockCapacity - 1);
+    }
+    return NO;
+}
+
+// Counts a block allocated by the counting thread.
+static void AllocationCounterAllocated(malloc_zone_t *zone, void *pointer) {
+    if (pointer == NULL) {
+        return;
+    }
+    size_t size = zone->size(zone, pointer);
+    ++AllocationCounterCount.count;
+    AllocationCounterCount.bytes += size;
+    if (AllocationCounterInsertBlock((uintptr_t)pointer)) {
+        AllocationCounterBytesInUse += size;
+        AllocationCounterCount.peakBytes = MAX(AllocationCounterCount.peakBytes, AllocationCounterBytesInUse);
+    }
+}
+
+// Subtracts a block freed by the counting thread if it has been allocated while counting.
+static void AllocationCounterFreed(malloc_zone_t *zone, void *pointer) {
+    if (pointer != NULL && AllocationCounterRemoveBlock((uintptr_t)pointer)) {
+        AllocationCounterBytesInUse -= zone->size(zone, pointer);
+    }
+}
+
+static void *AllocationCounterMalloc(malloc_zone_t *zone, size_t size) {
+    void *pointer = AllocationCounterOriginalMalloc(zone, size);
+    if (pthread_equal(pthread_self(), AllocationCounterThread)) AllocationCounterAllocated(zone, pointer);
+    return pointer;
+}
+
+static void *AllocationCounterCalloc(malloc_zone_t *zone, size_t count, size_t size) {
+    void *pointer = AllocationCounterOriginalCalloc(zone, count, size);
+    if (pthread_equal(pthread_self(), AllocationCounterThread)) AllocationCounterAllocated(zone, pointer);
+    return pointer;
+}
+
+static void *AllocationCounterRealloc(malloc_zone_t *zone, void *pointer, size_t size) {
+    BOOL counting = pthread_equal(pthread_self(), AllocationCounterThread);
+    if (counting) AllocationCounterFreed(zone, pointer);
+    void *reallocated = AllocationCounterOriginalRealloc(zone, pointer, size);
+    if (counting) AllocationCounterAllocated(zone, reallocated);
+    return reallocated;
+}
+
+static void AllocationCounterFree(malloc_zone_t *zone, void *pointer) {
+    if (pthread_equal(pthread_self(), AllocationCounterThread)) AllocationCounterFreed(zone, pointer);
+    AllocationCounterOriginalFree(zone, pointer);
+}
+
+static void AllocationCounterFreeDefiniteSize(malloc_zone_t *zone, void *pointer, size_t size) {
+    if (pthread_equal(pthread_self(), AllocationCounterThread)) AllocationCounterFreed(zone, pointer);
+    AllocationCounterOriginalFreeDefiniteSize(zone, pointer, size);
+}
+
+#endif
+
+
+BOOL AllocationCounterStart(void) {
+#if defined(__APPLE__)
+    NSCAssert(AllocationCounterBlocks == NULL, @"allocations are already counted");
+    vm_size_t blocksSize = AllocationCounterBlockCapacity * sizeof(uintptr_t);
+    vm_address_t blocks = 0;
+    if (vm_allocate(mach_task_self(), &blocks, blocksSize, VM_FLAGS_ANYWHERE) != KERN_SUCCESS) {
+        return NO;
+    }
+    malloc_zone_t *zone = malloc_default_zone();
+    if (vm_protect(mach_task_self(), (vm_address_t)zone, sizeof(malloc_zone_t), 0, VM_PROT_READ | VM_PROT_WRITE) != KERN_SUCCESS) {
+        vm_deallocate(mach_task_self(), blocks, blocksSize);
+        return NO;
+    }
+    AllocationCounterThread = pthread_self();
+    memset(&AllocationCounterCount, 0, sizeof(AllocationCount));
+    AllocationCounterBytesInUse = 0;
+    AllocationCounterBlocks = (uintptr_t *)blocks;
+    AllocationCounterUsedSlots = 0;
+    AllocationCounterBlocksOverflowed = NO;
+    AllocationCounterOriginalMalloc = zone->malloc;
+    AllocationCounterOriginalCalloc = zone->calloc;
+    AllocationCounterOriginalRealloc = zone->realloc;
+    AllocationCounterOriginalFree = zone->free;
+    AllocationCounterOriginalFreeDefiniteSize = (zone->version >= 6 ? zone->free_definite_size : NULL);
+    zone->malloc = AllocationCounterMalloc;
+    zone->calloc = AllocationCounterCalloc;
+    zone->realloc = AllocationCounterRealloc;
+    zone->free = AllocationCounterFree;
+    if (AllocationCounterOriginalFreeDefiniteSize != NULL) {
+        zone->free_definite_size = AllocationCounterFreeDefiniteSize;
+    }
+    vm_protect(mach_task_self(), (vm_address_t)zone, sizeof(malloc_zone_t), 0, VM_PROT_READ);
+    return YES;
+#else
+    return NO;
+#endif
+}
+
+AllocationCount AllocationCounterStop(void) {
+    AllocationCount count = {0, 0, 0};
+#if defined(__APPLE__)
+    if (AllocationCounterBlocks == NULL) {
+        return count;
+    }
+    malloc_zone_t *zone = malloc_default_zone();
+    vm_protect(mach_task_self(), (vm_address_t)zone, sizeof(malloc_zone_t), 0, VM_PROT_READ | VM_PROT_WRITE);
+    zone->malloc = AllocationCounterOriginalMalloc;
+    zone->calloc = AllocationCounterOriginalCalloc;
+    zone->realloc = AllocationCounterOriginalRealloc;
+    zone->free = AllocationCounterOriginalFree;
+    if (AllocationCounterOriginalFreeDefiniteSize != NULL) {
+        zone->free_definite_size = AllocationCounterOriginalFreeDefiniteSize;
+    }
+    vm_protect(mach_task_self(), (vm_address_t)zone, sizeof(malloc_zone_t), 0, VM_PROT_READ);
+    
+    count = AllocationCounterCount;
+    if (AllocationCounterBlocksOverflowed) {
+        count.peakBytes = 0;
+    }
+    vm_deallocate(mach_task_self(), (vm_address_t)AllocationCounterBlocks, AllocationCounterBlockCapacity * sizeof(uintptr_t));
+    AllocationCounterBlocks = NULL;
+#endif
+    return count;
+}
@@ -41,6 +41,11 @@
 /// A label which shows the currently playing animation name.
 @property (nonatomic, strong) SKLabelNode *animationNameLabel;
 
+/// A gun attached to the front hand, it isn't part of the animation.
+@property (nonatomic, strong) SKSpriteNode *gunNode;
+/// The index of the front hand's timeline in the current animation.
+@property (nonatomic, assign) NSUInteger handTimelineIndex;
+
 
 @end
 
@@ -59,6 +64,8 @@
     NSAssert([scmlParser parseFilename:@"player"], @"Failed loading the scml file");
     NSLog(@"%@ loaded", scmlParser);
     self.animationManager = [[INSKAnimationManager alloc] initWithAnimationData:[scmlParser animationData] textureLoader:self];
+    // call the delegates after all animation nodes are updated
+    self.animationManager.deferredNotifications = YES;
     
     // create animation node and assign entity
     self.animationNode = [INSKAnimationNode node];
@@ -68,6 +75,11 @@
     [self addChild:self.animationNode];
     self.animationNode.animationNodeDelegate = self;
     
+    // create the gun which follows the front hand
+    self.gunNode = [SKSpriteNode spriteNodeWithTexture:[self textureNamed:@"hand-gun.png" path:@"guns"]];
+    self.gunNode.zPosition = self.animationNode.zPosition + 1;
+    [self addChild:self.gunNode];
+    
     // load list of animation names
     self.animationNames = [self.animationManager allAnimationNamesForEntity:@"Player"];
     NSAssert(self.animationNames.count > 0, @"At least one animation should be there to play");
@@ -105,6 +117,16 @@
     // update the manager
     [self.animationManager update:currentTime];
     
+    // attach the gun to the hand by evaluating only the hand and its parent bones
+    INSKAMPose handPose;
+    if ([self.animationNode evaluatePose:&handPose ofTimelineAtIndex:self.handTimelineIndex] && !handPose.hidden) {
+        self.gunNode.hidden = NO;
+        self.gunNode.position = [self convertPoint:CGPointMake(handPose.positionX, handPose.positionY) fromNode:self.animationNode];
+        self.gunNode.zRotation = handPose.angle;
+    } else {
+        self.gunNode.hidden = YES;
+    }
+    
     // update the label with the updated animation time
     self.animationTimeLabel.text = [NSString stringWithFormat:@"Animation Time (total %.1f sec): %.1f", self.animationNode.animationLength, self.animationNode.currentAnimationTime];
 }
@@ -119,11 +141,13 @@
 
 - (void)startAnimation {
     NSString *animationName = self.animationNames[self.currentAnimationIndex];
-    if (![self.animationNode playAnimation:animationName]) {
+    // cross-fade from the previous animation
+    if (![self.animationNode playAnimation:animationName blendDuration:0.25]) {
         NSLog(@"Can't play animation '%@'", animationName);
     }
     self.animationNode.loopAnimation = YES;
     self.animationNameLabel.text = animationName;
+    self.handTimelineIndex = [self.animationNode timelineIndexNamed:@"front_hand"];
 }
 
 
@@ -0,0 +1,405 @@
+// PerformanceBenchmarks.m
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "PerformanceBenchmarks.h"
+#import "PlaybackBenchmark.h"
+#import "INSKAMHeaders.h"
+#import <QuartzCore/QuartzCore.h>
+#import "SpriterModelHeaders.h"
+#import "AllocationCounter.h"
+
+
+// The number of repetitions for each measurement.
+static NSUInteger const BenchmarkIterations = 20;
+// The frames per second used for stepping through the animations.
+static NSUInteger const BenchmarkFramesPerSecond = 60;
+// The number of animation nodes updated in the playback benchmarks.
+static NSUInteger const BenchmarkNodeCount = 50;
+// The number of actors evaluated in one batch by the collision evaluator benchmark.
+static NSUInteger const BenchmarkActorCount = 10000;
+// The instance-frames played by each run of the headless playback benchmark, spread over fewer frames for more instances.
+static NSUInteger const BenchmarkInstanceFrames = 1000000;
+
+
+@interface PerformanceBenchmarks () <INSKAMTextureLoader>
+
+@end
+
+
+@implementation PerformanceBenchmarks
+
+- (instancetype)initWithSize:(CGSize)size {
+    self = [super initWithSize:size];
+    if (self == nil) return self;
+    
+    self.backgroundColor = [SKColor colorWithRed:0.15 green:0.15 blue:0.3 alpha:1.0];
+    self.anchorPoint = CGPointMake(0.5, 0.5);
+    
+    // run all benchmarks
+    NSMutableArray *results = [NSMutableArray array];
+    [results addObjectsFromArray:[self benchmarkKeyframeCompression]];
+    [results addObjectsFromArray:[self benchmarkFlattenedRendering]];
+    [results addObjectsFromArray:[self benchmarkCollisionEvaluator]];
+    [results addObjectsFromArray:[self benchmarkHeadlessPlayback]];
+    [results addObjectsFromArray:[self benchmarkCachedStartup]];
+    [results addObjectsFromArray:[self benchmarkSconParsing]];
+    
+    // print results to console
+    NSLog(@"\n\n%@\n", [results componentsJoinedByString:@"\n"]);
+    
+    // show results
+    CGFloat positionY = size.height / 2 - 100;
+    for (NSString *result in results) {
+        SKLabelNode *label = [SKLabelNode labelNodeWithFontNamed:@"ChalkboardSE-Regular"];
+        label.fontSize = 15;
+        label.text = result;
+        label.position = CGPointMake(10 - size.width / 2, positionY);
+        label.horizontalAlignmentMode = SKLabelHorizontalAlignmentModeLeft;
+        [self addChild:label];
+        positionY -= 25;
+    }
+    
+    return self;
+}
+
+
+#pragma mark - helper
+
+- (INSKAMData *)animationDataForFile:(NSString *)filename compressed:(BOOL)compressed {
+    INSKScmlParser *scmlParser = [[INSKScmlParser alloc] init];
+    scmlParser.compressKeyframes = compressed;
+    BOOL parsed = [scmlParser parseFilename:filename];
+    NSAssert(parsed, @"Failed loading the scml file");
+    if (!parsed) {
+        return nil;
+    }
+    return [scmlParser animationData];
+}
+
+// Returns the number of all nodes in the tree below the given node.
+- (NSUInteger)descendantCountOfNode:(SKNode *)node {
+    NSUInteger count = node.children.count;
+    for (SKNode *child in node.children) {
+        count += [self descendantCountOfNode:child];
+    }
+    return count;
+}
+
+
+#pragma mark - Animation manager TextureLoader methods
+
+- (SKTexture *)textureNamed:(NSString *)textureName path:(NSString *)path {
+    return [SKTexture textureWithImageNamed:textureName];
+}
+
+
+#pragma mark - benchmarks
+
+- (NSArray *)benchmarkKeyframeCompression {
+    INSKAMData *data = [self animationDataForFile:@"player" compressed:NO];
+    INSKAMData *compressedData = [self animationDataForFile:@"player" compressed:YES];
+    
+    // memory
+    NSUInteger memorySize = [data keyframeMemorySize];
+    NSUInteger compressedMemorySize = [compressedData keyframeMemorySize];
+    NSString *memoryResult = [NSString stringWithFormat:@"Keyframe memory: %lu bytes, compressed %lu bytes (%.1fx less)", (unsigned long)memorySize, (unsigned long)compressedMemorySize, (double)memorySize / compressedMemorySize];
+    
+    // raw decoding of all keyframes
+    INSKAMSpatial *spatial = [[INSKAMSpatial alloc] init];
+    NSUInteger decodeCount = 0;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSUInteger iteration = 0; iteration < BenchmarkIterations; ++iteration) {
+        for (INSKAMEntity *entity in compressedData.entitiesByName.allValues) {
+            for (INSKAMAnimation *animation in entity.animationsByName.allValues) {
+                for (INSKAMTimeline *timeline in animation.timelinesById.allValues) {
+                    for (NSUInteger keyIndex = 0; keyIndex < timeline.keyCount; ++keyIndex) {
+                        [timeline decodeKeyAtIndex:keyIndex intoSpatial:spatial];
+                        ++decodeCount;
+                    }
+                }
+            }
+        }
+    }
+    CFTimeInterval decodeDuration = CACurrentMediaTime() - startTime;
+    NSString *decodeResult = [NSString stringWithFormat:@"Keyframe decode: %.0f ns per key", decodeDuration * 1e9 / decodeCount];
+    
+    // playback lookups with cursors
+    NSUInteger lookupCount = 0;
+    NSTimeInterval lookupDuration = [self timelineLookupDurationForData:data lookupCount:&lookupCount];
+    NSUInteger compressedLookupCount = 0;
+    NSTimeInterval compressedLookupDuration = [self timelineLookupDurationForData:compressedData lookupCount:&compressedLookupCount];
+    NSString *lookupResult = [NSString stringWithFormat:@"Keyframe lookup per timeline and frame: %.0f ns, compressed %.0f ns", lookupDuration * 1e9 / lookupCount, compressedLookupDuration * 1e9 / compressedLookupCount];
+    
+    return @[memoryResult, decodeResult, lookupResult];
+}
+
+- (NSArray *)benchmarkFlattenedRendering {
+    INSKAnimationManager *manager = [[INSKAnimationManager alloc] initWithAnimationData:[self animationDataForFile:@"player" compressed:NO] textureLoader:self];
+    NSUInteger nodeCount = 0;
+    NSTimeInterval duration = [self playbackDurationForManager:manager flattened:NO nodeCount:&nodeCount];
+    NSUInteger flattenedNodeCount = 0;
+    NSTimeInterval flattenedDuration = [self playbackDurationForManager:manager flattened:YES nodeCount:&flattenedNodeCount];
+    
+    NSString *nodeResult = [NSString stringWithFormat:@"SKNodes per character: %lu, flattened %lu", (unsigned long)nodeCount, (unsigned long)flattenedNodeCount];
+    NSString *updateResult = [NSString stringWithFormat:@"Update per character and frame: %.1f us, flattened %.1f us", duration * 1e6, flattenedDuration * 1e6];
+    return @[nodeResult, updateResult];
+}
+
+- (NSArray *)benchmarkCollisionEvaluator {
+    INSKAMCollisionEvaluator *evaluator = [[INSKAMCollisionEvaluator alloc] initWithData:[self animationDataForFile:@"player" compressed:NO]];
+    NSUInteger animationIndex = [evaluator indexOfAnimation:@"walk" entity:@"Player"];
+    NSAssert(animationIndex != NSNotFound, @"walk animation expected");
+    
+    // actors spread over the world and the animation
+    NSMutableData *actorData = [NSMutableData dataWithLength:BenchmarkActorCount * sizeof(INSKAMCollisionActor)];
+    INSKAMCollisionActor *actors = actorData.mutableBytes;
+    for (NSUInteger actorIndex = 0; actorIndex < BenchmarkActorCount; ++actorIndex) {
+        actors[actorIndex].animationIndex = animationIndex;
+        actors[actorIndex].time = actorIndex * 7;
+        actors[actorIndex].positionX = (actorIndex % 100) * 200;
+        actors[actorIndex].positionY = (actorIndex / 100) * 200;
+        actors[actorIndex].angle = 0.0;
+        actors[actorIndex].scaleX = (actorIndex % 2 == 0 ? 1.0 : -1.0);
+        actors[actorIndex].scaleY = 1.0;
+    }
+    
+    NSTimeInterval duration = [self durationForEvaluator:evaluator actors:actors];
+    evaluator.chunkSize = BenchmarkActorCount;
+    NSTimeInterval singleChunkDuration = [self durationForEvaluator:evaluator actors:actors];
+    
+    NSUInteger boxCount = 0;
+    for (NSUInteger actorIndex = 0; actorIndex < evaluator.actorCount; ++actorIndex) {
+        boxCount += evaluator.actorShapes[actorIndex].boxCount;
+    }
+    NSString *throughputResult = [NSString stringWithFormat:@"Batch hitboxes: %.0f actors per second, single threaded %.0f", 1.0 / duration, 1.0 / singleChunkDuration];
+    NSString *boxResult = [NSString stringWithFormat:@"Batch hitboxes: %lu boxes for %lu actors", (unsigned long)boxCount, (unsigned long)BenchmarkActorCount];
+    return @[throughputResult, boxResult];
+}
+
+- (NSArray *)benchmarkHeadlessPlayback {
+    NSArray *animationData = @[[self animationDataForFile:@"player" compressed:NO], [self animationDataForFile:@"BasicTests" compressed:NO]];
+    PlaybackBenchmark *benchmark = [[PlaybackBenchmark alloc] initWithAnimationData:animationData];
+    benchmark.framesPerSecond = BenchmarkFramesPerSecond;
+    
+    // without switching and with each instance switching its animation every second
+    NSMutableArray *results = [NSMutableArray array];
+    for (NSNumber *switchInterval in @[@0, @(BenchmarkFramesPerSecond)]) {
+        benchmark.switchInterval = switchInterval.unsignedIntegerValue;
+        for (NSNumber *instanceCount in @[@1, @100, @1000, @10000]) {
+            NSUInteger count = instanceCount.unsignedIntegerValue;
+            NSUInteger frameCount = MIN(BenchmarkIterations * BenchmarkFramesPerSecond, MAX(BenchmarkFramesPerSecond, BenchmarkInstanceFrames / count));
+            PlaybackBenchmarkResult result = [benchmark runWithInstanceCount:count frameCount:frameCount];
+            NSString *allocations = (result.allocationsPerFrame >= 0.0 ? [NSString stringWithFormat:@"%.1f", result.allocationsPerFrame] : @"n/a");
+            [results addObject:[NSString stringWithFormat:@"Headless %lu instances%@: %.0f ns per instance, frame p50 %.0f us p99 %.0f us, %@ allocs per frame",
+                                (unsigned long)count, (benchmark.switchInterval > 0 ? @" switching" : @""), result.nanosecondsPerInstanceFrame, result.medianFrameTime, result.p99FrameTime, allocations]];
+        }
+    }
+    return results;
+}
+
+- (NSArray *)benchmarkCachedStartup {
+    NSString *cacheDirectory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"PerformanceBenchmarksCache"];
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    
+    // cold starts parse, convert and store the entry, warm starts only read it
+    NSTimeInterval coldDuration = 0;
+    NSTimeInterval warmDuration = 0;
+    for (NSUInteger iteration = 0; iteration < BenchmarkIterations; ++iteration) {
+        [fileManager removeItemAtPath:cacheDirectory error:NULL];
+        coldDuration += [self startupDurationForFile:@"player" cacheDirectory:cacheDirectory];
+        warmDuration += [self startupDurationForFile:@"player" cacheDirectory:cacheDirectory];
+    }
+    
+    unsigned long long entrySize = 0;
+    for (NSString *name in [fileManager contentsOfDirectoryAtPath:cacheDirectory error:NULL]) {
+        entrySize += [[fileManager attributesOfItemAtPath:[cacheDirectory stringByAppendingPathComponent:name] error:NULL] fileSize];
+    }
+    unsigned long long fileSize = [[fileManager attributesOfItemAtPath:[[NSBundle mainBundle] pathForResource:@"player" ofType:@"scml"] error:NULL] fileSize];
+    [fileManager removeItemAtPath:cacheDirectory error:NULL];
+    
+    NSString *startupResult = [NSString stringWithFormat:@"Startup player.scml: cold %.2f ms, warm from cache %.2f ms (%.1fx faster)", coldDuration * 1e3 / BenchmarkIterations, warmDuration * 1e3 / BenchmarkIterations, coldDuration / warmDuration];
+    NSString *sizeResult = [NSString stringWithFormat:@"Startup cache entry: %llu bytes for %llu bytes of scml", entrySize, fileSize];
+    return @[startupResult, sizeResult];
+}
+
+- (NSArray *)benchmarkSconParsing {
+    // both files hold the same data, so the parsers have to build the same tree
+    unsigned long long scmlPeakBytes = 0;
+    unsigned long long sconPeakBytes = 0;
+    NSUInteger scmlKeyCount = 0;
+    NSUInteger sconKeyCount = 0;
+    NSTimeInterval scmlDuration = [self parseDurationForParser:[INSKScmlParser class] peakBytes:&scmlPeakBytes keyCount:&scmlKeyCount];
+    NSTimeInterval sconDuration = [self parseDurationForParser:[INSKSconParser class] peakBytes:&sconPeakBytes keyCount:&sconKeyCount];
+    NSAssert(scmlKeyCount == sconKeyCount, @"The scml and scon parsers created different trees");
+    
+    NSString *timeResult = [NSString stringWithFormat:@"Parse player: scml %.2f ms, scon %.2f ms (%.1fx faster)", scmlDuration * 1e3, sconDuration * 1e3, scmlDuration / sconDuration];
+    NSString *memoryResult = @"Parse player peak memory: n/a";
+    if (scmlPeakBytes > 0 && sconPeakBytes > 0) {
+        memoryResult = [NSString stringWithFormat:@"Parse player peak memory: scml %.1f KB, scon %.1f KB (%.1fx less)", scmlPeakBytes / 1024.0, sconPeakBytes / 1024.0, (double)scmlPeakBytes / sconPeakBytes];
+    }
+    return @[timeResult, memoryResult];
+}
+
+// Parses the player file with new parsers of the given class and returns the average parse time.
+// The peak heap usage of one parse or 0 if not measurable and the number of keys in the resulting tree are returned by reference.
+- (NSTimeInterval)parseDurationForParser:(Class)parserClass peakBytes:(unsigned long long *)peakBytes keyCount:(NSUInteger *)keyCount {
+    // the first parse measures the memory of this thread including the file content and the tree
+    BOOL counting = AllocationCounterStart();
+    @autoreleasepool {
+        INSKSpriterParser *parser = [[parserClass alloc] init];
+        BOOL parsed = [parser parseFilename:@"player"];
+        AllocationCount allocations = AllocationCounterStop();
+        NSAssert(parsed, @"Failed loading the %@ file", parser.filenameExtension);
+        *peakBytes = (counting ? allocations.peakBytes : 0);
+        *keyCount = [self keyCountOfSpriterData:parser.spriterData];
+        if (!parsed) {
+            return 0.0;
+        }
+    }
+    
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSUInteger iteration = 0; iteration < BenchmarkIterations; ++iteration) {
+        @autoreleasepool {
+            INSKSpriterParser *parser = [[parserClass alloc] init];
+            BOOL parsed = [parser parseFilename:@"player"];
+            NSAssert(parsed, @"Failed loading the %@ file", parser.filenameExtension);
+            if (!parsed) {
+                return 0.0;
+            }
+        }
+    }
+    CFTimeInterval duration = CACurrentMediaTime() - startTime;
+    return duration / BenchmarkIterations;
+}
+
+// Returns the number of mainline and timeline keys of all animations in the tree.
+- (NSUInteger)keyCountOfSpriterData:(SpriterData *)spriterData {
+    NSUInteger count = 0;
+    for (SpriterEntity *entity in spriterData.entities) {
+        for (SpriterAnimation *animation in entity.animations) {
+            count += animation.mainline.keys.count;
+            for (SpriterTimeline *timeline in animation.timelines) {
+                count += timeline.keys.count;
+            }
+        }
+    }
+    return count;
+}
+
+// Loads a file with a new parser using the cache and returns the time until the animation data is ready.
+- (NSTimeInterval)startupDurationForFile:(NSString *)filename cacheDirectory:(NSString *)cacheDirectory {
+    CFTimeInterval startTime = CACurrentMediaTime();
+    INSKScmlParser *scmlParser = [[INSKScmlParser alloc] init];
+    scmlParser.cacheDirectory = cacheDirectory;
+    BOOL parsed = [scmlParser parseFilename:filename];
+    NSAssert(parsed, @"Failed loading the scml file");
+    if (!parsed) {
+        return 0.0;
+    }
+    INSKAMData *data = [scmlParser animationData];
+    CFTimeInterval duration = CACurrentMediaTime() - startTime;
+    NSAssert(data != nil, @"animation data expected");
+    return duration;
+}
+
+// Evaluates the actors for some ticks and returns the average time of evaluating one actor.
+- (NSTimeInterval)durationForEvaluator:(INSKAMCollisionEvaluator *)evaluator actors:(INSKAMCollisionActor *)actors {
+    NSUInteger frameCount = BenchmarkIterations * BenchmarkFramesPerSecond / 10;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSUInteger frame = 0; frame < frameCount; ++frame) {
+        for (NSUInteger actorIndex = 0; actorIndex < BenchmarkActorCount; ++actorIndex) {
+            actors[actorIndex].time += INSKAMTicksPerSecond / BenchmarkFramesPerSecond;
+        }
+        [evaluator evaluateActors:actors count:BenchmarkActorCount];
+    }
+    CFTimeInterval duration = CACurrentMediaTime() - startTime;
+    return duration / (frameCount * BenchmarkActorCount);
+}
+
+// Plays the walk animation on some nodes frame by frame and returns the average time of updating one node for one frame.
+- (NSTimeInterval)playbackDurationForManager:(INSKAnimationManager *)manager flattened:(BOOL)flattened nodeCount:(NSUInteger *)nodeCount {
+    NSMutableArray *animationNodes = [NSMutableArray arrayWithCapacity:BenchmarkNodeCount];
+    for (NSUInteger index = 0; index < BenchmarkNodeCount; ++index) {
+        INSKAnimationNode *animationNode = [INSKAnimationNode node];
+        animationNode.flattenedRendering = flattened;
+        [animationNode loadEntity:@"Player" fromManager:manager];
+        [animationNode playAnimation:@"walk"];
+        [animationNodes addObject:animationNode];
+    }
+    
+    NSUInteger frameCount = BenchmarkIterations * BenchmarkFramesPerSecond;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSUInteger frame = 0; frame < frameCount; ++frame) {
+        for (INSKAnimationNode *animationNode in animationNodes) {
+            [animationNode updateTime:1.0 / BenchmarkFramesPerSecond];
+        }
+    }
+    CFTimeInterval duration = CACurrentMediaTime() - startTime;
+    
+    *nodeCount = [self descendantCountOfNode:animationNodes.firstObject];
+    for (INSKAnimationNode *animationNode in animationNodes) {
+        [manager removeAnimationNode:animationNode];
+    }
+    return duration / (frameCount * BenchmarkNodeCount);
+}
+
+// Plays all animations with a cursor per timeline and returns the time needed for all lookups.
+- (NSTimeInterval)timelineLookupDurationForData:(INSKAMData *)data lookupCount:(NSUInteger *)lookupCount {
+    NSMutableArray *animations = [NSMutableArray array];
+    NSMutableArray *animationCursors = [NSMutableArray array];
+    for (INSKAMEntity *entity in data.entitiesByName.allValues) {
+        for (INSKAMAnimation *animation in entity.animationsByName.allValues) {
+            NSMutableArray *cursors = [NSMutableArray array];
+            for (INSKAMTimeline *timeline in animation.timelinesById.allValues) {
+                [cursors addObject:[[INSKAMTimelineCursor alloc] initWithTimeline:timeline]];
+            }
+            [animations addObject:animation];
+            [animationCursors addObject:cursors];
+        }
+    }
+    
+    NSUInteger count = 0;
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSUInteger iteration = 0; iteration < BenchmarkIterations; ++iteration) {
+        for (NSUInteger animationIndex = 0; animationIndex < animations.count; ++animationIndex) {
+            INSKAMAnimation *animation = animations[animationIndex];
+            NSArray *cursors = animationCursors[animationIndex];
+            NSUInteger frameCount = animation.length * BenchmarkFramesPerSecond / INSKAMTicksPerSecond;
+            for (NSUInteger frame = 0; frame <= frameCount; ++frame) {
+                INSKAMTicks time = frame * INSKAMTicksPerSecond / BenchmarkFramesPerSecond;
+                for (INSKAMTimelineCursor *cursor in cursors) {
+                    [cursor spatialForTime:time];
+                    ++count;
+                }
+            }
+        }
+    }
+    CFTimeInterval duration = CACurrentMediaTime() - startTime;
+    
+    *lookupCount = count;
+    return duration;
+}
+
+
+@end
@@ -0,0 +1,78 @@
+// PlaybackBenchmark.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+/// The results of one run of a PlaybackBenchmark.
+typedef struct {
+    /// The number of played instances.
+    NSUInteger instanceCount;
+    /// The number of played frames.
+    NSUInteger frameCount;
+    /// The average time in nanoseconds for updating one instance for one frame.
+    double nanosecondsPerInstanceFrame;
+    /// The median time in microseconds for updating all instances for one frame.
+    double medianFrameTime;
+    /// The 99th percentile time in microseconds for updating all instances for one frame.
+    double p99FrameTime;
+    /// The average number of memory allocations of the benchmark's thread per frame or a negative value if allocations can't be counted on this platform.
+    double allocationsPerFrame;
+} PlaybackBenchmarkResult;
+
+
+/**
+ A headless benchmark which plays many animation nodes through the animation manager without adding them to a scene.
+ 
+ Each instance is an INSKAnimationNode with flattened rendering, which plays an animation of the loaded data with its own speed, which may be negative,
+ and its own start time, and switches to another animation of its entity after a number of frames if wanted.
+ The frames are played by the managers' update: like a scene does, so the results include the time handling, the mainline keys, the evaluation and the applying of the poses to the nodes.
+ The managers get a null texture loader, so the sprite nodes have no textures and nothing is loaded or rendered.
+ Non-looping animations stop at their end like they do in a game.
+ The random numbers are seeded, so runs with the same settings are repeatable.
+ 
+ Allocations are counted by hooking the default malloc zone on Apple platforms, only the allocations of the thread running the benchmark are counted.
+ */
+@interface PlaybackBenchmark : NSObject
+
+/**
+ Initializes a benchmark with the animations of all entities of some animation data.
+ 
+ @param animationData An array of INSKAMData objects, e.g. of player.scml and BasicTests.scml.
+ */
+- (instancetype)initWithAnimationData:(NSArray *)animationData;
+
+/// The frames per second of the simulated playback, defaults to 60.
+@property (nonatomic, assign) NSUInteger framesPerSecond;
+/// The number of frames between two animation switches of an instance or 0 for never switching, defaults to 0.
+@property (nonatomic, assign) NSUInteger switchInterval;
+/// The maximum absolute playback speed of an instance, the speeds are spread from -maximumSpeed to maximumSpeed, defaults to 2.
+@property (nonatomic, assign) double maximumSpeed;
+
+/**
+ Creates the instances and plays them for some frames.
+ 
+ @param instanceCount The number of instances, i.e. 1 to 10000.
+ @param frameCount The number of frames to play.
+ @return The measured results.
+ */
+- (PlaybackBenchmarkResult)runWithInstanceCount:(NSUInteger)instanceCount frameCount:(NSUInteger)frameCount;
+
+@end
@@ -0,0 +1,226 @@
+// PlaybackBenchmark.m
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "PlaybackBenchmark.h"
+#import "INSKAMHeaders.h"
+#import "INSKAnimationManager.h"
+#import "INSKAnimationNode.h"
+#import "AllocationCounter.h"
+#import <QuartzCore/QuartzCore.h>
+
+
+// Compares two frame times for sorting.
+static int PlaybackBenchmarkCompareTimes(const void *a, const void *b) {
+    double time1 = *(const double *)a;
+    double time2 = *(const double *)b;
+    return (time1 < time2 ? -1 : (time1 > time2 ? 1 : 0));
+}
+
+
+#pragma mark - PlaybackBenchmarkEntity
+
+// An entity whose animations are played by the instances.
+@interface PlaybackBenchmarkEntity : NSObject
+
+// The manager of the entity's animation data.
+@property (nonatomic, strong) INSKAnimationManager *animationManager;
+// The name of the entity.
+@property (nonatomic, copy) NSString *entityName;
+// The names of the playable animations in alphabetical order.
+@property (nonatomic, strong) NSArray *animationNames;
+
+@end
+
+
+@implementation PlaybackBenchmarkEntity
+
+@end
+
+
+#pragma mark - PlaybackBenchmarkInstance
+
+// An animation node played by the benchmark.
+@interface PlaybackBenchmarkInstance : NSObject
+
+// The node playing the animation.
+@property (nonatomic, strong) INSKAnimationNode *animationNode;
+// The entity of the node.
+@property (nonatomic, strong) PlaybackBenchmarkEntity *entity;
+// The frame of the next animation switch.
+@property (nonatomic, assign) NSUInteger switchFrame;
+
+@end
+
+
+@implementation PlaybackBenchmarkInstance
+
+@end
+
+
+#pragma mark - PlaybackBenchmark
+
+@interface PlaybackBenchmark () <INSKAMTextureLoader>
+
+// The PlaybackBenchmarkEntity objects of all entities with playable animations.
+@property (nonatomic, strong) NSArray *entities;
+// The entity of each playable animation, so the animations are chosen evenly.
+@property (nonatomic, strong) NSArray *animationEntities;
+// The index of each playable animation in its entity's animationNames.
+@property (nonatomic, strong) NSArray *animationNameIndexes;
+// The state of the pseudo random number generator.
+@property (nonatomic, assign) uint32_t randomState;
+
+@end
+
+
+@implementation PlaybackBenchmark
+
+- (instancetype)initWithAnimationData:(NSArray *)animationData {
+    self = [super init];
+    if (self == nil) return self;
+    
+    NSMutableArray *entities = [NSMutableArray array];
+    NSMutableArray *animationEntities = [NSMutableArray array];
+    NSMutableArray *animationNameIndexes = [NSMutableArray array];
+    for (INSKAMData *data in animationData) {
+        INSKAnimationManager *animationManager = [[INSKAnimationManager alloc] initWithAnimationData:data textureLoader:self];
+        // the order of the dictionaries isn't stable, but the random choices should be
+        NSArray *entityNames = [data.entitiesByName.allKeys sortedArrayUsingSelector:@selector(compare:)];
+        for (NSString *entityName in entityNames) {
+            INSKAMEntity *entity = data.entitiesByName[entityName];
+            NSMutableArray *animationNames = [NSMutableArray array];
+            for (INSKAMAnimation *animation in entity.animationsByName.allValues) {
+                if (animation.length > 0 && animation.mainlineKeys.count > 0) {
+                    [animationNames addObject:animation.name];
+                }
+            }
+            if (animationNames.count == 0) {
+                continue;
+            }
+            [animationNames sortUsingSelector:@selector(compare:)];
+            PlaybackBenchmarkEntity *benchmarkEntity = [[PlaybackBenchmarkEntity alloc] init];
+            benchmarkEntity.animationManager = animationManager;
+            benchmarkEntity.entityName = entityName;
+            benchmarkEntity.animationNames = animationNames;
+            [entities addObject:benchmarkEntity];
+            for (NSUInteger index = 0; index < animationNames.count; ++index) {
+                [animationEntities addObject:benchmarkEntity];
+                [animationNameIndexes addObject:@(index)];
+            }
+        }
+    }
+    NSAssert(animationEntities.count > 0, @"animations expected");
+    self.entities = entities;
+    self.animationEntities = animationEntities;
+    self.animationNameIndexes = animationNameIndexes;
+    self.framesPerSecond = 60;
+    self.maximumSpeed = 2.0;
+    
+    return self;
+}
+
+- (PlaybackBenchmarkResult)runWithInstanceCount:(NSUInteger)instanceCount frameCount:(NSUInteger)frameCount {
+    self.randomState = 12345;
+    
+    // nodes with spread animations, speeds and phases
+    NSMutableArray *instances = [NSMutableArray arrayWithCapacity:instanceCount];
+    for (NSUInteger index = 0; index < instanceCount; ++index) {
+        NSUInteger animationIndex = (NSUInteger)([self randomValue] * self.animationEntities.count);
+        PlaybackBenchmarkEntity *entity = self.animationEntities[animationIndex];
+        PlaybackBenchmarkInstance *instance = [[PlaybackBenchmarkInstance alloc] init];
+        instance.entity = entity;
+        instance.animationNode = [INSKAnimationNode node];
+        instance.animationNode.flattenedRendering = YES;
+        [instance.animationNode loadEntity:entity.entityName fromManager:entity.animationManager];
+        [instance.animationNode playAnimation:entity.animationNames[[self.animationNameIndexes[animationIndex] unsignedIntegerValue]]];
+        instance.animationNode.currentAnimationTime = [self randomValue] * instance.animationNode.animationLength;
+        instance.animationNode.animationSpeed = ([self randomValue] * 2.0 - 1.0) * self.maximumSpeed;
+        instance.switchFrame = (self.switchInterval > 0 ? (NSUInteger)([self randomValue] * self.switchInterval) + 1 : NSNotFound);
+        [instances addObject:instance];
+    }
+    NSMutableSet *animationManagers = [NSMutableSet set];
+    for (PlaybackBenchmarkEntity *entity in self.entities) {
+        [animationManagers addObject:entity.animationManager];
+    }
+    
+    // the managers start with a frame without a time step
+    NSTimeInterval frameDuration = 1.0 / self.framesPerSecond;
+    NSTimeInterval currentTime = 1.0;
+    for (INSKAnimationManager *animationManager in animationManagers) {
+        [animationManager update:currentTime];
+    }
+    
+    NSMutableData *frameTimeData = [NSMutableData dataWithLength:frameCount * sizeof(double)];
+    double *frameTimes = frameTimeData.mutableBytes;
+    BOOL countingAllocations = AllocationCounterStart();
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSUInteger frame = 0; frame < frameCount; ++frame) {
+        CFTimeInterval frameStartTime = CACurrentMediaTime();
+        @autoreleasepool {
+            for (PlaybackBenchmarkInstance *instance in instances) {
+                if (frame == instance.switchFrame) {
+                    NSArray *animationNames = instance.entity.animationNames;
+                    [instance.animationNode playAnimation:animationNames[(NSUInteger)([self randomValue] * animationNames.count)]];
+                    instance.switchFrame += self.switchInterval;
+                }
+            }
+            currentTime += frameDuration;
+            for (INSKAnimationManager *animationManager in animationManagers) {
+                [animationManager update:currentTime];
+            }
+        }
+        frameTimes[frame] = CACurrentMediaTime() - frameStartTime;
+    }
+    CFTimeInterval duration = CACurrentMediaTime() - startTime;
+    NSUInteger allocations = AllocationCounterStop().count;
+    
+    qsort(frameTimes, frameCount, sizeof(double), PlaybackBenchmarkCompareTimes);
+    PlaybackBenchmarkResult result;
+    result.instanceCount = instanceCount;
+    result.frameCount = frameCount;
+    result.nanosecondsPerInstanceFrame = duration * 1e9 / (instanceCount * frameCount);
+    result.medianFrameTime = frameTimes[frameCount / 2] * 1e6;
+    result.p99FrameTime = frameTimes[MIN(frameCount - 1, frameCount * 99 / 100)] * 1e6;
+    result.allocationsPerFrame = (countingAllocations ? (double)allocations / frameCount : -1.0);
+    return result;
+}
+
+
+#pragma mark - Animation manager TextureLoader methods
+
+- (SKTexture *)textureNamed:(NSString *)textureName path:(NSString *)path {
+    // nothing is rendered, so the sprites need no textures
+    return nil;
+}
+
+
+#pragma mark - private methods
+
+// Returns a pseudo random number from 0 up to 1 exclusive.
+- (double)randomValue {
+    // a linear congruential generator is good enough for spreading the instances
+    self.randomState = self.randomState * 1664525 + 1013904223;
+    return (self.randomState >> 8) / (double)(1 << 24);
+}
+
+@end
@@ -25,7 +25,7 @@
 
 /**
  A simple animation with the change of the sprite's Z-order.
- This is not yet supported by INSpriterKit.
+ The Z-order is applied through the sprites' zPosition without changing the node tree.
  */
 @interface ZOrderChanges : BasicTestScene
 
@@ -32,7 +32,7 @@
     // label
     SKLabelNode *label = [SKLabelNode labelNodeWithFontNamed:@"ChalkboardSE-Regular"];
     label.fontSize = 20;
-    label.text = @"The Z-order of some parts should change, but that's not implemented.";
+    label.text = @"The Z-order of some parts changes.";
     label.position = CGPointMake(0, size.height / 2 - 100);
     [self addChild:label];
     
@@ -22,8 +22,12 @@
 
 
 #import <XCTest/XCTest.h>
+#import "INSpriterKit.h"
+#import "INSKAMHeaders.h"
+#import "AllocationCounter.h"
 
-@interface Tests : XCTestCase
+
+@interface Tests : XCTestCase <INSKAMTextureLoader>
 
 @end
 
@@ -46,5 +50,216 @@
     XCTAssert(NO, @"No tests implemented, start the example app instead!");
 }
 
+- (void)test_steadyStatePlaybackDoesNotAllocate {
+    INSKScmlParser *scmlParser = [[INSKScmlParser alloc] init];
+    XCTAssert([scmlParser parseFilename:@"player"], @"Failed loading the scml file");
+    INSKAnimationManager *animationManager = [[INSKAnimationManager alloc] initWithAnimationData:[scmlParser animationData] textureLoader:self];
+    
+    NSMutableArray *animationNodes = [NSMutableArray array];
+    NSArray *animationNames = @[@"idle", @"walk", @"jump_loop"];
+    for (NSUInteger index = 0; index < 30; ++index) {
+        INSKAnimationNode *animationNode = [INSKAnimationNode node];
+        animationNode.flattenedRendering = (index % 2 == 1);
+        XCTAssert([animationNode loadEntity:@"Player" fromManager:animationManager], @"Failed loading the entity");
+        XCTAssert([animationNode playAnimation:animationNames[index % animationNames.count]], @"Failed playing the animation");
+        animationNode.animationSpeed = 1.0 + index * 0.1;
+        [animationNodes addObject:animationNode];
+    }
+    
+    // warm up, so every cursor, texture and buffer has been touched at least once
+    NSTimeInterval currentTime = 1.0;
+    for (NSUInteger frame = 0; frame < 300; ++frame) {
+        @autoreleasepool {
+            [animationManager update:currentTime];
+        }
+        currentTime += 1.0 / 60;
+    }
+    
+    if (!AllocationCounterStart()) {
+        NSLog(@"Allocations can't be counted, skipping the test");
+        return;
+    }
+    for (NSUInteger frame = 0; frame < 3000; ++frame) {
+        @autoreleasepool {
+            [animationManager update:currentTime];
+        }
+        currentTime += 1.0 / 60;
+    }
+    NSUInteger allocationCount = AllocationCounterStop().count;
+    XCTAssertEqual(allocationCount, (NSUInteger)0, @"Steady state playback allocated memory");
+}
+
+- (void)test_switchingAnimationsDoesNotAllocate {
+    INSKScmlParser *scmlParser = [[INSKScmlParser alloc] init];
+    XCTAssert([scmlParser parseFilename:@"player"], @"Failed loading the scml file");
+    INSKAnimationManager *animationManager = [[INSKAnimationManager alloc] initWithAnimationData:[scmlParser animationData] textureLoader:self];
+    
+    // the flattened mode never reparents, so Sprite Kit doesn't allocate for the children arrays
+    INSKAnimationNode *animationNode = [INSKAnimationNode node];
+    animationNode.flattenedRendering = YES;
+    XCTAssert([animationNode loadEntity:@"Player" fromManager:animationManager], @"Failed loading the entity");
+    NSArray *animationNames = @[@"idle", @"walk", @"jump_loop"];
+    
+    // warm up, so each object has its node and both cursor pools have been bound to each animation
+    NSTimeInterval currentTime = 1.0;
+    for (NSUInteger index = 0; index < 30; ++index) {
+        @autoreleasepool {
+            XCTAssert([animationNode playAnimation:animationNames[index % animationNames.count] blendDuration:0.1], @"Failed playing the animation");
+            [animationManager update:currentTime];
+        }
+        currentTime += 1.0 / 60;
+    }
+    
+    if (!AllocationCounterStart()) {
+        NSLog(@"Allocations can't be counted, skipping the test");
+        return;
+    }
+    for (NSUInteger index = 0; index < 300; ++index) {
+        @autoreleasepool {
+            [animationNode playAnimation:animationNames[index % animationNames.count] blendDuration:0.1];
+            [animationManager update:currentTime];
+        }
+        currentTime += 1.0 / 60;
+    }
+    NSUInteger allocationCount = AllocationCounterStop().count;
+    XCTAssertEqual(allocationCount, (NSUInteger)0, @"Switching the animation allocated memory");
+}
+
+- (void)test_restoringPlaybackStatesRewindsTheNodes {
+    INSKScmlParser *scmlParser = [[INSKScmlParser alloc] init];
+    XCTAssert([scmlParser parseFilename:@"player"], @"Failed loading the scml file");
+    INSKAnimationManager *animationManager = [[INSKAnimationManager alloc] initWithAnimationData:[scmlParser animationData] textureLoader:self];
+    animationManager.sleepScheduling = YES;
+    
+    INSKAnimationNode *walkingNode = [INSKAnimationNode node];
+    XCTAssert([walkingNode loadEntity:@"Player" fromManager:animationManager], @"Failed loading the entity");
+    XCTAssert([walkingNode playAnimation:@"walk"], @"Failed playing the animation");
+    INSKAnimationNode *stoppedNode = [INSKAnimationNode node];
+    XCTAssert([stoppedNode loadEntity:@"Player" fromManager:animationManager], @"Failed loading the entity");
+    XCTAssert([stoppedNode playAnimation:@"idle"], @"Failed playing the animation");
+    
+    // the stopped node falls asleep once the events of the first frame are passed
+    NSTimeInterval currentTime = 1.0;
+    for (NSUInteger frame = 0; frame < 20; ++frame) {
+        if (frame == 10) {
+            stoppedNode.animationSpeed = 0.0;
+        }
+        [animationManager update:currentTime];
+        currentTime += 1.0 / 60;
+    }
+    NSMutableData *states = [NSMutableData dataWithLength:animationManager.playbackStateCount * sizeof(INSKAnimationNodeState)];
+    [animationManager savePlaybackStates:states.mutableBytes];
+    INSKAMTicks walkingTicks = walkingNode.currentAnimationTicks;
+    
+    // the saved node keeps sleeping and the later switch is rolled back
+    XCTAssert(animationManager.sleepingNodeCount > 0, @"The stopped node should sleep");
+    [stoppedNode playAnimation:@"walk"];
+    for (NSUInteger frame = 0; frame < 10; ++frame) {
+        [animationManager update:currentTime];
+        currentTime += 1.0 / 60;
+    }
+    XCTAssertEqual([animationManager restorePlaybackStates:states.bytes count:animationManager.playbackStateCount], (NSUInteger)2, @"Not all nodes have been restored");
+    XCTAssertEqual(walkingNode.currentAnimationTicks, walkingTicks, @"The time hasn't been restored");
+    XCTAssertEqualObjects(stoppedNode.currentAnimationName, @"idle", @"The animation hasn't been restored");
+    XCTAssertEqual(stoppedNode.animationSpeed, (CGFloat)0.0, @"The speed hasn't been restored");
+}
+
+- (void)test_deallocatedNodesReturnTheirStateSlots {
+    INSKScmlParser *scmlParser = [[INSKScmlParser alloc] init];
+    XCTAssert([scmlParser parseFilename:@"player"], @"Failed loading the scml file");
+    INSKAnimationManager *animationManager = [[INSKAnimationManager alloc] initWithAnimationData:[scmlParser animationData] textureLoader:self];
+    animationManager.sleepScheduling = YES;
+    
+    INSKAnimationNode *keptNode = [INSKAnimationNode node];
+    XCTAssert([keptNode loadEntity:@"Player" fromManager:animationManager], @"Failed loading the entity");
+    XCTAssert([keptNode playAnimation:@"walk"], @"Failed playing the animation");
+    
+    // spawned nodes are dropped without removing them, the stopped ones while sleeping
+    NSUInteger nodesPerRound = 10;
+    NSTimeInterval currentTime = 1.0;
+    for (NSUInteger round = 0; round < 100; ++round) {
+        @autoreleasepool {
+            NSMutableArray *spawnedNodes = [NSMutableArray arrayWithCapacity:nodesPerRound];
+            for (NSUInteger index = 0; index < nodesPerRound; ++index) {
+                INSKAnimationNode *animationNode = [INSKAnimationNode node];
+                XCTAssert([animationNode loadEntity:@"Player" fromManager:animationManager], @"Failed loading the entity");
+                XCTAssert([animationNode playAnimation:@"idle"], @"Failed playing the animation");
+                if (index % 2 == 0) {
+                    animationNode.animationSpeed = 0.0;
+                }
+                [spawnedNodes addObject:animationNode];
+            }
+            for (NSUInteger frame = 0; frame < 5; ++frame) {
+                [animationManager update:currentTime];
+                currentTime += 1.0 / 60;
+            }
+        }
+    }
+    XCTAssert(animationManager.playbackStateCount <= 2 * (nodesPerRound + 1), @"The slots of deallocated nodes haven't been reused");
+    
+    // only the kept node is restored
+    NSMutableData *states = [NSMutableData dataWithLength:animationManager.playbackStateCount * sizeof(INSKAnimationNodeState)];
+    [animationManager savePlaybackStates:states.mutableBytes];
+    XCTAssertEqual([animationManager restorePlaybackStates:states.bytes count:animationManager.playbackStateCount], (NSUInteger)1, @"Only the kept node should be restored");
+    XCTAssertEqualObjects(keptNode.currentAnimationName, @"walk", @"The kept node has lost its state");
+}
+
+- (void)test_collectedEventsIncludeTheEndTimeOnly {
+    INSKAMAnimation *animation = [self eventAnimation];
+    XCTAssertEqualObjects([self eventNamesOfAnimation:animation fromTime:0 toTime:500], (@[@"middle"]), @"Wrong events within the loop");
+    XCTAssertEqualObjects([self eventNamesOfAnimation:animation fromTime:500 toTime:1000], (@[@"end", @"start"]), @"Wrong events up to the loop point");
+    XCTAssertEqualObjects([self eventNamesOfAnimation:animation fromTime:1000 toTime:1500], (@[@"middle"]), @"Events at the loop point passed twice");
+    
+    XCTAssertEqualObjects([self eventNamesOfAnimation:animation fromTime:600 toTime:0], (@[@"middle", @"start", @"end"]), @"Wrong events backwards down to the loop point");
+    XCTAssertEqualObjects([self eventNamesOfAnimation:animation fromTime:0 toTime:-600], (@[@"middle"]), @"Events at the loop point passed twice backwards");
+}
+
+- (void)test_collectedEventsWrapAroundTheLoop {
+    INSKAMAnimation *animation = [self eventAnimation];
+    XCTAssertEqualObjects([self eventNamesOfAnimation:animation fromTime:900 toTime:1100], (@[@"end", @"start"]), @"Wrong events wrapping forward");
+    XCTAssertEqualObjects([self eventNamesOfAnimation:animation fromTime:100 toTime:-100], (@[@"start", @"end"]), @"Wrong events wrapping backwards");
+}
+
+- (void)test_collectedEventsSpanSeveralLoops {
+    INSKAMAnimation *animation = [self eventAnimation];
+    NSArray *forwardNames = @[@"middle", @"end", @"start", @"middle", @"end", @"start", @"middle"];
+    XCTAssertEqualObjects([self eventNamesOfAnimation:animation fromTime:400 toTime:2600], forwardNames, @"Wrong events jumping forward");
+    NSArray *backwardNames = @[@"middle", @"start", @"end", @"middle", @"start", @"end", @"middle"];
+    XCTAssertEqualObjects([self eventNamesOfAnimation:animation fromTime:2600 toTime:400], backwardNames, @"Wrong events jumping backwards");
+}
+
+
+#pragma mark - helper
+
+// Returns a looping animation of 1000 ticks with the events "start" at 0, "middle" at 500 and "end" at 1000.
+- (INSKAMAnimation *)eventAnimation {
+    INSKAMAnimation *animation = [[INSKAMAnimation alloc] init];
+    animation.length = 1000;
+    animation.looping = YES;
+    INSKAMEvent events[] = {{0, 0}, {500, 1}, {1000, 2}};
+    animation.events = [NSData dataWithBytes:events length:sizeof(events)];
+    animation.eventNames = @[@"start", @"middle", @"end"];
+    return animation;
+}
+
+// Returns the names of the events passed from one time to another in the order of delivery.
+- (NSArray *)eventNamesOfAnimation:(INSKAMAnimation *)animation fromTime:(INSKAMTicks)startTime toTime:(INSKAMTicks)endTime {
+    NSMutableData *passedEvents = [NSMutableData data];
+    [animation collectEventsFromTime:startTime toTime:endTime looping:animation.looping passedEvents:passedEvents];
+    const INSKAMEvent *events = passedEvents.bytes;
+    NSMutableArray *names = [NSMutableArray array];
+    for (NSUInteger index = 0; index < passedEvents.length / sizeof(INSKAMEvent); ++index) {
+        [names addObject:animation.eventNames[events[index].eventlineIndex]];
+    }
+    return names;
+}
+
+
+#pragma mark - Animation manager TextureLoader methods
+
+- (SKTexture *)textureNamed:(NSString *)textureName path:(NSString *)path {
+    return [SKTexture textureWithImageNamed:textureName];
+}
+
 
 @end
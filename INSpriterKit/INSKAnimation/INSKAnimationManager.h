@@ -22,12 +22,26 @@
 
 
 #import "INSKAMTextureLoader.h"
+#import "INSKAMTypes.h"
+#import "INSKAnimationStatistics.h"
+#import "INSKAnimationNodeState.h"
 
 
 @class INSKAMData;
 @class INSKAnimationNode;
 @class INSKAMEntity;
 @class INSKAMAnimation;
+@class INSKAMTexture;
+@class SKNode;
+
+
+/**
+ A block which returns the updateFrameInterval for an animation node.
+ 
+ @param animationNode The animation node to rate.
+ @return The number of frames between two node updates, 1 for each frame or 0 for freezing the node tree.
+ */
+typedef NSUInteger (^INSKAnimationLODPolicy)(INSKAnimationNode *animationNode);
 
 
 
@@ -99,6 +113,170 @@
 - (void)update:(NSTimeInterval)currentTime;
 
 
+#pragma mark - Level of detail
+/// @name Level of detail
+
+/**
+ An optional block which assigns each animation node its updateFrameInterval before the node is updated, defaults to nil.
+ 
+ Without a policy the nodes keep their own updateFrameInterval, which can be set by the game logic, e.g. by the importance of the game object.
+ A policy is called for each node each frame, so it should be cheap.
+ 
+ @see [INSKAnimationNode updateFrameInterval]
+ @see distanceLODPolicyWithCenterNode:distances:
+ */
+@property (nonatomic, copy) INSKAnimationLODPolicy lodPolicy;
+
+
+/**
+ Returns a policy which reduces the update frequency of animation nodes with their distance to a center node, e.g. the player or the camera.
+ 
+ The distances are measured in the scene's coordinate space and have to be in ascending order.
+ A node nearer than the first distance is updated each frame, nearer than the second distance each second frame, and so on.
+ Nodes beyond the last distance are frozen.
+ Nodes which are not in the same scene as the center node are updated each frame.
+ The center node is not retained by the policy.
+ 
+    self.animationManager.lodPolicy = [INSKAnimationManager distanceLODPolicyWithCenterNode:self.player distances:@[@400, @800, @1600]];
+ 
+ @param centerNode The node to measure the distances from.
+ @param distances The distance thresholds as NSNumber objects in ascending order.
+ @return A policy for the lodPolicy property.
+ */
++ (INSKAnimationLODPolicy)distanceLODPolicyWithCenterNode:(SKNode *)centerNode distances:(NSArray *)distances;
+
+
+#pragma mark - Update budget
+/// @name Update budget
+
+/**
+ The maximum time in microseconds the update: method may spend on updating node trees, defaults to 0 for no limit.
+ 
+ With a budget the nodes which are due for an update are sorted by their updatePriority and updated until the budget is exhausted.
+ The remaining nodes are deferred to the next frame and come first among the nodes with the same priority, so they are updated in round-robin.
+ The animation time of deferred nodes is advanced anyway, so their playback, looping and delegate calls stay on time and only their node trees lag behind.
+ At least one node is updated each frame, so the budget is a soft cap which may be exceeded by a single node update.
+ 
+ @see deferredNodeCount
+ @see [INSKAnimationNode updatePriority]
+ */
+@property (nonatomic, assign) NSUInteger updateBudget;
+
+
+/**
+ The number of nodes whose node tree updates have been deferred by the last call of update: because the updateBudget was exhausted.
+ */
+@property (nonatomic, assign, readonly) NSUInteger deferredNodeCount;
+
+
+#pragma mark - Sleep scheduling
+/// @name Sleep scheduling
+
+/**
+ Flag for letting animation nodes sleep while nothing changes, defaults to false.
+ 
+ After each update the manager asks a node how long its node tree stays the same: until the end of a held keyframe, the next mainline key or the animation's end.
+ A node with such a hold is removed from the updates and put into a queue ordered by the wake time, so sleeping nodes cost nothing per frame.
+ When the wake time is reached, the node's time is advanced by the whole sleeping time, so loops and delegate calls stay on time.
+ Nodes with a stopped or paused animation sleep until a property like animationSpeed is changed or a new animation is played.
+ Culled nodes and nodes with deferred updates never sleep.
+ Reading the currentAnimationTime of a sleeping node returns the time it will have when woken without waking it.
+ Setting this flag to false wakes all sleeping nodes.
+ */
+@property (nonatomic, assign) BOOL sleepScheduling;
+
+
+/**
+ The number of currently sleeping animation nodes.
+ */
+@property (nonatomic, assign, readonly) NSUInteger sleepingNodeCount;
+
+
+#pragma mark - Deferred notifications
+/// @name Deferred notifications
+
+/**
+ Flag for collecting the delegate calls of the animation nodes during update: and dispatching them after all nodes are updated, defaults to false.
+ 
+ Without deferring the delegates are called in the middle of the node updates, so a delegate which plays a new animation rebuilds a node tree while the other nodes are still updated.
+ With deferring the finish, loop and event notifications of a frame are queued and dispatched in one batch after the updates.
+ The batch is ordered by the animation nodes' registration at the manager and for each node by occurrence, so the order doesn't depend on the update order.
+ The queue is reused each frame, so queueing doesn't allocate memory once it has grown to the frame's number of notifications.
+ Notifications caused outside of update:, e.g. by setting a node's time directly or by a delegate during the dispatch, are still delivered immediately.
+ */
+@property (nonatomic, assign) BOOL deferredNotifications;
+
+
+#pragma mark - Statistics
+/// @name Statistics
+
+/**
+ The statistics of the last call of update:.
+ 
+ The counters include everything happened since the previous update, e.g. texture lookups when playing a new animation.
+ Collecting the statistics costs a few integer increments per evaluated timeline and four time measurements per node update,
+ define INSK_ANIMATION_STATISTICS=0 to compile it out, the statistics stay zero then.
+ 
+ @see totalStatistics
+ */
+@property (nonatomic, assign, readonly) INSKAnimationStatistics frameStatistics;
+
+/**
+ The statistics summed over all calls of update: since the manager's creation or the last call of resetStatistics.
+ 
+ The node counts are summed over the frames, divide them by the frameCount for the average.
+ */
+@property (nonatomic, assign, readonly) INSKAnimationStatistics totalStatistics;
+
+/**
+ Sets all counters of the totalStatistics to zero.
+ */
+- (void)resetStatistics;
+
+
+#pragma mark - Playback states
+/// @name Playback states
+
+/**
+ The number of records needed for saving the playback states of all animation nodes.
+ 
+ Each added node gets a slot in the states which it keeps until it's removed or deallocated, the slots of removed nodes are reused by nodes added later.
+ A deallocated node doesn't have to be removed, its slot is reclaimed when the records would have to grow for an added node,
+ so the count stays bounded by twice the highest number of living nodes.
+ The count changes only when nodes are added, so a buffer allocated for it stays valid until then.
+ */
+@property (nonatomic, assign, readonly) NSUInteger playbackStateCount;
+
+
+/**
+ Saves the playback states of all animation nodes into a buffer.
+ 
+ The nodes play from their records in a contiguous array of the manager, so saving is one memcpy of the array and no node is called or woken.
+ The records are written at the nodes' slots, slots without a node get a record with a nodeSerial of 0.
+ Only the times of sleeping nodes are projected to the time they will have when they catch up the slept time.
+ The buffer is plain data, so keeping a history for a rollback netcode costs one memcpy of the buffer per saved frame.
+ 
+ @param states A buffer for at least playbackStateCount records.
+ */
+- (void)savePlaybackStates:(INSKAnimationNodeState *)states;
+
+
+/**
+ Restores the playback states of all animation nodes saved by savePlaybackStates:.
+ 
+ A record is only restored into the node it has been saved from, records of nodes which have been removed meanwhile are skipped
+ and nodes which have been added after saving keep their state.
+ The records are copied into the manager's array without calling the nodes, each node binds the restored animations when it's used next
+ and its node tree is updated with the next update. Restored sleeping nodes wake with the next update without catching up the slept time.
+ No delegate method is called for restoring.
+ 
+ @param states The saved playback states.
+ @param count The number of records in the buffer, which is the playbackStateCount when saving.
+ @return The number of restored nodes.
+ */
+- (NSUInteger)restorePlaybackStates:(const INSKAnimationNodeState *)states count:(NSUInteger)count;
+
+
 #pragma mark - Name gatherers
 /// @name Name gatherers
 
@@ -132,6 +310,20 @@
 - (NSDictionary *)allTextureNames;
 
 
+/**
+ Converts animations of an entity which have been loaded lazily, so playing them the first time doesn't convert them.
+ 
+ Call this method e.g. on a loading screen for the animations a level needs. It may be called on a background thread.
+ Animations not prepared are converted when a node plays them for the first time.
+ 
+ @param animationNames An array with the NSString names of the animations to prepare or nil for all animations of the entity.
+ @param entityName The name of the entity.
+ @return True if the entity exists, otherwise false.
+ @see [INSKSpriterParser lazyConversion]
+ */
+- (BOOL)prepareAnimations:(NSArray *)animationNames ofEntity:(NSString *)entityName;
+
+
 // ------------------------------------------------------------
 #pragma mark - Engine privates
 // ------------------------------------------------------------
@@ -148,6 +340,21 @@
 - (INSKAMEntity *)entityNamed:(NSString *)entityName;
 
 
+/**
+ The system time of the last update, used for projecting the time of sleeping nodes.
+ */
+@property (nonatomic, assign, readonly) NSTimeInterval lastSystemTime;
+
+
+/**
+ Returns the time a sleeping node has slept since it has fallen asleep, which it catches up when it wakes.
+ 
+ @param animationNode A sleeping animation node.
+ @return The slept time in seconds.
+ */
+- (NSTimeInterval)sleptTimeOfAnimationNode:(INSKAnimationNode *)animationNode;
+
+
 /**
  Adds a INSKAnimationNode to the management queue so the updateTime: methods will be called automatically.
  
@@ -172,6 +379,48 @@
 - (void)removeAnimationNode:(INSKAnimationNode *)animationNode;
 
 
+/**
+ Wakes a sleeping animation node so it will be updated each frame again.
+ 
+ The node's time is advanced to the last frame, which changes nothing visible because the node slept only during a hold.
+ A INSKAnimationNode wakes itself if a property affecting the playback is changed.
+ 
+ @param animationNode The sleeping animation node.
+ */
+- (void)wakeAnimationNode:(INSKAnimationNode *)animationNode;
+
+
+/**
+ Queues the notification of an animation node reaching its animation's end if notifications are deferred.
+ 
+ @param animationNode The animation node whiches animation reached the end.
+ @param looping True if the animation will be looped, otherwise false.
+ @return True if the notification has been queued, false if the node has to call its delegate immediately.
+ */
+- (BOOL)queueFinishOfAnimationNode:(INSKAnimationNode *)animationNode looping:(BOOL)looping;
+
+
+/**
+ Queues the notification of an animation node passing events if notifications are deferred.
+ 
+ The events are copied into the queue.
+ 
+ @param events The passed events.
+ @param count The number of passed events.
+ @param animationNode The animation node whiches animation passed the events.
+ @return True if the notification has been queued, false if the node has to call its delegate immediately.
+ */
+- (BOOL)queueEvents:(const INSKAMEvent *)events count:(NSUInteger)count ofAnimationNode:(INSKAnimationNode *)animationNode;
+
+
+/**
+ Returns the statistics of the running frame for the animation nodes to count into.
+ 
+ @return A pointer to the statistics which stays valid as long as the manager exists.
+ */
+- (INSKAnimationStatistics *)currentStatistics;
+
+
 /**
  Returns a SKTexture to use for a Sprite.
  
@@ -188,4 +437,16 @@
 - (SKTexture *)textureNamed:(NSString *)textureName path:(NSString *)path;
 
 
+/**
+ Returns a SKTexture to use for a Sprite.
+ 
+ Works like textureNamed:path: but uses the precomputed cache key of the texture model, so a cache hit does not allocate.
+ This is the variant the nodes call while playing.
+ 
+ @param texture The texture model of the sprite.
+ @return A SKTexture object for a sprite node to present.
+ */
+- (SKTexture *)textureForTexture:(INSKAMTexture *)texture;
+
+
 @end
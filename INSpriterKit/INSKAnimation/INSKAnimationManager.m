@@ -24,6 +24,53 @@
 #import "INSKAnimationManager.h"
 #import "INSKAnimationNode.h"
 #import "INSKAMHeaders.h"
+#import "INSKAnimationTrace.h"
+#import <QuartzCore/QuartzCore.h>
+
+
+// An entry of the sleep queue, a binary min-heap ordered by the wake time.
+typedef struct {
+    // The system time at which the node has to be updated again.
+    NSTimeInterval wakeTime;
+    // The system time of the frame the node has fallen asleep.
+    NSTimeInterval sleepTime;
+    // The state slot of the sleeping node, its weak reference in stateNodes becomes nil if the node is deallocated while sleeping.
+    NSUInteger stateSlot;
+    // The length of the node's animation in ticks, for projecting its time without calling it.
+    INSKAMTicks animationLength;
+} INSKAnimationSleepEntry;
+
+// A delegate call queued during the update.
+typedef struct {
+    // The update phase of the node, which orders the nodes by their registration.
+    NSUInteger nodePhase;
+    // The position in the queue, which orders the notifications of one node and is the index of the node in the notified nodes.
+    NSUInteger sequence;
+    // True for the finish of the animation, false for passed events.
+    BOOL finish;
+    // The looping flag of the finish notification.
+    BOOL looping;
+    // The range of the passed events in the queued events.
+    NSUInteger eventIndex;
+    NSUInteger eventCount;
+} INSKAnimationNotification;
+
+// The default capacity of the notification queue.
+static const NSUInteger INSKAnimationNotificationCapacity = 64;
+
+
+// Orders the notifications by the node's registration and then by their occurrence.
+static int INSKAnimationCompareNotifications(const void *a, const void *b) {
+    const INSKAnimationNotification *notification1 = a;
+    const INSKAnimationNotification *notification2 = b;
+    if (notification1->nodePhase != notification2->nodePhase) {
+        return (notification1->nodePhase < notification2->nodePhase ? -1 : 1);
+    }
+    if (notification1->sequence != notification2->sequence) {
+        return (notification1->sequence < notification2->sequence ? -1 : 1);
+    }
+    return 0;
+}
 
 
 @interface INSKAnimationManager ()
@@ -34,15 +81,53 @@
 @property (nonatomic, strong) INSKAMData *animationData;
 // Weak references of all animation nodes.
 @property (nonatomic, strong) NSHashTable *animationNodes;
+// Weak references of the animation nodes which are not sleeping and updated each frame.
+@property (nonatomic, strong) NSHashTable *awakeNodes;
+// The INSKAnimationSleepEntry records of the sleeping nodes as min-heap.
+@property (nonatomic, strong) NSMutableData *sleepQueue;
+// The nodes which may fall asleep after the current frame's updates.
+@property (nonatomic, strong) NSMutableArray *idleNodes;
+// The nodes woken while the awake nodes are updated, they are added after the updates.
+@property (nonatomic, strong) NSMutableArray *wokenNodes;
+// True while the awake nodes are updated.
+@property (nonatomic, assign) BOOL updatingNodes;
 // The last update's system time.
-@property (nonatomic, assign) NSTimeInterval lastSystemTime;
+@property (nonatomic, assign, readwrite) NSTimeInterval lastSystemTime;
 // The currently used textures in a cache, each new accessed NSTexture objects will be put here
 @property (nonatomic, strong) NSMapTable *textureCache;
+// The number of updates, used for spreading the node updates over the frames.
+@property (nonatomic, assign) NSUInteger frameCount;
+// The update phase for the next added animation node.
+@property (nonatomic, assign) NSUInteger nextUpdatePhase;
+// The nodes due for an update in the current frame if there is an update budget.
+@property (nonatomic, strong) NSMutableArray *budgetedNodes;
+@property (nonatomic, assign, readwrite) NSUInteger deferredNodeCount;
+// True while the delegate calls of the nodes are queued.
+@property (nonatomic, assign) BOOL queueingNotifications;
+// The INSKAnimationNotification records of the current update.
+@property (nonatomic, strong) NSMutableData *notificationQueue;
+// The INSKAMEvent records of the queued notifications.
+@property (nonatomic, strong) NSMutableData *queuedEventData;
+// The nodes of the queued notifications, retained until the notifications are dispatched.
+@property (nonatomic, strong) NSMutableArray *notifiedNodes;
+// Weak references of the animation nodes by their playback state slot.
+@property (nonatomic, strong) NSPointerArray *stateNodes;
+// The INSKAnimationNodeState records the nodes play from by their slot, its length is the capacity for nodes.
+@property (nonatomic, strong) NSMutableData *stateData;
+// The slots of removed nodes to reuse.
+@property (nonatomic, strong) NSMutableIndexSet *freeStateSlots;
+// The serial number for the next added animation node.
+@property (nonatomic, assign) NSUInteger nextStateSerial;
+@property (nonatomic, assign, readwrite) INSKAnimationStatistics frameStatistics;
+@property (nonatomic, assign, readwrite) INSKAnimationStatistics totalStatistics;
 
 @end
 
 
-@implementation INSKAnimationManager
+@implementation INSKAnimationManager {
+    // The statistics of the running frame.
+    INSKAnimationStatistics _currentStatistics;
+}
 
 - (instancetype)initWithAnimationData:(INSKAMData *)animationData textureLoader:(id<INSKAMTextureLoader>)textureLoader {
     self = [super init];
@@ -53,24 +138,507 @@
     self.textureLoader = textureLoader;
     
     self.animationNodes = [NSHashTable weakObjectsHashTable];
+    self.awakeNodes = [NSHashTable weakObjectsHashTable];
+    self.sleepQueue = [NSMutableData data];
+    self.idleNodes = [NSMutableArray array];
+    self.wokenNodes = [NSMutableArray array];
+    self.budgetedNodes = [NSMutableArray array];
+    self.notificationQueue = [NSMutableData dataWithCapacity:INSKAnimationNotificationCapacity * sizeof(INSKAnimationNotification)];
+    self.queuedEventData = [NSMutableData dataWithCapacity:INSKAnimationNotificationCapacity * sizeof(INSKAMEvent)];
+    self.notifiedNodes = [NSMutableArray arrayWithCapacity:INSKAnimationNotificationCapacity];
     self.textureCache = [NSMapTable strongToWeakObjectsMapTable];
+    self.stateNodes = [NSPointerArray weakObjectsPointerArray];
+    self.stateData = [NSMutableData data];
+    self.freeStateSlots = [NSMutableIndexSet indexSet];
+    self.nextStateSerial = 1;
     self.lastSystemTime = 0;
     
     return self;
 }
 
+- (void)dealloc {
+    // the nodes take their states along
+    [self detachStateRecords];
+}
+
 - (void)update:(NSTimeInterval)currentTime {
+    INSKAnimationTraceScoped("manager update");
+    CFTimeInterval startTime = CACurrentMediaTime();
     NSTimeInterval deltaTime = 0;
     if (self.lastSystemTime > 0) {
         deltaTime = currentTime - self.lastSystemTime;
     }
+    
+    // wake the nodes whose hold ends, their time is advanced to the last frame first
+    self.queueingNotifications = self.deferredNotifications;
+    [self wakeAnimationNodesUntilTime:currentTime];
     self.lastSystemTime = currentTime;
 
-    for (INSKAnimationNode *node in self.animationNodes) {
-        [node updateTime:deltaTime];
+    NSUInteger frameCount = self.frameCount++;
+    INSKAnimationLODPolicy lodPolicy = self.lodPolicy;
+    NSMutableArray *budgetedNodes = (self.updateBudget > 0 ? self.budgetedNodes : nil);
+    self.updatingNodes = YES;
+    for (INSKAnimationNode *node in self.awakeNodes) {
+        if (lodPolicy != nil) {
+            node.updateFrameInterval = lodPolicy(node);
+        }
+        
+        // the time is advanced each frame, only the node tree update is skipped
+        NSUInteger updateFrameInterval = node.updateFrameInterval;
+        BOOL updateNodes = (updateFrameInterval == 1 || (updateFrameInterval != 0 && (frameCount + node.updatePhase) % updateFrameInterval == 0));
+        updateNodes = updateNodes || node.updatePending;
+        if (updateNodes && budgetedNodes != nil) {
+            // updated below in priority order
+            [budgetedNodes addObject:node];
+            continue;
+        }
+        [node updateTime:deltaTime updateNodes:updateNodes];
+        if (updateNodes) {
+            node.updatePending = NO;
+            node.lastUpdateFrame = frameCount;
+        }
+        [self collectIdleNode:node];
+    }
+    
+    self.deferredNodeCount = 0;
+    if (budgetedNodes.count > 0) {
+        [self updateBudgetedNodes:budgetedNodes deltaTime:deltaTime frameCount:frameCount deadline:startTime + self.updateBudget / 1000000.0];
+        [budgetedNodes removeAllObjects];
+    }
+    self.updatingNodes = NO;
+    
+    // the awake nodes can be changed again
+    for (INSKAnimationNode *node in self.wokenNodes) {
+        [self.awakeNodes addObject:node];
+    }
+    [self.wokenNodes removeAllObjects];
+    
+    // the delegates are called after all nodes are updated
+    self.queueingNotifications = NO;
+    [self dispatchNotifications];
+    
+    for (INSKAnimationNode *node in self.idleNodes) {
+        // the duration may have changed by a delegate
+        NSTimeInterval sleepDuration = [node sleepDuration];
+        if (sleepDuration > 0.0 && node.sleepIndex == NSNotFound) {
+            [self sleepAnimationNode:node untilTime:currentTime + sleepDuration];
+        }
+    }
+    [self.idleNodes removeAllObjects];
+    
+    [self finishFrameStatisticsWithStartTime:startTime];
+}
+
+// Remembers a node for sleeping after the updates if nothing changes in the next frame.
+- (void)collectIdleNode:(INSKAnimationNode *)node {
+    if (self.sleepScheduling && [node sleepDuration] > 0.0) {
+        [self.idleNodes addObject:node];
+    }
+}
+
+// Updates the nodes in priority order until the deadline has passed and defers the node tree updates of the remaining nodes.
+- (void)updateBudgetedNodes:(NSMutableArray *)nodes deltaTime:(NSTimeInterval)deltaTime frameCount:(NSUInteger)frameCount deadline:(CFTimeInterval)deadline {
+    // higher priority first, then the longest waiting node
+    [nodes sortUsingComparator:^NSComparisonResult(INSKAnimationNode *node1, INSKAnimationNode *node2) {
+        if (node1.updatePriority != node2.updatePriority) {
+            return (node1.updatePriority > node2.updatePriority ? NSOrderedAscending : NSOrderedDescending);
+        }
+        if (node1.lastUpdateFrame != node2.lastUpdateFrame) {
+            return (node1.lastUpdateFrame < node2.lastUpdateFrame ? NSOrderedAscending : NSOrderedDescending);
+        }
+        return NSOrderedSame;
+    }];
+    
+    BOOL budgetExhausted = NO;
+    NSUInteger deferredNodeCount = 0;
+    for (INSKAnimationNode *node in nodes) {
+        if (budgetExhausted) {
+            // advance the clock only
+            [node updateTime:deltaTime updateNodes:NO];
+            node.updatePending = YES;
+            ++deferredNodeCount;
+            continue;
+        }
+        [node updateTime:deltaTime updateNodes:YES];
+        node.updatePending = NO;
+        node.lastUpdateFrame = frameCount;
+        [self collectIdleNode:node];
+        budgetExhausted = (CACurrentMediaTime() >= deadline);
+    }
+    self.deferredNodeCount = deferredNodeCount;
+}
+
+
+#pragma mark - Playback states
+
+- (NSUInteger)playbackStateCount {
+    return self.stateNodes.count;
+}
+
+- (void)savePlaybackStates:(INSKAnimationNodeState *)states {
+    // the nodes play from the records, so saving is one copy
+    NSUInteger count = self.playbackStateCount;
+    memcpy(states, self.stateData.bytes, count * sizeof(INSKAnimationNodeState));
+    
+    // a sleeping node's time is only brought up to date when it wakes
+    const INSKAnimationSleepEntry *entries = self.sleepQueue.bytes;
+    NSUInteger sleepingNodeCount = self.sleepingNodeCount;
+    for (NSUInteger index = 0; index < sleepingNodeCount; ++index) {
+        INSKAnimationNodeState *state = &states[entries[index].stateSlot];
+        if (state->nodeSerial != 0) {
+            INSKAnimationNodeStateAdvance(state, self.lastSystemTime - entries[index].sleepTime, entries[index].animationLength);
+        }
+    }
+}
+
+- (NSUInteger)restorePlaybackStates:(const INSKAnimationNodeState *)states count:(NSUInteger)count {
+    count = MIN(count, self.playbackStateCount);
+    INSKAnimationNodeState *records = self.stateData.mutableBytes;
+    NSUInteger restoredCount = 0;
+    for (NSUInteger slot = 0; slot < count; ++slot) {
+        // removed and deallocated nodes have a serial of 0 in their slot
+        if (states[slot].nodeSerial == 0 || states[slot].nodeSerial != records[slot].nodeSerial) {
+            continue;
+        }
+        records[slot] = states[slot];
+        records[slot].restorePending = YES;
+        ++restoredCount;
+    }
+    
+    // restored sleeping nodes are due with the next update, the slept time belongs to the replaced state
+    INSKAnimationSleepEntry *entries = self.sleepQueue.mutableBytes;
+    NSUInteger sleepingNodeCount = self.sleepingNodeCount;
+    BOOL wakeTimesChanged = NO;
+    for (NSUInteger index = 0; index < sleepingNodeCount; ++index) {
+        if (records[entries[index].stateSlot].restorePending) {
+            entries[index].wakeTime = -INFINITY;
+            wakeTimesChanged = YES;
+        }
+    }
+    if (wakeTimesChanged) {
+        for (NSUInteger index = sleepingNodeCount / 2; index > 0; --index) {
+            [self siftDownSleepEntryAtIndex:index - 1];
+        }
+    }
+    return restoredCount;
+}
+
+// Gives an added node a slot in the playback states and a new serial number, the node plays from the slot's record from now on.
+- (void)assignStateSlotToAnimationNode:(INSKAnimationNode *)animationNode {
+    NSUInteger stateSlot = animationNode.stateSlot;
+    if (stateSlot < self.stateNodes.count && [self.stateNodes pointerAtIndex:stateSlot] == (__bridge void *)animationNode) {
+        // already added
+        return;
+    }
+    // the slots of deallocated nodes are only reclaimed before the records grow, so the scan is rare
+    if (self.freeStateSlots.count == 0 && self.stateNodes.count * sizeof(INSKAnimationNodeState) >= self.stateData.length) {
+        [self reclaimStateSlots];
+    }
+    stateSlot = self.freeStateSlots.firstIndex;
+    if (stateSlot != NSNotFound) {
+        [self.freeStateSlots removeIndex:stateSlot];
+        [self.stateNodes replacePointerAtIndex:stateSlot withPointer:(__bridge void *)animationNode];
+    } else {
+        stateSlot = self.stateNodes.count;
+        [self reserveStateRecords:stateSlot + 1];
+        [self.stateNodes addPointer:(__bridge void *)animationNode];
+    }
+    INSKAnimationNodeState *record = (INSKAnimationNodeState *)self.stateData.mutableBytes + stateSlot;
+    *record = *animationNode.stateRecord;
+    animationNode.stateRecord = record;
+    animationNode.stateSlot = stateSlot;
+    animationNode.stateSerial = self.nextStateSerial++;
+}
+
+// Frees the slots of the nodes which have been deallocated without being removed and drops the free slots at the end.
+- (void)reclaimStateSlots {
+    // a node deallocated while sleeping has left its entry, which refers to the slot
+    INSKAnimationSleepEntry *entries = self.sleepQueue.mutableBytes;
+    NSUInteger sleepingNodeCount = self.sleepingNodeCount;
+    NSUInteger liveCount = 0;
+    for (NSUInteger index = 0; index < sleepingNodeCount; ++index) {
+        if ([self nodeOfSleepEntry:entries[index]] != nil) {
+            entries[liveCount++] = entries[index];
+        }
+    }
+    if (liveCount < sleepingNodeCount) {
+        self.sleepQueue.length = liveCount * sizeof(INSKAnimationSleepEntry);
+        for (NSUInteger index = 0; index < liveCount; ++index) {
+            [self nodeOfSleepEntry:entries[index]].sleepIndex = index;
+        }
+        for (NSUInteger index = liveCount / 2; index > 0; --index) {
+            [self siftDownSleepEntryAtIndex:index - 1];
+        }
+    }
+    
+    // the weak references of deallocated nodes are NULL
+    NSPointerArray *stateNodes = self.stateNodes;
+    INSKAnimationNodeState *records = self.stateData.mutableBytes;
+    for (NSUInteger slot = 0; slot < stateNodes.count; ++slot) {
+        if ([stateNodes pointerAtIndex:slot] == NULL && ![self.freeStateSlots containsIndex:slot]) {
+            memset(&records[slot], 0, sizeof(INSKAnimationNodeState));
+            [self.freeStateSlots addIndex:slot];
+        }
+    }
+    NSUInteger slotCount = stateNodes.count;
+    while (slotCount > 0 && [stateNodes pointerAtIndex:slotCount - 1] == NULL) {
+        --slotCount;
+    }
+    [self.freeStateSlots removeIndexesInRange:NSMakeRange(slotCount, NSNotFound - slotCount)];
+    stateNodes.count = slotCount;
+}
+
+// Grows the records for the given number of slots, the nodes are pointed to the moved records.
+- (void)reserveStateRecords:(NSUInteger)count {
+    NSUInteger capacity = self.stateData.length / sizeof(INSKAnimationNodeState);
+    if (count <= capacity) {
+        return;
+    }
+    // the capacity is doubled, so the nodes are rarely moved
+    NSMutableData *stateData = [NSMutableData dataWithLength:MAX(count, MAX(16, 2 * capacity)) * sizeof(INSKAnimationNodeState)];
+    memcpy(stateData.mutableBytes, self.stateData.bytes, self.stateData.length);
+    INSKAnimationNodeState *records = stateData.mutableBytes;
+    NSPointerArray *stateNodes = self.stateNodes;
+    for (NSUInteger slot = 0; slot < stateNodes.count; ++slot) {
+        INSKAnimationNode *node = (__bridge INSKAnimationNode *)[stateNodes pointerAtIndex:slot];
+        node.stateRecord = &records[slot];
+    }
+    self.stateData = stateData;
+}
+
+// Lets all nodes play from their own records again.
+- (void)detachStateRecords {
+    NSPointerArray *stateNodes = self.stateNodes;
+    for (NSUInteger slot = 0; slot < stateNodes.count; ++slot) {
+        INSKAnimationNode *node = (__bridge INSKAnimationNode *)[stateNodes pointerAtIndex:slot];
+        node.stateRecord = NULL;
+    }
+}
+
+
+#pragma mark - Sleep scheduling
+
+- (void)setSleepScheduling:(BOOL)sleepScheduling {
+    _sleepScheduling = sleepScheduling;
+    if (!sleepScheduling) {
+        [self wakeAnimationNodesUntilTime:INFINITY];
+    }
+}
+
+- (NSUInteger)sleepingNodeCount {
+    return self.sleepQueue.length / sizeof(INSKAnimationSleepEntry);
+}
+
+// Wakes all nodes with a wake time up to the given time.
+- (void)wakeAnimationNodesUntilTime:(NSTimeInterval)time {
+    while (self.sleepingNodeCount > 0) {
+        INSKAnimationSleepEntry *entries = self.sleepQueue.mutableBytes;
+        if (entries[0].wakeTime > time) {
+            break;
+        }
+        INSKAnimationNode *node = [self nodeOfSleepEntry:entries[0]];
+        if (node != nil) {
+            [self wakeAnimationNode:node];
+        } else {
+            // the node has been deallocated while sleeping
+            [self removeSleepEntryAtIndex:0];
+        }
+    }
+}
+
+// Returns the node of a sleep queue entry or nil if it has been deallocated.
+- (INSKAnimationNode *)nodeOfSleepEntry:(INSKAnimationSleepEntry)entry {
+    return (__bridge INSKAnimationNode *)[self.stateNodes pointerAtIndex:entry.stateSlot];
+}
+
+// Removes a node from the updates and puts it into the sleep queue.
+- (void)sleepAnimationNode:(INSKAnimationNode *)node untilTime:(NSTimeInterval)wakeTime {
+    [self.awakeNodes removeObject:node];
+    NSAssert(node.stateSlot != NSNotFound, @"only managed nodes can sleep");
+    // the length is a whole number of ticks
+    INSKAnimationSleepEntry entry = {wakeTime, self.lastSystemTime, node.stateSlot, (INSKAMTicks)llround(node.animationLength * INSKAMTicksPerSecond)};
+    [self.sleepQueue appendBytes:&entry length:sizeof(INSKAnimationSleepEntry)];
+    NSUInteger index = self.sleepingNodeCount - 1;
+    node.sleepIndex = index;
+    [self siftUpSleepEntryAtIndex:index];
+}
+
+// Removes an entry from the sleep queue and restores the heap order.
+- (void)removeSleepEntryAtIndex:(NSUInteger)index {
+    INSKAnimationSleepEntry *entries = self.sleepQueue.mutableBytes;
+    NSUInteger lastIndex = self.sleepingNodeCount - 1;
+    [self nodeOfSleepEntry:entries[index]].sleepIndex = NSNotFound;
+    if (index != lastIndex) {
+        entries[index] = entries[lastIndex];
+        [self nodeOfSleepEntry:entries[index]].sleepIndex = index;
+    }
+    self.sleepQueue.length = lastIndex * sizeof(INSKAnimationSleepEntry);
+    if (index < lastIndex) {
+        [self siftDownSleepEntryAtIndex:index];
+        [self siftUpSleepEntryAtIndex:index];
+    }
+}
+
+// Swaps two entries of the sleep queue and updates the nodes' indexes.
+- (void)swapSleepEntryAtIndex:(NSUInteger)index withIndex:(NSUInteger)otherIndex {
+    INSKAnimationSleepEntry *entries = self.sleepQueue.mutableBytes;
+    INSKAnimationSleepEntry entry = entries[index];
+    entries[index] = entries[otherIndex];
+    entries[otherIndex] = entry;
+    [self nodeOfSleepEntry:entries[index]].sleepIndex = index;
+    [self nodeOfSleepEntry:entries[otherIndex]].sleepIndex = otherIndex;
+}
+
+- (void)siftUpSleepEntryAtIndex:(NSUInteger)index {
+    INSKAnimationSleepEntry *entries = self.sleepQueue.mutableBytes;
+    while (index > 0) {
+        NSUInteger parentIndex = (index - 1) / 2;
+        if (entries[parentIndex].wakeTime <= entries[index].wakeTime) {
+            break;
+        }
+        [self swapSleepEntryAtIndex:index withIndex:parentIndex];
+        index = parentIndex;
+    }
+}
+
+- (void)siftDownSleepEntryAtIndex:(NSUInteger)index {
+    INSKAnimationSleepEntry *entries = self.sleepQueue.mutableBytes;
+    NSUInteger count = self.sleepingNodeCount;
+    while (YES) {
+        NSUInteger smallestIndex = index;
+        NSUInteger leftIndex = 2 * index + 1;
+        NSUInteger rightIndex = leftIndex + 1;
+        if (leftIndex < count && entries[leftIndex].wakeTime < entries[smallestIndex].wakeTime) {
+            smallestIndex = leftIndex;
+        }
+        if (rightIndex < count && entries[rightIndex].wakeTime < entries[smallestIndex].wakeTime) {
+            smallestIndex = rightIndex;
+        }
+        if (smallestIndex == index) {
+            break;
+        }
+        [self swapSleepEntryAtIndex:index withIndex:smallestIndex];
+        index = smallestIndex;
     }
 }
 
+
+#pragma mark - Deferred notifications
+
+// Appends a notification to the queue and retains its node.
+- (void)queueNotification:(INSKAnimationNotification)notification ofAnimationNode:(INSKAnimationNode *)animationNode {
+    notification.nodePhase = animationNode.updatePhase;
+    notification.sequence = self.notificationQueue.length / sizeof(INSKAnimationNotification);
+    [self.notifiedNodes addObject:animationNode];
+    [self.notificationQueue appendBytes:&notification length:sizeof(INSKAnimationNotification)];
+}
+
+// Calls the delegates of all queued notifications in a deterministic order and empties the queue.
+- (void)dispatchNotifications {
+    NSUInteger notificationCount = self.notificationQueue.length / sizeof(INSKAnimationNotification);
+    if (notificationCount == 0) {
+        return;
+    }
+    
+    INSKAnimationNotification *notifications = self.notificationQueue.mutableBytes;
+    qsort(notifications, notificationCount, sizeof(INSKAnimationNotification), INSKAnimationCompareNotifications);
+    const INSKAMEvent *events = self.queuedEventData.bytes;
+    for (NSUInteger index = 0; index < notificationCount; ++index) {
+        INSKAnimationNotification notification = notifications[index];
+        INSKAnimationNode *node = self.notifiedNodes[notification.sequence];
+        id<INSKAnimationNodeDelegate> delegate = node.animationNodeDelegate;
+        if (notification.finish) {
+            if ([delegate respondsToSelector:@selector(animationNodeDidFinishPlayback:looping:)]) {
+                [delegate animationNodeDidFinishPlayback:node looping:notification.looping];
+                INSKAnimationStatisticsCount(&_currentStatistics, delegateCalls, 1);
+            }
+        } else {
+            if ([delegate respondsToSelector:@selector(animationNode:didPassEvents:count:)]) {
+                [delegate animationNode:node didPassEvents:events + notification.eventIndex count:notification.eventCount];
+                INSKAnimationStatisticsCount(&_currentStatistics, delegateCalls, 1);
+            }
+        }
+    }
+    
+    // the buffers keep their capacity for the next frame
+    self.notificationQueue.length = 0;
+    self.queuedEventData.length = 0;
+    [self.notifiedNodes removeAllObjects];
+}
+
+
+#pragma mark - Statistics
+
+- (void)resetStatistics {
+    INSKAnimationStatistics statistics = {0};
+    self.totalStatistics = statistics;
+}
+
+// Publishes the statistics of the frame, adds them to the total and starts counting the next frame.
+- (void)finishFrameStatisticsWithStartTime:(CFTimeInterval)startTime {
+#if INSK_ANIMATION_STATISTICS
+    INSKAnimationStatistics *frame = &_currentStatistics;
+    frame->frameCount = 1;
+    frame->activeNodeCount = self.awakeNodes.count;
+    frame->sleepingNodeCount = self.sleepingNodeCount;
+    frame->updateTime = CACurrentMediaTime() - startTime;
+    
+    INSKAnimationStatistics total = self.totalStatistics;
+    total.frameCount += frame->frameCount;
+    total.activeNodeCount += frame->activeNodeCount;
+    total.sleepingNodeCount += frame->sleepingNodeCount;
+    total.timelinesEvaluated += frame->timelinesEvaluated;
+    total.interpolations += frame->interpolations;
+    total.exactKeyHits += frame->exactKeyHits;
+    total.reparentCount += frame->reparentCount;
+    total.textureLookups += frame->textureLookups;
+    total.textureCacheMisses += frame->textureCacheMisses;
+    total.delegateCalls += frame->delegateCalls;
+    total.updateTime += frame->updateTime;
+    total.nodeUpdateTime += frame->nodeUpdateTime;
+    total.propertyTime += frame->propertyTime;
+    self.totalStatistics = total;
+    self.frameStatistics = *frame;
+    memset(frame, 0, sizeof(INSKAnimationStatistics));
+#endif
+}
+
+
+#pragma mark - Level of detail
+
++ (INSKAnimationLODPolicy)distanceLODPolicyWithCenterNode:(SKNode *)centerNode distances:(NSArray *)distances {
+    NSUInteger distanceCount = distances.count;
+    CGFloat *squaredDistances = malloc(MAX(distanceCount, 1) * sizeof(CGFloat));
+    for (NSUInteger index = 0; index < distanceCount; ++index) {
+        CGFloat distance = [distances[index] doubleValue];
+        squaredDistances[index] = distance * distance;
+        NSAssert(index == 0 || squaredDistances[index] >= squaredDistances[index - 1], @"distances have to be in ascending order");
+    }
+    NSData *squaredDistanceData = [NSData dataWithBytesNoCopy:squaredDistances length:distanceCount * sizeof(CGFloat) freeWhenDone:YES];
+    
+    __weak SKNode *weakCenterNode = centerNode;
+    return ^NSUInteger(INSKAnimationNode *animationNode) {
+        SKNode *center = weakCenterNode;
+        SKScene *scene = animationNode.scene;
+        if (center == nil || scene == nil || center.scene != scene) {
+            return 1;
+        }
+        
+        CGPoint nodePosition = [animationNode.parent convertPoint:animationNode.position toNode:scene];
+        CGPoint centerPosition = [center.parent convertPoint:center.position toNode:scene];
+        CGFloat deltaX = nodePosition.x - centerPosition.x;
+        CGFloat deltaY = nodePosition.y - centerPosition.y;
+        CGFloat squaredDistance = deltaX * deltaX + deltaY * deltaY;
+        const CGFloat *thresholds = squaredDistanceData.bytes;
+        for (NSUInteger index = 0; index < distanceCount; ++index) {
+            if (squaredDistance < thresholds[index]) {
+                return index + 1;
+            }
+        }
+        return 0;
+    };
+}
+
 - (NSArray *)allEntityNames {
     return self.animationData.entitiesByName.allKeys.copy;
 }
@@ -80,6 +648,15 @@
     return entity.animationsByName.allKeys.copy;
 }
 
+- (BOOL)prepareAnimations:(NSArray *)animationNames ofEntity:(NSString *)entityName {
+    INSKAMEntity *entity = [self.animationData.entitiesByName objectForKey:entityName];
+    if (entity == nil) {
+        return NO;
+    }
+    [entity prepareAnimations:animationNames];
+    return YES;
+}
+
 - (NSDictionary *)allTextureNames {
     NSMutableDictionary *paths = [NSMutableDictionary dictionary];
     for (INSKAMTexture *texture in self.animationData.texturesById.allValues) {
@@ -101,16 +678,96 @@
 }
 
 - (void)addAnimationNode:(INSKAnimationNode *)animationNode {
+    // consecutive phases spread the updates of nodes with the same interval evenly over the frames
+    animationNode.updatePhase = self.nextUpdatePhase++;
     [self.animationNodes addObject:animationNode];
+    [self assignStateSlotToAnimationNode:animationNode];
+    if (self.updatingNodes) {
+        [self.wokenNodes addObject:animationNode];
+    } else {
+        [self.awakeNodes addObject:animationNode];
+    }
+}
+
+- (NSTimeInterval)sleptTimeOfAnimationNode:(INSKAnimationNode *)animationNode {
+    NSAssert(animationNode.sleepIndex != NSNotFound, @"the node isn't sleeping");
+    const INSKAnimationSleepEntry *entries = self.sleepQueue.bytes;
+    return self.lastSystemTime - entries[animationNode.sleepIndex].sleepTime;
+}
+
+- (void)wakeAnimationNode:(INSKAnimationNode *)animationNode {
+    if (animationNode.sleepIndex == NSNotFound) {
+        return;
+    }
+    NSTimeInterval sleptTime = [self sleptTimeOfAnimationNode:animationNode];
+    [self removeSleepEntryAtIndex:animationNode.sleepIndex];
+    if (self.updatingNodes) {
+        [self.wokenNodes addObject:animationNode];
+    } else {
+        [self.awakeNodes addObject:animationNode];
+    }
+    
+    // catch up the slept time, nothing visible changes until the last frame, a restored state has nothing to catch up
+    if (!animationNode.stateRecord->restorePending) {
+        [animationNode updateTime:sleptTime updateNodes:NO];
+    }
 }
 
 - (void)removeAnimationNode:(INSKAnimationNode *)animationNode {
+    if (animationNode.sleepIndex != NSNotFound) {
+        [self removeSleepEntryAtIndex:animationNode.sleepIndex];
+    }
+    [self.awakeNodes removeObject:animationNode];
+    [self.wokenNodes removeObject:animationNode];
     [self.animationNodes removeObject:animationNode];
+    
+    // the slot can be reused when its node is removed, a removed node isn't restored anymore
+    NSUInteger stateSlot = animationNode.stateSlot;
+    if (stateSlot < self.stateNodes.count && [self.stateNodes pointerAtIndex:stateSlot] == (__bridge void *)animationNode) {
+        [self.stateNodes replacePointerAtIndex:stateSlot withPointer:NULL];
+        [self.freeStateSlots addIndex:stateSlot];
+        animationNode.stateRecord = NULL;
+        animationNode.stateSlot = NSNotFound;
+        animationNode.stateSerial = 0;
+        memset((INSKAnimationNodeState *)self.stateData.mutableBytes + stateSlot, 0, sizeof(INSKAnimationNodeState));
+    }
+}
+
+- (BOOL)queueFinishOfAnimationNode:(INSKAnimationNode *)animationNode looping:(BOOL)looping {
+    if (!self.queueingNotifications) {
+        return NO;
+    }
+    INSKAnimationNotification notification = {0, 0, YES, looping, 0, 0};
+    [self queueNotification:notification ofAnimationNode:animationNode];
+    return YES;
+}
+
+- (BOOL)queueEvents:(const INSKAMEvent *)events count:(NSUInteger)count ofAnimationNode:(INSKAnimationNode *)animationNode {
+    if (!self.queueingNotifications) {
+        return NO;
+    }
+    INSKAnimationNotification notification = {0, 0, NO, NO, self.queuedEventData.length / sizeof(INSKAMEvent), count};
+    [self.queuedEventData appendBytes:events length:count * sizeof(INSKAMEvent)];
+    [self queueNotification:notification ofAnimationNode:animationNode];
+    return YES;
+}
+
+- (INSKAnimationStatistics *)currentStatistics {
+    return &_currentStatistics;
 }
 
 - (SKTexture *)textureNamed:(NSString *)textureName path:(NSString *)path {
+    return [self textureNamed:textureName path:path cacheKey:[path stringByAppendingString:textureName]];
+}
+
+- (SKTexture *)textureForTexture:(INSKAMTexture *)texture {
+    return [self textureNamed:texture.fileName path:texture.relativePath cacheKey:texture.cacheKey];
+}
+
+- (SKTexture *)textureNamed:(NSString *)textureName path:(NSString *)path cacheKey:(NSString *)key {
+    INSKAnimationStatisticsCount(&_currentStatistics, textureLookups, 1);
+    
     // get texture from cache
-    NSString *key = [path stringByAppendingString:textureName];
     id textureOrNull = [self.textureCache objectForKey:key];
     if (textureOrNull != nil) {
         // something cached found
@@ -124,7 +781,11 @@
     }
     
     // no cached texture found, ask the delegate
-    textureOrNull = [self.textureLoader textureNamed:textureName path:path];
+    INSKAnimationStatisticsCount(&_currentStatistics, textureCacheMisses, 1);
+    {
+        INSKAnimationTraceScoped("load texture");
+        textureOrNull = [self.textureLoader textureNamed:textureName path:path];
+    }
     if (textureOrNull == nil) {
         // no texture, save the null object for not asking the delegate again for this resource
         [self.textureCache setObject:[NSNull null] forKey:key];
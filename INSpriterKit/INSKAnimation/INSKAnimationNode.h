@@ -22,6 +22,9 @@
 
 
 #import <SpriteKit/SpriteKit.h>
+#import "INSKAMTypes.h"
+#import "INSKAMCollisionShapes.h"
+#import "INSKAnimationNodeState.h"
 
 @class INSKAnimationManager;
 @class INSKAnimationNode;
@@ -42,6 +45,19 @@
 @optional
 - (void)animationNodeDidFinishPlayback:(INSKAnimationNode *)animationNode looping:(BOOL)looping;
 
+/**
+ Gets called if the animation playback has passed events of the animation's eventlines, e.g. footsteps.
+ 
+ All events passed by one update are reported with one call in order of playback, before animationNodeDidFinishPlayback:looping: of the same update.
+ A big time step may pass an event more than once if the animation loops.
+ Only playback passes events, setting the animation's time directly doesn't.
+ 
+ @param animationNode The animation node whiches animation passed the events.
+ @param events The passed events, only valid during this call.
+ @param count The number of passed events.
+ */
+- (void)animationNode:(INSKAnimationNode *)animationNode didPassEvents:(const INSKAMEvent *)events count:(NSUInteger)count;
+
 @end
 
 
@@ -151,16 +167,31 @@
  After starting an animation playback this property will be set to 0.0 and will be updated by the manager each frame.
  Assigning a new value will automatically instantly update the visual representation (node tree).
  The time will automatically clamped to the animation length respecting the looping flag.
+ This is the seconds representation of currentAnimationTicks plus the fraction of a tick not yet played.
  
  @see playAnimation:
+ @see currentAnimationTicks
  */
 @property (nonatomic, assign) NSTimeInterval currentAnimationTime;
 
 
+/**
+ The elapsed time in ticks (Spriter's milliseconds) of the current animation.
+ 
+ This is the time the animation is evaluated at, all keyframe lookups and the looping are done with these integer ticks.
+ The frame times passed by the manager are accumulated with their fractions so the playback doesn't drift.
+ Assigning a new value will automatically instantly update the visual representation (node tree)
+ and will be clamped or wrapped to the animation length like currentAnimationTime.
+ 
+ @see currentAnimationTime
+ */
+@property (nonatomic, assign) INSKAMTicks currentAnimationTicks;
+
+
 /**
  The total length in seconds of the current animation.
  
- Undefined if no animation is currently applyed and will be set if a new animation is started.
+ Zero if no animation is currently applyed and will be set if a new animation is started.
 
  @see playAnimation:
  */
@@ -180,6 +211,286 @@
 @property (nonatomic, assign) BOOL loopAnimation;
 
 
+#pragma mark - Events
+/// @name Events
+
+/**
+ Returns the name of an event of the current animation.
+ 
+ @param event An event passed to the delegate's animationNode:didPassEvents:count: method.
+ @return The name of the event's eventline.
+ */
+- (NSString *)nameOfEvent:(INSKAMEvent)event;
+
+
+#pragma mark - Blending
+/// @name Blending
+
+/**
+ Starts playing a new animation with a cross-fade from the current one.
+ 
+ The new animation starts like with playAnimation:, but during the blend duration the previous animation continues playing in the background
+ and each bone and sprite shows a mix of both animations, weighted from the previous to the new animation.
+ Both animations are evaluated into pose buffers and mixed per object, identified by the timeline names of the entity.
+ The nodes are shared by all animations of the entity, but only the objects of the new animation are shown, so objects which only the previous animation shows disappear immediately
+ and the hierarchy and drawing order of the new animation are used from the start.
+ The transition only switches the timeline cursors and the pose buffers are owned by the entity, so it allocates nothing once all objects have been shown.
+ Starting another blend while blending fades from the current target animation only.
+ 
+ @param animationName The animation's name.
+ @param blendDuration The time in seconds for the cross-fade, scaled by the animationSpeed like the playback. No blending if zero.
+ @return True if the animation could be found and playback started, otherwise false.
+ @see playAnimation:
+ */
+- (BOOL)playAnimation:(NSString *)animationName blendDuration:(NSTimeInterval)blendDuration;
+
+
+/**
+ True while a cross-fade started by playAnimation:blendDuration: is in progress.
+ */
+@property (nonatomic, assign, readonly, getter=isBlending) BOOL blending;
+
+
+#pragma mark - Z-order
+/// @name Z-order
+
+/**
+ The zPosition distance between two Z-indexes of Spriter, defaults to 0.001.
+ 
+ The drawing order of the animation's objects is applied through their zPosition relative to this node instead of reordering the node tree.
+ Each object gets its Z-index of the current mainline key multiplied with this value, bones always stay at zero.
+ The default keeps an animation with less than 1000 objects inside the zPosition range from this node's zPosition to the next integer above,
+ so other nodes with integer zPositions are drawn above or below the whole animation.
+ Changing the value takes effect when the next animation is started.
+ */
+@property (nonatomic, assign) CGFloat zPositionStep;
+
+
+#pragma mark - Flattened rendering
+/// @name Flattened rendering
+
+/**
+ Flag for rendering the animation without a node tree, defaults to false.
+ 
+ Normally the node tree mirrors Spriter's bone hierarchy, so bones are empty SKNode objects and sprites are moved between them when the hierarchy changes.
+ In the flattened mode bones exist only as math: each sprite is a direct child of this node and gets its position, rotation, scale and alpha
+ composed from all its parent bones by the library, so no nodes are created for bones and no node is ever reparented.
+ The visual result is the same, but Sprite Kit has less nodes to process and no deep parent chains to multiply.
+ 
+ Changing the value takes effect when the next animation is started.
+ */
+@property (nonatomic, assign) BOOL flattenedRendering;
+
+
+#pragma mark - Partial evaluation
+/// @name Partial evaluation
+
+/**
+ Flag for playing animations without any nodes, defaults to false.
+ 
+ In the bones only mode no nodes are created for sprites and bones, so there is no sprite or texture work at all.
+ The animation time still advances, the delegate is informed and the collision shapes and the poses of single timelines can be evaluated on demand,
+ i.e. for an actor outside of the screen which still drives the gameplay.
+ 
+ Changing the value takes effect when the next animation is started.
+ 
+ @see evaluatePose:ofTimelineAtIndex:
+ */
+@property (nonatomic, assign) BOOL bonesOnly;
+
+
+/**
+ Returns the index of a timeline of the current animation by its name in Spriter.
+ 
+ Look up the index once after starting an animation and pass it to evaluatePose:ofTimelineAtIndex: each frame.
+ 
+ @param timelineName The name of the timeline, which is the bone's or object's name in Spriter.
+ @return The index of the timeline or NSNotFound if the current animation has no such timeline.
+ */
+- (NSUInteger)timelineIndexNamed:(NSString *)timelineName;
+
+
+/**
+ Evaluates the pose of a single timeline of the current animation time in this node's coordinate space.
+ 
+ Only the timeline and its ancestors are evaluated by walking the ancestor chain precomputed for the current mainline key,
+ so querying a hand bone for attaching a weapon doesn't evaluate the rest of the skeleton and works in the bones only mode or while culled.
+ Poses of ancestors shared by several queries of the same animation time are evaluated only once.
+ A blend started with playAnimation:blendDuration: isn't applied, the pose is the current animation's one.
+ 
+    INSKAMPose pose;
+    if ([self.animationNode evaluatePose:&pose ofTimelineAtIndex:self.handIndex] && !pose.hidden) {
+        self.gunNode.position = CGPointMake(pose.positionX, pose.positionY);
+        self.gunNode.zRotation = pose.angle;
+    }
+ 
+ @param pose Returns the pose composed with all parent bones.
+ @param timelineIndex The index of the timeline as returned by timelineIndexNamed:.
+ @return True if the timeline is part of the current mainline key and the pose has been evaluated, otherwise false.
+ */
+- (BOOL)evaluatePose:(INSKAMPose *)pose ofTimelineAtIndex:(NSUInteger)timelineIndex;
+
+
+#pragma mark - Playback state
+/// @name Playback state
+
+
+/**
+ Saves the playback state into a fixed-size record.
+ 
+ The state includes the playing animation, its time, speed and looping flag and the state of a running blend, but no object references,
+ so states can be stored in plain buffers and copied with memcpy, i.e. for rolling back the animations of a netcode.
+ A sleeping node isn't woken, the saved time is the one it will have when it catches up the slept time.
+ 
+ @param state Returns the playback state.
+ */
+- (void)savePlaybackState:(INSKAnimationNodeState *)state;
+
+
+/**
+ Restores a playback state saved by savePlaybackState: and updates the node tree to it.
+ 
+ The state has to be saved from a node of the same entity.
+ The timeline cursors are only switched if the animation differs from the current one, otherwise only the time is applied and the nodes are evaluated again.
+ Evaluating depends only on the state, so restoring the same state always results in the same node tree.
+ No delegate method is called for restoring, neither for events nor for the animation's end, and events passed but not delivered yet are dropped.
+ 
+ @param state The playback state to restore.
+ @return True if the state could be restored, false if its animations don't exist in the node's entity.
+ */
+- (BOOL)restorePlaybackState:(const INSKAnimationNodeState *)state;
+
+
+#pragma mark - Bounds and culling
+/// @name Bounds and culling
+
+/**
+ A conservative bounding rect of all visible sprites of the current animation time in this node's coordinate space.
+ 
+ The bounds are precomputed by the parser for each span between keyframes from the textures' sizes, the pivots and the bone transformations,
+ so this is a lookup without walking the node tree like calculateAccumulatedFrame does.
+ CGRectNull if no sprite is visible.
+ 
+ @see spriteBoundsInParent
+ */
+@property (nonatomic, assign, readonly) CGRect spriteBounds;
+
+
+/**
+ The spriteBounds transformed to the coordinate space of this node's parent.
+ 
+ The node's position, rotation and scale are applied, so the rect may be larger than the transformed sprite bounds.
+ */
+@property (nonatomic, assign, readonly) CGRect spriteBoundsInParent;
+
+
+/**
+ A rect in the coordinate space of this node's parent outside of which the sprites are not updated, defaults to CGRectNull for no culling.
+ 
+ Set it to the visible area, e.g. the camera's view rect, and the animation only advances its time while spriteBoundsInParent doesn't intersect it,
+ so the nodes keep their last state until the animation becomes visible again.
+ The delegate is still informed and the collision boxes and points are still evaluated on demand.
+ 
+ @see culled
+ */
+@property (nonatomic, assign) CGRect cullingRect;
+
+
+/**
+ True if the last update has been skipped because the sprites are outside of the cullingRect.
+ */
+@property (nonatomic, assign, readonly, getter=isCulled) BOOL culled;
+
+
+#pragma mark - Level of detail
+/// @name Level of detail
+
+/**
+ The number of frames between two node updates, defaults to 1 for updating each frame.
+ 
+ This is the level of detail of the animation: a value of N lets the manager update the node tree only every Nth frame
+ and a value of 0 freezes the nodes in their current state.
+ The animation time is still advanced each frame regardless of this value, so the playback doesn't slow down,
+ loops and ends happen at the same time and the delegate is informed in the frame they happen.
+ A skipped update is caught up with the next update, so the nodes jump directly to the current animation time.
+ The manager spreads the updates of nodes with the same interval evenly over the frames.
+ If the manager has a lodPolicy, this value will be overwritten by the policy each frame.
+ 
+ @see [INSKAnimationManager lodPolicy]
+ */
+@property (nonatomic, assign) NSUInteger updateFrameInterval;
+
+
+/**
+ The priority of the node update if the manager has an updateBudget, defaults to 0.
+ 
+ Nodes with a higher priority are updated first, so important game objects, e.g. the player, keep their full update frequency
+ while less important nodes are deferred if the budget is exhausted.
+ Nodes with the same priority are updated in round-robin, the node which has waited the longest comes first.
+ 
+ @see [INSKAnimationManager updateBudget]
+ */
+@property (nonatomic, assign) NSInteger updatePriority;
+
+
+#pragma mark - Collision boxes and points
+/// @name Collision boxes and points
+
+/**
+ A conservative bounding rect of all visible collision boxes and action points of the current animation time in this node's coordinate space.
+ 
+ The bounds are precomputed by the parser for each span between keyframes, so this is only a lookup without any interpolation.
+ Use it as broad phase test and only ask for collisionBoxes or collisionPoints if it intersects with the area of interest.
+ CGRectNull if the animation has no collision boxes or points or none are visible.
+ 
+ @see collisionBoundsInParent
+ */
+@property (nonatomic, assign, readonly) CGRect collisionBounds;
+
+
+/**
+ The collisionBounds transformed to the coordinate space of this node's parent.
+ 
+ The node's position, rotation and scale are applied, so the rect may be larger than the transformed collision bounds.
+ */
+@property (nonatomic, assign, readonly) CGRect collisionBoundsInParent;
+
+
+/**
+ The number of visible collision boxes of the current animation time.
+ 
+ The boxes are evaluated lazily on the first access after the animation time has changed.
+ 
+ @see collisionBoxes
+ */
+@property (nonatomic, assign, readonly) NSUInteger collisionBoxCount;
+
+
+/**
+ The visible collision boxes of the current animation time in this node's coordinate space.
+ 
+ No nodes are created for collision boxes, they are only evaluated when accessing them.
+ The array has collisionBoxCount entries and is owned by the node, so it is only valid until the animation time changes.
+ */
+@property (nonatomic, assign, readonly) const INSKAMCollisionBox *collisionBoxes;
+
+
+/**
+ The number of visible action points of the current animation time.
+ 
+ @see collisionPoints
+ */
+@property (nonatomic, assign, readonly) NSUInteger collisionPointCount;
+
+
+/**
+ The visible action points of the current animation time in this node's coordinate space.
+ 
+ The array has collisionPointCount entries and is owned by the node, so it is only valid until the animation time changes.
+ */
+@property (nonatomic, assign, readonly) const INSKAMCollisionPoint *collisionPoints;
+
+
 // ------------------------------------------------------------
 #pragma mark - Engine privates
 // ------------------------------------------------------------
@@ -195,4 +506,76 @@
 - (void)updateTime:(NSTimeInterval)deltaTime;
 
 
+/**
+ Updates the current animation time and optionally skips updating the node tree.
+ 
+ The animation time, the looping and the delegate calls are processed as in updateTime:, only the node tree keeps its state if updateNodes is false.
+ The next call with updateNodes set to true brings the node tree up to date.
+ This method is called each frame by the animation manager respecting the updateFrameInterval.
+ 
+ @param deltaTime The time difference in seconds from the last rendered frame.
+ @param updateNodes True if the node tree should be updated to the new animation time.
+ */
+- (void)updateTime:(NSTimeInterval)deltaTime updateNodes:(BOOL)updateNodes;
+
+
+/**
+ The frame offset of the updates for spreading nodes with the same updateFrameInterval over different frames.
+ 
+ Assigned by the animation manager when the node is added.
+ */
+@property (nonatomic, assign) NSUInteger updatePhase;
+
+
+/**
+ True if the manager has deferred the node update because the updateBudget was exhausted.
+ 
+ A pending node is updated in the next frame regardless of its updateFrameInterval.
+ */
+@property (nonatomic, assign) BOOL updatePending;
+
+
+/**
+ The manager's frame count of the last node tree update, used for the round-robin order of nodes with the same updatePriority.
+ */
+@property (nonatomic, assign) NSUInteger lastUpdateFrame;
+
+
+/**
+ The index of the node in the manager's sleep queue or NSNotFound if the node is awake.
+ */
+@property (nonatomic, assign) NSUInteger sleepIndex;
+
+
+/**
+ The serial number assigned by the manager when the node is added, identifies the node in saved playback states.
+ */
+@property (nonatomic, assign) NSUInteger stateSerial;
+
+
+/**
+ The record the node reads and writes its playback state from.
+ 
+ While the node is added to a manager this is the node's slot in the manager's playback states, so the manager saves and restores all nodes without calling them.
+ The manager copies the state into the slot before assigning it, assigning NULL copies the state back into the node's own record.
+ */
+@property (nonatomic, assign) INSKAnimationNodeState *stateRecord;
+
+
+/**
+ The index of the node's record in the playback states of the manager.
+ */
+@property (nonatomic, assign) NSUInteger stateSlot;
+
+
+/**
+ Returns the time in seconds until the node tree may change.
+ 
+ The time is derived from the hold span of the animation at the current time and the animation speed, so it ends at the next keyframe or mainline key which changes anything or the animation's end.
+ 
+ @return The time in seconds, 0 if the node has to be updated each frame or infinity if nothing changes until a property is changed.
+ */
+- (NSTimeInterval)sleepDuration;
+
+
 @end
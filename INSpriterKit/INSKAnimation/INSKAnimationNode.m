@@ -24,12 +24,64 @@
 #import "INSKAnimationNode.h"
 #import "INSKAnimationManager.h"
 #import "INSKAMHeaders.h"
+#import "INSKAnimationTrace.h"
 #import <INSpriteKit/INSpriteKit.h>
 
 
-@interface INSKAnimationNode ()
+// Counts the evaluation of a timeline's pose.
+static inline void INSKAnimationNodeCountEvaluation(INSKAnimationStatistics *statistics, BOOL exactKeyHit) {
+    INSKAnimationStatisticsCount(statistics, timelinesEvaluated, 1);
+    if (exactKeyHit) {
+        INSKAnimationStatisticsCount(statistics, exactKeyHits, 1);
+    } else {
+        INSKAnimationStatisticsCount(statistics, interpolations, 1);
+    }
+}
 
-@property (nonatomic, assign, readwrite) NSTimeInterval animationLength;
+// Keeps a time within the animation length by looping or clamping it, returns true if the time has passed an end of the animation.
+static inline BOOL INSKAnimationNodeWrapTicks(INSKAMTicks *ticks, INSKAMTicks animationLength, BOOL looping, BOOL *looped, BOOL *stopped) {
+    *looped = NO;
+    *stopped = NO;
+    if (animationLength == 0) {
+        *ticks = 0;
+        *stopped = YES;
+        return YES;
+    }
+    if (*ticks >= 0 && *ticks < animationLength) {
+        return NO;
+    }
+    if (looping) {
+        *ticks %= animationLength;
+        if (*ticks < 0) {
+            *ticks += animationLength;
+        }
+        *looped = YES;
+    } else {
+        // stop at the first or last keyframe
+        *ticks = (*ticks < 0 ? 0 : animationLength);
+        *stopped = YES;
+    }
+    return YES;
+}
+
+void INSKAnimationNodeStateAdvance(INSKAnimationNodeState *state, NSTimeInterval duration, INSKAMTicks animationLength) {
+    if (!state->playing || state->restorePending) {
+        return;
+    }
+    double ticks = state->tickFraction + duration * state->speed * INSKAMTicksPerSecond;
+    INSKAMTicks wholeTicks = (INSKAMTicks)floor(ticks);
+    state->ticks += wholeTicks;
+    state->tickFraction = ticks - wholeTicks;
+    BOOL looped, stopped;
+    INSKAnimationNodeWrapTicks(&state->ticks, animationLength, state->looping, &looped, &stopped);
+    if (stopped) {
+        state->tickFraction = 0.0;
+        state->playing = NO;
+    }
+}
+
+
+@interface INSKAnimationNode ()
 
 // A weak reference to the animation manager which holds the data model and is queryed for all needed data.
 @property (nonatomic, weak) INSKAnimationManager *animationManager;
@@ -37,33 +89,159 @@
 @property (nonatomic, weak) INSKAMEntity *entity;
 // The animation currently to play back. Nil if no animation is currently applyed. The animation is retrieved from the animation manager.
 @property (nonatomic, weak) INSKAMAnimation *animation;
-// True if the update method should increase the animation's current time.
+// True if the update method should increase the animation's current time, kept in the playback state record.
 @property (nonatomic, assign) BOOL animationPlayback;
+// The fraction of a tick the playback is ahead of currentAnimationTicks, in the range of 0 to 1, kept in the playback state record.
+@property (nonatomic, assign) double tickFraction;
+// A pool of INSKAMTimelineCursor objects, the first timelineCount ones walk on the current animation's timelines in their order.
+@property (nonatomic, strong) NSMutableArray *timelineCursors;
+// The number of timelines of the current animation.
+@property (nonatomic, assign) NSUInteger timelineCount;
+// The SKNode objects of the current animation's timelines taken from objectNodes, NSNull for timelines without a node. Only the first timelineCount entries are valid.
+@property (nonatomic, strong) NSMutableArray *timelineNodes;
+// The SKNode objects shared by all animations of the entity at their object index, NSNull for objects which haven't been shown yet.
+@property (nonatomic, strong) NSMutableArray *objectNodes;
+// The mainline key currently applied to the node tree or nil if none has been applied yet.
+@property (nonatomic, strong) INSKAMMainlineKey *mainlineKey;
+// The index of the applied mainline key in the animation's mainline keys.
+@property (nonatomic, assign) NSUInteger mainlineKeyIndex;
+// True if the object nodes have been created flattened, the timeline nodes of bones are NSNull then.
+@property (nonatomic, assign) BOOL flattenedTree;
+// True if the object nodes are used in the bones only mode, so there are no nodes at all.
+@property (nonatomic, assign) BOOL bonesOnlyTree;
+// A buffer with one INSKAMPose for each timeline holding the world poses of single evaluated timelines.
+@property (nonatomic, strong) NSMutableData *partialPoseData;
+// A BOOL for each timeline, true if its pose in partialPoseData is evaluated for the current animation time.
+@property (nonatomic, strong) NSMutableData *partialPoseMaskData;
+// True if partialPoseMaskData belongs to the current animation time.
+@property (nonatomic, assign) BOOL partialPosesValid;
+// A buffer for the INSKAMCollisionBox records of the animation's boxes.
+@property (nonatomic, strong) NSMutableData *collisionBoxData;
+// A buffer for the INSKAMCollisionPoint records of the animation's points.
+@property (nonatomic, strong) NSMutableData *collisionPointData;
+// The number of evaluated collision boxes.
+@property (nonatomic, assign, readwrite) NSUInteger collisionBoxCount;
+// The number of evaluated collision points.
+@property (nonatomic, assign, readwrite) NSUInteger collisionPointCount;
+// True if the collision boxes and points have been evaluated for the current animation time.
+@property (nonatomic, assign) BOOL collisionShapesEvaluated;
+// The index of the last looked up span of the animation's collision spans.
+@property (nonatomic, assign) NSUInteger collisionSpanIndex;
+// The index of the last looked up span of the animation's sprite spans.
+@property (nonatomic, assign) NSUInteger spriteSpanIndex;
+// True if the last update was skipped by culling.
+@property (nonatomic, assign, readwrite, getter=isCulled) BOOL culled;
+// True if the node tree doesn't show the current animation time, because an update has been culled or deferred.
+@property (nonatomic, assign) BOOL nodesOutdated;
+// True while the manager advances the time without updating the node tree.
+@property (nonatomic, assign) BOOL nodeUpdateDeferred;
+// The animation blended from or nil if not blending, its index is kept in the playback state record.
+@property (nonatomic, weak) INSKAMAnimation *blendSourceAnimation;
+// A pool of cursors like timelineCursors, the first blendSourceTimelineCount ones walk on the timelines of the animation blended from.
+@property (nonatomic, strong) NSMutableArray *blendSourceCursors;
+// The number of timelines of the animation blended from.
+@property (nonatomic, assign) NSUInteger blendSourceTimelineCount;
+// The blend's state, kept in the playback state record.
+// The time in ticks of the animation blended from.
+@property (nonatomic, assign) double blendSourceTime;
+// The looping flag of the animation blended from.
+@property (nonatomic, assign) BOOL blendSourceLooping;
+// The duration of the current blend.
+@property (nonatomic, assign) NSTimeInterval blendDuration;
+// The elapsed time of the current blend.
+@property (nonatomic, assign) NSTimeInterval blendElapsedTime;
+// True if the playback has just started and the events at time 0 are still to be passed, kept in the playback state record.
+@property (nonatomic, assign) BOOL startEventsDue;
+// The INSKAMEvent records passed by the current update, reused for each update.
+@property (nonatomic, strong) NSMutableData *passedEventData;
+// True while the passed events are reported to the delegate.
+@property (nonatomic, assign) BOOL deliveringEvents;
 
 @end
 
 
-@implementation INSKAnimationNode
+@implementation INSKAnimationNode {
+    // The playback state while the node isn't added to a manager.
+    INSKAnimationNodeState _ownState;
+    // The record the playback state is read from and written to, the own state or the node's slot in the manager's playback states.
+    INSKAnimationNodeState *_state;
+}
 
 - (instancetype)init {
     self = [super init];
     if (self == nil) return self;
     
-    self.animationSpeed = 1.0;
+    [self resetOwnState];
+    self.sleepIndex = NSNotFound;
+    self.stateSlot = NSNotFound;
+    self.zPositionStep = 0.001;
+    self.cullingRect = CGRectNull;
+    self.updateFrameInterval = 1;
     self.animationPlayback = NO;
+    self.mainlineKeyIndex = NSNotFound;
+    self.passedEventData = [NSMutableData data];
     
     return self;
 }
 
+- (instancetype)initWithCoder:(NSCoder *)aDecoder {
+    self = [super initWithCoder:aDecoder];
+    if (self == nil) return self;
+    
+    // the playback isn't archived
+    [self resetOwnState];
+    self.sleepIndex = NSNotFound;
+    self.stateSlot = NSNotFound;
+    self.mainlineKeyIndex = NSNotFound;
+    self.passedEventData = [NSMutableData data];
+    
+    return self;
+}
+
+- (void)dealloc {
+    // a saved state isn't restored into the slot of a deallocated node
+    if (_state != NULL && _state != &_ownState) {
+        _state->nodeSerial = 0;
+    }
+}
+
 - (instancetype)copyWithZone:(NSZone *)zone {
+    [self applyRestoredState];
     INSKAnimationNode *copy = [super copyWithZone:zone];
+    [copy resetOwnState];
+    copy.sleepIndex = NSNotFound;
+    copy.stateSlot = NSNotFound;
     copy.animationSpeed = self.animationSpeed;
+    copy.zPositionStep = self.zPositionStep;
+    copy.flattenedRendering = self.flattenedRendering;
+    copy.bonesOnly = self.bonesOnly;
+    copy.cullingRect = self.cullingRect;
+    copy.updateFrameInterval = self.updateFrameInterval;
+    copy.updatePriority = self.updatePriority;
     copy.animationManager = self.animationManager;
     copy.entity = self.entity;
-    copy.animation = self.animation;
-    copy.currentAnimationTime = self.currentAnimationTime; // TODO test this
-    copy.animationLength = self.animationLength;
+    copy.passedEventData = [NSMutableData data];
+    [copy createEvaluationBuffers];
+    copy.flattenedTree = self.flattenedTree;
+    copy.bonesOnlyTree = self.bonesOnlyTree;
+    
+    // the copied children contain the object nodes at the same positions
+    NSNull *noNode = [NSNull null];
+    NSUInteger objectCount = MIN(self.objectNodes.count, copy.objectNodes.count);
+    for (NSUInteger objectIndex = 0; objectIndex < objectCount; ++objectIndex) {
+        SKNode *node = self.objectNodes[objectIndex];
+        SKNode *copiedNode = (node != (id)noNode ? [self nodeInTree:copy atPositionOfNode:node] : nil);
+        if (copiedNode != nil) {
+            copy.objectNodes[objectIndex] = copiedNode;
+        }
+    }
+    if (self.animation != nil) {
+        [copy bindAnimation:self.animation];
+    }
+    copy.tickFraction = self.tickFraction;
+    copy.currentAnimationTicks = self.currentAnimationTicks; // TODO test this
     copy.animationPlayback = self.animationPlayback;
+    copy.startEventsDue = self.startEventsDue;
     copy.animationNodeDelegate = self.animationNodeDelegate;
     copy.loopAnimation = self.loopAnimation;
     return copy;
@@ -76,6 +254,12 @@
     // remove from an old manager if any
     [self.animationManager removeAnimationNode:self];
     
+    // the object nodes belong to the old entity
+    if (self.animation != nil) {
+        [self stopAnimation];
+    }
+    [self removeObjectNodes];
+    
     // bind new spriter manager
     self.animationManager = animationManager;
     
@@ -85,6 +269,9 @@
         return NO;
     }
     
+    // the buffers and the object nodes are shared by all animations of the entity
+    [self createEvaluationBuffers];
+    
     // add node to the manager
     [self.animationManager addAnimationNode:self];
     
@@ -92,150 +279,1105 @@
 }
 
 - (BOOL)playAnimation:(NSString *)animationName {
-    // first stop any old animation
-    if (self.animation != nil) {
-        [self stopAnimation];
-    }
+    [self wakeUp];
     
     // load animation data
-    self.animation = [self.entity.animationsByName objectForKey:animationName];
-    if (self.animation == nil) {
+    INSKAMAnimation *animation = [self.entity.animationsByName objectForKey:animationName];
+    if (animation == nil) {
+        // the old animation is stopped anyway
+        if (self.animation != nil) {
+            [self stopAnimation];
+        }
         return NO;
     }
+    [self stopBlending];
+    [self startAnimation:animation];
+    
+    return YES;
+}
 
-    // reset animation time and show first frame
-    self.animationLength = self.animation.length;
-    self.loopAnimation = self.animation.looping;
-    [self buildNodeTreeFromTimelines];
-    self.currentAnimationTime = 0; // also updates nodes
-    self.animationPlayback = YES;
+- (BOOL)playAnimation:(NSString *)animationName blendDuration:(NSTimeInterval)blendDuration {
+    // blending needs a current animation and objects identified across the animations
+    INSKAMAnimation *sourceAnimation = self.animation;
+    INSKAMAnimation *animation = [self.entity.animationsByName objectForKey:animationName];
+    if (blendDuration <= 0.0 || sourceAnimation == nil || animation == nil || self.entity.objectCount == 0) {
+        return [self playAnimation:animationName];
+    }
+    [self wakeUp];
+    
+    // the current cursors keep walking on the animation blended from and the other pool is bound to the new animation
+    double sourceTime = _state->ticks + self.tickFraction;
+    BOOL sourceLooping = self.loopAnimation;
+    NSUInteger sourceTimelineCount = self.timelineCount;
+    [self stopBlending];
+    NSMutableArray *sourceCursors = self.timelineCursors;
+    self.timelineCursors = self.blendSourceCursors;
+    self.blendSourceCursors = sourceCursors;
+    [self startAnimation:animation];
+    
+    self.blendSourceAnimation = sourceAnimation;
+    self.blendSourceTimelineCount = sourceTimelineCount;
+    self.blendSourceTime = sourceTime;
+    self.blendSourceLooping = sourceLooping;
+    self.blendDuration = blendDuration;
+    self.blendElapsedTime = 0.0;
     
+    // show the first blended frame instead of the new animation's first frame
+    [self updateNodesIfVisible];
     return YES;
 }
 
+- (BOOL)isBlending {
+    [self applyRestoredState];
+    return (self.blendSourceAnimation != nil);
+}
+
 - (void)stopAnimation {
+    [self wakeUp];
+    [self stopBlending];
+    
+    // the object nodes stay hidden for the next animation
+    [self hideObjectNodes];
     self.animation = nil;
+    _state->animationIndex = NSNotFound;
+    self.timelineCount = 0;
+    self.collisionBoxCount = 0;
+    self.collisionPointCount = 0;
+    self.collisionShapesEvaluated = NO;
+    self.partialPosesValid = NO;
+    self.culled = NO;
+    self.nodesOutdated = NO;
+    self.mainlineKey = nil;
+    self.mainlineKeyIndex = NSNotFound;
     self.animationPlayback = NO;
-    [self removeAllChildren];
+    self.startEventsDue = NO;
 }
 
 - (NSString *)currentAnimationName {
+    [self applyRestoredState];
     return self.animation.name;
 }
 
+- (NSTimeInterval)animationLength {
+    [self applyRestoredState];
+    return INSKAMSecondsFromTicks(self.animation.length);
+}
+
+- (CGFloat)animationSpeed {
+    return _state->speed;
+}
+
+- (void)setAnimationSpeed:(CGFloat)animationSpeed {
+    // the sleeping time has to be played with the old speed
+    [self wakeUp];
+    _state->speed = animationSpeed;
+}
+
+- (BOOL)loopAnimation {
+    return _state->looping;
+}
+
+- (void)setLoopAnimation:(BOOL)loopAnimation {
+    [self wakeUp];
+    _state->looping = loopAnimation;
+}
+
+- (NSTimeInterval)currentAnimationTime {
+    INSKAMTicks ticks;
+    double tickFraction;
+    [self projectTicks:&ticks tickFraction:&tickFraction];
+    return (ticks + tickFraction) / INSKAMTicksPerSecond;
+}
+
 - (void)setCurrentAnimationTime:(NSTimeInterval)currentAnimationTime {
-    _currentAnimationTime = currentAnimationTime;
-    self.animationPlayback = YES;
-    BOOL animationEndReached = NO;
-    BOOL animationLooped = NO;
+    [self wakeUp];
     
-    // make sure the time stays in bounds
-    if (self.animationLength == 0.0) {
-        _currentAnimationTime = 0.0;
+    // convert to ticks at the API edge
+    double ticks = currentAnimationTime * INSKAMTicksPerSecond;
+    INSKAMTicks wholeTicks = (INSKAMTicks)floor(ticks);
+    self.tickFraction = ticks - wholeTicks;
+    self.currentAnimationTicks = wholeTicks;
+}
+
+- (INSKAMTicks)currentAnimationTicks {
+    INSKAMTicks ticks;
+    double tickFraction;
+    [self projectTicks:&ticks tickFraction:&tickFraction];
+    return ticks;
+}
+
+// Returns the time the node has after catching up the time it has slept, without waking it.
+- (void)projectTicks:(INSKAMTicks *)ticks tickFraction:(double *)tickFraction {
+    INSKAnimationNodeState state = *_state;
+    if (_sleepIndex != NSNotFound) {
+        INSKAnimationNodeStateAdvance(&state, [self.animationManager sleptTimeOfAnimationNode:self], self.animation.length);
+    }
+    *ticks = state.ticks;
+    *tickFraction = state.tickFraction;
+}
+
+- (void)setCurrentAnimationTicks:(INSKAMTicks)currentAnimationTicks {
+    [self wakeUp];
+    _state->ticks = currentAnimationTicks;
+    self.collisionShapesEvaluated = NO;
+    self.partialPosesValid = NO;
+    self.animationPlayback = YES;
+    BOOL animationLooped, animationStopped;
+    BOOL animationEndReached = INSKAnimationNodeWrapTicks(&_state->ticks, self.animation.length, self.loopAnimation, &animationLooped, &animationStopped);
+    if (animationStopped) {
+        self.tickFraction = 0.0;
         self.animationPlayback = NO;
-        animationEndReached = YES;
-    } else if (_currentAnimationTime >= self.animationLength) {
-        // animation time exceeded
-        animationEndReached = YES;
-        if (self.loopAnimation) {
-            // animation loops
-            _currentAnimationTime -= self.animationLength * floor(_currentAnimationTime / self.animationLength);
-            animationLooped = YES;
-        } else {
-            // stop at last keyframe
-            _currentAnimationTime = self.animationLength;
-            self.animationPlayback = NO;
-        }
-    } else if (_currentAnimationTime < 0.0) {
-        // animation time below zero
-        animationEndReached = YES;
-        if (self.loopAnimation) {
-            // animation loops
-            _currentAnimationTime += self.animationLength * (1 + floor(-_currentAnimationTime / self.animationLength));
-            animationLooped = YES;
-        } else {
-            // stop at first keyframe
-            _currentAnimationTime = 0.0;
-            self.animationPlayback = NO;
-        }
     }
     
     // update nodes
-    [self updateNodes];
+    [self updateNodesIfVisible];
+    
+    // inform delegate about the events passed by the update, the delegate may change the time again while the events are delivered
+    // the manager may queue the calls until all nodes are updated
+    id<INSKAnimationNodeDelegate> delegate = self.animationNodeDelegate;
+    if (self.passedEventData.length > 0 && !self.deliveringEvents) {
+        self.deliveringEvents = YES;
+        if ([delegate respondsToSelector:@selector(animationNode:didPassEvents:count:)]) {
+            const INSKAMEvent *events = self.passedEventData.bytes;
+            NSUInteger eventCount = self.passedEventData.length / sizeof(INSKAMEvent);
+            if (![self.animationManager queueEvents:events count:eventCount ofAnimationNode:self]) {
+                [delegate animationNode:self didPassEvents:events count:eventCount];
+                INSKAnimationStatisticsCount([self.animationManager currentStatistics], delegateCalls, 1);
+            }
+        }
+        self.passedEventData.length = 0;
+        self.deliveringEvents = NO;
+    }
     
     // inform delegate about reaching the end of the animation
     if (animationEndReached) {
-        if ([self.animationNodeDelegate respondsToSelector:@selector(animationNodeDidFinishPlayback:looping:)]) {
-            [self.animationNodeDelegate animationNodeDidFinishPlayback:self looping:animationLooped];
+        if ([delegate respondsToSelector:@selector(animationNodeDidFinishPlayback:looping:)]) {
+            if (![self.animationManager queueFinishOfAnimationNode:self looping:animationLooped]) {
+                [delegate animationNodeDidFinishPlayback:self looping:animationLooped];
+                INSKAnimationStatisticsCount([self.animationManager currentStatistics], delegateCalls, 1);
+            }
         }
     }
 }
 
+- (NSString *)nameOfEvent:(INSKAMEvent)event {
+    NSAssert(event.eventlineIndex < self.animation.eventNames.count, @"event doesn't belong to the current animation");
+    return self.animation.eventNames[event.eventlineIndex];
+}
+
+- (NSUInteger)timelineIndexNamed:(NSString *)timelineName {
+    NSUInteger timelineCount = self.timelineCount;
+    for (NSUInteger timelineIndex = 0; timelineIndex < timelineCount; ++timelineIndex) {
+        INSKAMTimelineCursor *timelineCursor = self.timelineCursors[timelineIndex];
+        if ([timelineCursor.timeline.name isEqualToString:timelineName]) {
+            return timelineIndex;
+        }
+    }
+    return NSNotFound;
+}
+
+- (BOOL)evaluatePose:(INSKAMPose *)pose ofTimelineAtIndex:(NSUInteger)timelineIndex {
+    [self applyRestoredState];
+    if (self.animation == nil || timelineIndex >= self.timelineCount) {
+        return NO;
+    }
+    
+    // the mainline key isn't up to date if the node update has been culled or deferred
+    INSKAMTicks time = self.currentAnimationTicks;
+    [self updateMainlineKeyForTime:time];
+    INSKAMMainlineKey *mainlineKey = self.mainlineKey;
+    if (mainlineKey == nil) {
+        return NO;
+    }
+    NSUInteger chainCount = 0;
+    const NSUInteger *chain = [mainlineKey ancestorChainOfSlot:timelineIndex count:&chainCount];
+    if (chainCount == 0) {
+        return NO;
+    }
+    
+    // the masked poses are reused until the time changes
+    INSKAMPose *poses = self.partialPoseData.mutableBytes;
+    BOOL *evaluated = self.partialPoseMaskData.mutableBytes;
+    if (!self.partialPosesValid) {
+        memset(evaluated, 0, self.partialPoseMaskData.length);
+        self.partialPosesValid = YES;
+    }
+    
+    // walk the chain root first, so each parent's world pose is known
+    INSKAnimationStatistics *statistics = [self.animationManager currentStatistics];
+    INSKAMMainlineSlot *slots = mainlineKey.slots;
+    for (NSUInteger chainIndex = 0; chainIndex < chainCount; ++chainIndex) {
+        NSUInteger index = chain[chainIndex];
+        if (evaluated[index]) {
+            continue;
+        }
+        INSKAMTimelineCursor *timelineCursor = self.timelineCursors[index];
+        INSKAMSpatial *spatial = [timelineCursor spatialForTime:time];
+        INSKAnimationNodeCountEvaluation(statistics, spatial.time == time);
+        INSKAMPose localPose = [spatial poseWithInterpolation:(spatial.time == time ? 0.0 : [spatial interpolationRatioForTime:time])];
+        NSInteger parentIndex = slots[index].parentIndex;
+        poses[index] = (parentIndex != INSKAMMainlineNoParent ? INSKAMPoseConcat(poses[parentIndex], localPose) : localPose);
+        evaluated[index] = YES;
+    }
+    *pose = poses[timelineIndex];
+    return YES;
+}
+
+- (void)savePlaybackState:(INSKAnimationNodeState *)state {
+    // a sleeping node isn't woken, the saved time is the one it has after catching up
+    *state = *_state;
+    if (_sleepIndex != NSNotFound) {
+        INSKAnimationNodeStateAdvance(state, [self.animationManager sleptTimeOfAnimationNode:self], self.animation.length);
+    }
+}
+
+- (BOOL)restorePlaybackState:(const INSKAnimationNodeState *)state {
+    NSUInteger animationCount = self.entity.animations.count;
+    if ((state->animationIndex != NSNotFound && state->animationIndex >= animationCount)
+        || (state->blendSourceAnimationIndex != NSNotFound && state->blendSourceAnimationIndex >= animationCount)) {
+        return NO;
+    }
+    
+    // the node keeps its serial, a sleeping node wakes without catching up the slept time of the replaced state
+    NSUInteger nodeSerial = _state->nodeSerial;
+    *_state = *state;
+    _state->nodeSerial = nodeSerial;
+    _state->restorePending = YES;
+    [self wakeUp];
+    [self updateNodesIfVisible];
+    return YES;
+}
+
+- (CGRect)spriteBounds {
+    [self applyRestoredState];
+    return [self boundsInSpans:self.animation.spriteSpans spanIndex:&_spriteSpanIndex];
+}
+
+- (CGRect)spriteBoundsInParent {
+    return [self rectInParent:self.spriteBounds];
+}
+
+- (CGRect)collisionBounds {
+    [self applyRestoredState];
+    return [self boundsInSpans:self.animation.collisionSpans spanIndex:&_collisionSpanIndex];
+}
+
+- (CGRect)collisionBoundsInParent {
+    return [self rectInParent:self.collisionBounds];
+}
+
+- (NSUInteger)collisionBoxCount {
+    [self evaluateCollisionShapes];
+    return _collisionBoxCount;
+}
+
+- (const INSKAMCollisionBox *)collisionBoxes {
+    [self evaluateCollisionShapes];
+    return self.collisionBoxData.bytes;
+}
+
+- (NSUInteger)collisionPointCount {
+    [self evaluateCollisionShapes];
+    return _collisionPointCount;
+}
+
+- (const INSKAMCollisionPoint *)collisionPoints {
+    [self evaluateCollisionShapes];
+    return self.collisionPointData.bytes;
+}
+
+
+#pragma mark - playback state record
+
+- (BOOL)animationPlayback {
+    return _state->playing;
+}
+
+- (void)setAnimationPlayback:(BOOL)animationPlayback {
+    _state->playing = animationPlayback;
+}
+
+- (double)tickFraction {
+    return _state->tickFraction;
+}
+
+- (void)setTickFraction:(double)tickFraction {
+    _state->tickFraction = tickFraction;
+}
+
+- (BOOL)startEventsDue {
+    return _state->startEventsDue;
+}
+
+- (void)setStartEventsDue:(BOOL)startEventsDue {
+    _state->startEventsDue = startEventsDue;
+}
+
+- (void)setBlendSourceAnimation:(INSKAMAnimation *)blendSourceAnimation {
+    _blendSourceAnimation = blendSourceAnimation;
+    _state->blendSourceAnimationIndex = (blendSourceAnimation != nil ? blendSourceAnimation.animationIndex : NSNotFound);
+}
+
+- (double)blendSourceTime {
+    return _state->blendSourceTime;
+}
+
+- (void)setBlendSourceTime:(double)blendSourceTime {
+    _state->blendSourceTime = blendSourceTime;
+}
+
+- (BOOL)blendSourceLooping {
+    return _state->blendSourceLooping;
+}
+
+- (void)setBlendSourceLooping:(BOOL)blendSourceLooping {
+    _state->blendSourceLooping = blendSourceLooping;
+}
+
+- (NSTimeInterval)blendDuration {
+    return _state->blendDuration;
+}
+
+- (void)setBlendDuration:(NSTimeInterval)blendDuration {
+    _state->blendDuration = blendDuration;
+}
+
+- (NSTimeInterval)blendElapsedTime {
+    return _state->blendElapsedTime;
+}
+
+- (void)setBlendElapsedTime:(NSTimeInterval)blendElapsedTime {
+    _state->blendElapsedTime = blendElapsedTime;
+}
+
+- (NSUInteger)stateSerial {
+    return _state->nodeSerial;
+}
+
+- (void)setStateSerial:(NSUInteger)stateSerial {
+    _state->nodeSerial = stateSerial;
+}
+
+- (INSKAnimationNodeState *)stateRecord {
+    return _state;
+}
+
+- (void)setStateRecord:(INSKAnimationNodeState *)stateRecord {
+    if (stateRecord != NULL) {
+        _state = stateRecord;
+    } else if (_state != &_ownState) {
+        // the state is taken along when the node leaves the manager
+        _ownState = *_state;
+        _state = &_ownState;
+    }
+}
+
 
 #pragma mark - engine privates
 
-- (void)buildNodeTreeFromTimelines {
-    NSAssert(self.animation != nil, @"Animation needed");
-    for (INSKAMTimeline *timeline in self.animation.timelinesById.allValues) {
-        INSKAMSpatial *spatial = timeline.spatialsByTime[0];
-        SKNode *node = [spatial createNodeForManager:self.animationManager];
+// Starts the playback of an animation from its first frame.
+- (void)startAnimation:(INSKAMAnimation *)animation {
+    // a lazily loaded animation is converted on its first use
+    [animation prepare];
+    [self bindAnimation:animation];
+    
+    // reset animation time and show first frame
+    self.loopAnimation = animation.looping;
+    self.tickFraction = 0.0;
+    self.currentAnimationTicks = 0; // also updates nodes
+    self.animationPlayback = YES;
+    self.startEventsDue = YES;
+}
+
+// Switches the cursors and the object nodes to the timelines of an animation, nodes are only created for objects shown for the first time.
+- (void)bindAnimation:(INSKAMAnimation *)animation {
+    INSKAnimationTraceScoped("bind animation");
+    
+    // another tree mode needs another node set
+    if (self.flattenedTree != self.flattenedRendering || self.bonesOnlyTree != self.bonesOnly) {
+        [self removeObjectNodes];
+    }
+    
+    // objects of the previous animation may not be part of this one
+    [self hideObjectNodes];
+    self.animation = animation;
+    _state->animationIndex = animation.animationIndex;
+    self.timelineCount = [self bindCursors:self.timelineCursors toAnimation:animation];
+    for (NSUInteger timelineIndex = 0; timelineIndex < self.timelineCount; ++timelineIndex) {
+        self.timelineNodes[timelineIndex] = [self objectNodeForTimelineCursor:self.timelineCursors[timelineIndex]];
+    }
+    
+    // the first mainline key applies the hierarchy and the drawing order to all nodes
+    self.mainlineKey = nil;
+    self.mainlineKeyIndex = NSNotFound;
+    self.collisionBoxCount = 0;
+    self.collisionPointCount = 0;
+    self.collisionShapesEvaluated = NO;
+    self.partialPosesValid = NO;
+    self.collisionSpanIndex = NSNotFound;
+    self.spriteSpanIndex = NSNotFound;
+    self.culled = NO;
+    self.nodesOutdated = NO;
+}
+
+// Resets the cursors of a pool to the timelines of an animation and returns the number of timelines.
+- (NSUInteger)bindCursors:(NSArray *)timelineCursors toAnimation:(INSKAMAnimation *)animation {
+    NSArray *timelines = animation.timelines;
+    NSUInteger timelineCount = timelines.count;
+    [self reserveBuffersForTimelineCount:timelineCount];
+    for (NSUInteger timelineIndex = 0; timelineIndex < timelineCount; ++timelineIndex) {
+        [timelineCursors[timelineIndex] resetWithTimeline:timelines[timelineIndex]];
+    }
+    return timelineCount;
+}
+
+// Returns the node of the object a timeline animates, created when the object is shown for the first time, or NSNull if the timeline needs no node.
+- (id)objectNodeForTimelineCursor:(INSKAMTimelineCursor *)timelineCursor {
+    INSKAMSpatial *spatial = [timelineCursor spatialForTime:0];
+    if (![self needsNodeForSpatialType:spatial.spatialType]) {
+        // only calculated
+        return [NSNull null];
+    }
+    
+    // an object which hasn't been registered when the entity was loaded gets its slot now
+    NSUInteger objectIndex = timelineCursor.timeline.objectIndex;
+    while (self.objectNodes.count <= objectIndex) {
+        [self.objectNodes addObject:[NSNull null]];
+    }
+    
+    SKNode *node = self.objectNodes[objectIndex];
+    BOOL sprite = (spatial.spatialType == INSKAMSpatialTypeSprite);
+    if (node == (id)[NSNull null] || [node isKindOfClass:[SKSpriteNode class]] != sprite) {
+        // a new object or one which is a bone in one animation and a sprite in another
+        [node removeFromParent];
+        node = [spatial createNodeForManager:self.animationManager];
         [self addChild:node];
+        self.objectNodes[objectIndex] = node;
+    } else if (sprite) {
+        // a sprite gets the size of its first texture like a new node
+        ((SKSpriteNode *)node).size = CGSizeMake(spatial.texture.width, spatial.texture.height);
+    }
+    return node;
+}
+
+// Hides the nodes of all objects, the mainline keys show the ones of the current animation again.
+- (void)hideObjectNodes {
+    NSNull *noNode = [NSNull null];
+    for (SKNode *node in self.objectNodes) {
+        if (node != (id)noNode) {
+            node.hidden = YES;
+        }
+    }
+}
+
+// Removes the nodes of all objects, i.e. when the tree mode or the entity changes.
+- (void)removeObjectNodes {
+    NSNull *noNode = [NSNull null];
+    NSUInteger objectCount = self.objectNodes.count;
+    for (NSUInteger objectIndex = 0; objectIndex < objectCount; ++objectIndex) {
+        SKNode *node = self.objectNodes[objectIndex];
+        if (node != (id)noNode) {
+            [node removeFromParent];
+            self.objectNodes[objectIndex] = noNode;
+        }
+    }
+    self.flattenedTree = self.flattenedRendering;
+    self.bonesOnlyTree = self.bonesOnly;
+}
+
+// Returns the node at the same position in another tree as the given node in this one, i.e. in a copy of this node.
+- (SKNode *)nodeInTree:(SKNode *)root atPositionOfNode:(SKNode *)node {
+    if (node == self) {
+        return root;
+    }
+    SKNode *parent = node.parent;
+    if (parent == nil) {
+        // not part of the tree
+        return nil;
+    }
+    SKNode *otherParent = [self nodeInTree:root atPositionOfNode:parent];
+    NSUInteger index = [parent.children indexOfObjectIdenticalTo:node];
+    return (index < otherParent.children.count ? otherParent.children[index] : nil);
+}
+
+// Returns true if a timeline of the type is represented by a node in the current tree.
+- (BOOL)needsNodeForSpatialType:(INSKAMSpatialType)spatialType {
+    if (spatialType == INSKAMSpatialTypeSprite) {
+        return !self.bonesOnlyTree;
+    } else if (spatialType == INSKAMSpatialTypeNode) {
+        // bones exist only as math in a flattened tree
+        return !self.flattenedTree && !self.bonesOnlyTree;
+    }
+    return NO;
+}
+
+// Returns the bounds of the span for the current time, the span index is a cache for the last looked up span.
+- (CGRect)boundsInSpans:(NSData *)spans spanIndex:(NSUInteger *)spanIndex {
+    NSUInteger spanCount = spans.length / sizeof(INSKAMBoundsSpan);
+    if (spanCount == 0) {
+        return CGRectNull;
+    }
+    
+    // the last span is still valid if the time lays before the next one
+    const INSKAMBoundsSpan *boundsSpans = spans.bytes;
+    INSKAMTicks time = self.currentAnimationTicks;
+    NSUInteger index = *spanIndex;
+    if (index >= spanCount || boundsSpans[index].time > time || (index + 1 < spanCount && boundsSpans[index + 1].time <= time)) {
+        // most times playback has just moved on to the next span
+        if (index + 1 < spanCount && boundsSpans[index + 1].time <= time && (index + 2 == spanCount || boundsSpans[index + 2].time > time)) {
+            index = index + 1;
+        } else {
+            index = [self.animation boundsSpanIndexForTime:time inSpans:spans];
+        }
+        *spanIndex = index;
+    }
+    return boundsSpans[index].bounds;
+}
+
+// Transforms a rect from this node's space to the parent's space and returns the bounding rect of the result.
+- (CGRect)rectInParent:(CGRect)bounds {
+    if (CGRectIsNull(bounds)) {
+        return bounds;
+    }
+    
+    // scale, rotate and translate the corners like the node does
+    CGPoint corners[4] = {
+        CGPointMake(CGRectGetMinX(bounds), CGRectGetMinY(bounds)),
+        CGPointMake(CGRectGetMaxX(bounds), CGRectGetMinY(bounds)),
+        CGPointMake(CGRectGetMaxX(bounds), CGRectGetMaxY(bounds)),
+        CGPointMake(CGRectGetMinX(bounds), CGRectGetMaxY(bounds))
+    };
+    CGFloat sine = sin(self.zRotation);
+    CGFloat cosine = cos(self.zRotation);
+    CGRect parentBounds = CGRectNull;
+    for (NSUInteger index = 0; index < 4; ++index) {
+        CGFloat x = corners[index].x * self.xScale;
+        CGFloat y = corners[index].y * self.yScale;
+        CGRect corner = CGRectMake(self.position.x + cosine * x - sine * y, self.position.y + sine * x + cosine * y, 0.0, 0.0);
+        parentBounds = CGRectUnion(parentBounds, corner);
+    }
+    return parentBounds;
+}
+
+// Allocates the cursor pools, the object node slots and the buffers for the entity, so switching between its animations allocates nothing.
+- (void)createEvaluationBuffers {
+    NSUInteger objectCount = self.entity.objectCount;
+    self.objectNodes = [NSMutableArray arrayWithCapacity:objectCount];
+    for (NSUInteger objectIndex = 0; objectIndex < objectCount; ++objectIndex) {
+        [self.objectNodes addObject:[NSNull null]];
+    }
+    self.flattenedTree = self.flattenedRendering;
+    self.bonesOnlyTree = self.bonesOnly;
+    self.timelineCursors = [NSMutableArray arrayWithCapacity:objectCount];
+    self.blendSourceCursors = [NSMutableArray arrayWithCapacity:objectCount];
+    self.timelineNodes = [NSMutableArray arrayWithCapacity:objectCount];
+    self.partialPoseData = nil;
+    self.partialPoseMaskData = nil;
+    self.collisionBoxData = nil;
+    self.collisionPointData = nil;
+    
+    // each animation animates each object with one timeline at most
+    [self reserveBuffersForTimelineCount:objectCount];
+}
+
+// Grows the cursor pools and the buffers per timeline, they only grow if an animation has more timelines than the entity has objects.
+- (void)reserveBuffersForTimelineCount:(NSUInteger)timelineCount {
+    while (self.timelineCursors.count < timelineCount) {
+        [self.timelineCursors addObject:[[INSKAMTimelineCursor alloc] initWithTimeline:nil]];
+        [self.blendSourceCursors addObject:[[INSKAMTimelineCursor alloc] initWithTimeline:nil]];
+        [self.timelineNodes addObject:[NSNull null]];
+    }
+    if (self.partialPoseData == nil || self.partialPoseMaskData.length < timelineCount * sizeof(BOOL)) {
+        self.partialPoseData = [NSMutableData dataWithLength:timelineCount * sizeof(INSKAMPose)];
+        self.partialPoseMaskData = [NSMutableData dataWithLength:timelineCount * sizeof(BOOL)];
+        self.partialPosesValid = NO;
+        self.collisionBoxData = [NSMutableData dataWithLength:timelineCount * sizeof(INSKAMCollisionBox)];
+        self.collisionPointData = [NSMutableData dataWithLength:timelineCount * sizeof(INSKAMCollisionPoint)];
     }
 }
 
 - (void)updateTime:(NSTimeInterval)deltaTime {
+    [self updateTime:deltaTime updateNodes:YES];
+}
+
+- (void)updateTime:(NSTimeInterval)deltaTime updateNodes:(BOOL)updateNodes {
+    [self applyRestoredState];
+    
     // only process if there is an animation at all
     if (!self.animationPlayback || self.animation == nil) {
+        // a stopped animation which has been culled or deferred needs its last update
+        if (updateNodes && self.nodesOutdated && self.animation != nil) {
+            [self updateNodesIfVisible];
+        }
         return;
     }
     
-    // update time
-    self.currentAnimationTime += deltaTime * self.animationSpeed;
+    // the animation blended from plays in the background
+    if (self.blendSourceAnimation != nil) {
+        [self advanceBlendByTime:deltaTime];
+    }
+    
+    // update time, the fraction of a tick is carried over to the next frame
+    double ticks = self.tickFraction + deltaTime * self.animationSpeed * INSKAMTicksPerSecond;
+    INSKAMTicks wholeTicks = (INSKAMTicks)floor(ticks);
+    self.tickFraction = ticks - wholeTicks;
+    
+    // find the events between the old and the new time before the time gets wrapped
+    if (wholeTicks != 0 && !self.deliveringEvents) {
+        INSKAMTicks eventStartTime = (self.startEventsDue ? -1 : _state->ticks);
+        [self.animation collectEventsFromTime:eventStartTime toTime:_state->ticks + wholeTicks looping:self.loopAnimation passedEvents:self.passedEventData];
+        self.startEventsDue = NO;
+    }
+    
+    self.nodeUpdateDeferred = !updateNodes;
+    self.currentAnimationTicks = _state->ticks + wholeTicks;
+    self.nodeUpdateDeferred = NO;
 }
 
-- (void)updateNodes {
-    // no updates if there is no animation
-    if (self.animation == nil) {
+- (NSTimeInterval)sleepDuration {
+    if (self.nodesOutdated || self.blendSourceAnimation != nil || self.startEventsDue) {
+        return 0.0;
+    }
+    if (!self.animationPlayback || self.animation == nil || self.animationSpeed == 0.0) {
+        // nothing changes until a property is changed
+        return INFINITY;
+    }
+    
+    NSUInteger spanIndex = [self.animation holdSpanIndexForTime:_state->ticks];
+    if (spanIndex == NSNotFound) {
+        return 0.0;
+    }
+    const INSKAMHoldSpan *holdSpan = (const INSKAMHoldSpan *)self.animation.holdSpans.bytes + spanIndex;
+    double time = _state->ticks + self.tickFraction;
+    // backwards the change comes with leaving the span's start, so a bit more than the distance is needed
+    double ticks = (self.animationSpeed > 0.0 ? holdSpan->endTime - time : time - holdSpan->time + 0.001);
+    ticks = MIN(ticks, [self ticksToNextEventFromTime:time]);
+    return ticks / (fabs(self.animationSpeed) * INSKAMTicksPerSecond);
+}
+
+// Returns the playback distance in ticks to the next event, so a sleeping node wakes in time to pass it, or INFINITY if there is none.
+- (double)ticksToNextEventFromTime:(double)time {
+    NSUInteger eventCount = self.animation.events.length / sizeof(INSKAMEvent);
+    if (eventCount == 0) {
+        return INFINITY;
+    }
+    const INSKAMEvent *events = self.animation.events.bytes;
+    INSKAMTicks length = self.animation.length;
+    if (self.animationSpeed > 0.0) {
+        NSUInteger index = [self.animation eventIndexAfterTime:_state->ticks];
+        if (index < eventCount) {
+            return events[index].time - time;
+        }
+        return (self.loopAnimation ? events[0].time + length - time : INFINITY);
+    } else {
+        NSUInteger index = [self.animation eventIndexAfterTime:_state->ticks - 1];
+        if (index > 0) {
+            return time - events[index - 1].time + 0.001;
+        }
+        return (self.loopAnimation ? time - (events[eventCount - 1].time - length) + 0.001 : INFINITY);
+    }
+}
+
+// Asks the manager to wake this node if it is sleeping and binds a restored state before it's changed.
+- (void)wakeUp {
+    if (_sleepIndex != NSNotFound) {
+        [self.animationManager wakeAnimationNode:self];
+    }
+    [self applyRestoredState];
+}
+
+// Initializes the own playback state and reads and writes the playback state from it.
+- (void)resetOwnState {
+    memset(&_ownState, 0, sizeof(INSKAnimationNodeState));
+    _ownState.animationIndex = NSNotFound;
+    _ownState.blendSourceAnimationIndex = NSNotFound;
+    _ownState.speed = 1.0;
+    _state = &_ownState;
+}
+
+// Binds the animations of a state the manager has restored into the record, the record already holds the restored values.
+- (void)applyRestoredState {
+    if (!_state->restorePending) {
+        return;
+    }
+    _state->restorePending = NO;
+    INSKAnimationNodeState state = *_state;
+    
+    // a record which doesn't fit the entity stops the animation
+    NSArray *animations = self.entity.animations;
+    INSKAMAnimation *animation = (state.animationIndex < animations.count ? animations[state.animationIndex] : nil);
+    INSKAMAnimation *blendSourceAnimation = (animation != nil && state.blendSourceAnimationIndex < animations.count ? animations[state.blendSourceAnimationIndex] : nil);
+    if (animation == nil) {
+        if (self.animation != nil) {
+            [self stopAnimation];
+        }
+        state.animationIndex = NSNotFound;
+        state.playing = NO;
+        state.startEventsDue = NO;
+    } else {
+        // the cursors and nodes are only bound to another animation
+        [animation prepare];
+        if (animation != self.animation) {
+            [self bindAnimation:animation];
+        }
+        
+        // the cursors of the animation blended from are kept if it's the same
+        if (blendSourceAnimation == nil) {
+            [self stopBlending];
+        } else if (blendSourceAnimation != self.blendSourceAnimation) {
+            [blendSourceAnimation prepare];
+            self.blendSourceAnimation = blendSourceAnimation;
+            self.blendSourceTimelineCount = [self bindCursors:self.blendSourceCursors toAnimation:blendSourceAnimation];
+        }
+    }
+    if (blendSourceAnimation == nil) {
+        state.blendSourceAnimationIndex = NSNotFound;
+    }
+    
+    // the saved time is in bounds, so it's applied without wrapping it and without calling the delegate
+    *_state = state;
+    self.passedEventData.length = 0;
+    self.collisionShapesEvaluated = NO;
+    self.partialPosesValid = NO;
+    self.nodesOutdated = (animation != nil);
+}
+
+// Updates the nodes unless the update is deferred or the sprites are outside of the culling rect.
+- (void)updateNodesIfVisible {
+    if (self.nodeUpdateDeferred) {
+        self.nodesOutdated = YES;
+        return;
+    }
+    self.culled = !CGRectIsNull(self.cullingRect) && !CGRectIntersectsRect(self.spriteBoundsInParent, self.cullingRect);
+    self.nodesOutdated = self.culled;
+    if (!self.culled) {
+        INSKAnimationStatistics *statistics = [self.animationManager currentStatistics];
+        CFTimeInterval startTime = INSKAnimationStatisticsTimestamp();
+        [self updateNodesWithStatistics:statistics];
+        INSKAnimationStatisticsCount(statistics, nodeUpdateTime, INSKAnimationStatisticsTimestamp() - startTime);
+    }
+}
+
+// Evaluates the timelines for the current time and applies the poses to the nodes, the time is measured once around all timelines.
+- (void)updateNodesWithStatistics:(INSKAnimationStatistics *)statistics {
+    // no updates if there is no animation or nothing to show
+    if (self.animation == nil || self.bonesOnlyTree) {
+        return;
+    }
+    INSKAnimationTraceScoped("update nodes");
+    
+    // the hierarchy only changes when crossing a mainline key
+    INSKAMTicks time = self.currentAnimationTicks;
+    [self updateMainlineKeyForTime:time];
+    INSKAMMainlineSlot *slots = self.mainlineKey.slots;
+    const BOOL *blendMask = NULL;
+    const INSKAMPose *blendPoses = [self evaluateBlendSourcePosesWithMask:&blendMask statistics:statistics];
+    CFTimeInterval startTime = INSKAnimationStatisticsTimestamp();
+    if (self.flattenedTree) {
+        [self updateFlattenedNodesForTime:time blendPoses:blendPoses blendMask:blendMask statistics:statistics];
+        INSKAnimationStatisticsCount(statistics, propertyTime, INSKAnimationStatisticsTimestamp() - startTime);
         return;
     }
     
     // process the timelines
-    NSArray *timelines = self.animation.timelinesById.allValues;
-    for (INSKAMTimeline *timeline in timelines) {
-        INSKAMSpatial *spatial = [timeline spatialForTime:self.currentAnimationTime];
+    NSNull *noNode = [NSNull null];
+    NSUInteger timelineCount = self.timelineCount;
+    for (NSUInteger timelineIndex = 0; timelineIndex < timelineCount; ++timelineIndex) {
+        // inactive timelines are hidden and need no update, neither timelines without a node
+        SKNode *spatialNode = self.timelineNodes[timelineIndex];
+        if ((slots != NULL && !slots[timelineIndex].active) || spatialNode == (id)noNode) {
+            continue;
+        }
+        
+        INSKAMTimelineCursor *timelineCursor = self.timelineCursors[timelineIndex];
+        INSKAMSpatial *spatial = [timelineCursor spatialForTime:time];
         NSAssert(spatial != nil, @"A Spatial should be found");
-        NSString *searchString = [NSString stringWithFormat:@"//%@", spatial.nodeName];
-        SKNode *spatialNode = [self childNodeWithName:searchString];
-        NSAssert(spatialNode != nil, @"There should be a node for each spatial");
+        INSKAnimationNodeCountEvaluation(statistics, spatial.time == time);
         
-        // update tree order
-        if (spatial.parentNodeName == nil) {
-            // no parent, move to root if needed
-            if (spatialNode.parent != self) {
-                [spatialNode removeFromParent];
-                [self addChild:spatialNode];
-            }
-        } else {
-            // change parent if needed
-            if (![spatial.parentNodeName isEqualToString:spatialNode.parent.name]) {
-                NSString *searchString = [NSString stringWithFormat:@"//%@", spatial.parentNodeName];
-                SKNode *parentNode = [self childNodeWithName:searchString];
-                NSAssert(parentNode != nil, @"There should be a parent node");
-                [spatialNode removeFromParent];
-                [parentNode addChild:spatialNode];
-            }
+        // blend with the pose of the animation blended from
+        if (blendPoses != NULL) {
+            INSKAMPose pose = [spatial poseWithInterpolation:(spatial.time == time ? 0.0 : [spatial interpolationRatioForTime:time])];
+            pose = [self blendPose:pose ofTimeline:timelineCursor.timeline withPoses:blendPoses mask:blendMask];
+            [spatial updateNode:spatialNode pose:pose animationManager:self.animationManager];
+            continue;
         }
         
         // update values
-        if ([spatial equalsTime:self.currentAnimationTime]) {
+        if (spatial.time == time) {
             // spatial for time, no interpolation needed
             [spatial updateNode:spatialNode interpolation:0.0 animationManager:self.animationManager];
         } else {
             // interpolate spatials
-            CGFloat interpolationRatio = [spatial interpolationRatioForTime:self.currentAnimationTime];
+            CGFloat interpolationRatio = [spatial interpolationRatioForTime:time];
             [spatial updateNode:spatialNode interpolation:interpolationRatio animationManager:self.animationManager];
         }
     }
+    INSKAnimationStatisticsCount(statistics, propertyTime, INSKAnimationStatisticsTimestamp() - startTime);
+}
+
+// Evaluates the world pose of each active timeline parents first and applies them to the sprites directly attached to this node.
+- (void)updateFlattenedNodesForTime:(INSKAMTicks)time blendPoses:(const INSKAMPose *)blendPoses blendMask:(const BOOL *)blendMask statistics:(INSKAnimationStatistics *)statistics {
+    INSKAMMainlineKey *mainlineKey = self.mainlineKey;
+    if (mainlineKey == nil) {
+        return;
+    }
+    INSKAMMainlineSlot *slots = mainlineKey.slots;
+    NSUInteger *evaluationOrder = mainlineKey.evaluationOrder;
+    NSUInteger evaluationCount = mainlineKey.evaluationCount;
+    INSKAMPose *poses = [self.entity targetPosesWithCount:self.timelineCount];
+    NSNull *noNode = [NSNull null];
+    
+    for (NSUInteger orderIndex = 0; orderIndex < evaluationCount; ++orderIndex) {
+        NSUInteger timelineIndex = evaluationOrder[orderIndex];
+        INSKAMTimelineCursor *timelineCursor = self.timelineCursors[timelineIndex];
+        SKNode *spatialNode = self.timelineNodes[timelineIndex];
+        if (spatialNode == (id)noNode && timelineCursor.timeline.spatialType != INSKAMSpatialTypeNode) {
+            // collision boxes and points are evaluated on demand
+            continue;
+        }
+        INSKAMSpatial *spatial = [timelineCursor spatialForTime:time];
+        NSAssert(spatial != nil, @"A Spatial should be found");
+        INSKAnimationNodeCountEvaluation(statistics, spatial.time == time);
+        
+        // local pose composed with the parent's world pose which has been evaluated already
+        CGFloat interpolationRatio = (spatial.time == time ? 0.0 : [spatial interpolationRatioForTime:time]);
+        INSKAMPose pose = [spatial poseWithInterpolation:interpolationRatio];
+        if (blendPoses != NULL) {
+            pose = [self blendPose:pose ofTimeline:timelineCursor.timeline withPoses:blendPoses mask:blendMask];
+        }
+        NSInteger parentIndex = slots[timelineIndex].parentIndex;
+        if (parentIndex != INSKAMMainlineNoParent) {
+            pose = INSKAMPoseConcat(poses[parentIndex], pose);
+        }
+        poses[timelineIndex] = pose;
+        
+        // only sprites have a node
+        if (spatialNode != (id)noNode) {
+            [spatial updateNode:spatialNode pose:pose animationManager:self.animationManager];
+        }
+    }
+}
+
+// Plays the animation blended from and ends the blend after its duration.
+- (void)advanceBlendByTime:(NSTimeInterval)deltaTime {
+    self.blendElapsedTime += deltaTime * fabs(self.animationSpeed);
+    if (self.blendElapsedTime >= self.blendDuration) {
+        [self stopBlending];
+        return;
+    }
+    
+    // loop or clamp like the playback of the animation blended from would do
+    double time = self.blendSourceTime + deltaTime * self.animationSpeed * INSKAMTicksPerSecond;
+    double length = self.blendSourceAnimation.length;
+    if (self.blendSourceLooping && length > 0.0) {
+        time = fmod(time, length);
+        if (time < 0.0) {
+            time += length;
+        }
+    } else {
+        time = MAX(0.0, MIN(time, length));
+    }
+    self.blendSourceTime = time;
+}
+
+// Ends blending and releases the animation blended from, its cursors stay in the pool.
+- (void)stopBlending {
+    self.blendSourceAnimation = nil;
+    self.blendSourceTimelineCount = 0;
+}
+
+// Evaluates the local poses of the animation blended from into the entity's source buffer, returns NULL if not blending.
+- (const INSKAMPose *)evaluateBlendSourcePosesWithMask:(const BOOL **)blendMask statistics:(INSKAnimationStatistics *)statistics {
+    INSKAMAnimation *sourceAnimation = self.blendSourceAnimation;
+    if (sourceAnimation == nil) {
+        return NULL;
+    }
+    INSKAMTicks time = (INSKAMTicks)floor(self.blendSourceTime);
+    NSUInteger mainlineKeyIndex = [sourceAnimation mainlineKeyIndexForTime:time];
+    if (mainlineKeyIndex == NSNotFound) {
+        return NULL;
+    }
+    INSKAMMainlineSlot *slots = ((INSKAMMainlineKey *)sourceAnimation.mainlineKeys[mainlineKeyIndex]).slots;
+    
+    INSKAMEntity *entity = self.entity;
+    BOOL *mask = NULL;
+    INSKAMPose *poses = [entity sourcePosesWithMask:&mask];
+    memset(mask, 0, entity.objectCount * sizeof(BOOL));
+    NSUInteger timelineCount = self.blendSourceTimelineCount;
+    for (NSUInteger timelineIndex = 0; timelineIndex < timelineCount; ++timelineIndex) {
+        INSKAMTimelineCursor *timelineCursor = self.blendSourceCursors[timelineIndex];
+        INSKAMSpatialType spatialType = timelineCursor.timeline.spatialType;
+        if (!slots[timelineIndex].active || (spatialType != INSKAMSpatialTypeNode && spatialType != INSKAMSpatialTypeSprite)) {
+            continue;
+        }
+        INSKAMSpatial *spatial = [timelineCursor spatialForTime:time];
+        INSKAnimationNodeCountEvaluation(statistics, spatial.time == time);
+        NSUInteger objectIndex = timelineCursor.timeline.objectIndex;
+        poses[objectIndex] = [spatial poseWithInterpolation:(spatial.time == time ? 0.0 : [spatial interpolationRatioForTime:time])];
+        mask[objectIndex] = YES;
+    }
+    *blendMask = mask;
+    return poses;
+}
+
+// Blends a local pose of the current animation with the pose of the same object of the animation blended from.
+- (INSKAMPose)blendPose:(INSKAMPose)pose ofTimeline:(INSKAMTimeline *)timeline withPoses:(const INSKAMPose *)blendPoses mask:(const BOOL *)mask {
+    NSUInteger objectIndex = timeline.objectIndex;
+    if (!mask[objectIndex]) {
+        return pose;
+    }
+    return INSKAMPoseBlend(blendPoses[objectIndex], pose, self.blendElapsedTime / self.blendDuration);
+}
+
+// Evaluates the collision boxes and points of the current time with their parent bones if not already done.
+- (void)evaluateCollisionShapes {
+    [self applyRestoredState];
+    if (self.collisionShapesEvaluated) {
+        return;
+    }
+    self.collisionShapesEvaluated = YES;
+    _collisionBoxCount = 0;
+    _collisionPointCount = 0;
+    if (self.animation == nil) {
+        return;
+    }
+    
+    // the mainline key isn't up to date if the node update has been culled or deferred
+    [self updateMainlineKeyForTime:self.currentAnimationTicks];
+    INSKAMMainlineKey *mainlineKey = self.mainlineKey;
+    if (mainlineKey == nil || self.animation.collisionSpans == nil) {
+        return;
+    }
+    
+    INSKAMTicks time = self.currentAnimationTicks;
+    INSKAMMainlineSlot *slots = mainlineKey.slots;
+    NSUInteger *evaluationOrder = mainlineKey.evaluationOrder;
+    NSUInteger evaluationCount = mainlineKey.evaluationCount;
+    INSKAMPose *poses = [self.entity targetPosesWithCount:self.timelineCount];
+    INSKAMCollisionBox *boxes = self.collisionBoxData.mutableBytes;
+    INSKAMCollisionPoint *points = self.collisionPointData.mutableBytes;
+    for (NSUInteger orderIndex = 0; orderIndex < evaluationCount; ++orderIndex) {
+        NSUInteger timelineIndex = evaluationOrder[orderIndex];
+        INSKAMTimelineCursor *timelineCursor = self.timelineCursors[timelineIndex];
+        INSKAMSpatialType spatialType = timelineCursor.timeline.spatialType;
+        if (spatialType == INSKAMSpatialTypeSprite) {
+            // sprites are never parents
+            continue;
+        }
+        
+        // world pose composed from the parent bones
+        INSKAMSpatial *spatial = [timelineCursor spatialForTime:time];
+        CGFloat interpolationRatio = (spatial.time == time ? 0.0 : [spatial interpolationRatioForTime:time]);
+        INSKAMPose pose = [spatial poseWithInterpolation:interpolationRatio];
+        NSInteger parentIndex = slots[timelineIndex].parentIndex;
+        if (parentIndex != INSKAMMainlineNoParent) {
+            pose = INSKAMPoseConcat(poses[parentIndex], pose);
+        }
+        poses[timelineIndex] = pose;
+        if (pose.hidden) {
+            continue;
+        }
+        
+        if (spatialType == INSKAMSpatialTypeCollisionbox) {
+            INSKAMCollisionBox *box = &boxes[_collisionBoxCount++];
+            box->timelineIndex = timelineIndex;
+            INSKAMCollisionBoxSetPose(box, pose, spatial.width, spatial.height);
+        } else if (spatialType == INSKAMSpatialTypePoint) {
+            INSKAMCollisionPoint *point = &points[_collisionPointCount++];
+            point->timelineIndex = timelineIndex;
+            point->position = CGPointMake(pose.positionX, pose.positionY);
+            point->angle = pose.angle;
+        }
+    }
+}
+
+// Applies a new mainline key if the time has crossed a mainline key boundary.
+- (void)updateMainlineKeyForTime:(INSKAMTicks)time {
+    // the applied mainline key is still valid if the time lays before the next one
+    NSArray *mainlineKeys = self.animation.mainlineKeys;
+    if (self.mainlineKey != nil && time >= self.mainlineKey.time) {
+        NSUInteger nextIndex = self.mainlineKeyIndex + 1;
+        if (nextIndex >= mainlineKeys.count || time < ((INSKAMMainlineKey *)mainlineKeys[nextIndex]).time) {
+            return;
+        }
+    }
+    
+    NSUInteger mainlineKeyIndex = [self.animation mainlineKeyIndexForTime:time];
+    if (mainlineKeyIndex == NSNotFound || mainlineKeyIndex == self.mainlineKeyIndex) {
+        return;
+    }
+    INSKAMMainlineKey *mainlineKey = mainlineKeys[mainlineKeyIndex];
+    [self applyMainlineKey:mainlineKey previousMainlineKey:self.mainlineKey];
+    self.mainlineKey = mainlineKey;
+    self.mainlineKeyIndex = mainlineKeyIndex;
+}
+
+// Changes the node tree from one mainline key's state to another.
+- (void)applyMainlineKey:(INSKAMMainlineKey *)mainlineKey previousMainlineKey:(INSKAMMainlineKey *)previousMainlineKey {
+    NSAssert(mainlineKey.slotCount == self.timelineCount, @"a slot for each timeline node expected");
+    INSKAMMainlineSlot *slots = mainlineKey.slots;
+    INSKAMMainlineSlot *previousSlots = previousMainlineKey.slots;
+    NSUInteger slotCount = mainlineKey.slotCount;
+    
+    // a flattened tree has only sprites directly attached to this node
+    if (self.flattenedTree) {
+        NSNull *noNode = [NSNull null];
+        for (NSUInteger index = 0; index < slotCount; ++index) {
+            SKNode *node = self.timelineNodes[index];
+            if (node == (id)noNode) {
+                continue;
+            }
+            if (!slots[index].active) {
+                if (previousSlots == NULL || previousSlots[index].active) {
+                    node.hidden = YES;
+                }
+                continue;
+            }
+            if (previousSlots == NULL || previousSlots[index].zIndex != slots[index].zIndex) {
+                node.zPosition = slots[index].zIndex * self.zPositionStep;
+            }
+        }
+        return;
+    }
+    
+    // move nodes which change their parent to the root first, so attaching them can't build a cycle
+    INSKAnimationStatistics *statistics = [self.animationManager currentStatistics];
+    NSNull *noNode = [NSNull null];
+    for (NSUInteger index = 0; index < slotCount; ++index) {
+        SKNode *node = self.timelineNodes[index];
+        if (!slots[index].active || node == (id)noNode) {
+            continue;
+        }
+        SKNode *parentNode = (slots[index].parentIndex == INSKAMMainlineNoParent ? self : self.timelineNodes[slots[index].parentIndex]);
+        if (node.parent != parentNode && node.parent != self) {
+            [node removeFromParent];
+            [self addChild:node];
+            INSKAnimationStatisticsCount(statistics, reparentCount, 1);
+        }
+    }
+    
+    // attach the nodes to their new parents, apply the drawing order and hide the ones not used anymore
+    for (NSUInteger index = 0; index < slotCount; ++index) {
+        SKNode *node = self.timelineNodes[index];
+        if (node == (id)noNode) {
+            continue;
+        }
+        if (!slots[index].active) {
+            if (previousSlots == NULL || previousSlots[index].active) {
+                node.hidden = YES;
+            }
+            continue;
+        }
+        SKNode *parentNode = (slots[index].parentIndex == INSKAMMainlineNoParent ? self : self.timelineNodes[slots[index].parentIndex]);
+        if (node.parent != parentNode) {
+            [node removeFromParent];
+            [parentNode addChild:node];
+            INSKAnimationStatisticsCount(statistics, reparentCount, 1);
+        }
+        if (previousSlots == NULL || previousSlots[index].zIndex != slots[index].zIndex) {
+            node.zPosition = slots[index].zIndex * self.zPositionStep;
+        }
+    }
 }
 
 
@@ -0,0 +1,76 @@
+// INSKAnimationNodeState.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "INSKAMTypes.h"
+
+
+/**
+ The playback state of an INSKAnimationNode in a fixed-size record, i.e. for saving and restoring the animations of a rollback netcode.
+ 
+ The record holds no object references and can be copied with memcpy.
+ Only the playback is saved, not the node's properties like the position or the delegate.
+ The timeline cursors and the applied mainline key aren't part of the state, they are caches which are looked up again from the restored time.
+ A node added to a manager plays directly from its record in the manager's contiguous playback states, so all states are saved and restored with one memcpy.
+ */
+typedef struct {
+    /// The serial the manager has assigned to the node when saving, used for restoring only into the same node, 0 if saved from no node.
+    NSUInteger nodeSerial;
+    /// The index of the playing animation in the entity's animations or NSNotFound if no animation plays.
+    NSUInteger animationIndex;
+    /// The animation time in whole ticks.
+    INSKAMTicks ticks;
+    /// The fraction of a tick the playback is ahead of the whole ticks, in the range of 0 to 1.
+    double tickFraction;
+    /// The animation speed.
+    double speed;
+    /// True if the playback advances the time.
+    BOOL playing;
+    /// True if the animation loops.
+    BOOL looping;
+    /// True if the events at time 0 are still to be passed.
+    BOOL startEventsDue;
+    /// True if the animation blended from loops.
+    BOOL blendSourceLooping;
+    /// The index of the animation blended from in the entity's animations or NSNotFound if not blending.
+    NSUInteger blendSourceAnimationIndex;
+    /// The time in ticks of the animation blended from.
+    double blendSourceTime;
+    /// The duration of the blend in seconds.
+    double blendDuration;
+    /// The elapsed time of the blend in seconds.
+    double blendElapsedTime;
+    /// True if the record has been restored and the node hasn't bound its animations to it yet, used by the engine only.
+    BOOL restorePending;
+} INSKAnimationNodeState;
+
+
+/**
+ Advances the time of a playing state by a duration without passing events, i.e. for projecting the time a node has slept.
+ 
+ The time is looped or clamped like the playback does, a state with a pending restore isn't advanced.
+ 
+ @param state The state to advance.
+ @param duration The duration in seconds.
+ @param animationLength The length of the state's animation in ticks.
+ */
+void INSKAnimationNodeStateAdvance(INSKAnimationNodeState *state, NSTimeInterval duration, INSKAMTicks animationLength);
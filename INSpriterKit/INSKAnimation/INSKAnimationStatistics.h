@@ -0,0 +1,79 @@
+// INSKAnimationStatistics.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import <QuartzCore/QuartzCore.h>
+
+
+/**
+ Switches the collection of runtime statistics on or off at compile time, defaults to 1.
+ 
+ Define INSK_ANIMATION_STATISTICS=0 in the preprocessor macros of the target to remove all counting and timing,
+ the statistics of INSKAnimationManager stay zero then.
+ */
+#ifndef INSK_ANIMATION_STATISTICS
+#define INSK_ANIMATION_STATISTICS 1
+#endif
+
+
+/**
+ Runtime statistics of an INSKAnimationManager and its animation nodes.
+ */
+typedef struct {
+    /// The number of updates counted.
+    NSUInteger frameCount;
+    /// The number of animation nodes updated each frame, summed over the frames.
+    NSUInteger activeNodeCount;
+    /// The number of sleeping animation nodes, summed over the frames.
+    NSUInteger sleepingNodeCount;
+    /// The number of timelines whose pose has been evaluated.
+    NSUInteger timelinesEvaluated;
+    /// The number of evaluations which had to interpolate between two keyframes.
+    NSUInteger interpolations;
+    /// The number of evaluations which hit a keyframe's time exactly.
+    NSUInteger exactKeyHits;
+    /// The number of nodes moved to another parent for a mainline key.
+    NSUInteger reparentCount;
+    /// The number of textures requested from the manager.
+    NSUInteger textureLookups;
+    /// The number of texture requests which had to ask the texture loader.
+    NSUInteger textureCacheMisses;
+    /// The number of delegate methods called.
+    NSUInteger delegateCalls;
+    /// The wall time in seconds spent in the manager's update: method.
+    NSTimeInterval updateTime;
+    /// The wall time in seconds spent in updating node trees, part of the update time.
+    NSTimeInterval nodeUpdateTime;
+    /// The wall time in seconds spent in evaluating the timelines and applying their poses and textures to the nodes, part of the node update time.
+    NSTimeInterval propertyTime;
+} INSKAnimationStatistics;
+
+
+#if INSK_ANIMATION_STATISTICS
+/// Adds a value to a counter of an INSKAnimationStatistics pointer, which may be NULL.
+#define INSKAnimationStatisticsCount(statistics, counter, value) do { if ((statistics) != NULL) (statistics)->counter += (value); } while (0)
+/// Returns the current time for measuring wall times.
+#define INSKAnimationStatisticsTimestamp() CACurrentMediaTime()
+#else
+#define INSKAnimationStatisticsCount(statistics, counter, value) do { (void)(statistics); (void)(value); } while (0)
+#define INSKAnimationStatisticsTimestamp() ((CFTimeInterval)0.0)
+#endif
@@ -0,0 +1,133 @@
+// INSKAnimationTrace.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+/**
+ Switches the trace markers on or off at compile time, defaults to 1.
+ 
+ Define INSK_ANIMATION_TRACE=0 in the preprocessor macros of the target to remove all markers.
+ With markers compiled in, a marker costs only a check of a global flag as long as tracing isn't enabled with INSKAnimationTrace.
+ */
+#ifndef INSK_ANIMATION_TRACE
+#define INSK_ANIMATION_TRACE 1
+#endif
+
+
+/// The running time span of a trace marker.
+typedef struct {
+    /// The name of the traced phase, a string constant.
+    const char *name;
+    /// The start time in nanoseconds or 0 if tracing was disabled at the start.
+    uint64_t startTime;
+} INSKAnimationTraceScope;
+
+
+/// True if the trace markers record their time spans, use INSKAnimationTrace for changing it.
+extern BOOL INSKAnimationTraceEnabled;
+
+/// Returns the time of a monotonic clock in nanoseconds.
+uint64_t INSKAnimationTraceNow(void);
+
+/// Records a time span into the calling thread's ring buffer.
+void INSKAnimationTraceRecord(const char *name, uint64_t startTime, uint64_t endTime);
+
+
+/// Starts the time span of a trace marker.
+static inline INSKAnimationTraceScope INSKAnimationTraceBegin(const char *name) {
+    INSKAnimationTraceScope scope = {name, (INSKAnimationTraceEnabled ? INSKAnimationTraceNow() : 0)};
+    return scope;
+}
+
+/// Ends the time span of a trace marker and records it if it has been started with tracing enabled.
+static inline void INSKAnimationTraceEnd(INSKAnimationTraceScope *scope) {
+    if (scope->startTime != 0) {
+        INSKAnimationTraceRecord(scope->name, scope->startTime, INSKAnimationTraceNow());
+    }
+}
+
+
+#define INSKAnimationTraceConcat2(a, b) a##b
+#define INSKAnimationTraceConcat(a, b) INSKAnimationTraceConcat2(a, b)
+
+#if INSK_ANIMATION_TRACE
+/// Traces the time from this statement to the end of the enclosing scope under the given name, which has to be a string constant like "update".
+#define INSKAnimationTraceScoped(name) __attribute__((cleanup(INSKAnimationTraceEnd))) INSKAnimationTraceScope INSKAnimationTraceConcat(traceScope, __LINE__) = INSKAnimationTraceBegin(name)
+#else
+#define INSKAnimationTraceScoped(name) do { } while (0)
+#endif
+
+
+/**
+ Controls the recording of the trace markers placed in the parser, the animation manager and the animation nodes and exports them as Chrome trace events.
+ 
+ Each thread records into its own ring buffer without any locks, so tracing can be enabled in release builds, on a device or in headless runs.
+ A ring buffer keeps the latest 16384 time spans of its thread, older ones are overwritten.
+ The recorded spans can be written as Chrome trace event JSON, which can be opened with chrome://tracing, Perfetto or any other trace viewer.
+ 
+    [INSKAnimationTrace setEnabled:YES];
+    // load and play the animations
+    [INSKAnimationTrace writeChromeTraceToFile:@"/tmp/animation.json"];
+ 
+ The export reads the ring buffers while the threads may still record, so spans recorded during the export may be missing or incomplete.
+ */
+@interface INSKAnimationTrace : NSObject
+
+/**
+ Enables or disables the recording of the trace markers, disabled by default.
+ 
+ @param enabled True for recording.
+ */
++ (void)setEnabled:(BOOL)enabled;
+
+/**
+ Returns true if the trace markers are recorded.
+ 
+ @return True if recording.
+ */
++ (BOOL)isEnabled;
+
+/**
+ Discards all recorded spans of all threads.
+ 
+ Clearing starts a new epoch instead of writing into the buffers, so it is safe while other threads record:
+ each thread starts its buffer over with its next span and the export skips buffers of an older epoch.
+ */
++ (void)clear;
+
+/**
+ Returns the recorded spans of all threads as Chrome trace event JSON.
+ 
+ The spans are complete events with the phase's name, the start time and the duration in microseconds and the thread.
+ 
+ @return UTF-8 encoded JSON data.
+ */
++ (NSData *)chromeTraceData;
+
+/**
+ Writes the recorded spans of all threads as Chrome trace event JSON to a file.
+ 
+ @param path The path of the file to write.
+ @return True if the file has been written.
+ */
++ (BOOL)writeChromeTraceToFile:(NSString *)path;
+
+@end
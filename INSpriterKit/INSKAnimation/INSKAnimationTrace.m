@@ -0,0 +1,204 @@
+// INSKAnimationTrace.m
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "INSKAnimationTrace.h"
+#import <stdatomic.h>
+#import <pthread.h>
+#import <time.h>
+#if defined(__APPLE__)
+#import <mach/mach_time.h>
+#endif
+
+
+// The number of spans each thread's ring buffer keeps.
+#define INSKAnimationTraceCapacity 16384
+
+// A recorded time span.
+typedef struct {
+    const char *name;
+    uint64_t startTime;
+    uint64_t endTime;
+} INSKAnimationTraceSpan;
+
+// The ring buffer of a thread, the buffers are kept in a list and reused by new threads after their thread has ended.
+typedef struct INSKAnimationTraceBuffer {
+    // The next buffer in the list.
+    struct INSKAnimationTraceBuffer *next;
+    // The thread ID written into the trace, a reused buffer gets a new one.
+    atomic_ulong threadId;
+    // True while a thread owns the buffer.
+    atomic_bool inUse;
+    // The clear epoch the written spans belong to, only the owning thread changes it.
+    atomic_ulong epoch;
+    // The number of spans written so far, the next span is written at this count modulo the capacity.
+    atomic_ulong writeCount;
+    INSKAnimationTraceSpan spans[INSKAnimationTraceCapacity];
+} INSKAnimationTraceBuffer;
+
+
+BOOL INSKAnimationTraceEnabled = NO;
+
+// The head of the list of all buffers, buffers are only added and never removed.
+static _Atomic(INSKAnimationTraceBuffer *) INSKAnimationTraceBuffers = NULL;
+// The number of threads which have got a buffer for numbering the threads.
+static atomic_ulong INSKAnimationTraceThreadCount = 0;
+// The current clear epoch, spans recorded in an older epoch are dropped.
+static atomic_ulong INSKAnimationTraceEpoch = 0;
+// The key holding the buffer of each thread, its destructor releases the buffer when the thread ends.
+static pthread_key_t INSKAnimationTraceThreadKey;
+static pthread_once_t INSKAnimationTraceThreadKeyOnce = PTHREAD_ONCE_INIT;
+
+
+// Releases the buffer of an ended thread for reuse.
+static void INSKAnimationTraceReleaseBuffer(void *buffer) {
+    atomic_store(&((INSKAnimationTraceBuffer *)buffer)->inUse, false);
+}
+
+static void INSKAnimationTraceCreateThreadKey(void) {
+    pthread_key_create(&INSKAnimationTraceThreadKey, INSKAnimationTraceReleaseBuffer);
+}
+
+// Returns the buffer of the current thread, takes a released one or adds a new one to the list on the first call.
+static INSKAnimationTraceBuffer *INSKAnimationTraceCurrentBuffer(void) {
+    // a thread local variable isn't supported before iOS 9, so the buffer is looked up by the key
+    pthread_once(&INSKAnimationTraceThreadKeyOnce, INSKAnimationTraceCreateThreadKey);
+    INSKAnimationTraceBuffer *buffer = pthread_getspecific(INSKAnimationTraceThreadKey);
+    if (buffer != NULL) {
+        return buffer;
+    }
+    
+    unsigned long threadId = atomic_fetch_add(&INSKAnimationTraceThreadCount, 1) + 1;
+    for (buffer = atomic_load(&INSKAnimationTraceBuffers); buffer != NULL; buffer = buffer->next) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&buffer->inUse, &expected, true)) {
+            // the spans of the ended thread are dropped, the count is reset before the epoch so the export never sees old spans in the current epoch
+            atomic_store_explicit(&buffer->writeCount, 0, memory_order_release);
+            atomic_store_explicit(&buffer->threadId, threadId, memory_order_relaxed);
+            atomic_store_explicit(&buffer->epoch, atomic_load(&INSKAnimationTraceEpoch), memory_order_release);
+            break;
+        }
+    }
+    if (buffer == NULL) {
+        buffer = calloc(1, sizeof(INSKAnimationTraceBuffer));
+        if (buffer == NULL) {
+            return NULL;
+        }
+        atomic_init(&buffer->threadId, threadId);
+        atomic_init(&buffer->inUse, true);
+        atomic_init(&buffer->epoch, atomic_load(&INSKAnimationTraceEpoch));
+        atomic_init(&buffer->writeCount, 0);
+        INSKAnimationTraceBuffer *head = atomic_load(&INSKAnimationTraceBuffers);
+        do {
+            buffer->next = head;
+        } while (!atomic_compare_exchange_weak(&INSKAnimationTraceBuffers, &head, buffer));
+    }
+    
+    pthread_setspecific(INSKAnimationTraceThreadKey, buffer);
+    return buffer;
+}
+
+uint64_t INSKAnimationTraceNow(void) {
+#if defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000ull + (uint64_t)time.tv_nsec;
+#endif
+}
+
+void INSKAnimationTraceRecord(const char *name, uint64_t startTime, uint64_t endTime) {
+    INSKAnimationTraceBuffer *buffer = INSKAnimationTraceCurrentBuffer();
+    if (buffer == NULL) {
+        return;
+    }
+    
+    // a clear starts a new epoch, which the owning thread applies by starting its buffer over
+    unsigned long epoch = atomic_load_explicit(&INSKAnimationTraceEpoch, memory_order_acquire);
+    if (atomic_load_explicit(&buffer->epoch, memory_order_relaxed) != epoch) {
+        atomic_store_explicit(&buffer->writeCount, 0, memory_order_release);
+        atomic_store_explicit(&buffer->epoch, epoch, memory_order_release);
+    }
+    
+    // only this thread writes, the release store publishes the span to the export
+    unsigned long writeCount = atomic_load_explicit(&buffer->writeCount, memory_order_relaxed);
+    INSKAnimationTraceSpan *span = &buffer->spans[writeCount % INSKAnimationTraceCapacity];
+    span->name = name;
+    span->startTime = startTime;
+    span->endTime = endTime;
+    atomic_store_explicit(&buffer->writeCount, writeCount + 1, memory_order_release);
+}
+
+
+@implementation INSKAnimationTrace
+
++ (void)setEnabled:(BOOL)enabled {
+    INSKAnimationTraceEnabled = enabled;
+}
+
++ (BOOL)isEnabled {
+    return INSKAnimationTraceEnabled;
+}
+
++ (void)clear {
+    // the buffers are only written by their threads, which start over when they see the new epoch
+    atomic_fetch_add(&INSKAnimationTraceEpoch, 1);
+}
+
++ (NSData *)chromeTraceData {
+    NSMutableString *json = [NSMutableString stringWithString:@"{\"traceEvents\":["];
+    BOOL firstEvent = YES;
+    int processId = (int)[NSProcessInfo processInfo].processIdentifier;
+    unsigned long epoch = atomic_load(&INSKAnimationTraceEpoch);
+    for (INSKAnimationTraceBuffer *buffer = atomic_load(&INSKAnimationTraceBuffers); buffer != NULL; buffer = buffer->next) {
+        // a buffer which hasn't been written since the last clear holds only cleared spans
+        if (atomic_load_explicit(&buffer->epoch, memory_order_acquire) != epoch) {
+            continue;
+        }
+        unsigned long writeCount = atomic_load_explicit(&buffer->writeCount, memory_order_acquire);
+        unsigned long threadId = atomic_load_explicit(&buffer->threadId, memory_order_relaxed);
+        unsigned long startCount = (writeCount > INSKAnimationTraceCapacity ? writeCount - INSKAnimationTraceCapacity : 0);
+        for (unsigned long count = startCount; count < writeCount; ++count) {
+            INSKAnimationTraceSpan span = buffer->spans[count % INSKAnimationTraceCapacity];
+            if (span.name == NULL || span.endTime < span.startTime) {
+                continue;
+            }
+            // complete events with times in microseconds
+            [json appendFormat:@"%@\n{\"name\":\"%s\",\"cat\":\"INSpriterKit\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%lu}",
+                (firstEvent ? @"" : @","), span.name, span.startTime / 1000.0, (span.endTime - span.startTime) / 1000.0, processId, threadId];
+            firstEvent = NO;
+        }
+    }
+    [json appendString:@"\n],\"displayTimeUnit\":\"ms\"}\n"];
+    return [json dataUsingEncoding:NSUTF8StringEncoding];
+}
+
++ (BOOL)writeChromeTraceToFile:(NSString *)path {
+    return [[self chromeTraceData] writeToFile:path atomically:YES];
+}
+
+@end
@@ -21,16 +21,282 @@
 // THE SOFTWARE.
 
 
+#import "INSKAMTypes.h"
+
+
+/**
+ The bounds of some timelines of an animation during a time span.
+ */
+typedef struct {
+    /// The start time of the span in ticks, the span lasts until the next span's start or the animation's end.
+    INSKAMTicks time;
+    /// A conservative bounding rect in the animation node's space which contains the timelines for the whole span or CGRectNull if none is visible.
+    CGRect bounds;
+} INSKAMBoundsSpan;
+
+
+/**
+ A span of time in which an animation shows no visible change.
+ */
+typedef struct {
+    /// The start time of the span in ticks.
+    INSKAMTicks time;
+    /// The end time of the span in ticks, from this time on the animation may change again.
+    INSKAMTicks endTime;
+} INSKAMHoldSpan;
+
+
+@class INSKAMArchive;
+@class INSKAMAnimation;
+
+/**
+ A block which converts the content of a lazily loaded animation.
+ 
+ The block gets an animation which has only its name, index, length and looping flag set and fills in the timelines, mainline keys, spans and events.
+ */
+typedef void (^INSKAMAnimationConverter)(INSKAMAnimation *animation);
+
+
 @interface INSKAMAnimation : NSObject <NSCopying>
 
 /// The animation's name.
 @property (nonatomic, copy) NSString *name;
-/// The length of the animation in seconds.
-@property (nonatomic, assign) NSTimeInterval length;
+/// The index of the animation in its entity's animations.
+@property (nonatomic, assign) NSUInteger animationIndex;
+/// The length of the animation in ticks.
+@property (nonatomic, assign) INSKAMTicks length;
 /// Flag indicating whether the animation should loop or not.
 @property (nonatomic, assign) BOOL looping;
 /// A dictionary with INSKAMTimeline objects and their timelineId as key.
 @property (nonatomic, strong) NSMutableDictionary *timelinesById;
+/// An array with the INSKAMTimeline objects in Spriter's order, the index of a timeline is its slot in the mainline keys.
+@property (nonatomic, strong) NSMutableArray *timelines;
+/// An array with INSKAMMainlineKey objects in order of their time.
+@property (nonatomic, strong) NSMutableArray *mainlineKeys;
+/// The INSKAMBoundsSpan records of all collision boxes and points in order of their time or nil if the animation has none.
+@property (nonatomic, strong) NSData *collisionSpans;
+/// The INSKAMBoundsSpan records of all sprites in order of their time.
+@property (nonatomic, strong) NSData *spriteSpans;
+/// The INSKAMHoldSpan records of all spans without visible changes in order of their time.
+@property (nonatomic, strong) NSData *holdSpans;
+/// The INSKAMEvent records of all eventlines in order of their time.
+@property (nonatomic, strong) NSData *events;
+/// An array with the names of the eventlines as NSString objects in Spriter's order.
+@property (nonatomic, strong) NSArray *eventNames;
+/// The converter of a lazily loaded animation which hasn't been prepared yet, nil if the animation is complete. Released after the conversion.
+@property (nonatomic, copy) INSKAMAnimationConverter converter;
+
+
+/**
+ Converts the content of a lazily loaded animation if not already done.
+ 
+ An animation created by a parser in the lazy conversion mode has no timelines until it's prepared.
+ The conversion runs only once, calls from other threads wait for it to finish, so the animation may be prepared on any thread.
+ This method does nothing for an animation which is complete.
+ 
+ @see [INSKSpriterParser lazyConversion]
+ */
+- (void)prepare;
+
+
+/**
+ Returns the index of the mainline key for a given time or the nearest with less time.
+ 
+ If there is no mainline key with the given time or less the first key will be returned.
+ 
+ @param time The time in ticks.
+ @return The index of the corresponding mainline key or NSNotFound if there are no mainline keys.
+ */
+- (NSUInteger)mainlineKeyIndexForTime:(INSKAMTicks)time;
+
+
+/**
+ Returns the number of timelines animating a specific type of spatials.
+ 
+ @param spatialType The type of the timelines to count.
+ @return The number of timelines.
+ */
+- (NSUInteger)timelineCountOfSpatialType:(INSKAMSpatialType)spatialType;
+
+
+/**
+ Computes conservative bounds of all timelines of some spatial types for each span of time in which no involved keyframe or mainline key changes.
+ 
+ Inside a span all values are interpolated linearly, so the bounds are computed with interval arithmetic from the values at the span's start and end:
+ the positions are bounded by the rect of both end points, the angles by their range and a rotation by an angle range is bounded
+ by rotating with the range's center and expanding the result by the rotated radius multiplied with half of the range.
+ The bounds are composed along the bone hierarchy, so the result is never smaller than the real extent, but may be a bit larger for fast rotating bones.
+ Collision boxes and sprites are bounded by their rect, points by their position.
+ 
+ The timelines have to be uncompressed and complete, so call this method only after the parser has created all spatials and links.
+ 
+ @param spatialTypes The INSKAMSpatialType values of the timelines to bound as indexes, i.e. INSKAMSpatialTypeCollisionbox and INSKAMSpatialTypePoint.
+ @return The INSKAMBoundsSpan records in order of their time.
+ @see appendBoundsSpansForSpatialTypes:spanTimes:fromTime:maxCount:toSpans:
+ */
+- (NSData *)boundsSpansForSpatialTypes:(NSIndexSet *)spatialTypes;
+
+
+/**
+ Adds the times of the mainline keys and the animation's start to a set of span start times.
+ 
+ Together with addKeyframeTimesOfTimelineAtIndex:spatialTypes:toSpanTimes: for each timeline this collects the times
+ which boundsSpansForSpatialTypes: and holdSpansOfTimelines compute at once, so a parser can spread the work.
+ 
+ @param spanTimes The set of times to add to.
+ */
+- (void)addMainlineKeyTimesToSpanTimes:(NSMutableIndexSet *)spanTimes;
+
+
+/**
+ Adds the times of a timeline's keyframes to a set of span start times if the timeline is a bone or of one of the spatial types.
+ 
+ @param timelineIndex The index of the uncompressed timeline.
+ @param spatialTypes The INSKAMSpatialType values of the timelines to bound as indexes.
+ @param spanTimes The set of times to add to.
+ */
+- (void)addKeyframeTimesOfTimelineAtIndex:(NSUInteger)timelineIndex spatialTypes:(NSIndexSet *)spatialTypes toSpanTimes:(NSMutableIndexSet *)spanTimes;
+
+
+/**
+ Computes the bounds spans like boundsSpansForSpatialTypes:, but only for up to a number of spans starting at a given time.
+ 
+ Times from the animation's length on don't start a span. Continue with the returned time until it's NSNotFound.
+ 
+ @param spatialTypes The INSKAMSpatialType values of the timelines to bound as indexes.
+ @param spanTimes The start times of all spans collected with addMainlineKeyTimesToSpanTimes: and addKeyframeTimesOfTimelineAtIndex:spatialTypes:toSpanTimes:.
+ @param spanTime The start time of the first span to compute, i.e. the first index of spanTimes.
+ @param maxCount The maximum number of spans to compute.
+ @param spans The data to append the INSKAMBoundsSpan records to.
+ @return The start time of the next span to compute or NSNotFound if all spans are computed.
+ */
+- (NSUInteger)appendBoundsSpansForSpatialTypes:(NSIndexSet *)spatialTypes spanTimes:(NSIndexSet *)spanTimes fromTime:(NSUInteger)spanTime maxCount:(NSUInteger)maxCount toSpans:(NSMutableData *)spans;
+
+
+/**
+ Returns the index of the span for a given time.
+ 
+ @param time The time in ticks.
+ @param spans The INSKAMBoundsSpan records to search, i.e. collisionSpans.
+ @return The index of the last span starting at the time or before or NSNotFound if there are no spans.
+ */
+- (NSUInteger)boundsSpanIndexForTime:(INSKAMTicks)time inSpans:(NSData *)spans;
+
+
+/**
+ Computes the spans of time in which no bone or sprite changes, e.g. a held keyframe.
+ 
+ A span between two keyframes or mainline keys is a hold if each active bone and sprite is either hidden
+ or has the same values at the span's start and end, so the linear interpolation doesn't change anything in between.
+ Collision boxes and points are ignored, because they aren't visible.
+ The spans aren't merged, a keyframe or mainline key always ends a hold span because it may change a texture or the hierarchy.
+ 
+ The timelines have to be uncompressed and complete, so call this method only after the parser has created all spatials and links.
+ 
+ @return The INSKAMHoldSpan records in order of their time.
+ @see appendHoldSpansWithSpanTimes:fromTime:maxCount:toSpans:
+ */
+- (NSData *)holdSpansOfTimelines;
+
+
+/**
+ Computes the hold spans like holdSpansOfTimelines, but only checks up to a number of spans starting at a given time.
+ 
+ @param spanTimes The start times of all spans collected for the sprites, the same times as for the sprite bounds.
+ @param spanTime The start time of the first span to check, i.e. the first index of spanTimes.
+ @param maxCount The maximum number of spans to check.
+ @param spans The data to append the INSKAMHoldSpan records to.
+ @return The start time of the next span to check or NSNotFound if all spans are checked.
+ */
+- (NSUInteger)appendHoldSpansWithSpanTimes:(NSIndexSet *)spanTimes fromTime:(NSUInteger)spanTime maxCount:(NSUInteger)maxCount toSpans:(NSMutableData *)spans;
+
+
+/**
+ Returns the index of the hold span containing a given time.
+ 
+ @param time The time in ticks.
+ @return The index of the hold span in holdSpans or NSNotFound if the time isn't inside a hold span.
+ */
+- (NSUInteger)holdSpanIndexForTime:(INSKAMTicks)time;
+
+
+/**
+ Returns the index of the first event after a given time.
+ 
+ @param time The time in ticks.
+ @return The index of the first event in events with a greater time or the number of events if there is none.
+ */
+- (NSUInteger)eventIndexAfterTime:(INSKAMTicks)time;
+
+
+/**
+ Collects the events which are passed when playing from one time to another.
+ 
+ The times are unwrapped, so they may be outside of the animation's length and more than one length apart.
+ Playing forward passes the events after the start time up to and including the end time,
+ playing backwards passes the events before the start time down to and including the end time.
+ Only one search is needed to find the first event, then the events are walked in playback order,
+ wrapping around the end for each loop if looping, otherwise the times are clamped to the animation's length.
+ 
+ @param startTime The unwrapped time in ticks to start from, i.e. -1 to include events at time 0 when playing forward.
+ @param endTime The unwrapped time in ticks to play to.
+ @param looping True if the animation loops.
+ @param passedEvents The data to append the passed INSKAMEvent records to in playback order.
+ */
+- (void)collectEventsFromTime:(INSKAMTicks)startTime toTime:(INSKAMTicks)endTime looping:(BOOL)looping passedEvents:(NSMutableData *)passedEvents;
+
+
+#pragma mark - Archiving
+/// @name Archiving
+
+/**
+ Writes the animation with its timelines, mainline keys, spans and events into an archive.
+ 
+ The animation has to be complete, so a lazily loaded animation has to be prepared before.
+ 
+ @param archive The archive to write into.
+ */
+- (void)encodeWithArchive:(INSKAMArchive *)archive;
+
+
+/**
+ Initializes a complete animation read from an archive.
+ 
+ @param archive The archive to read from.
+ @return The animation or nil if the archive is malformed.
+ */
+- (instancetype)initWithArchive:(INSKAMArchive *)archive;
+
+
+/**
+ Initializes an animation with the values in front of its timelines read from an archive, for decoding the rest in parts.
+ 
+ Decode each timeline with decodeTimelineFromArchive: and then the mainline keys, spans and events with decodeRemainderFromArchive:,
+ which together read the same as initWithArchive:.
+ 
+ @param archive The archive to read from.
+ @param timelineCount Returns the number of timelines which follow.
+ @return The incomplete animation or nil if the archive is malformed.
+ */
+- (instancetype)initWithArchiveHeader:(INSKAMArchive *)archive timelineCount:(NSUInteger *)timelineCount;
+
+
+/**
+ Reads the next timeline of an animation initialized with initWithArchiveHeader:timelineCount:.
+ 
+ @param archive The archive to read from.
+ @return True if the timeline has been added, false if the archive is malformed.
+ */
+- (BOOL)decodeTimelineFromArchive:(INSKAMArchive *)archive;
+
+
+/**
+ Reads the mainline keys, spans and events following the timelines of an animation initialized with initWithArchiveHeader:timelineCount:.
+ 
+ @param archive The archive to read from.
+ @return True if the animation is complete, false if the archive is malformed.
+ */
+- (BOOL)decodeRemainderFromArchive:(INSKAMArchive *)archive;
 
 
 @end
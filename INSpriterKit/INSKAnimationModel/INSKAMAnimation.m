@@ -22,22 +22,572 @@
 
 
 #import "INSKAMAnimation.h"
+#import "INSKAMMainlineKey.h"
+#import "INSKAMTimeline.h"
+#import "INSKAMSpatial.h"
+#import "INSKAMPose.h"
+#import "INSKAMArchive.h"
 #import <INLib/INLib.h>
+#import <stdatomic.h>
 
 
-@implementation INSKAMAnimation
+// A closed range of values.
+typedef struct {
+    CGFloat minimum;
+    CGFloat maximum;
+} INSKAMInterval;
+
+// The bounds of a timeline during a span.
+typedef struct {
+    // the rect containing all positions
+    CGRect position;
+    // the range of all angles
+    INSKAMInterval angle;
+    BOOL hidden;
+} INSKAMSpanBounds;
+
+
+static inline INSKAMInterval INSKAMIntervalMake(CGFloat a, CGFloat b) {
+    INSKAMInterval interval = {MIN(a, b), MAX(a, b)};
+    return interval;
+}
+
+static inline INSKAMInterval INSKAMIntervalMultiply(INSKAMInterval a, INSKAMInterval b) {
+    CGFloat p1 = a.minimum * b.minimum;
+    CGFloat p2 = a.minimum * b.maximum;
+    CGFloat p3 = a.maximum * b.minimum;
+    CGFloat p4 = a.maximum * b.maximum;
+    INSKAMInterval interval = {MIN(MIN(p1, p2), MIN(p3, p4)), MAX(MAX(p1, p2), MAX(p3, p4))};
+    return interval;
+}
+
+// Returns the extent of a rect relative to its pivot, i.e. from -pivot * size * scale to (1 - pivot) * size * scale.
+static inline INSKAMInterval INSKAMIntervalOfExtent(INSKAMInterval pivot, INSKAMInterval scale, CGFloat size) {
+    INSKAMInterval lower = INSKAMIntervalMultiply(INSKAMIntervalMake(-pivot.minimum * size, -pivot.maximum * size), scale);
+    INSKAMInterval upper = INSKAMIntervalMultiply(INSKAMIntervalMake((1.0 - pivot.minimum) * size, (1.0 - pivot.maximum) * size), scale);
+    return INSKAMIntervalMake(MIN(lower.minimum, upper.minimum), MAX(lower.maximum, upper.maximum));
+}
+
+// Returns the bounds of a rect of vectors rotated by any angle of a range.
+static CGRect INSKAMRectRotatedByInterval(CGRect rect, INSKAMInterval angle) {
+    CGPoint corners[4] = {
+        CGPointMake(CGRectGetMinX(rect), CGRectGetMinY(rect)),
+        CGPointMake(CGRectGetMaxX(rect), CGRectGetMinY(rect)),
+        CGPointMake(CGRectGetMaxX(rect), CGRectGetMaxY(rect)),
+        CGPointMake(CGRectGetMinX(rect), CGRectGetMaxY(rect))
+    };
+    CGFloat radius = 0.0;
+    for (NSUInteger index = 0; index < 4; ++index) {
+        radius = MAX(radius, hypot(corners[index].x, corners[index].y));
+    }
+    
+    // a half turn or more may point anywhere
+    CGFloat range = angle.maximum - angle.minimum;
+    if (range >= M_PI) {
+        return CGRectMake(-radius, -radius, 2.0 * radius, 2.0 * radius);
+    }
+    
+    // rotate by the center and expand by the maximum arc length to the range's ends
+    CGFloat center = (angle.minimum + angle.maximum) / 2.0;
+    CGFloat sine = sin(center);
+    CGFloat cosine = cos(center);
+    CGRect bounds = CGRectNull;
+    for (NSUInteger index = 0; index < 4; ++index) {
+        CGPoint corner = CGPointMake(cosine * corners[index].x - sine * corners[index].y, sine * corners[index].x + cosine * corners[index].y);
+        bounds = CGRectUnion(bounds, CGRectMake(corner.x, corner.y, 0.0, 0.0));
+    }
+    CGFloat expansion = radius * range / 2.0;
+    return CGRectInset(bounds, -expansion, -expansion);
+}
+
+// Returns the Minkowski sum of two rects.
+static inline CGRect INSKAMRectAdd(CGRect a, CGRect b) {
+    CGRect r1 = CGRectStandardize(a);
+    CGRect r2 = CGRectStandardize(b);
+    return CGRectMake(r1.origin.x + r2.origin.x, r1.origin.y + r2.origin.y, r1.size.width + r2.size.width, r1.size.height + r2.size.height);
+}
+
+
+@implementation INSKAMAnimation {
+    // True once the animation is complete, read without a lock when it's prepared again.
+    atomic_bool _prepared;
+}
 
 - (instancetype)copyWithZone:(NSZone *)zone {
     INSKAMAnimation *animationCopy = [[[self class] allocWithZone:zone] init];
     animationCopy.name = self.name;
+    animationCopy.animationIndex = self.animationIndex;
     animationCopy.length = self.length;
     animationCopy.looping = self.looping;
     animationCopy.timelinesById = self.timelinesById.mutableCopy;
+    animationCopy.timelines = self.timelines.mutableCopy;
+    animationCopy.mainlineKeys = self.mainlineKeys.mutableCopy;
+    animationCopy.collisionSpans = self.collisionSpans;
+    animationCopy.spriteSpans = self.spriteSpans;
+    animationCopy.holdSpans = self.holdSpans;
+    animationCopy.events = self.events;
+    animationCopy.eventNames = self.eventNames;
+    animationCopy.converter = self.converter;
     return animationCopy;
 }
 
+- (void)prepare {
+    if (atomic_load_explicit(&_prepared, memory_order_acquire)) {
+        return;
+    }
+    
+    // a dispatch_once predicate has to be static, so concurrent callers wait on the animation's lock instead
+    @synchronized (self) {
+        if (!atomic_load_explicit(&_prepared, memory_order_relaxed)) {
+            INSKAMAnimationConverter converter = self.converter;
+            if (converter != nil) {
+                converter(self);
+                self.converter = nil;
+            }
+            atomic_store_explicit(&_prepared, true, memory_order_release);
+        }
+    }
+}
+
 - (NSString *)description {
-    return [NSString stringWithFormat:@"Animation '%@' %f (%@): %@", self.name, self.length, (self.looping ? @"looped" : @"no loop"), [self.timelinesById.allValues descriptionWithStart:@"[\n" elementFormatter:@"%@,\n" lastElementFormatter:@"%@\n" end:@"]"]];
+    return [NSString stringWithFormat:@"Animation '%@' %ld (%@): %@", self.name, (long)self.length, (self.looping ? @"looped" : @"no loop"), [self.timelinesById.allValues descriptionWithStart:@"[\n" elementFormatter:@"%@,\n" lastElementFormatter:@"%@\n" end:@"]"]];
+}
+
+
+- (NSUInteger)mainlineKeyIndexForTime:(INSKAMTicks)time {
+    if (self.mainlineKeys.count == 0) {
+        return NSNotFound;
+    }
+    
+    // binary search for the last key with the given time or less
+    NSUInteger index = 0;
+    NSInteger startIndex = 0;
+    NSInteger endIndex = self.mainlineKeys.count - 1;
+    while (startIndex <= endIndex) {
+        NSInteger midIndex = (startIndex + endIndex) / 2;
+        INSKAMMainlineKey *mainlineKey = self.mainlineKeys[midIndex];
+        if (mainlineKey.time <= time) {
+            index = midIndex;
+            startIndex = midIndex + 1;
+        } else {
+            endIndex = midIndex - 1;
+        }
+    }
+    return index;
+}
+
+- (NSUInteger)timelineCountOfSpatialType:(INSKAMSpatialType)spatialType {
+    NSUInteger count = 0;
+    for (INSKAMTimeline *timeline in self.timelines) {
+        if (timeline.spatialType == spatialType) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+- (void)addMainlineKeyTimesToSpanTimes:(NSMutableIndexSet *)spanTimes {
+    [spanTimes addIndex:0];
+    for (INSKAMMainlineKey *mainlineKey in self.mainlineKeys) {
+        [spanTimes addIndex:mainlineKey.time];
+    }
+}
+
+- (void)addKeyframeTimesOfTimelineAtIndex:(NSUInteger)timelineIndex spatialTypes:(NSIndexSet *)spatialTypes toSpanTimes:(NSMutableIndexSet *)spanTimes {
+    INSKAMTimeline *timeline = self.timelines[timelineIndex];
+    NSAssert(!timeline.compressed, @"spans can only be computed for uncompressed timelines");
+    if (timeline.spatialType != INSKAMSpatialTypeNode && ![spatialTypes containsIndex:timeline.spatialType]) {
+        return;
+    }
+    for (INSKAMSpatial *spatial in timeline.spatialsByTime) {
+        [spanTimes addIndex:spatial.time];
+    }
+}
+
+// Returns the start times of the spans between all mainline keys and the keyframes of the timelines of the spatial types.
+- (NSIndexSet *)spanTimesForSpatialTypes:(NSIndexSet *)spatialTypes {
+    NSMutableIndexSet *spanTimes = [NSMutableIndexSet indexSet];
+    [self addMainlineKeyTimesToSpanTimes:spanTimes];
+    for (NSUInteger timelineIndex = 0; timelineIndex < self.timelines.count; ++timelineIndex) {
+        [self addKeyframeTimesOfTimelineAtIndex:timelineIndex spatialTypes:spatialTypes toSpanTimes:spanTimes];
+    }
+    return spanTimes;
+}
+
+- (NSData *)boundsSpansForSpatialTypes:(NSIndexSet *)spatialTypes {
+    NSIndexSet *spanTimes = [self spanTimesForSpatialTypes:spatialTypes];
+    NSMutableData *spans = [NSMutableData dataWithCapacity:spanTimes.count * sizeof(INSKAMBoundsSpan)];
+    [self appendBoundsSpansForSpatialTypes:spatialTypes spanTimes:spanTimes fromTime:spanTimes.firstIndex maxCount:NSUIntegerMax toSpans:spans];
+    return spans;
+}
+
+- (NSUInteger)appendBoundsSpansForSpatialTypes:(NSIndexSet *)spatialTypes spanTimes:(NSIndexSet *)spanTimes fromTime:(NSUInteger)spanTime maxCount:(NSUInteger)maxCount toSpans:(NSMutableData *)spans {
+    // the times from the animation's length on start no span
+    NSUInteger length = MAX(self.length, 0);
+    NSMutableData *boundsData = [NSMutableData dataWithLength:self.timelines.count * sizeof(INSKAMSpanBounds)];
+    INSKAMSpanBounds *timelineBounds = boundsData.mutableBytes;
+    for (NSUInteger count = 0; count < maxCount && spanTime < length; ++count) {
+        NSUInteger nextSpanTime = [spanTimes indexGreaterThanIndex:spanTime];
+        INSKAMTicks startTime = spanTime;
+        INSKAMTicks endTime = (nextSpanTime < length ? (INSKAMTicks)nextSpanTime : self.length);
+        INSKAMBoundsSpan span = {startTime, [self boundsForSpatialTypes:spatialTypes fromTime:startTime toTime:endTime timelineBounds:timelineBounds]};
+        [spans appendBytes:&span length:sizeof(INSKAMBoundsSpan)];
+        spanTime = nextSpanTime;
+    }
+    return (spanTime < length ? spanTime : NSNotFound);
+}
+
+// Returns the bounds of all timelines of the spatial types between two times where no involved keyframe or mainline key lays in between.
+- (CGRect)boundsForSpatialTypes:(NSIndexSet *)spatialTypes fromTime:(INSKAMTicks)startTime toTime:(INSKAMTicks)endTime timelineBounds:(INSKAMSpanBounds *)timelineBounds {
+    NSUInteger mainlineKeyIndex = [self mainlineKeyIndexForTime:startTime];
+    if (mainlineKeyIndex == NSNotFound) {
+        return CGRectNull;
+    }
+    INSKAMMainlineKey *mainlineKey = self.mainlineKeys[mainlineKeyIndex];
+    INSKAMMainlineSlot *slots = mainlineKey.slots;
+    
+    // bound the timelines parents first
+    CGRect bounds = CGRectNull;
+    for (NSUInteger orderIndex = 0; orderIndex < mainlineKey.evaluationCount; ++orderIndex) {
+        NSUInteger timelineIndex = mainlineKey.evaluationOrder[orderIndex];
+        INSKAMTimeline *timeline = self.timelines[timelineIndex];
+        INSKAMSpatialType spatialType = timeline.spatialType;
+        if (spatialType != INSKAMSpatialTypeNode && ![spatialTypes containsIndex:spatialType]) {
+            continue;
+        }
+        
+        // the local values at both ends of the span
+        INSKAMSpatial *spatial = [timeline spatialForTime:startTime];
+        INSKAMSpanBounds *spanBounds = &timelineBounds[timelineIndex];
+        NSInteger parentIndex = slots[timelineIndex].parentIndex;
+        spanBounds->hidden = spatial.hidden || (parentIndex != INSKAMMainlineNoParent && timelineBounds[parentIndex].hidden);
+        if (spanBounds->hidden) {
+            continue;
+        }
+        INSKAMPose startPose = [spatial poseWithInterpolation:(spatial.time == startTime ? 0.0 : [spatial interpolationRatioForTime:startTime])];
+        INSKAMPose endPose = [spatial poseWithInterpolation:[spatial interpolationRatioForTime:endTime]];
+        CGRect position = CGRectStandardize(CGRectMake(startPose.positionX, startPose.positionY, endPose.positionX - startPose.positionX, endPose.positionY - startPose.positionY));
+        INSKAMInterval angle = INSKAMIntervalMake(startPose.angle, endPose.angle);
+        
+        // compose with the parent
+        if (parentIndex != INSKAMMainlineNoParent) {
+            INSKAMSpanBounds parentBounds = timelineBounds[parentIndex];
+            position = INSKAMRectAdd(parentBounds.position, INSKAMRectRotatedByInterval(position, parentBounds.angle));
+            angle.minimum += parentBounds.angle.minimum;
+            angle.maximum += parentBounds.angle.maximum;
+        }
+        spanBounds->position = position;
+        spanBounds->angle = angle;
+        
+        // add the timeline's extent
+        if (spatialType == INSKAMSpatialTypeNode) {
+            continue;
+        } else if (spatialType == INSKAMSpatialTypePoint) {
+            bounds = CGRectUnion(bounds, position);
+        } else {
+            INSKAMInterval extentX = INSKAMIntervalOfExtent(INSKAMIntervalMake(startPose.pivotX, endPose.pivotX), INSKAMIntervalMake(startPose.scaleX, endPose.scaleX), spatial.width);
+            INSKAMInterval extentY = INSKAMIntervalOfExtent(INSKAMIntervalMake(startPose.pivotY, endPose.pivotY), INSKAMIntervalMake(startPose.scaleY, endPose.scaleY), spatial.height);
+            CGRect extent = CGRectMake(extentX.minimum, extentY.minimum, extentX.maximum - extentX.minimum, extentY.maximum - extentY.minimum);
+            bounds = CGRectUnion(bounds, INSKAMRectAdd(position, INSKAMRectRotatedByInterval(extent, angle)));
+        }
+    }
+    return bounds;
+}
+
+- (NSData *)holdSpansOfTimelines {
+    // the spans start at each mainline key and each keyframe of the bones and sprites
+    NSIndexSet *spanTimes = [self spanTimesForSpatialTypes:[NSIndexSet indexSetWithIndex:INSKAMSpatialTypeSprite]];
+    NSMutableData *spans = [NSMutableData data];
+    [self appendHoldSpansWithSpanTimes:spanTimes fromTime:spanTimes.firstIndex maxCount:NSUIntegerMax toSpans:spans];
+    return spans;
+}
+
+- (NSUInteger)appendHoldSpansWithSpanTimes:(NSIndexSet *)spanTimes fromTime:(NSUInteger)spanTime maxCount:(NSUInteger)maxCount toSpans:(NSMutableData *)spans {
+    NSUInteger length = MAX(self.length, 0);
+    for (NSUInteger count = 0; count < maxCount && spanTime < length; ++count) {
+        NSUInteger nextSpanTime = [spanTimes indexGreaterThanIndex:spanTime];
+        INSKAMTicks startTime = spanTime;
+        INSKAMTicks endTime = (nextSpanTime < length ? (INSKAMTicks)nextSpanTime : self.length);
+        if ([self isHoldFromTime:startTime toTime:endTime]) {
+            INSKAMHoldSpan span = {startTime, endTime};
+            [spans appendBytes:&span length:sizeof(INSKAMHoldSpan)];
+        }
+        spanTime = nextSpanTime;
+    }
+    return (spanTime < length ? spanTime : NSNotFound);
+}
+
+// Returns true if no bone or sprite changes between two times where no keyframe or mainline key lays in between.
+- (BOOL)isHoldFromTime:(INSKAMTicks)startTime toTime:(INSKAMTicks)endTime {
+    NSUInteger mainlineKeyIndex = [self mainlineKeyIndexForTime:startTime];
+    if (mainlineKeyIndex == NSNotFound) {
+        return YES;
+    }
+    INSKAMMainlineKey *mainlineKey = self.mainlineKeys[mainlineKeyIndex];
+    for (NSUInteger orderIndex = 0; orderIndex < mainlineKey.evaluationCount; ++orderIndex) {
+        INSKAMTimeline *timeline = self.timelines[mainlineKey.evaluationOrder[orderIndex]];
+        if (timeline.spatialType != INSKAMSpatialTypeNode && timeline.spatialType != INSKAMSpatialTypeSprite) {
+            continue;
+        }
+        
+        // a linear interpolation is constant if both ends are equal
+        INSKAMSpatial *spatial = [timeline spatialForTime:startTime];
+        if (spatial.hidden || spatial.time >= spatial.nextSpatial.time) {
+            continue;
+        }
+        INSKAMPose startPose = [spatial poseWithInterpolation:(spatial.time == startTime ? 0.0 : [spatial interpolationRatioForTime:startTime])];
+        INSKAMPose endPose = [spatial poseWithInterpolation:[spatial interpolationRatioForTime:endTime]];
+        if (startPose.positionX != endPose.positionX || startPose.positionY != endPose.positionY || startPose.angle != endPose.angle
+            || startPose.scaleX != endPose.scaleX || startPose.scaleY != endPose.scaleY || startPose.alpha != endPose.alpha
+            || startPose.pivotX != endPose.pivotX || startPose.pivotY != endPose.pivotY) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (NSUInteger)holdSpanIndexForTime:(INSKAMTicks)time {
+    NSUInteger spanCount = self.holdSpans.length / sizeof(INSKAMHoldSpan);
+    
+    // binary search for the last span starting at the given time or before
+    const INSKAMHoldSpan *holdSpans = self.holdSpans.bytes;
+    NSInteger startIndex = 0;
+    NSInteger endIndex = (NSInteger)spanCount - 1;
+    while (startIndex <= endIndex) {
+        NSInteger midIndex = (startIndex + endIndex) / 2;
+        if (holdSpans[midIndex].time <= time) {
+            startIndex = midIndex + 1;
+        } else {
+            endIndex = midIndex - 1;
+        }
+    }
+    if (endIndex < 0 || time >= holdSpans[endIndex].endTime) {
+        return NSNotFound;
+    }
+    return endIndex;
+}
+
+- (NSUInteger)eventIndexAfterTime:(INSKAMTicks)time {
+    NSUInteger eventCount = self.events.length / sizeof(INSKAMEvent);
+    
+    // binary search for the first event after the given time
+    const INSKAMEvent *events = self.events.bytes;
+    NSUInteger startIndex = 0;
+    NSUInteger endIndex = eventCount;
+    while (startIndex < endIndex) {
+        NSUInteger midIndex = (startIndex + endIndex) / 2;
+        if (events[midIndex].time <= time) {
+            startIndex = midIndex + 1;
+        } else {
+            endIndex = midIndex;
+        }
+    }
+    return startIndex;
+}
+
+- (void)collectEventsFromTime:(INSKAMTicks)startTime toTime:(INSKAMTicks)endTime looping:(BOOL)looping passedEvents:(NSMutableData *)passedEvents {
+    NSUInteger eventCount = self.events.length / sizeof(INSKAMEvent);
+    INSKAMTicks length = self.length;
+    if (eventCount == 0 || length <= 0 || startTime == endTime) {
+        return;
+    }
+    const INSKAMEvent *events = self.events.bytes;
+    
+    // split the start time into the loop cycle and the time inside the animation
+    INSKAMTicks cycle = 0;
+    INSKAMTicks time = startTime;
+    if (looping) {
+        cycle = startTime / length;
+        time = startTime % length;
+        if (time < 0) {
+            time += length;
+            --cycle;
+        }
+    } else {
+        endTime = MAX(0, MIN(endTime, length));
+        if (endTime == startTime) {
+            return;
+        }
+    }
+    
+    if (endTime > startTime) {
+        // walk forward from the first event after the start
+        NSUInteger index = [self eventIndexAfterTime:time];
+        while (YES) {
+            if (index == eventCount) {
+                if (!looping) {
+                    break;
+                }
+                index = 0;
+                ++cycle;
+            }
+            if (events[index].time + cycle * length > endTime) {
+                break;
+            }
+            [passedEvents appendBytes:&events[index] length:sizeof(INSKAMEvent)];
+            ++index;
+        }
+    } else {
+        // an event at the end of the previous loop is at the start time, so start before the end instead
+        if (looping && time == 0) {
+            time = length;
+            --cycle;
+        }
+        
+        // walk backwards from the last event before the start
+        NSUInteger index = [self eventIndexAfterTime:time - 1];
+        while (YES) {
+            if (index == 0) {
+                if (!looping) {
+                    break;
+                }
+                index = eventCount;
+                --cycle;
+            }
+            --index;
+            if (events[index].time + cycle * length < endTime) {
+                break;
+            }
+            [passedEvents appendBytes:&events[index] length:sizeof(INSKAMEvent)];
+        }
+    }
+}
+
+- (NSUInteger)boundsSpanIndexForTime:(INSKAMTicks)time inSpans:(NSData *)spans {
+    NSUInteger spanCount = spans.length / sizeof(INSKAMBoundsSpan);
+    if (spanCount == 0) {
+        return NSNotFound;
+    }
+    
+    // binary search for the last span starting at the given time or before
+    const INSKAMBoundsSpan *boundsSpans = spans.bytes;
+    NSUInteger index = 0;
+    NSInteger startIndex = 0;
+    NSInteger endIndex = spanCount - 1;
+    while (startIndex <= endIndex) {
+        NSInteger midIndex = (startIndex + endIndex) / 2;
+        if (boundsSpans[midIndex].time <= time) {
+            index = midIndex;
+            startIndex = midIndex + 1;
+        } else {
+            endIndex = midIndex - 1;
+        }
+    }
+    return index;
+}
+
+
+#pragma mark - Archiving
+
+- (void)encodeWithArchive:(INSKAMArchive *)archive {
+    NSAssert(self.converter == nil, @"a lazily loaded animation has to be prepared before archiving");
+    [archive encodeString:self.name];
+    [archive encodeInteger:self.animationIndex];
+    [archive encodeInteger:self.length];
+    [archive encodeInteger:self.looping];
+    [archive encodeInteger:self.timelines.count];
+    for (INSKAMTimeline *timeline in self.timelines) {
+        [timeline encodeWithArchive:archive];
+    }
+    [archive encodeInteger:self.mainlineKeys.count];
+    for (INSKAMMainlineKey *mainlineKey in self.mainlineKeys) {
+        [mainlineKey encodeWithArchive:archive];
+    }
+    [archive encodeData:self.collisionSpans];
+    [archive encodeData:self.spriteSpans];
+    [archive encodeData:self.holdSpans];
+    [archive encodeData:self.events];
+    [archive encodeInteger:self.eventNames.count];
+    for (NSString *eventName in self.eventNames) {
+        [archive encodeString:eventName];
+    }
+}
+
+- (instancetype)initWithArchive:(INSKAMArchive *)archive {
+    NSUInteger timelineCount = 0;
+    self = [self initWithArchiveHeader:archive timelineCount:&timelineCount];
+    if (self == nil) return self;
+    
+    for (NSUInteger index = 0; index < timelineCount; ++index) {
+        if (![self decodeTimelineFromArchive:archive]) {
+            return nil;
+        }
+    }
+    if (![self decodeRemainderFromArchive:archive]) {
+        return nil;
+    }
+    
+    return self;
+}
+
+- (instancetype)initWithArchiveHeader:(INSKAMArchive *)archive timelineCount:(NSUInteger *)timelineCount {
+    self = [super init];
+    if (self == nil) return self;
+    
+    self.name = [archive decodeString];
+    self.animationIndex = [archive decodeInteger];
+    self.length = [archive decodeInteger];
+    self.looping = ([archive decodeInteger] != 0);
+    *timelineCount = [archive decodeCount];
+    self.timelines = [NSMutableArray arrayWithCapacity:*timelineCount];
+    self.timelinesById = [NSMutableDictionary dictionaryWithCapacity:*timelineCount];
+    if (archive.failed || self.name == nil) {
+        return nil;
+    }
+    
+    return self;
+}
+
+- (BOOL)decodeTimelineFromArchive:(INSKAMArchive *)archive {
+    if (archive.failed) {
+        return NO;
+    }
+    INSKAMTimeline *timeline = [[INSKAMTimeline alloc] initWithArchive:archive];
+    if (timeline == nil || timeline.timelineId == nil) {
+        return NO;
+    }
+    [self.timelines addObject:timeline];
+    [self.timelinesById setObject:timeline forKey:timeline.timelineId];
+    return YES;
+}
+
+- (BOOL)decodeRemainderFromArchive:(INSKAMArchive *)archive {
+    NSUInteger mainlineKeyCount = [archive decodeCount];
+    self.mainlineKeys = [NSMutableArray arrayWithCapacity:mainlineKeyCount];
+    for (NSUInteger index = 0; index < mainlineKeyCount && !archive.failed; ++index) {
+        INSKAMMainlineKey *mainlineKey = [[INSKAMMainlineKey alloc] initWithArchive:archive slotCount:self.timelines.count];
+        if (mainlineKey == nil) {
+            return NO;
+        }
+        [self.mainlineKeys addObject:mainlineKey];
+    }
+    self.collisionSpans = [archive decodeData];
+    self.spriteSpans = [archive decodeData];
+    self.holdSpans = [archive decodeData];
+    self.events = [archive decodeData];
+    NSUInteger eventNameCount = [archive decodeCount];
+    NSMutableArray *eventNames = [NSMutableArray arrayWithCapacity:eventNameCount];
+    for (NSUInteger index = 0; index < eventNameCount && !archive.failed; ++index) {
+        NSString *eventName = [archive decodeString];
+        if (eventName == nil) {
+            return NO;
+        }
+        [eventNames addObject:eventName];
+    }
+    self.eventNames = eventNames;
+    if (archive.failed) {
+        return NO;
+    }
+    
+    // the events index into the names without checks during playback
+    const INSKAMEvent *events = self.events.bytes;
+    NSUInteger eventCount = self.events.length / sizeof(INSKAMEvent);
+    for (NSUInteger index = 0; index < eventCount; ++index) {
+        if (events[index].eventlineIndex >= eventNameCount) {
+            return NO;
+        }
+    }
+    return YES;
 }
 
 
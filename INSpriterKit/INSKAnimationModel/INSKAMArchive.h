@@ -0,0 +1,188 @@
+// INSKAMArchive.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "INSKAMTypes.h"
+
+
+@class INSKAMTexture;
+
+
+/**
+ A compact binary archive of an animation model used for caching converted animation data.
+ 
+ An archive is either written or read, depending on the initializer.
+ The model classes write their values in a fixed order with encodeWithArchive: and read them back in the same order with initWithArchive:.
+ Numbers are stored in their native size and byte order, so an archive can only be read on the same architecture it was written.
+ Strings are collected in a table and each one is stored only once, textures are stored once and referenced by their index.
+ 
+ Reading never goes beyond the archived data, a read outside of it returns 0 or nil and marks the archive as failed.
+ 
+ @see [INSKAMData encodeWithArchive:]
+ */
+@interface INSKAMArchive : NSObject
+
+/// True if a read has failed, because the archived data is malformed or has ended too early. Always false for writing.
+@property (nonatomic, assign, readonly) BOOL failed;
+/// True if all archived data has been read. Always false for writing.
+@property (nonatomic, assign, readonly, getter=isAtEnd) BOOL atEnd;
+
+
+/**
+ Initializes an empty archive for writing.
+ 
+ @return A new archive instance.
+ */
+- (instancetype)init;
+
+
+/**
+ Initializes an archive for reading data created by archivedData.
+ 
+ @param data The archived data.
+ @return A new archive instance, which has failed if the data isn't valid.
+ */
+- (instancetype)initWithArchivedData:(NSData *)data;
+
+
+/**
+ Returns the written values with the string table.
+ 
+ @return The archived data.
+ */
+- (NSData *)archivedData;
+
+
+#pragma mark - Writing
+/// @name Writing
+
+/**
+ Writes an integer value.
+ 
+ @param value The value to write.
+ */
+- (void)encodeInteger:(NSInteger)value;
+
+
+/**
+ Writes a floating point value.
+ 
+ @param value The value to write.
+ */
+- (void)encodeFloat:(CGFloat)value;
+
+
+/**
+ Writes a string as a reference into the string table.
+ 
+ @param string The string to write, may be nil.
+ */
+- (void)encodeString:(NSString *)string;
+
+
+/**
+ Writes the bytes of a data object, i.e. of struct records.
+ 
+ @param data The data to write, may be nil.
+ */
+- (void)encodeData:(NSData *)data;
+
+
+/**
+ Writes all textures of the model, so they can be referenced by encodeTexture: afterwards.
+ 
+ @param textures The INSKAMTexture objects.
+ */
+- (void)encodeTextures:(NSArray *)textures;
+
+
+/**
+ Writes a reference to a texture written with encodeTextures: before.
+ 
+ @param texture The texture to reference, may be nil.
+ */
+- (void)encodeTexture:(INSKAMTexture *)texture;
+
+
+#pragma mark - Reading
+/// @name Reading
+
+/**
+ Reads an integer value.
+ 
+ @return The value or 0 if the read failed.
+ */
+- (NSInteger)decodeInteger;
+
+
+/**
+ Reads a floating point value.
+ 
+ @return The value or 0 if the read failed.
+ */
+- (CGFloat)decodeFloat;
+
+
+/**
+ Reads a string.
+ 
+ @return The string or nil.
+ */
+- (NSString *)decodeString;
+
+
+/**
+ Reads the bytes of a data object.
+ 
+ @return The data or nil.
+ */
+- (NSData *)decodeData;
+
+
+/**
+ Reads the textures of the model, so they can be referenced by decodeTexture afterwards.
+ 
+ @return The INSKAMTexture objects in the order of writing.
+ */
+- (NSArray *)decodeTextures;
+
+
+/**
+ Reads a reference to a texture read with decodeTextures before.
+ 
+ @return The referenced texture or nil.
+ */
+- (INSKAMTexture *)decodeTexture;
+
+
+/**
+ Reads a count of following records and validates it against the remaining data.
+ 
+ Each record needs at least one byte, so a count larger than the remaining data marks the archive as failed.
+ 
+ @return The count or 0 if the read failed.
+ */
+- (NSUInteger)decodeCount;
+
+
+@end
@@ -0,0 +1,280 @@
+// INSKAMArchive.m
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "INSKAMArchive.h"
+#import "INSKAMTexture.h"
+
+
+// The index of a nil string or texture reference.
+static uint32_t const INSKAMArchiveNoIndex = UINT32_MAX;
+// The length of a nil data object.
+static int64_t const INSKAMArchiveNoData = -1;
+
+
+@interface INSKAMArchive ()
+
+@property (nonatomic, assign, readwrite) BOOL failed;
+// The written values without the string table.
+@property (nonatomic, strong) NSMutableData *body;
+// The strings of the string table in order of their index.
+@property (nonatomic, strong) NSMutableArray *strings;
+// The index of each written string in the string table, only used for writing.
+@property (nonatomic, strong) NSMutableDictionary *stringIndexes;
+// The written or read textures in order of their index.
+@property (nonatomic, strong) NSArray *textures;
+// The index of each written texture by its ID, only used for writing.
+@property (nonatomic, strong) NSMutableDictionary *textureIndexes;
+// The archived data while reading.
+@property (nonatomic, strong) NSData *data;
+// The read position in data.
+@property (nonatomic, assign) NSUInteger position;
+
+@end
+
+
+@implementation INSKAMArchive
+
+- (instancetype)init {
+    self = [super init];
+    if (self == nil) return self;
+    
+    self.body = [NSMutableData data];
+    self.strings = [NSMutableArray array];
+    self.stringIndexes = [NSMutableDictionary dictionary];
+    self.textures = @[];
+    self.textureIndexes = [NSMutableDictionary dictionary];
+    
+    return self;
+}
+
+- (instancetype)initWithArchivedData:(NSData *)data {
+    self = [super init];
+    if (self == nil) return self;
+    
+    self.data = data;
+    self.textures = @[];
+    
+    // read the string table in front of the values
+    NSUInteger stringCount = [self decodeCount];
+    self.strings = [NSMutableArray arrayWithCapacity:stringCount];
+    for (NSUInteger index = 0; index < stringCount && !self.failed; ++index) {
+        NSUInteger length = [self decodeCount];
+        NSString *string = nil;
+        if (!self.failed) {
+            string = [[NSString alloc] initWithBytes:(const uint8_t *)data.bytes + self.position length:length encoding:NSUTF8StringEncoding];
+            self.position += length;
+        }
+        if (string == nil) {
+            self.failed = YES;
+            break;
+        }
+        [self.strings addObject:string];
+    }
+    
+    return self;
+}
+
+- (NSData *)archivedData {
+    NSAssert(self.data == nil, @"only an archive for writing has archived data");
+    NSMutableData *archivedData = [NSMutableData dataWithCapacity:self.body.length];
+    int64_t count = self.strings.count;
+    [archivedData appendBytes:&count length:sizeof(count)];
+    for (NSString *string in self.strings) {
+        NSData *bytes = [string dataUsingEncoding:NSUTF8StringEncoding];
+        int64_t length = bytes.length;
+        [archivedData appendBytes:&length length:sizeof(length)];
+        [archivedData appendData:bytes];
+    }
+    [archivedData appendData:self.body];
+    return archivedData;
+}
+
+- (BOOL)isAtEnd {
+    return (self.data != nil && !self.failed && self.position == self.data.length);
+}
+
+
+#pragma mark - Writing
+
+- (void)encodeInteger:(NSInteger)value {
+    int64_t storedValue = value;
+    [self.body appendBytes:&storedValue length:sizeof(storedValue)];
+}
+
+- (void)encodeFloat:(CGFloat)value {
+    [self.body appendBytes:&value length:sizeof(value)];
+}
+
+- (void)encodeString:(NSString *)string {
+    uint32_t index = INSKAMArchiveNoIndex;
+    if (string != nil) {
+        NSNumber *storedIndex = [self.stringIndexes objectForKey:string];
+        if (storedIndex == nil) {
+            storedIndex = @(self.strings.count);
+            [self.strings addObject:string];
+            [self.stringIndexes setObject:storedIndex forKey:string];
+        }
+        index = storedIndex.unsignedIntValue;
+    }
+    [self.body appendBytes:&index length:sizeof(index)];
+}
+
+- (void)encodeData:(NSData *)data {
+    int64_t length = (data != nil ? (int64_t)data.length : INSKAMArchiveNoData);
+    [self.body appendBytes:&length length:sizeof(length)];
+    if (data != nil) {
+        [self.body appendData:data];
+    }
+}
+
+- (void)encodeTextures:(NSArray *)textures {
+    [self encodeInteger:textures.count];
+    for (INSKAMTexture *texture in textures) {
+        [self.textureIndexes setObject:@(self.textureIndexes.count) forKey:texture.textureId];
+        [self encodeString:texture.textureId];
+        [self encodeString:texture.relativePath];
+        [self encodeString:texture.fileName];
+        [self encodeFloat:texture.width];
+        [self encodeFloat:texture.height];
+    }
+    self.textures = textures.copy;
+}
+
+- (void)encodeTexture:(INSKAMTexture *)texture {
+    uint32_t index = INSKAMArchiveNoIndex;
+    if (texture != nil) {
+        NSNumber *storedIndex = [self.textureIndexes objectForKey:texture.textureId];
+        NSAssert(storedIndex != nil, @"the texture should be written with encodeTextures: first");
+        index = storedIndex.unsignedIntValue;
+    }
+    [self.body appendBytes:&index length:sizeof(index)];
+}
+
+
+#pragma mark - Reading
+
+// Returns the next bytes and moves the read position behind them or returns NULL if there aren't enough bytes left.
+- (const void *)readBytesOfLength:(NSUInteger)length {
+    if (self.failed || length > self.data.length - self.position) {
+        self.failed = YES;
+        return NULL;
+    }
+    const void *bytes = (const uint8_t *)self.data.bytes + self.position;
+    self.position += length;
+    return bytes;
+}
+
+- (NSInteger)decodeInteger {
+    int64_t value = 0;
+    const void *bytes = [self readBytesOfLength:sizeof(value)];
+    if (bytes != NULL) {
+        memcpy(&value, bytes, sizeof(value));
+    }
+    return (NSInteger)value;
+}
+
+- (CGFloat)decodeFloat {
+    CGFloat value = 0;
+    const void *bytes = [self readBytesOfLength:sizeof(value)];
+    if (bytes != NULL) {
+        memcpy(&value, bytes, sizeof(value));
+    }
+    return value;
+}
+
+// Reads an index of the string table or texture list.
+- (uint32_t)decodeIndex {
+    uint32_t index = INSKAMArchiveNoIndex;
+    const void *bytes = [self readBytesOfLength:sizeof(index)];
+    if (bytes != NULL) {
+        memcpy(&index, bytes, sizeof(index));
+    }
+    return index;
+}
+
+- (NSString *)decodeString {
+    uint32_t index = [self decodeIndex];
+    if (index == INSKAMArchiveNoIndex) {
+        return nil;
+    }
+    if (index >= self.strings.count) {
+        self.failed = YES;
+        return nil;
+    }
+    return self.strings[index];
+}
+
+- (NSData *)decodeData {
+    NSInteger length = [self decodeInteger];
+    if (length == INSKAMArchiveNoData || self.failed) {
+        return nil;
+    }
+    if (length < 0) {
+        self.failed = YES;
+        return nil;
+    }
+    const void *bytes = [self readBytesOfLength:length];
+    if (bytes == NULL) {
+        return nil;
+    }
+    return [NSData dataWithBytes:bytes length:length];
+}
+
+- (NSArray *)decodeTextures {
+    NSUInteger count = [self decodeCount];
+    NSMutableArray *textures = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger index = 0; index < count && !self.failed; ++index) {
+        INSKAMTexture *texture = [[INSKAMTexture alloc] init];
+        texture.textureId = [self decodeString];
+        texture.relativePath = [self decodeString];
+        texture.fileName = [self decodeString];
+        texture.width = [self decodeFloat];
+        texture.height = [self decodeFloat];
+        [textures addObject:texture];
+    }
+    self.textures = textures;
+    return textures;
+}
+
+- (INSKAMTexture *)decodeTexture {
+    uint32_t index = [self decodeIndex];
+    if (index == INSKAMArchiveNoIndex) {
+        return nil;
+    }
+    if (index >= self.textures.count) {
+        self.failed = YES;
+        return nil;
+    }
+    return self.textures[index];
+}
+
+- (NSUInteger)decodeCount {
+    NSInteger count = [self decodeInteger];
+    if (count < 0 || (NSUInteger)count > self.data.length - self.position) {
+        self.failed = YES;
+        return 0;
+    }
+    return count;
+}
+
+@end
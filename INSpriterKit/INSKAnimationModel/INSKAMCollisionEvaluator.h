@@ -0,0 +1,142 @@
+// INSKAMCollisionEvaluator.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "INSKAMTypes.h"
+#import "INSKAMCollisionShapes.h"
+
+
+@class INSKAMData;
+
+
+/**
+ One animated instance to evaluate in a batch, e.g. an actor of a game server's simulation.
+ 
+ The root transformation places the animation in the world like an animation node's position, zRotation, xScale and yScale would.
+ */
+typedef struct {
+    /// The index returned by the evaluator's indexOfAnimation:entity: method.
+    NSUInteger animationIndex;
+    /// The animation time in ticks, wrapped for looping animations and clamped otherwise.
+    INSKAMTicks time;
+    /// The X position of the root in world space.
+    CGFloat positionX;
+    /// The Y position of the root in world space.
+    CGFloat positionY;
+    /// The rotation of the root in radians.
+    CGFloat angle;
+    /// The X scale factor of the root.
+    CGFloat scaleX;
+    /// The Y scale factor of the root.
+    CGFloat scaleY;
+} INSKAMCollisionActor;
+
+
+/**
+ The location of an actor's evaluated shapes in the evaluator's output buffers.
+ */
+typedef struct {
+    /// The index of the actor's first box in the boxes buffer.
+    NSUInteger firstBox;
+    /// The number of visible boxes of the actor.
+    NSUInteger boxCount;
+    /// The index of the actor's first point in the points buffer.
+    NSUInteger firstPoint;
+    /// The number of visible points of the actor.
+    NSUInteger pointCount;
+} INSKAMCollisionActorShapes;
+
+
+/**
+ Evaluates the collision boxes and points of many animation instances at once without any animation nodes.
+ 
+ The evaluator is meant for simulations without rendering, e.g. an authoritative game server, which has to know the hitboxes of thousands of actors for a tick.
+ Only the timelines needed for the boxes and points are evaluated, which are the shapes themselves and their parent bones.
+ Sprites, textures and SpriteKit nodes are never touched.
+ 
+ The actors are split into chunks which are evaluated in parallel on the global concurrent queue.
+ The results are written into buffers owned by the evaluator which are reused by the next evaluation,
+ so after the first batch an evaluation doesn't allocate any memory except the chunks' scratch buffers.
+ The shapes of each actor are stored contiguously in world space, the actor's INSKAMCollisionActorShapes record tells where.
+ 
+ The animation data must not be changed while an evaluation is running.
+ An evaluator itself isn't thread safe, so use one evaluator per thread which evaluates batches.
+ */
+@interface INSKAMCollisionEvaluator : NSObject
+
+/// The animation data the evaluator works on.
+@property (nonatomic, strong, readonly) INSKAMData *data;
+/// The number of actors evaluated in one block on the concurrent queue, defaults to 64.
+@property (nonatomic, assign) NSUInteger chunkSize;
+/// The number of actors of the last evaluation.
+@property (nonatomic, assign, readonly) NSUInteger actorCount;
+/// One record per actor of the last evaluation in the order of the actors.
+@property (nonatomic, assign, readonly) const INSKAMCollisionActorShapes *actorShapes;
+/// The evaluated collision boxes of the last evaluation.
+@property (nonatomic, assign, readonly) const INSKAMCollisionBox *boxes;
+/// The evaluated collision points of the last evaluation.
+@property (nonatomic, assign, readonly) const INSKAMCollisionPoint *points;
+
+
+/**
+ Initializes an evaluator for some animation data.
+ 
+ @param data The animation data with the entities whose animations will be evaluated.
+ @return A new evaluator instance.
+ */
+- (instancetype)initWithData:(INSKAMData *)data;
+
+
+/**
+ Returns the index of an animation to use for INSKAMCollisionActor's animationIndex.
+ 
+ The animation is prepared for the evaluation the first time it is requested, so look up the indexes once and not for every batch.
+ 
+ @param animationName The name of the animation.
+ @param entityName The name of the entity the animation belongs to.
+ @return The animation's index or NSNotFound if there is no such animation.
+ */
+- (NSUInteger)indexOfAnimation:(NSString *)animationName entity:(NSString *)entityName;
+
+
+/**
+ Evaluates the collision boxes and points of some actors.
+ 
+ Blocks until all actors are evaluated, the results are available through actorShapes, boxes and points until the next evaluation.
+ 
+ @param actors The actors to evaluate.
+ @param actorCount The number of actors.
+ */
+- (void)evaluateActors:(const INSKAMCollisionActor *)actors count:(NSUInteger)actorCount;
+
+
+/**
+ Returns the first actor of the last evaluation with a collision box containing a given point.
+ 
+ @param point The point in world space.
+ @return The index of the actor or NSNotFound if no box contains the point.
+ */
+- (NSUInteger)indexOfActorContainingPoint:(CGPoint)point;
+
+
+@end
@@ -0,0 +1,310 @@
+// INSKAMCollisionEvaluator.m
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "INSKAMCollisionEvaluator.h"
+#import "INSKAMData.h"
+#import "INSKAMEntity.h"
+#import "INSKAMAnimation.h"
+#import "INSKAMMainlineKey.h"
+#import "INSKAMTimeline.h"
+#import "INSKAMSpatial.h"
+#import "INSKAMPose.h"
+
+
+// The number of collision boxes and points an animation can have at most at one time.
+typedef struct {
+    NSUInteger boxCount;
+    NSUInteger pointCount;
+} INSKAMCollisionCapacity;
+
+
+@interface INSKAMCollisionEvaluator ()
+
+@property (nonatomic, strong, readwrite) INSKAMData *data;
+@property (nonatomic, assign, readwrite) NSUInteger actorCount;
+// The prepared animations, the index in this array is the animation index used by the actors.
+@property (nonatomic, strong) NSMutableArray *animations;
+// One array per prepared animation with one NSData per mainline key holding the indexes of the timelines to evaluate in evaluation order.
+@property (nonatomic, strong) NSMutableArray *evaluationOrders;
+// One INSKAMCollisionCapacity per prepared animation.
+@property (nonatomic, strong) NSMutableData *capacityData;
+// The highest number of timelines of all prepared animations which is the size of the pose scratch buffers.
+@property (nonatomic, assign) NSUInteger maxTimelineCount;
+// The output buffers which only grow.
+@property (nonatomic, strong) NSMutableData *actorShapeData;
+@property (nonatomic, strong) NSMutableData *boxData;
+@property (nonatomic, strong) NSMutableData *pointData;
+
+@end
+
+
+@implementation INSKAMCollisionEvaluator
+
+- (instancetype)initWithData:(INSKAMData *)data {
+    self = [super init];
+    if (self == nil) return self;
+    
+    self.data = data;
+    self.chunkSize = 64;
+    self.animations = [NSMutableArray array];
+    self.evaluationOrders = [NSMutableArray array];
+    self.capacityData = [NSMutableData data];
+    self.actorShapeData = [NSMutableData data];
+    self.boxData = [NSMutableData data];
+    self.pointData = [NSMutableData data];
+    
+    return self;
+}
+
+
+#pragma mark - public methods
+
+- (const INSKAMCollisionActorShapes *)actorShapes {
+    return self.actorShapeData.bytes;
+}
+
+- (const INSKAMCollisionBox *)boxes {
+    return self.boxData.bytes;
+}
+
+- (const INSKAMCollisionPoint *)points {
+    return self.pointData.bytes;
+}
+
+- (NSUInteger)indexOfAnimation:(NSString *)animationName entity:(NSString *)entityName {
+    INSKAMEntity *entity = self.data.entitiesByName[entityName];
+    INSKAMAnimation *animation = entity.animationsByName[animationName];
+    if (animation == nil) {
+        return NSNotFound;
+    }
+    NSUInteger animationIndex = [self.animations indexOfObjectIdenticalTo:animation];
+    if (animationIndex != NSNotFound) {
+        return animationIndex;
+    }
+    
+    [animation prepare];
+    [self prepareAnimation:animation];
+    return self.animations.count - 1;
+}
+
+- (void)evaluateActors:(const INSKAMCollisionActor *)actors count:(NSUInteger)actorCount {
+    // reserve the shapes of each actor in the output buffers
+    self.actorCount = actorCount;
+    if (self.actorShapeData.length < actorCount * sizeof(INSKAMCollisionActorShapes)) {
+        self.actorShapeData.length = actorCount * sizeof(INSKAMCollisionActorShapes);
+    }
+    INSKAMCollisionActorShapes *actorShapes = self.actorShapeData.mutableBytes;
+    const INSKAMCollisionCapacity *capacities = self.capacityData.bytes;
+    NSUInteger animationCount = self.animations.count;
+    NSUInteger boxTotal = 0;
+    NSUInteger pointTotal = 0;
+    for (NSUInteger actorIndex = 0; actorIndex < actorCount; ++actorIndex) {
+        NSAssert(actors[actorIndex].animationIndex < animationCount, @"unknown animation index");
+        const INSKAMCollisionCapacity *capacity = &capacities[actors[actorIndex].animationIndex];
+        actorShapes[actorIndex].firstBox = boxTotal;
+        actorShapes[actorIndex].boxCount = 0;
+        actorShapes[actorIndex].firstPoint = pointTotal;
+        actorShapes[actorIndex].pointCount = 0;
+        boxTotal += capacity->boxCount;
+        pointTotal += capacity->pointCount;
+    }
+    if (self.boxData.length < boxTotal * sizeof(INSKAMCollisionBox)) {
+        self.boxData.length = boxTotal * sizeof(INSKAMCollisionBox);
+    }
+    if (self.pointData.length < pointTotal * sizeof(INSKAMCollisionPoint)) {
+        self.pointData.length = pointTotal * sizeof(INSKAMCollisionPoint);
+    }
+    if (actorCount == 0) {
+        return;
+    }
+    
+    // evaluate the chunks in parallel, each with its own scratch buffers
+    INSKAMCollisionBox *boxes = self.boxData.mutableBytes;
+    INSKAMCollisionPoint *points = self.pointData.mutableBytes;
+    NSUInteger chunkSize = MAX(self.chunkSize, 1);
+    NSUInteger chunkCount = (actorCount + chunkSize - 1) / chunkSize;
+    NSUInteger maxTimelineCount = self.maxTimelineCount;
+    dispatch_apply(chunkCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t chunkIndex) {
+        INSKAMPose *poses = malloc(maxTimelineCount * sizeof(INSKAMPose));
+        INSKAMSpatial *decodedSpatial = [[INSKAMSpatial alloc] init];
+        INSKAMSpatial *decodedNextSpatial = [[INSKAMSpatial alloc] init];
+        decodedSpatial.nextSpatial = decodedNextSpatial;
+        
+        NSUInteger endIndex = MIN((chunkIndex + 1) * chunkSize, actorCount);
+        for (NSUInteger actorIndex = chunkIndex * chunkSize; actorIndex < endIndex; ++actorIndex) {
+            [self evaluateActor:&actors[actorIndex] shapes:&actorShapes[actorIndex] boxes:boxes points:points poses:poses decodedSpatial:decodedSpatial];
+        }
+        
+        free(poses);
+    });
+}
+
+- (NSUInteger)indexOfActorContainingPoint:(CGPoint)point {
+    const INSKAMCollisionActorShapes *actorShapes = self.actorShapes;
+    const INSKAMCollisionBox *boxes = self.boxes;
+    for (NSUInteger actorIndex = 0; actorIndex < self.actorCount; ++actorIndex) {
+        const INSKAMCollisionActorShapes *shapes = &actorShapes[actorIndex];
+        for (NSUInteger boxIndex = shapes->firstBox; boxIndex < shapes->firstBox + shapes->boxCount; ++boxIndex) {
+            if (INSKAMCollisionBoxContainsPoint(&boxes[boxIndex], point)) {
+                return actorIndex;
+            }
+        }
+    }
+    return NSNotFound;
+}
+
+
+#pragma mark - private methods
+
+// Registers an animation and builds for each of its mainline keys the list of timelines needed for its boxes and points.
+- (void)prepareAnimation:(INSKAMAnimation *)animation {
+    NSArray *timelines = animation.timelines;
+    NSUInteger timelineCount = timelines.count;
+    NSMutableData *neededData = [NSMutableData dataWithLength:timelineCount * sizeof(BOOL)];
+    BOOL *needed = neededData.mutableBytes;
+    NSMutableArray *orders = [NSMutableArray arrayWithCapacity:animation.mainlineKeys.count];
+    for (INSKAMMainlineKey *mainlineKey in animation.mainlineKeys) {
+        // walk the evaluation order backwards so children mark their parents before the parents are visited
+        memset(needed, 0, timelineCount * sizeof(BOOL));
+        NSUInteger *evaluationOrder = mainlineKey.evaluationOrder;
+        NSUInteger evaluationCount = mainlineKey.evaluationCount;
+        for (NSUInteger orderIndex = evaluationCount; orderIndex > 0; --orderIndex) {
+            NSUInteger timelineIndex = evaluationOrder[orderIndex - 1];
+            INSKAMSpatialType spatialType = [timelines[timelineIndex] spatialType];
+            if (spatialType == INSKAMSpatialTypeCollisionbox || spatialType == INSKAMSpatialTypePoint) {
+                needed[timelineIndex] = YES;
+            }
+            NSInteger parentIndex = mainlineKey.slots[timelineIndex].parentIndex;
+            if (needed[timelineIndex] && parentIndex != INSKAMMainlineNoParent) {
+                needed[parentIndex] = YES;
+            }
+        }
+        
+        // keep the needed timelines in evaluation order
+        NSMutableData *order = [NSMutableData dataWithCapacity:evaluationCount * sizeof(NSUInteger)];
+        for (NSUInteger orderIndex = 0; orderIndex < evaluationCount; ++orderIndex) {
+            NSUInteger timelineIndex = evaluationOrder[orderIndex];
+            if (needed[timelineIndex]) {
+                [order appendBytes:&timelineIndex length:sizeof(NSUInteger)];
+            }
+        }
+        [orders addObject:order];
+    }
+    
+    INSKAMCollisionCapacity capacity;
+    capacity.boxCount = [animation timelineCountOfSpatialType:INSKAMSpatialTypeCollisionbox];
+    capacity.pointCount = [animation timelineCountOfSpatialType:INSKAMSpatialTypePoint];
+    [self.capacityData appendBytes:&capacity length:sizeof(INSKAMCollisionCapacity)];
+    [self.evaluationOrders addObject:orders];
+    [self.animations addObject:animation];
+    self.maxTimelineCount = MAX(self.maxTimelineCount, timelineCount);
+}
+
+// Evaluates the boxes and points of one actor, may be called concurrently with different scratch buffers.
+- (void)evaluateActor:(const INSKAMCollisionActor *)actor shapes:(INSKAMCollisionActorShapes *)shapes boxes:(INSKAMCollisionBox *)boxes points:(INSKAMCollisionPoint *)points poses:(INSKAMPose *)poses decodedSpatial:(INSKAMSpatial *)decodedSpatial {
+    INSKAMAnimation *animation = self.animations[actor->animationIndex];
+    
+    // bring the time into the animation's range like an animation node does
+    INSKAMTicks time = actor->time;
+    INSKAMTicks animationLength = animation.length;
+    if (animationLength == 0) {
+        time = 0;
+    } else if (animation.looping) {
+        time %= animationLength;
+        if (time < 0) {
+            time += animationLength;
+        }
+    } else {
+        time = MIN(MAX(time, 0), animationLength);
+    }
+    
+    NSUInteger mainlineKeyIndex = [animation mainlineKeyIndexForTime:time];
+    if (mainlineKeyIndex == NSNotFound) {
+        return;
+    }
+    INSKAMMainlineKey *mainlineKey = animation.mainlineKeys[mainlineKeyIndex];
+    INSKAMMainlineSlot *slots = mainlineKey.slots;
+    NSData *order = self.evaluationOrders[actor->animationIndex][mainlineKeyIndex];
+    const NSUInteger *timelineIndexes = order.bytes;
+    NSUInteger timelineIndexCount = order.length / sizeof(NSUInteger);
+    NSArray *timelines = animation.timelines;
+    CGFloat rootSine = sin(actor->angle);
+    CGFloat rootCosine = cos(actor->angle);
+    
+    for (NSUInteger orderIndex = 0; orderIndex < timelineIndexCount; ++orderIndex) {
+        NSUInteger timelineIndex = timelineIndexes[orderIndex];
+        INSKAMTimeline *timeline = timelines[timelineIndex];
+        
+        // the spatial for the time, compressed keyframes are decoded into the scratch spatials
+        INSKAMSpatial *spatial;
+        if (timeline.compressed) {
+            NSUInteger keyIndex = [timeline keyIndexForTime:time];
+            [timeline decodeKeyAtIndex:keyIndex intoSpatial:decodedSpatial];
+            [timeline decodeKeyAtIndex:(keyIndex + 1) % timeline.keyCount intoSpatial:decodedSpatial.nextSpatial];
+            spatial = decodedSpatial;
+        } else {
+            spatial = [timeline spatialForTime:time];
+        }
+        NSAssert(spatial != nil, @"A Spatial should be found");
+        
+        // local pose composed with the parent's pose which has been evaluated already
+        CGFloat interpolationRatio = (spatial.time == time ? 0.0 : [spatial interpolationRatioForTime:time]);
+        INSKAMPose pose = [spatial poseWithInterpolation:interpolationRatio];
+        NSInteger parentIndex = slots[timelineIndex].parentIndex;
+        if (parentIndex != INSKAMMainlineNoParent) {
+            pose = INSKAMPoseConcat(poses[parentIndex], pose);
+        }
+        poses[timelineIndex] = pose;
+        if (pose.hidden) {
+            continue;
+        }
+        
+        // shapes are evaluated in the animation's space and then placed with the actor's root transformation
+        INSKAMSpatialType spatialType = timeline.spatialType;
+        if (spatialType == INSKAMSpatialTypeCollisionbox) {
+            INSKAMCollisionBox *box = &boxes[shapes->firstBox + shapes->boxCount++];
+            box->timelineIndex = timelineIndex;
+            INSKAMCollisionBoxSetPose(box, pose, spatial.width, spatial.height);
+            box->bounds = CGRectNull;
+            for (NSUInteger cornerIndex = 0; cornerIndex < 4; ++cornerIndex) {
+                CGPoint corner = box->corners[cornerIndex];
+                CGFloat scaledX = corner.x * actor->scaleX;
+                CGFloat scaledY = corner.y * actor->scaleY;
+                corner = CGPointMake(actor->positionX + rootCosine * scaledX - rootSine * scaledY, actor->positionY + rootSine * scaledX + rootCosine * scaledY);
+                box->corners[cornerIndex] = corner;
+                box->bounds = CGRectUnion(box->bounds, CGRectMake(corner.x, corner.y, 0.0, 0.0));
+            }
+        } else if (spatialType == INSKAMSpatialTypePoint) {
+            INSKAMCollisionPoint *point = &points[shapes->firstPoint + shapes->pointCount++];
+            point->timelineIndex = timelineIndex;
+            CGFloat scaledX = pose.positionX * actor->scaleX;
+            CGFloat scaledY = pose.positionY * actor->scaleY;
+            point->position = CGPointMake(actor->positionX + rootCosine * scaledX - rootSine * scaledY, actor->positionY + rootSine * scaledX + rootCosine * scaledY);
+            point->angle = actor->angle + atan2(sin(pose.angle) * actor->scaleY, cos(pose.angle) * actor->scaleX);
+        }
+    }
+}
+
+
+@end
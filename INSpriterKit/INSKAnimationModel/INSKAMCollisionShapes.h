@@ -0,0 +1,108 @@
+// INSKAMCollisionShapes.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "INSKAMPose.h"
+
+
+/**
+ A collision box of an animation evaluated for one point of time.
+ 
+ The coordinates are in the animation node's space.
+ */
+typedef struct {
+    /// The index of the box's timeline in the animation's timelines array, i.e. to get the box's name.
+    NSUInteger timelineIndex;
+    /// The corners of the box in the order lower left, lower right, upper right and upper left before rotating it.
+    CGPoint corners[4];
+    /// The axis aligned bounding rect of the corners.
+    CGRect bounds;
+} INSKAMCollisionBox;
+
+
+/**
+ An action point of an animation evaluated for one point of time.
+ 
+ The coordinates are in the animation node's space.
+ */
+typedef struct {
+    /// The index of the point's timeline in the animation's timelines array, i.e. to get the point's name.
+    NSUInteger timelineIndex;
+    /// The point's position.
+    CGPoint position;
+    /// The point's angle in radians.
+    CGFloat angle;
+} INSKAMCollisionPoint;
+
+
+/**
+ Sets a collision box's corners and bounds from the box's evaluated pose.
+ 
+ The pivot point and the scale of the pose define the box's extent relative to its position, the angle rotates it around the position.
+ 
+ @param box The box to update, its timelineIndex is left untouched.
+ @param pose The evaluated pose of the box.
+ @param width The unscaled width of the box.
+ @param height The unscaled height of the box.
+ */
+static inline void INSKAMCollisionBoxSetPose(INSKAMCollisionBox *box, INSKAMPose pose, CGFloat width, CGFloat height) {
+    CGFloat left = -pose.pivotX * width * pose.scaleX;
+    CGFloat right = (1.0 - pose.pivotX) * width * pose.scaleX;
+    CGFloat bottom = -pose.pivotY * height * pose.scaleY;
+    CGFloat top = (1.0 - pose.pivotY) * height * pose.scaleY;
+    CGPoint localCorners[4] = {CGPointMake(left, bottom), CGPointMake(right, bottom), CGPointMake(right, top), CGPointMake(left, top)};
+    CGFloat sine = sin(pose.angle);
+    CGFloat cosine = cos(pose.angle);
+    box->bounds = CGRectNull;
+    for (NSUInteger cornerIndex = 0; cornerIndex < 4; ++cornerIndex) {
+        CGPoint corner = localCorners[cornerIndex];
+        box->corners[cornerIndex] = CGPointMake(pose.positionX + cosine * corner.x - sine * corner.y, pose.positionY + sine * corner.x + cosine * corner.y);
+        box->bounds = CGRectUnion(box->bounds, CGRectMake(box->corners[cornerIndex].x, box->corners[cornerIndex].y, 0.0, 0.0));
+    }
+}
+
+
+/**
+ Tests if a point lays inside of a collision box.
+ 
+ The bounds are checked first, then the point has to be on the same side of all four edges.
+ The test works for both winding orders so boxes mirrored by a negative scale are supported as well.
+ 
+ @param box The collision box.
+ @param point The point in the same coordinate space as the box.
+ @return True if the point is inside of the box or on its edges.
+ */
+static inline BOOL INSKAMCollisionBoxContainsPoint(const INSKAMCollisionBox *box, CGPoint point) {
+    if (!CGRectContainsPoint(box->bounds, point)) {
+        return NO;
+    }
+    BOOL hasPositive = NO;
+    BOOL hasNegative = NO;
+    for (NSUInteger cornerIndex = 0; cornerIndex < 4; ++cornerIndex) {
+        CGPoint start = box->corners[cornerIndex];
+        CGPoint end = box->corners[(cornerIndex + 1) % 4];
+        CGFloat cross = (end.x - start.x) * (point.y - start.y) - (end.y - start.y) * (point.x - start.x);
+        hasPositive = hasPositive || cross > 0.0;
+        hasNegative = hasNegative || cross < 0.0;
+    }
+    return !(hasPositive && hasNegative);
+}
@@ -21,6 +21,10 @@
 // THE SOFTWARE.
 
 
+@class INSKAMArchive;
+@class INSKAMEntity;
+
+
 @interface INSKAMData : NSObject <NSCopying>
 
 /// A dictionary of ISNKAMEntity objects with their name property as key.
@@ -29,4 +33,69 @@
 @property (nonatomic, strong) NSMutableDictionary *texturesById;
 
 
+/**
+ Converts the keyframes of all timelines into the compressed storage form.
+ 
+ Lazily loaded animations which haven't been prepared yet have no timelines and are skipped.
+ 
+ @return The number of timelines which could be compressed.
+ @see [INSKAMTimeline compress]
+ */
+- (NSUInteger)compressTimelines;
+
+
+/**
+ Returns the number of bytes used for storing the keyframes of all timelines.
+ 
+ @return The keyframe storage size in bytes.
+ @see [INSKAMTimeline keyframeMemorySize]
+ */
+- (NSUInteger)keyframeMemorySize;
+
+
+#pragma mark - Archiving
+/// @name Archiving
+
+/**
+ Writes the textures and entities with all their animations into an archive.
+ 
+ All animations have to be complete, lazily loaded animations have to be prepared before.
+ 
+ @param archive The archive to write into.
+ @see [INSKSpriterParser cacheDirectory]
+ */
+- (void)encodeWithArchive:(INSKAMArchive *)archive;
+
+
+/**
+ Initializes animation data with the textures and entities read from an archive written by encodeWithArchive:.
+ 
+ @param archive The archive to read from.
+ @return The animation data or nil if the archive is malformed.
+ */
+- (instancetype)initWithArchive:(INSKAMArchive *)archive;
+
+
+/**
+ Initializes animation data with only the textures read from an archive, for decoding the entities in parts.
+ 
+ The entities following the textures can be read with initWithArchive: of INSKAMEntity or in parts with its initWithArchiveHeader:animationCount:.
+ 
+ @param archive The archive to read from.
+ @param entityCount Returns the number of entities which follow.
+ @return The animation data without entities or nil if the archive is malformed.
+ @see [INSKSpriterParser step:]
+ */
+- (instancetype)initWithArchiveHeader:(INSKAMArchive *)archive entityCount:(NSUInteger *)entityCount;
+
+
+/**
+ Adds an entity read from the archive to animation data initialized with initWithArchiveHeader:entityCount:.
+ 
+ @param entity The decoded entity, may be nil.
+ @return True if the entity has been added, false if it's nil.
+ */
+- (BOOL)addDecodedEntity:(INSKAMEntity *)entity;
+
+
 @end
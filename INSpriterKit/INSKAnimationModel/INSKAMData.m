@@ -22,6 +22,11 @@
 
 
 #import "INSKAMData.h"
+#import "INSKAMEntity.h"
+#import "INSKAMAnimation.h"
+#import "INSKAMTimeline.h"
+#import "INSKAMTexture.h"
+#import "INSKAMArchive.h"
 #import <INLib/INLib.h>
 
 
@@ -39,4 +44,88 @@
 }
 
 
+- (NSUInteger)compressTimelines {
+    NSUInteger compressedCount = 0;
+    for (INSKAMEntity *entity in self.entitiesByName.allValues) {
+        for (INSKAMAnimation *animation in entity.animationsByName.allValues) {
+            for (INSKAMTimeline *timeline in animation.timelinesById.allValues) {
+                if ([timeline compress]) {
+                    ++compressedCount;
+                }
+            }
+        }
+    }
+    return compressedCount;
+}
+
+- (NSUInteger)keyframeMemorySize {
+    NSUInteger size = 0;
+    for (INSKAMEntity *entity in self.entitiesByName.allValues) {
+        for (INSKAMAnimation *animation in entity.animationsByName.allValues) {
+            for (INSKAMTimeline *timeline in animation.timelinesById.allValues) {
+                size += [timeline keyframeMemorySize];
+            }
+        }
+    }
+    return size;
+}
+
+
+#pragma mark - Archiving
+
+- (void)encodeWithArchive:(INSKAMArchive *)archive {
+    [archive encodeTextures:self.texturesById.allValues];
+    [archive encodeInteger:self.entitiesByName.count];
+    for (INSKAMEntity *entity in self.entitiesByName.allValues) {
+        [entity encodeWithArchive:archive];
+    }
+}
+
+- (instancetype)initWithArchive:(INSKAMArchive *)archive {
+    NSUInteger entityCount = 0;
+    self = [self initWithArchiveHeader:archive entityCount:&entityCount];
+    if (self == nil) return self;
+    
+    for (NSUInteger index = 0; index < entityCount; ++index) {
+        if (archive.failed || ![self addDecodedEntity:[[INSKAMEntity alloc] initWithArchive:archive]]) {
+            return nil;
+        }
+    }
+    if (archive.failed) {
+        return nil;
+    }
+    
+    return self;
+}
+
+- (instancetype)initWithArchiveHeader:(INSKAMArchive *)archive entityCount:(NSUInteger *)entityCount {
+    self = [super init];
+    if (self == nil) return self;
+    
+    NSArray *textures = [archive decodeTextures];
+    self.texturesById = [NSMutableDictionary dictionaryWithCapacity:textures.count];
+    for (INSKAMTexture *texture in textures) {
+        if (texture.textureId == nil) {
+            return nil;
+        }
+        [self.texturesById setObject:texture forKey:texture.textureId];
+    }
+    *entityCount = [archive decodeCount];
+    self.entitiesByName = [NSMutableDictionary dictionaryWithCapacity:*entityCount];
+    if (archive.failed) {
+        return nil;
+    }
+    
+    return self;
+}
+
+- (BOOL)addDecodedEntity:(INSKAMEntity *)entity {
+    if (entity == nil) {
+        return NO;
+    }
+    [self.entitiesByName setObject:entity forKey:entity.name];
+    return YES;
+}
+
+
 @end
@@ -21,12 +21,130 @@
 // THE SOFTWARE.
 
 
+#import "INSKAMPose.h"
+
+
+@class INSKAMArchive;
+@class INSKAMAnimation;
+
+
 @interface INSKAMEntity : NSObject <NSCopying>
 
 /// The entity's name.
 @property (nonatomic, copy) NSString *name;
 /// A dictionary of INSKAMAnimation objects and their name as the key.
 @property (nonatomic, strong) NSMutableDictionary *animationsByName;
+/// The INSKAMAnimation objects in Spriter's order, each at the position of its animationIndex.
+@property (nonatomic, strong) NSMutableArray *animations;
+/// The number of different objects animated by the timelines of all animations.
+@property (nonatomic, assign) NSUInteger objectCount;
+/// A dictionary with the object index of each timeline name as NSNumber, timelines without a name are identified by their ID.
+@property (nonatomic, strong) NSMutableDictionary *objectIndexesByName;
+
+
+/**
+ Assigns each timeline of all animations the index of the object it animates.
+ 
+ Timelines are identified by their names across the animations, so the same bone or sprite gets the same objectIndex in each animation.
+ This allows mapping the timelines of two animations onto each other, i.e. for blending, and sizing buffers per entity with objectCount.
+ Call this method after all animations have been added.
+ */
+- (void)assignObjectIndexes;
+
+
+/**
+ Assigns each timeline of an animation the index of the object it animates.
+ 
+ Names not registered yet get the next object index and increase the objectCount.
+ 
+ @param animation The animation of this entity.
+ */
+- (void)assignObjectIndexesOfAnimation:(INSKAMAnimation *)animation;
+
+
+/**
+ Registers an object by its timeline name before the animations are converted.
+ 
+ A parser converting the animations lazily registers all objects first, so the objectCount is known before any animation is converted.
+ 
+ @param name The name of the timeline or its ID if it has no name.
+ @return The object's index.
+ */
+- (NSUInteger)registerObjectNamed:(NSString *)name;
+
+
+/**
+ Prepares some animations which have been loaded lazily, so playing them doesn't convert them.
+ 
+ @param animationNames An array with the NSString names of the animations to prepare or nil for all animations.
+ @see [INSKAMAnimation prepare]
+ */
+- (void)prepareAnimations:(NSArray *)animationNames;
+
+
+#pragma mark - Evaluation buffers
+/// @name Evaluation buffers
+
+/**
+ Returns a buffer for the world poses of the animation an animation node plays, indexed by the animation's timeline indexes.
+ 
+ The buffer is shared by all animation nodes of the entity and only valid during a single update or evaluation on the thread updating the nodes.
+ It is sized by the objectCount and only grows if an animation has more timelines than the entity has objects.
+ 
+ @param count The number of poses needed.
+ @return The pose buffer.
+ */
+- (INSKAMPose *)targetPosesWithCount:(NSUInteger)count;
+
+
+/**
+ Returns a buffer for the local poses of an animation blended from, indexed by the object indexes.
+ 
+ The buffer is shared by all animation nodes of the entity like targetPosesWithCount:, so a transition between two animations allocates nothing.
+ 
+ @param mask Returns a buffer with a BOOL for each object, true if the pose of the object has been evaluated.
+ @return The pose buffer with one pose for each object.
+ */
+- (INSKAMPose *)sourcePosesWithMask:(BOOL **)mask;
+
+
+#pragma mark - Archiving
+/// @name Archiving
+
+/**
+ Writes the entity with its object indexes and animations into an archive.
+ 
+ @param archive The archive to write into.
+ */
+- (void)encodeWithArchive:(INSKAMArchive *)archive;
+
+
+/**
+ Initializes an entity read from an archive.
+ 
+ @param archive The archive to read from.
+ @return The entity or nil if the archive is malformed.
+ */
+- (instancetype)initWithArchive:(INSKAMArchive *)archive;
+
+
+/**
+ Initializes an entity with its name and object indexes read from an archive, without the animations following them.
+ 
+ @param archive The archive to read from.
+ @param animationCount Returns the number of animations which follow.
+ @return The entity without animations or nil if the archive is malformed.
+ */
+- (instancetype)initWithArchiveHeader:(INSKAMArchive *)archive animationCount:(NSUInteger *)animationCount;
+
+
+/**
+ Adds the next animation read from the archive to an entity initialized with initWithArchiveHeader:animationCount:.
+ 
+ @param animation The decoded animation, may be nil.
+ @return True if the animation has been added, false if it's nil or its index doesn't follow the added animations.
+ */
+- (BOOL)addDecodedAnimation:(INSKAMAnimation *)animation;
 
 
 @end
@@ -22,15 +22,33 @@
 
 
 #import "INSKAMEntity.h"
+#import "INSKAMAnimation.h"
+#import "INSKAMTimeline.h"
+#import "INSKAMArchive.h"
 #import <INLib/INLib.h>
 
 
+@interface INSKAMEntity ()
+
+// The buffer returned by targetPosesWithCount:.
+@property (nonatomic, strong) NSMutableData *targetPoseData;
+// The buffer returned by sourcePosesWithMask:.
+@property (nonatomic, strong) NSMutableData *sourcePoseData;
+// The mask returned by sourcePosesWithMask:.
+@property (nonatomic, strong) NSMutableData *sourcePoseMaskData;
+
+@end
+
+
 @implementation INSKAMEntity
 
 - (instancetype)copyWithZone:(NSZone *)zone {
     INSKAMEntity *entityCopy = [[[self class] allocWithZone:zone] init];
     entityCopy.name = self.name;
     entityCopy.animationsByName = self.animationsByName.mutableCopy;
+    entityCopy.animations = self.animations.mutableCopy;
+    entityCopy.objectCount = self.objectCount;
+    entityCopy.objectIndexesByName = self.objectIndexesByName.mutableCopy;
     return entityCopy;
 }
 
@@ -38,5 +56,132 @@
     return [NSString stringWithFormat:@"Entity '%@': %@", self.name, [self.animationsByName.allValues descriptionWithStart:@"[\n" elementFormatter:@"%@,\n" lastElementFormatter:@"%@\n" end:@"]"]];
 }
 
+- (void)assignObjectIndexes {
+    self.objectIndexesByName = [NSMutableDictionary dictionary];
+    self.objectCount = 0;
+    for (INSKAMAnimation *animation in self.animationsByName.allValues) {
+        [self assignObjectIndexesOfAnimation:animation];
+    }
+}
+
+- (void)assignObjectIndexesOfAnimation:(INSKAMAnimation *)animation {
+    for (INSKAMTimeline *timeline in animation.timelines) {
+        // unnamed timelines can only be identified by their ID
+        timeline.objectIndex = [self registerObjectNamed:(timeline.name != nil ? timeline.name : timeline.timelineId)];
+    }
+}
+
+- (NSUInteger)registerObjectNamed:(NSString *)name {
+    if (self.objectIndexesByName == nil) {
+        self.objectIndexesByName = [NSMutableDictionary dictionary];
+    }
+    NSNumber *objectIndex = [self.objectIndexesByName objectForKey:name];
+    if (objectIndex == nil) {
+        objectIndex = @(self.objectIndexesByName.count);
+        [self.objectIndexesByName setObject:objectIndex forKey:name];
+        self.objectCount = self.objectIndexesByName.count;
+    }
+    return objectIndex.unsignedIntegerValue;
+}
+
+- (INSKAMPose *)targetPosesWithCount:(NSUInteger)count {
+    NSUInteger length = MAX(count, self.objectCount) * sizeof(INSKAMPose);
+    if (self.targetPoseData.length < length) {
+        self.targetPoseData = [NSMutableData dataWithLength:length];
+    }
+    return self.targetPoseData.mutableBytes;
+}
+
+- (INSKAMPose *)sourcePosesWithMask:(BOOL **)mask {
+    NSUInteger objectCount = self.objectCount;
+    if (self.sourcePoseMaskData.length < objectCount * sizeof(BOOL)) {
+        self.sourcePoseData = [NSMutableData dataWithLength:objectCount * sizeof(INSKAMPose)];
+        self.sourcePoseMaskData = [NSMutableData dataWithLength:objectCount * sizeof(BOOL)];
+    }
+    *mask = self.sourcePoseMaskData.mutableBytes;
+    return self.sourcePoseData.mutableBytes;
+}
+
+- (void)prepareAnimations:(NSArray *)animationNames {
+    if (animationNames == nil) {
+        for (INSKAMAnimation *animation in self.animations) {
+            [animation prepare];
+        }
+        return;
+    }
+    for (NSString *animationName in animationNames) {
+        [[self.animationsByName objectForKey:animationName] prepare];
+    }
+}
+
+
+#pragma mark - Archiving
+
+- (void)encodeWithArchive:(INSKAMArchive *)archive {
+    [archive encodeString:self.name];
+    [archive encodeInteger:self.objectCount];
+    [archive encodeInteger:self.objectIndexesByName.count];
+    [self.objectIndexesByName enumerateKeysAndObjectsUsingBlock:^(NSString *objectName, NSNumber *objectIndex, BOOL *stop) {
+        [archive encodeString:objectName];
+        [archive encodeInteger:objectIndex.integerValue];
+    }];
+    [archive encodeInteger:self.animations.count];
+    for (INSKAMAnimation *animation in self.animations) {
+        [animation encodeWithArchive:archive];
+    }
+}
+
+- (instancetype)initWithArchive:(INSKAMArchive *)archive {
+    NSUInteger animationCount = 0;
+    self = [self initWithArchiveHeader:archive animationCount:&animationCount];
+    if (self == nil) return self;
+    
+    for (NSUInteger index = 0; index < animationCount; ++index) {
+        if (archive.failed || ![self addDecodedAnimation:[[INSKAMAnimation alloc] initWithArchive:archive]]) {
+            return nil;
+        }
+    }
+    if (archive.failed) {
+        return nil;
+    }
+    
+    return self;
+}
+
+- (instancetype)initWithArchiveHeader:(INSKAMArchive *)archive animationCount:(NSUInteger *)animationCount {
+    self = [super init];
+    if (self == nil) return self;
+    
+    self.name = [archive decodeString];
+    self.objectCount = [archive decodeInteger];
+    NSUInteger objectNameCount = [archive decodeCount];
+    self.objectIndexesByName = [NSMutableDictionary dictionaryWithCapacity:objectNameCount];
+    for (NSUInteger index = 0; index < objectNameCount && !archive.failed; ++index) {
+        NSString *objectName = [archive decodeString];
+        NSInteger objectIndex = [archive decodeInteger];
+        if (objectName == nil || objectIndex < 0 || (NSUInteger)objectIndex >= self.objectCount) {
+            return nil;
+        }
+        [self.objectIndexesByName setObject:@(objectIndex) forKey:objectName];
+    }
+    *animationCount = [archive decodeCount];
+    self.animations = [NSMutableArray arrayWithCapacity:*animationCount];
+    self.animationsByName = [NSMutableDictionary dictionaryWithCapacity:*animationCount];
+    if (archive.failed || self.name == nil) {
+        return nil;
+    }
+    
+    return self;
+}
+
+- (BOOL)addDecodedAnimation:(INSKAMAnimation *)animation {
+    if (animation == nil || animation.animationIndex != self.animations.count) {
+        return NO;
+    }
+    [self.animations addObject:animation];
+    [self.animationsByName setObject:animation forKey:animation.name];
+    return YES;
+}
+
 
 @end
@@ -23,9 +23,16 @@
 
 #import "INSKAMMath.h"
 #import "INSKAMAnimation.h"
+#import "INSKAMArchive.h"
+#import "INSKAMCollisionEvaluator.h"
+#import "INSKAMCollisionShapes.h"
 #import "INSKAMData.h"
 #import "INSKAMEntity.h"
+#import "INSKAMMainlineKey.h"
+#import "INSKAMPose.h"
 #import "INSKAMSpatial.h"
+#import "INSKAMSpatial+SpriteKit.h"
 #import "INSKAMTexture.h"
 #import "INSKAMTimeline.h"
+#import "INSKAMTimelineCursor.h"
 #import "INSKAMTypes.h"
@@ -0,0 +1,122 @@
+// INSKAMMainlineKey.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "INSKAMTypes.h"
+
+
+@class INSKAMArchive;
+
+
+/// The parent index of a mainline slot which has no parent and is attached to the animation node directly.
+static NSInteger const INSKAMMainlineNoParent = -1;
+
+
+/**
+ The hierarchy and visibility state of one timeline for a mainline key.
+ */
+typedef struct {
+    /// The index of the parent timeline in the animation's timelines array or INSKAMMainlineNoParent.
+    int16_t parentIndex;
+    /// The Z-index of the timeline's object, 0 for bones.
+    int16_t zIndex;
+    /// True if the timeline is referenced by the mainline key and thus part of the animation, otherwise the node is hidden.
+    BOOL active;
+} INSKAMMainlineSlot;
+
+
+/**
+ A precomputed mainline key of an animation.
+ 
+ The hierarchy, Z-order and visibility of the nodes in an animation can only change at mainline keys.
+ A mainline key holds a compact table with one INSKAMMainlineSlot per timeline ordered like the animation's timelines array
+ so the animation node only has to apply the differences when the playback crosses a mainline key.
+ */
+@interface INSKAMMainlineKey : NSObject <NSCopying>
+
+/// The time of the mainline key in ticks.
+@property (nonatomic, assign) INSKAMTicks time;
+/// The number of slots which is the number of timelines in the animation.
+@property (nonatomic, assign, readonly) NSUInteger slotCount;
+/// The table of slots, one for each timeline of the animation.
+@property (nonatomic, assign, readonly) INSKAMMainlineSlot *slots;
+/// The number of entries in evaluationOrder which is the number of active slots.
+@property (nonatomic, assign, readonly) NSUInteger evaluationCount;
+/// The indexes of the active slots ordered so each parent comes before its children, valid after calling buildEvaluationOrder.
+@property (nonatomic, assign, readonly) NSUInteger *evaluationOrder;
+
+
+/**
+ Initializes a mainline key with a table of inactive slots without parents.
+ 
+ @param slotCount The number of timelines in the animation.
+ @return A new mainline key.
+ */
+- (instancetype)initWithSlotCount:(NSUInteger)slotCount;
+
+
+/**
+ Sorts the active slots so parents are evaluated before their children.
+ 
+ Needed for composing world poses in a single pass over the slots.
+ The ancestor chains of all active slots are built in the same pass.
+ Call this method after all slots have been set up.
+ */
+- (void)buildEvaluationOrder;
+
+
+/**
+ Returns the ancestor chain of a slot, which are the indexes of its parent, the parent's parent and so on, ordered root first and ending with the slot itself.
+ 
+ Evaluating the slots in this order composes the world pose of a single timeline without evaluating the other timelines.
+ Valid after calling buildEvaluationOrder.
+ 
+ @param slotIndex The index of the slot.
+ @param count Returns the number of indexes in the chain, 0 if the slot isn't active.
+ @return The chain's slot indexes owned by the mainline key.
+ */
+- (const NSUInteger *)ancestorChainOfSlot:(NSUInteger)slotIndex count:(NSUInteger *)count;
+
+
+#pragma mark - Archiving
+/// @name Archiving
+
+/**
+ Writes the mainline key's time and slots into an archive.
+ 
+ @param archive The archive to write into.
+ */
+- (void)encodeWithArchive:(INSKAMArchive *)archive;
+
+
+/**
+ Initializes a mainline key read from an archive and builds its evaluation order.
+ 
+ @param archive The archive to read from.
+ @param slotCount The number of timelines in the animation, which the archived slots have to match.
+ @return The mainline key or nil if the archive is malformed.
+ */
+- (instancetype)initWithArchive:(INSKAMArchive *)archive slotCount:(NSUInteger)slotCount;
+
+
+@end
@@ -0,0 +1,195 @@
+// INSKAMMainlineKey.m
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "INSKAMMainlineKey.h"
+#import "INSKAMArchive.h"
+
+
+@interface INSKAMMainlineKey ()
+
+// The storage for the slots.
+@property (nonatomic, strong) NSMutableData *slotData;
+// The storage for the evaluation order.
+@property (nonatomic, strong) NSMutableData *evaluationOrderData;
+// The storage for the ancestor chains of all active slots one after another.
+@property (nonatomic, strong) NSMutableData *ancestorChainData;
+// A NSRange for each slot locating its ancestor chain in ancestorChainData.
+@property (nonatomic, strong) NSMutableData *ancestorChainRangeData;
+
+@end
+
+
+@implementation INSKAMMainlineKey
+
+- (instancetype)initWithSlotCount:(NSUInteger)slotCount {
+    self = [super init];
+    if (self == nil) return self;
+    
+    self.slotData = [NSMutableData dataWithLength:slotCount * sizeof(INSKAMMainlineSlot)];
+    for (NSUInteger index = 0; index < slotCount; ++index) {
+        self.slots[index].parentIndex = INSKAMMainlineNoParent;
+        self.slots[index].zIndex = 0;
+        self.slots[index].active = NO;
+    }
+    
+    return self;
+}
+
+- (instancetype)init {
+    return [self initWithSlotCount:0];
+}
+
+- (instancetype)copyWithZone:(NSZone *)zone {
+    INSKAMMainlineKey *keyCopy = [[[self class] allocWithZone:zone] init];
+    keyCopy.time = self.time;
+    keyCopy.slotData = self.slotData.mutableCopy;
+    keyCopy.evaluationOrderData = self.evaluationOrderData.mutableCopy;
+    keyCopy.ancestorChainData = self.ancestorChainData.mutableCopy;
+    keyCopy.ancestorChainRangeData = self.ancestorChainRangeData.mutableCopy;
+    return keyCopy;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"MainlineKey %ld (%lu slots)", (long)self.time, (unsigned long)self.slotCount];
+}
+
+- (NSUInteger)slotCount {
+    return self.slotData.length / sizeof(INSKAMMainlineSlot);
+}
+
+- (INSKAMMainlineSlot *)slots {
+    return self.slotData.mutableBytes;
+}
+
+- (NSUInteger)evaluationCount {
+    return self.evaluationOrderData.length / sizeof(NSUInteger);
+}
+
+- (NSUInteger *)evaluationOrder {
+    return self.evaluationOrderData.mutableBytes;
+}
+
+- (void)buildEvaluationOrder {
+    NSUInteger slotCount = self.slotCount;
+    INSKAMMainlineSlot *slots = self.slots;
+    NSMutableData *orderData = [NSMutableData dataWithCapacity:slotCount * sizeof(NSUInteger)];
+    NSMutableData *addedData = [NSMutableData dataWithLength:slotCount * sizeof(BOOL)];
+    BOOL *added = addedData.mutableBytes;
+    
+    // add the slots level by level, a slot can be added when its parent has been added already
+    BOOL slotAdded = YES;
+    while (slotAdded) {
+        slotAdded = NO;
+        for (NSUInteger index = 0; index < slotCount; ++index) {
+            if (added[index] || !slots[index].active) {
+                continue;
+            }
+            NSInteger parentIndex = slots[index].parentIndex;
+            if (parentIndex == INSKAMMainlineNoParent || added[parentIndex]) {
+                [orderData appendBytes:&index length:sizeof(NSUInteger)];
+                added[index] = YES;
+                slotAdded = YES;
+            }
+        }
+    }
+    NSAssert(orderData.length / sizeof(NSUInteger) == [self activeSlotCount], @"the active slots should only have active parents without cycles");
+    self.evaluationOrderData = orderData;
+    [self buildAncestorChains];
+}
+
+// Builds the ancestor chains in evaluation order, so each chain is the parent's chain plus the slot itself.
+- (void)buildAncestorChains {
+    NSUInteger slotCount = self.slotCount;
+    INSKAMMainlineSlot *slots = self.slots;
+    NSMutableData *rangeData = [NSMutableData dataWithLength:slotCount * sizeof(NSRange)];
+    NSRange *ranges = rangeData.mutableBytes;
+    NSMutableData *chainData = [NSMutableData data];
+    NSUInteger *evaluationOrder = self.evaluationOrder;
+    for (NSUInteger orderIndex = 0; orderIndex < self.evaluationCount; ++orderIndex) {
+        NSUInteger index = evaluationOrder[orderIndex];
+        NSInteger parentIndex = slots[index].parentIndex;
+        NSUInteger location = chainData.length / sizeof(NSUInteger);
+        if (parentIndex != INSKAMMainlineNoParent) {
+            NSRange parentRange = ranges[parentIndex];
+            NSMutableData *parentChain = [NSMutableData dataWithBytes:(const NSUInteger *)chainData.bytes + parentRange.location length:parentRange.length * sizeof(NSUInteger)];
+            [chainData appendData:parentChain];
+        }
+        [chainData appendBytes:&index length:sizeof(NSUInteger)];
+        ranges[index] = NSMakeRange(location, chainData.length / sizeof(NSUInteger) - location);
+    }
+    self.ancestorChainData = chainData;
+    self.ancestorChainRangeData = rangeData;
+}
+
+- (const NSUInteger *)ancestorChainOfSlot:(NSUInteger)slotIndex count:(NSUInteger *)count {
+    NSAssert(slotIndex < self.slotCount, @"slot index out of bounds");
+    NSRange range = ((const NSRange *)self.ancestorChainRangeData.bytes)[slotIndex];
+    *count = range.length;
+    return (const NSUInteger *)self.ancestorChainData.bytes + range.location;
+}
+
+// Returns the number of active slots.
+- (NSUInteger)activeSlotCount {
+    NSUInteger count = 0;
+    for (NSUInteger index = 0; index < self.slotCount; ++index) {
+        if (self.slots[index].active) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+
+#pragma mark - Archiving
+
+- (void)encodeWithArchive:(INSKAMArchive *)archive {
+    [archive encodeInteger:self.time];
+    [archive encodeData:self.slotData];
+}
+
+- (instancetype)initWithArchive:(INSKAMArchive *)archive slotCount:(NSUInteger)slotCount {
+    self = [self initWithSlotCount:slotCount];
+    if (self == nil) return self;
+    
+    self.time = [archive decodeInteger];
+    NSData *slotData = [archive decodeData];
+    if (archive.failed || slotData.length != self.slotData.length) {
+        return nil;
+    }
+    [self.slotData setData:slotData];
+    
+    // a parent outside of the table would break the evaluation order
+    for (NSUInteger index = 0; index < slotCount; ++index) {
+        NSInteger parentIndex = self.slots[index].parentIndex;
+        if (parentIndex != INSKAMMainlineNoParent && (parentIndex < 0 || parentIndex >= (NSInteger)slotCount)) {
+            return nil;
+        }
+    }
+    [self buildEvaluationOrder];
+    
+    return self;
+}
+
+
+@end
@@ -21,7 +21,8 @@
 // THE SOFTWARE.
 
 
-#import <INSpriteKit/INSpriteKit.h>
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
 
 
 /**
@@ -80,11 +81,11 @@ static inline CGFloat LinearAngleInterpolationDegrees(CGFloat angleA, CGFloat an
 static inline CGFloat LinearAngleInterpolationRadian(CGFloat angleA, CGFloat angleB, NSInteger spin, CGFloat t) {
     if (spin > 0) {
         if (angleB < angleA) {
-            angleB += M_PI_X_2;
+            angleB += 2.0 * M_PI;
         }
     } else if (spin < 0) {
         if (angleB > angleA) {
-            angleB -= M_PI_X_2;
+            angleB -= 2.0 * M_PI;
         }
     } else {
         return angleA;
@@ -92,3 +93,19 @@ static inline CGFloat LinearAngleInterpolationRadian(CGFloat angleA, CGFloat ang
     return LinearInterpolation(angleA, angleB, t);
 }
 
+
+/**
+ Interpolates linearly between two radian angles along the shorter way.
+ 
+ The angles may lay in any range, e.g. composed from several parent angles.
+ The spin direction is chosen so the rotation is never more than a half turn.
+ 
+ @param angleA The first radian angle.
+ @param angleB The second radian angle.
+ @param t The percentage (in the range of 0 to 1) to interpolate from agleA to angleB.
+ @return The interpolated radian angle.
+ */
+static inline CGFloat ShortestAngleInterpolationRadian(CGFloat angleA, CGFloat angleB, CGFloat t) {
+    CGFloat difference = remainder(angleB - angleA, 2.0 * M_PI);
+    return LinearAngleInterpolationRadian(angleA, angleA + difference, (difference < 0.0 ? -1 : 1), t);
+}
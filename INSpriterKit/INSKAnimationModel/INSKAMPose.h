@@ -0,0 +1,109 @@
+// INSKAMPose.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "INSKAMMath.h"
+
+
+/**
+ The evaluated transformation and visibility of a timeline at one point of time.
+ 
+ A pose is a plain struct without any object references so it can be stored in preallocated buffers and computed without any allocations.
+ The values are either local to the parent timeline as stored in the spatials or composed to the animation node's coordinate space with INSKAMPoseConcat.
+ */
+typedef struct {
+    /// The X position.
+    CGFloat positionX;
+    /// The Y position.
+    CGFloat positionY;
+    /// The angle in radians.
+    CGFloat angle;
+    /// The X scale factor.
+    CGFloat scaleX;
+    /// The Y scale factor.
+    CGFloat scaleY;
+    /// The alpha value.
+    CGFloat alpha;
+    /// The X pivot point.
+    CGFloat pivotX;
+    /// The Y pivot point.
+    CGFloat pivotY;
+    /// True if the timeline is hidden, then all other values are undefined.
+    BOOL hidden;
+} INSKAMPose;
+
+
+/**
+ Composes a child's local pose with its parent's world pose.
+ 
+ The composition is the same a SKNode tree does with bone nodes which have no scale applied:
+ the child's position is rotated by the parent's angle and added to the parent's position, the angles are added and the alpha values multiplied.
+ The scale isn't inherited, because the parser already multiplied a bone's scale into the positions and scales of its children.
+ A child of a hidden parent is hidden, too.
+ 
+ @param parent The parent's pose in world space.
+ @param local The child's pose relative to the parent.
+ @return The child's pose in world space.
+ */
+static inline INSKAMPose INSKAMPoseConcat(INSKAMPose parent, INSKAMPose local) {
+    if (parent.hidden || local.hidden) {
+        local.hidden = YES;
+        return local;
+    }
+    CGFloat sine = sin(parent.angle);
+    CGFloat cosine = cos(parent.angle);
+    INSKAMPose world = local;
+    world.positionX = parent.positionX + cosine * local.positionX - sine * local.positionY;
+    world.positionY = parent.positionY + sine * local.positionX + cosine * local.positionY;
+    world.angle = parent.angle + local.angle;
+    world.alpha = parent.alpha * local.alpha;
+    return world;
+}
+
+
+/**
+ Blends two poses of the same object linearly, i.e. for cross-fading from one animation to another.
+ 
+ The angles are blended along the shorter way, all other values linearly.
+ A hidden pose isn't blended, so an object which is hidden in one of the poses pops in or out.
+ 
+ @param from The pose to blend from.
+ @param to The pose to blend to.
+ @param weight The weight of the to pose in the range of 0 to 1.
+ @return The blended pose.
+ */
+static inline INSKAMPose INSKAMPoseBlend(INSKAMPose from, INSKAMPose to, CGFloat weight) {
+    if (from.hidden || to.hidden) {
+        return to;
+    }
+    INSKAMPose pose;
+    pose.positionX = LinearInterpolation(from.positionX, to.positionX, weight);
+    pose.positionY = LinearInterpolation(from.positionY, to.positionY, weight);
+    pose.angle = ShortestAngleInterpolationRadian(from.angle, to.angle, weight);
+    pose.scaleX = LinearInterpolation(from.scaleX, to.scaleX, weight);
+    pose.scaleY = LinearInterpolation(from.scaleY, to.scaleY, weight);
+    pose.alpha = LinearInterpolation(from.alpha, to.alpha, weight);
+    pose.pivotX = LinearInterpolation(from.pivotX, to.pivotX, weight);
+    pose.pivotY = LinearInterpolation(from.pivotY, to.pivotY, weight);
+    pose.hidden = NO;
+    return pose;
+}
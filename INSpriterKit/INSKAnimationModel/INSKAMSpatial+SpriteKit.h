@@ -0,0 +1,80 @@
+// INSKAMSpatial+SpriteKit.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "INSKAMSpatial.h"
+#import <SpriteKit/SpriteKit.h>
+
+
+@class INSKAnimationManager;
+
+
+/**
+ Sprite Kit node creation and updates of a spatial.
+ 
+ These methods are kept out of INSKAMSpatial, so the animation model and the collision evaluator only depend on Foundation and Core Graphics.
+ */
+@interface INSKAMSpatial (SpriteKit)
+
+#pragma mark - Node methods
+/// @name Node methods
+
+/**
+ Creates a new SKNode out of this spatial.
+ 
+ This method creates the node depending of the spatial type, i.e. a SKNode for a bone or a SKSpriteNode if the spatial has a texture assigned.
+ Collision boxes and points have no node representation.
+ All stats of the SKNode are set depending on the spatial's values.
+ The animation manager is asked for a texture if one is needed.
+ 
+ @param animationManager The animation manager to ask for resources.
+ @return A initialized SKNode.
+ */
+- (SKNode *)createNodeForManager:(INSKAnimationManager *)animationManager;
+
+
+/**
+ Updates a SKNode with the values of this spatial interpolated with the spatial's next spatial object in chain.
+ 
+ The node's properties like position, scale, rotation, alpha, etc will be updated according to the current time.
+ 
+ @param node The SKNode which properties to update.
+ @param interpolationRatio The ratio to use for interpolating, range from 0 = only this spatial's properties to 1 = only the next spatial's properties. Any value between 0 and 1 will interpolate with this ratio.
+ @param animationManager The animation manager to ask for texture resources.
+ */
+- (void)updateNode:(SKNode *)node interpolation:(CGFloat)interpolationRatio animationManager:(INSKAnimationManager *)animationManager;
+
+
+/**
+ Updates a SKNode with an already evaluated pose.
+ 
+ The pose's values are assigned to the node as they are, so a pose composed with INSKAMPoseConcat places the node directly in the animation node's space.
+ Sprite nodes also get their scale, anchor point and texture assigned, other nodes only position, rotation and alpha.
+ 
+ @param node The SKNode which properties to update.
+ @param pose The pose to apply, i.e. from poseWithInterpolation:.
+ @param animationManager The animation manager to ask for texture resources.
+ */
+- (void)updateNode:(SKNode *)node pose:(INSKAMPose)pose animationManager:(INSKAnimationManager *)animationManager;
+
+
+@end
@@ -0,0 +1,88 @@
+// INSKAMSpatial+SpriteKit.m
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "INSKAMSpatial+SpriteKit.h"
+#import "INSKAMTexture.h"
+#import "INSKAnimationManager.h"
+
+
+@implementation INSKAMSpatial (SpriteKit)
+
+- (SKNode *)createNodeForManager:(INSKAnimationManager *)animationManager {
+    SKNode *node = nil;
+    if (self.spatialType == INSKAMSpatialTypeSprite) {
+        SKTexture *texture = [animationManager textureForTexture:self.texture];
+        CGSize size = CGSizeMake(self.texture.width, self.texture.height);
+        SKSpriteNode *sprite = [SKSpriteNode spriteNodeWithTexture:texture size:size];
+        node = sprite;
+        sprite.anchorPoint = CGPointMake(self.pivotX, self.pivotY);
+    } else if (self.spatialType == INSKAMSpatialTypeNode) {
+        node = [SKNode node];
+    } else {
+        NSAssert(false, @"unknown spatial type");
+    }
+
+    // the nodes should only be created, no properties yet to assign
+    node.name = self.nodeName;
+    node.hidden = YES;
+    
+    return node;
+}
+
+- (void)updateNode:(SKNode *)node interpolation:(CGFloat)interpolationRatio animationManager:(INSKAnimationManager *)animationManager {
+    [self updateNode:node pose:[self poseWithInterpolation:interpolationRatio] animationManager:animationManager];
+}
+
+- (void)updateNode:(SKNode *)node pose:(INSKAMPose)pose animationManager:(INSKAnimationManager *)animationManager {
+    // node hidden?
+    node.hidden = pose.hidden;
+    if (node.hidden) {
+        return;
+    }
+    
+    node.position = CGPointMake(pose.positionX, pose.positionY);
+    node.alpha = pose.alpha;
+    node.zRotation = pose.angle;
+    
+    // update node depending values
+    if (self.spatialType == INSKAMSpatialTypeSprite) {
+        NSAssert([node isKindOfClass:[SKSpriteNode class]], @"node expected to be a sprite node");
+        SKSpriteNode *spriteNode = (SKSpriteNode *)node;
+        spriteNode.anchorPoint = CGPointMake(pose.pivotX, pose.pivotY);
+        spriteNode.xScale = pose.scaleX;
+        spriteNode.yScale = pose.scaleY;
+
+        // get texture from the animation manager who caches it
+        SKTexture *texture = [animationManager textureForTexture:self.texture];
+        if (spriteNode.texture != texture) {
+            spriteNode.texture = texture;
+        }
+    } else if (self.spatialType == INSKAMSpatialTypeNode) {
+        // nothing to do
+    } else {
+        NSAssert(false, @"unknown spatial type");
+    }
+}
+
+
+@end
@@ -22,11 +22,11 @@
 
 
 #import "INSKAMTypes.h"
-#import <SpriteKit/SpriteKit.h>
+#import "INSKAMPose.h"
 
 
+@class INSKAMArchive;
 @class INSKAMTexture;
-@class INSKAnimationManager;
 
 
 @interface INSKAMSpatial : NSObject <NSCopying>
@@ -36,8 +36,8 @@
 
 /// The spatial's ID for the timeline
 @property (nonatomic, copy) NSString *spatialId;
-/// The time of the spatial's key frame in seconds.
-@property (nonatomic, assign) NSTimeInterval time;
+/// The time of the spatial's key frame in ticks.
+@property (nonatomic, assign) INSKAMTicks time;
 
 
 #pragma mark - SKNode
@@ -55,6 +55,8 @@
 @property (nonatomic, copy) NSString *parentTimelineId;
 /// Whether this spatial's node is hidden or not.
 @property (nonatomic, assign) BOOL hidden;
+/// The Z-index of the object in the mainline key starting at this spatial's time. Always 0 for bones.
+@property (nonatomic, assign) NSInteger zIndex;
 
 /// The X postion.
 @property (nonatomic, assign) CGFloat positionX;
@@ -81,6 +83,10 @@
 @property (nonatomic, assign) CGFloat pivotX;
 /// The Y pivot from 0 to 1.
 @property (nonatomic, assign) CGFloat pivotY;
+/// The unscaled width of a sprite's texture or a collision box, 0 for bones and points.
+@property (nonatomic, assign) CGFloat width;
+/// The unscaled height of a sprite's texture or a collision box, 0 for bones and points.
+@property (nonatomic, assign) CGFloat height;
 
 
 #pragma mark - Engine methods
@@ -100,50 +106,46 @@
 
 
 /**
- Compares the spatial's time with another time.
+ Evaluates the local pose of this spatial interpolated with the next spatial object in chain.
  
- The spatial's time is equal if both time values vary at most of 0.0001.
- @param time The time to compare the spatial's with.
- @return True if both times are approximately equal.
+ Only the hidden flag is set if the spatial is hidden.
+ 
+ @param interpolationRatio The ratio to use for interpolating, range from 0 = only this spatial's properties to 1 = only the next spatial's properties.
+ @return The pose relative to the spatial's parent.
  */
-- (BOOL)equalsTime:(NSTimeInterval)time;
+- (INSKAMPose)poseWithInterpolation:(CGFloat)interpolationRatio;
 
 
 /**
- Creates a new SKNode out of this spatial.
+ Calculates an interpolation ratio for a spatial depending on the current animation time.
  
- This method creates the node depending of the spatial type, i.e. a SKNode for a bone or a SKSpriteNode if the spatial has a texture assigned.
- All stats of the SKNode are set depending on the spatial's values.
- The animation manager is asked for a texture if one is needed.
+ The current animation time has to be the spatial's time or lay between this spatial and the next spatial.
+ Because the first keyframe follows right after the last keyframe in a looped animation no interpolation between both are needed and thus is not supported.
  
- @param animationManager The animation manager to ask for resources.
- @return A initialized SKNode.
+ @param time The current animation time in ticks.
+ @return A ratio for interpolating this and the next spatial.
  */
-- (SKNode *)createNodeForManager:(INSKAnimationManager *)animationManager;
+- (CGFloat)interpolationRatioForTime:(INSKAMTicks)time;
+
 
+#pragma mark - Archiving
+/// @name Archiving
 
 /**
- Updates a SKNode with the values of this spatial interpolated with the spatial's next spatial object in chain.
+ Writes the spatial's values into an archive, the next spatial link isn't written.
  
- The node's properties like position, scale, rotation, alpha, etc will be updated according to the current time.
- 
- @param node The SKNode which properties to update.
- @param interpolationRatio The ratio to use for interpolating, range from 0 = only this spatial's properties to 1 = only the next spatial's properties. Any value between 0 and 1 will interpolate with this ratio.
- @param animationManager The animation manager to ask for texture resources.
+ @param archive The archive to write into.
  */
-- (void)updateNode:(SKNode *)node interpolation:(CGFloat)interpolationRatio animationManager:(INSKAnimationManager *)animationManager;
+- (void)encodeWithArchive:(INSKAMArchive *)archive;
 
 
 /**
- Calculates an interpolation ratio for a spatial depending on the current animation time.
- 
- The current animation time has to be the spatial's time or lay between this spatial and the next spatial.
- Because the first keyframe follows right after the last keyframe in a looped animation no interpolation between both are needed and thus is not supported.
+ Initializes a spatial read from an archive.
  
- @param time The current animation time.
- @return A ratio for interpolating this and the next spatial.
+ @param archive The archive to read from.
+ @return The spatial with no next spatial.
  */
-- (CGFloat)interpolationRatioForTime:(NSTimeInterval)time;
+- (instancetype)initWithArchive:(INSKAMArchive *)archive;
 
 
 @end
@@ -23,9 +23,8 @@
 
 #import "INSKAMSpatial.h"
 #import "INSKAMTexture.h"
-#import "INSKAnimationManager.h"
 #import "INSKAMMath.h"
-#import <INSpriteKit/INSKMath.h>
+#import "INSKAMArchive.h"
 
 
 @implementation INSKAMSpatial
@@ -40,6 +39,7 @@
     spatialCopy.parentNodeName = self.parentNodeName;
     spatialCopy.parentTimelineId = self.parentTimelineId;
     spatialCopy.hidden = self.hidden;
+    spatialCopy.zIndex = self.zIndex;
     spatialCopy.positionX = self.positionX;
     spatialCopy.positionY = self.positionY;
     spatialCopy.scaleX = self.scaleX;
@@ -50,102 +50,118 @@
     spatialCopy.texture = self.texture;
     spatialCopy.pivotX = self.pivotX;
     spatialCopy.pivotY = self.pivotY;
+    spatialCopy.width = self.width;
+    spatialCopy.height = self.height;
     return spatialCopy;
 }
 
 - (NSString *)description {
-    return [NSString stringWithFormat:@"Spatial:'%@' Next:'%@' Type:%lu Name:'%@' Parent:'%@' Time:%.2f Pos:%.0f,%.0f Scale:%.1f,%.1f Alpha:%.2f %@ Angle:%.2f Spin:%lu Pivot:%.1f,%.1f", self.spatialId, self.nextSpatial.spatialId, (long unsigned)self.spatialType, self.nodeName, self.parentNodeName, self.time, self.positionX, self.positionY, self.scaleX, self.scaleY, self.alpha, (self.hidden ? @"hidden" : @"opaque"), self.angle, (long unsigned)self.spin, self.pivotX, self.pivotY];
-}
-
-- (SKNode *)createNodeForManager:(INSKAnimationManager *)animationManager {
-    SKNode *node = nil;
-    if (self.spatialType == INSKAMSpatialTypeSprite) {
-        SKTexture *texture = [animationManager textureNamed:self.texture.fileName path:self.texture.relativePath];
-        CGSize size = CGSizeMake(self.texture.width, self.texture.height);
-        SKSpriteNode *sprite = [SKSpriteNode spriteNodeWithTexture:texture size:size];
-        node = sprite;
-        sprite.anchorPoint = CGPointMake(self.pivotX, self.pivotY);
-    } else if (self.spatialType == INSKAMSpatialTypeNode) {
-        node = [SKNode node];
-    } else {
-        NSAssert(false, @"unknown spatial type");
-    }
-
-    // the nodes should only be created, no properties yet to assign
-    node.name = self.nodeName;
-    node.hidden = YES;
-    
-    return node;
-}
-
-- (BOOL)equalsTime:(NSTimeInterval)time {
-    return ScalarNearOtherWithVariance(self.time, time, 0.0001);
+    return [NSString stringWithFormat:@"Spatial:'%@' Next:'%@' Type:%lu Name:'%@' Parent:'%@' Time:%ld Z:%ld Pos:%.0f,%.0f Scale:%.1f,%.1f Alpha:%.2f %@ Angle:%.2f Spin:%lu Pivot:%.1f,%.1f Size:%.0fx%.0f", self.spatialId, self.nextSpatial.spatialId, (long unsigned)self.spatialType, self.nodeName, self.parentNodeName, (long)self.time, (long)self.zIndex, self.positionX, self.positionY, self.scaleX, self.scaleY, self.alpha, (self.hidden ? @"hidden" : @"opaque"), self.angle, (long unsigned)self.spin, self.pivotX, self.pivotY, self.width, self.height];
 }
 
 + (NSString *)composeNameWithTimelineId:(NSString *)timelineId animationId:(NSString *)animationId entityId:(NSString *)entityId {
     return [NSString stringWithFormat:@"INSKAM_%@_%@_%@", entityId, animationId, timelineId];
 }
 
-- (void)updateNode:(SKNode *)node interpolation:(CGFloat)interpolationRatio animationManager:(INSKAnimationManager *)animationManager {
+- (INSKAMPose)poseWithInterpolation:(CGFloat)interpolationRatio {
     NSAssert(self.nextSpatial != nil, @"a next spatial is always expected");
     NSAssert(interpolationRatio >= 0.0 && interpolationRatio <= 1.0, @"interpolation ratio range from 0 to 1 expected");
     NSAssert(self.time < self.nextSpatial.time || interpolationRatio == 0.0, @"There should be never an interpolation between the last and the first spatial");
     
-    // node hidden?
-    node.hidden = self.hidden;
-    if (node.hidden) {
-        return;
+    INSKAMPose pose;
+    pose.hidden = self.hidden;
+    if (pose.hidden) {
+        return pose;
     }
     
     // interpolation needed?
     if (interpolationRatio == 0.0) {
         // no interpolation
-        node.position = CGPointMake(self.positionX, self.positionY);
-        node.alpha = self.alpha;
-        node.zRotation = self.angle;
+        pose.positionX = self.positionX;
+        pose.positionY = self.positionY;
+        pose.angle = self.angle;
+        pose.scaleX = self.scaleX;
+        pose.scaleY = self.scaleY;
+        pose.alpha = self.alpha;
+        pose.pivotX = self.pivotX;
+        pose.pivotY = self.pivotY;
     } else {
         // interpolate
-        node.position = CGPointMake(LinearInterpolation(self.positionX, self.nextSpatial.positionX, interpolationRatio), LinearInterpolation(self.positionY, self.nextSpatial.positionY, interpolationRatio));
-        node.alpha = LinearInterpolation(self.alpha, self.nextSpatial.alpha, interpolationRatio);
-        node.zRotation = LinearAngleInterpolationRadian(self.angle, self.nextSpatial.angle, self.spin, interpolationRatio);
+        INSKAMSpatial *nextSpatial = self.nextSpatial;
+        pose.positionX = LinearInterpolation(self.positionX, nextSpatial.positionX, interpolationRatio);
+        pose.positionY = LinearInterpolation(self.positionY, nextSpatial.positionY, interpolationRatio);
+        pose.angle = LinearAngleInterpolationRadian(self.angle, nextSpatial.angle, self.spin, interpolationRatio);
+        pose.scaleX = LinearInterpolation(self.scaleX, nextSpatial.scaleX, interpolationRatio);
+        pose.scaleY = LinearInterpolation(self.scaleY, nextSpatial.scaleY, interpolationRatio);
+        pose.alpha = LinearInterpolation(self.alpha, nextSpatial.alpha, interpolationRatio);
+        pose.pivotX = LinearInterpolation(self.pivotX, nextSpatial.pivotX, interpolationRatio);
+        pose.pivotY = LinearInterpolation(self.pivotY, nextSpatial.pivotY, interpolationRatio);
     }
-    
-    // update node depending values
-    if (self.spatialType == INSKAMSpatialTypeSprite) {
-        NSAssert([node isKindOfClass:[SKSpriteNode class]], @"node expected to be a sprite node");
-        SKSpriteNode *spriteNode = (SKSpriteNode *)node;
-
-        if (interpolationRatio == 0.0) {
-            // no interpolation
-            spriteNode.anchorPoint = CGPointMake(self.pivotX, self.pivotY);
-            spriteNode.xScale = self.scaleX;
-            spriteNode.yScale = self.scaleY;
-        } else {
-            // interpolate
-            spriteNode.anchorPoint = CGPointMake(LinearInterpolation(self.pivotX, self.nextSpatial.pivotX, interpolationRatio), LinearInterpolation(self.pivotY, self.nextSpatial.pivotY, interpolationRatio));
-            spriteNode.xScale = LinearInterpolation(self.scaleX, self.nextSpatial.scaleX, interpolationRatio);
-            spriteNode.yScale = LinearInterpolation(self.scaleY, self.nextSpatial.scaleY, interpolationRatio);
-        }
-
-        // get texture from the animation manager who caches it
-        SKTexture *texture = [animationManager textureNamed:self.texture.fileName path:self.texture.relativePath];
-        spriteNode.texture = texture;
-    } else if (self.spatialType == INSKAMSpatialTypeNode) {
-        // nothing to do
-    } else {
-        NSAssert(false, @"unknown spatial type");
-    }
-
+    return pose;
 }
 
-- (CGFloat)interpolationRatioForTime:(NSTimeInterval)time {
+- (CGFloat)interpolationRatioForTime:(INSKAMTicks)time {
     // make some assumptions
     NSAssert(self.nextSpatial != nil, @"a next spatial is always expected");
-    NSAssert(self.time < self.nextSpatial.time || [self equalsTime:time], @"There should be never an interpolation between the last and the first spatial");
+    NSAssert(self.time < self.nextSpatial.time || self.time == time, @"There should be never an interpolation between the last and the first spatial");
     NSAssert(time >= self.time && time <= self.nextSpatial.time, @"the time should lay between this and the next spatial");
     
     // calculate the ratio
-    return (time - self.time) / (self.nextSpatial.time - self.time);
+    return (CGFloat)(time - self.time) / (self.nextSpatial.time - self.time);
+}
+
+
+#pragma mark - Archiving
+
+- (void)encodeWithArchive:(INSKAMArchive *)archive {
+    [archive encodeString:self.spatialId];
+    [archive encodeInteger:self.time];
+    [archive encodeInteger:self.spatialType];
+    [archive encodeString:self.nodeName];
+    [archive encodeString:self.parentNodeName];
+    [archive encodeString:self.parentTimelineId];
+    [archive encodeInteger:self.hidden];
+    [archive encodeInteger:self.zIndex];
+    [archive encodeFloat:self.positionX];
+    [archive encodeFloat:self.positionY];
+    [archive encodeFloat:self.scaleX];
+    [archive encodeFloat:self.scaleY];
+    [archive encodeFloat:self.alpha];
+    [archive encodeFloat:self.angle];
+    [archive encodeInteger:(NSInteger)self.spin];
+    [archive encodeTexture:self.texture];
+    [archive encodeFloat:self.pivotX];
+    [archive encodeFloat:self.pivotY];
+    [archive encodeFloat:self.width];
+    [archive encodeFloat:self.height];
+}
+
+- (instancetype)initWithArchive:(INSKAMArchive *)archive {
+    self = [super init];
+    if (self == nil) return self;
+    
+    self.spatialId = [archive decodeString];
+    self.time = [archive decodeInteger];
+    self.spatialType = [archive decodeInteger];
+    self.nodeName = [archive decodeString];
+    self.parentNodeName = [archive decodeString];
+    self.parentTimelineId = [archive decodeString];
+    self.hidden = ([archive decodeInteger] != 0);
+    self.zIndex = [archive decodeInteger];
+    self.positionX = [archive decodeFloat];
+    self.positionY = [archive decodeFloat];
+    self.scaleX = [archive decodeFloat];
+    self.scaleY = [archive decodeFloat];
+    self.alpha = [archive decodeFloat];
+    self.angle = [archive decodeFloat];
+    self.spin = [archive decodeInteger];
+    self.texture = [archive decodeTexture];
+    self.pivotX = [archive decodeFloat];
+    self.pivotY = [archive decodeFloat];
+    self.width = [archive decodeFloat];
+    self.height = [archive decodeFloat];
+    
+    return self;
 }
 
 
@@ -21,6 +21,10 @@
 // THE SOFTWARE.
 
 
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+
 @interface INSKAMTexture : NSObject <NSCopying>
 
 /// The texture's ID composed of the Spriter's folder ID and file ID separated by an underscore.
@@ -33,6 +37,8 @@
 @property (nonatomic, assign) CGFloat width;
 /// The texture's height in points.
 @property (nonatomic, assign) CGFloat height;
+/// The key of the texture in the animation manager's texture cache, built once from the relative path and the file name.
+@property (nonatomic, copy, readonly) NSString *cacheKey;
 
 
 @end
@@ -25,6 +25,26 @@
 
 @implementation INSKAMTexture
 
+@synthesize cacheKey = _cacheKey;
+
+- (void)setRelativePath:(NSString *)relativePath {
+    _relativePath = [relativePath copy];
+    _cacheKey = nil;
+}
+
+- (void)setFileName:(NSString *)fileName {
+    _fileName = [fileName copy];
+    _cacheKey = nil;
+}
+
+- (NSString *)cacheKey {
+    // build the key on first use so the playback does not need to build it every frame
+    if (_cacheKey == nil) {
+        _cacheKey = [self.relativePath stringByAppendingString:self.fileName];
+    }
+    return _cacheKey;
+}
+
 - (instancetype)copyWithZone:(NSZone *)zone {
     INSKAMTexture *textureCopy = [[[self class] allocWithZone:zone] init];
     textureCopy.textureId = self.textureId;
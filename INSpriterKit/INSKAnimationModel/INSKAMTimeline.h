@@ -21,28 +21,137 @@
 // THE SOFTWARE.
 
 
+#import "INSKAMTypes.h"
+
+
+@class INSKAMArchive;
 @class INSKAMSpatial;
 
 
+/**
+ The number of quantization steps used for a compressed keyframe channel.
+ 
+ A compressed channel is stored as an unsigned 16 bit value relative to the timeline's range of that channel,
+ so the maximal error of a decoded position, scale, alpha or pivot value is (max - min) / (2 * 65535) of the timeline's range.
+ */
+static NSUInteger const INSKAMCompressedChannelSteps = 65535;
+
+
 @interface INSKAMTimeline : NSObject <NSCopying>
 
 /// The timeline's ID.
 @property (nonatomic, copy) NSString *timelineId;
-/// An array of INSKAMSpatial objects in order of their time for this timeline.
+/// The timeline's name in Spriter, i.e. to identify a collision box.
+@property (nonatomic, copy) NSString *name;
+/// An array of INSKAMSpatial objects in order of their time for this timeline. Nil if the timeline has been compressed.
 @property (nonatomic, strong) NSMutableArray *spatialsByTime;
+/// The index of the timeline's object within its entity, timelines of different animations animating the same object share the index.
+@property (nonatomic, assign) NSUInteger objectIndex;
 
 
 /**
  Returns the spatial for a given time or the nearest with less time.
  
- The spatial's time is equal to the given if they vary at most of 0.0001.
  If there is no spatial with the given time or less the first spatial in the timeline will be returned.
  If there are no spatials in the timeline nil will be returned.
+ This method is only available for uncompressed timelines, use a INSKAMTimelineCursor for accessing the spatials of a compressed timeline.
  
- @param time The keyframe's time.
+ @param time The keyframe's time in ticks.
  @return The corresponding spatial for the time stamp.
  */
-- (INSKAMSpatial *)spatialForTime:(NSTimeInterval)time;
+- (INSKAMSpatial *)spatialForTime:(INSKAMTicks)time;
+
+
+#pragma mark - Compression
+/// @name Compression
+
+/// True if the keyframes are stored in the compressed form and spatialsByTime is nil.
+@property (nonatomic, assign, readonly, getter=isCompressed) BOOL compressed;
+
+/// The type of the spatials in this timeline regardless of the storage form.
+@property (nonatomic, assign, readonly) INSKAMSpatialType spatialType;
+/// The number of keyframes in this timeline regardless of the storage form.
+@property (nonatomic, assign, readonly) NSUInteger keyCount;
+
+
+/**
+ Converts the spatials of this timeline into the compressed keyframe storage and releases the spatial objects.
+ 
+ Each keyframe is reduced to a packed record of 24 bytes and every 32nd keyframe's absolute time is kept for searching:
+ the key time is delta encoded in integer milliseconds to the previous key,
+ position, scale, alpha and pivot are quantized to 16 bit relative to the per timeline range of each channel,
+ the angle is packed to a 16 bit fixed point value of a full turn texture and parent are indexes into small per timeline tables and the Z-index is stored as 16 bit integer.
+ 
+ Precision bounds of the decoded values:
+ - time: exact, because Spriter's time resolution is a millisecond.
+ - Z-index: exact.
+ - position, scale, alpha and pivot: at most (max - min) / 131070 of the timeline's channel range.
+ - angle: at most pi / 65536 radians (about 0.0027 degrees).
+ 
+ A timeline can't be compressed if two consecutive keyframes are more than 65535 milliseconds apart, if it references more than 255 different parents
+ or if the size of the keyframes without a texture changes.
+ In such a case the timeline stays uncompressed.
+ The timeline has to be complete, so call this method only after the parser has created all spatials and links.
+ 
+ @return True if the timeline is compressed after the call, otherwise false.
+ */
+- (BOOL)compress;
+
+
+/**
+ Returns the index of the keyframe for a given time or the nearest with less time.
+ 
+ This is the index counterpart of spatialForTime: and works for both storage forms.
+ For a compressed timeline the absolute time of every 32nd keyframe is kept, so the search is binary up to such a checkpoint and sums up at most 31 time deltas behind it.
+ 
+ @param time The keyframe's time in ticks.
+ @return The index of the corresponding keyframe or NSNotFound if there are no keyframes.
+ */
+- (NSUInteger)keyIndexForTime:(INSKAMTicks)time;
+
+
+/**
+ Decodes a compressed keyframe into an existing spatial object.
+ 
+ All values of the spatial are overwritten except the nextSpatial link which is left to the caller.
+ Only supported for compressed timelines.
+ 
+ @param index The keyframe's index.
+ @param spatial The spatial to write the decoded values into.
+ */
+- (void)decodeKeyAtIndex:(NSUInteger)index intoSpatial:(INSKAMSpatial *)spatial;
+
+
+/**
+ Returns the number of bytes used for storing the keyframes.
+ 
+ For uncompressed timelines this is an estimation of the spatial objects' instance sizes without the shared textures and strings.
+ 
+ @return The keyframe storage size in bytes.
+ */
+- (NSUInteger)keyframeMemorySize;
+
+
+#pragma mark - Archiving
+/// @name Archiving
+
+/**
+ Writes the timeline's keyframes in their current storage form into an archive.
+ 
+ @param archive The archive to write into.
+ */
+- (void)encodeWithArchive:(INSKAMArchive *)archive;
+
+
+/**
+ Initializes a timeline read from an archive.
+ 
+ The spatials of an uncompressed timeline are linked to their next ones again, the last one to the first.
+ 
+ @param archive The archive to read from.
+ @return The timeline or nil if the archive is malformed.
+ */
+- (instancetype)initWithArchive:(INSKAMArchive *)archive;
 
 
 @end
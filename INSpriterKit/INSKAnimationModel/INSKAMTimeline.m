@@ -21,9 +21,92 @@
 // THE SOFTWARE.
 
 
+
 #import "INSKAMTimeline.h"
 #import "INSKAMSpatial.h"
+#import "INSKAMTexture.h"
+#import "INSKAMArchive.h"
 #import <INLib/INLib.h>
+#import <INSpriteKit/INSKMath.h>
+#import <objc/runtime.h>
+
+
+// The channels of a compressed keyframe which are quantized relative to the timeline's range.
+typedef NS_ENUM(NSUInteger, INSKAMCompressedChannel) {
+    INSKAMCompressedChannelPositionX = 0,
+    INSKAMCompressedChannelPositionY,
+    INSKAMCompressedChannelScaleX,
+    INSKAMCompressedChannelScaleY,
+    INSKAMCompressedChannelAlpha,
+    INSKAMCompressedChannelPivotX,
+    INSKAMCompressedChannelPivotY,
+    INSKAMCompressedChannelCount
+};
+
+// Flags of a compressed keyframe.
+static uint8_t const INSKAMCompressedFlagHidden = 1 << 0;
+static uint8_t const INSKAMCompressedFlagSpinClockwise = 1 << 1;
+static uint8_t const INSKAMCompressedFlagSpinCounterclockwise = 1 << 2;
+
+// Index value of a compressed keyframe if there is no parent or texture.
+static uint8_t const INSKAMCompressedNoParent = UINT8_MAX;
+static uint16_t const INSKAMCompressedNoTexture = UINT16_MAX;
+
+// The number of fixed point steps for a full turn of a compressed angle.
+static double const INSKAMCompressedAngleSteps = 65536.0;
+
+// The number of compressed keyframes between two stored absolute key times.
+static NSUInteger const INSKAMCompressedCheckpointInterval = 32;
+
+// A packed keyframe of a compressed timeline, 24 bytes.
+typedef struct {
+    uint16_t timeDelta; // milliseconds since the previous keyframe
+    uint16_t channels[INSKAMCompressedChannelCount];
+    uint16_t angle; // fixed point of a full turn
+    uint16_t textureIndex;
+    int16_t zIndex;
+    uint8_t parentIndex;
+    uint8_t flags;
+} INSKAMCompressedKey;
+
+
+// Writes the spatial's values for all compressed channels into the values array.
+static inline void INSKAMSpatialChannelValues(INSKAMSpatial *spatial, CGFloat *values) {
+    values[INSKAMCompressedChannelPositionX] = spatial.positionX;
+    values[INSKAMCompressedChannelPositionY] = spatial.positionY;
+    values[INSKAMCompressedChannelScaleX] = spatial.scaleX;
+    values[INSKAMCompressedChannelScaleY] = spatial.scaleY;
+    values[INSKAMCompressedChannelAlpha] = spatial.alpha;
+    values[INSKAMCompressedChannelPivotX] = spatial.pivotX;
+    values[INSKAMCompressedChannelPivotY] = spatial.pivotY;
+}
+
+
+@interface INSKAMTimeline () {
+    // The minimal value of each channel in this timeline.
+    CGFloat _channelMinimum[INSKAMCompressedChannelCount];
+    // The value of one quantization step for each channel in this timeline.
+    CGFloat _channelStep[INSKAMCompressedChannelCount];
+}
+
+// The INSKAMCompressedKey records of a compressed timeline or nil.
+@property (nonatomic, strong) NSData *compressedKeys;
+// The absolute INSKAMTicks time of every INSKAMCompressedCheckpointInterval-th compressed keyframe, so no lookup has to sum up all time deltas.
+@property (nonatomic, strong) NSData *compressedCheckpointTimes;
+// The spatial type which is the same for all keyframes of a timeline.
+@property (nonatomic, assign) INSKAMSpatialType compressedSpatialType;
+// The node name which is the same for all keyframes of a timeline.
+@property (nonatomic, copy) NSString *compressedNodeName;
+// The size of the keyframes without a texture, i.e. of a collision box, which is the same for all keyframes of a timeline.
+@property (nonatomic, assign) CGSize compressedSize;
+// The INSKAMTexture objects referenced by the compressed keyframes' texture index.
+@property (nonatomic, strong) NSArray *compressedTextures;
+// The parent node names referenced by the compressed keyframes' parent index.
+@property (nonatomic, strong) NSArray *compressedParentNodeNames;
+// The parent timeline IDs referenced by the compressed keyframes' parent index.
+@property (nonatomic, strong) NSArray *compressedParentTimelineIds;
+
+@end
 
 
 @implementation INSKAMTimeline
@@ -31,62 +114,414 @@
 - (instancetype)copyWithZone:(NSZone *)zone {
     INSKAMTimeline *timelineCopy = [[[self class] allocWithZone:zone] init];
     timelineCopy.timelineId = self.timelineId;
+    timelineCopy.name = self.name;
+    timelineCopy.objectIndex = self.objectIndex;
     timelineCopy.spatialsByTime = self.spatialsByTime.mutableCopy;
+    timelineCopy.compressedKeys = self.compressedKeys;
+    timelineCopy.compressedCheckpointTimes = self.compressedCheckpointTimes;
+    timelineCopy.compressedSpatialType = self.compressedSpatialType;
+    timelineCopy.compressedNodeName = self.compressedNodeName;
+    timelineCopy.compressedSize = self.compressedSize;
+    timelineCopy.compressedTextures = self.compressedTextures;
+    timelineCopy.compressedParentNodeNames = self.compressedParentNodeNames;
+    timelineCopy.compressedParentTimelineIds = self.compressedParentTimelineIds;
+    memcpy(timelineCopy->_channelMinimum, _channelMinimum, sizeof(_channelMinimum));
+    memcpy(timelineCopy->_channelStep, _channelStep, sizeof(_channelStep));
     return timelineCopy;
 }
 
 - (NSString *)description {
+    if (self.compressed) {
+        return [NSString stringWithFormat:@"Timeline '%@': %lu compressed keys", self.timelineId, (unsigned long)self.keyCount];
+    }
     return [NSString stringWithFormat:@"Timeline '%@': %@", self.timelineId, [self.spatialsByTime descriptionWithStart:@"[\n" elementFormatter:@"%@,\n" lastElementFormatter:@"%@\n" end:@"]"]];
 }
 
-- (INSKAMSpatial *)spatialForTime:(NSTimeInterval)time {
-    // Return nil if there are no spatials in the timeline
-    if (self.spatialsByTime.count == 0) {
+- (INSKAMSpatial *)spatialForTime:(INSKAMTicks)time {
+    NSAssert(!self.compressed, @"spatial objects are not available for a compressed timeline");
+    NSUInteger index = [self keyIndexForTime:time];
+    if (index == NSNotFound) {
         return nil;
     }
+    return self.spatialsByTime[index];
+}
+
+- (NSUInteger)keyIndexForTime:(INSKAMTicks)time {
+    // Return NSNotFound if there are no keyframes in the timeline
+    NSUInteger keyCount = self.keyCount;
+    if (keyCount == 0) {
+        return NSNotFound;
+    }
+    
+    if (self.compressed) {
+        // Do a binary search for the last checkpoint which has the given time or less, the first if there is none
+        const INSKAMTicks *checkpointTimes = self.compressedCheckpointTimes.bytes;
+        NSUInteger checkpoint = 0;
+        NSInteger startCheckpoint = 0;
+        NSInteger endCheckpoint = self.compressedCheckpointTimes.length / sizeof(INSKAMTicks) - 1;
+        while (startCheckpoint <= endCheckpoint) {
+            NSInteger midCheckpoint = (startCheckpoint + endCheckpoint) / 2;
+            if (checkpointTimes[midCheckpoint] <= time) {
+                checkpoint = midCheckpoint;
+                startCheckpoint = midCheckpoint + 1;
+            } else {
+                endCheckpoint = midCheckpoint - 1;
+            }
+        }
+        
+        // Sum up the time deltas behind the checkpoint until the next keyframe lays behind the time
+        const INSKAMCompressedKey *keys = self.compressedKeys.bytes;
+        NSUInteger index = checkpoint * INSKAMCompressedCheckpointInterval;
+        INSKAMTicks keyTime = checkpointTimes[checkpoint];
+        NSUInteger endIndex = MIN(keyCount, index + INSKAMCompressedCheckpointInterval);
+        for (NSUInteger keyIndex = index + 1; keyIndex < endIndex; ++keyIndex) {
+            keyTime += keys[keyIndex].timeDelta;
+            if (keyTime > time) {
+                break;
+            }
+            index = keyIndex;
+        }
+        return index;
+    }
     
-    // Do a binary search for the spatial which has the given time and the last one if there are multiple
-    INSKAMSpatial *spatial = nil;
+    // Do a binary search for the last spatial which has the given time or less, the first if there is none
+    NSUInteger index = 0;
     NSInteger startIndex = 0;
-    NSInteger endIndex = self.spatialsByTime.count - 1;
+    NSInteger endIndex = keyCount - 1;
     while (startIndex <= endIndex) {
         NSInteger midIndex = (startIndex + endIndex) / 2;
         INSKAMSpatial *currentSpatial = self.spatialsByTime[midIndex];
-        if ([currentSpatial equalsTime:time]) {
-            spatial = currentSpatial;
-            // spatial has same time, but may not be the last in the line
-            while (midIndex < endIndex) {
-                ++midIndex;
-                currentSpatial = self.spatialsByTime[midIndex];
-                if ([currentSpatial equalsTime:time]) {
-                    spatial = currentSpatial;
-                } else {
-                    break;
-                }
-            }
-            break;
-        } else if (currentSpatial.time < time) {
+        if (currentSpatial.time <= time) {
+            index = midIndex;
             startIndex = midIndex + 1;
-            if (startIndex > endIndex) {
-                spatial = self.spatialsByTime[endIndex];
-                break;
-            }
-        } else if (currentSpatial.time > time) {
+        } else {
             endIndex = midIndex - 1;
-            if (startIndex > endIndex) {
-                if (startIndex == 0) {
-                    spatial = self.spatialsByTime[0];
-                } else {
-                    spatial = self.spatialsByTime[startIndex - 1];
-                }
-                break;
+        }
+    }
+    
+    return index;
+}
+
+
+#pragma mark - Compression
+
+- (BOOL)isCompressed {
+    return self.compressedKeys != nil;
+}
+
+- (NSUInteger)keyCount {
+    if (self.compressed) {
+        return self.compressedKeys.length / sizeof(INSKAMCompressedKey);
+    }
+    return self.spatialsByTime.count;
+}
+
+- (INSKAMSpatialType)spatialType {
+    if (self.compressed) {
+        return self.compressedSpatialType;
+    }
+    INSKAMSpatial *firstSpatial = self.spatialsByTime.firstObject;
+    return firstSpatial.spatialType;
+}
+
+- (BOOL)compress {
+    if (self.compressed) {
+        return YES;
+    }
+    NSUInteger keyCount = self.spatialsByTime.count;
+    if (keyCount == 0) {
+        return NO;
+    }
+    
+    // collect the channel ranges and the lookup tables
+    CGFloat minimum[INSKAMCompressedChannelCount];
+    CGFloat maximum[INSKAMCompressedChannelCount];
+    for (NSUInteger channel = 0; channel < INSKAMCompressedChannelCount; ++channel) {
+        minimum[channel] = CGFLOAT_MAX;
+        maximum[channel] = -CGFLOAT_MAX;
+    }
+    NSMutableArray *textures = [NSMutableArray array];
+    NSMutableArray *parentNodeNames = [NSMutableArray array];
+    NSMutableArray *parentTimelineIds = [NSMutableArray array];
+    INSKAMSpatial *firstSpatial = self.spatialsByTime[0];
+    CGSize size = CGSizeMake(firstSpatial.width, firstSpatial.height);
+    INSKAMTicks previousTime = 0;
+    for (INSKAMSpatial *spatial in self.spatialsByTime) {
+        // key times have to fit as delta into 16 bit
+        if (spatial.time < previousTime || spatial.time - previousTime > UINT16_MAX) {
+            return NO;
+        }
+        previousTime = spatial.time;
+        
+        // the Z-index has to fit into 16 bit
+        if (spatial.zIndex < INT16_MIN || spatial.zIndex > INT16_MAX) {
+            return NO;
+        }
+        
+        // only the size of textures may change
+        if (spatial.texture == nil && (spatial.width != size.width || spatial.height != size.height)) {
+            return NO;
+        }
+        
+        CGFloat values[INSKAMCompressedChannelCount];
+        INSKAMSpatialChannelValues(spatial, values);
+        for (NSUInteger channel = 0; channel < INSKAMCompressedChannelCount; ++channel) {
+            minimum[channel] = MIN(minimum[channel], values[channel]);
+            maximum[channel] = MAX(maximum[channel], values[channel]);
+        }
+        
+        if (spatial.texture != nil && [textures indexOfObjectIdenticalTo:spatial.texture] == NSNotFound) {
+            [textures addObject:spatial.texture];
+        }
+        if (spatial.parentTimelineId != nil && ![parentTimelineIds containsObject:spatial.parentTimelineId]) {
+            [parentTimelineIds addObject:spatial.parentTimelineId];
+            [parentNodeNames addObject:spatial.parentNodeName];
+        }
+    }
+    if (textures.count >= INSKAMCompressedNoTexture || parentTimelineIds.count >= INSKAMCompressedNoParent) {
+        return NO;
+    }
+    for (NSUInteger channel = 0; channel < INSKAMCompressedChannelCount; ++channel) {
+        _channelMinimum[channel] = minimum[channel];
+        _channelStep[channel] = (maximum[channel] - minimum[channel]) / INSKAMCompressedChannelSteps;
+    }
+    
+    // encode the keyframes
+    NSMutableData *data = [NSMutableData dataWithLength:keyCount * sizeof(INSKAMCompressedKey)];
+    INSKAMCompressedKey *keys = data.mutableBytes;
+    previousTime = 0;
+    for (NSUInteger keyIndex = 0; keyIndex < keyCount; ++keyIndex) {
+        INSKAMSpatial *spatial = self.spatialsByTime[keyIndex];
+        INSKAMCompressedKey *key = &keys[keyIndex];
+        
+        key->timeDelta = (uint16_t)(spatial.time - previousTime);
+        previousTime = spatial.time;
+        
+        CGFloat values[INSKAMCompressedChannelCount];
+        INSKAMSpatialChannelValues(spatial, values);
+        for (NSUInteger channel = 0; channel < INSKAMCompressedChannelCount; ++channel) {
+            if (_channelStep[channel] > 0.0) {
+                key->channels[channel] = (uint16_t)round((values[channel] - _channelMinimum[channel]) / _channelStep[channel]);
+            } else {
+                key->channels[channel] = 0;
             }
-        } else {
-            NSAssert(false, @"impossible state");
+        }
+        
+        double turns = fmod(spatial.angle / M_PI_X_2, 1.0);
+        if (turns < 0.0) {
+            turns += 1.0;
+        }
+        key->angle = (uint16_t)((NSUInteger)round(turns * INSKAMCompressedAngleSteps) & UINT16_MAX);
+        
+        key->textureIndex = (spatial.texture != nil ? (uint16_t)[textures indexOfObjectIdenticalTo:spatial.texture] : INSKAMCompressedNoTexture);
+        key->parentIndex = (spatial.parentTimelineId != nil ? (uint8_t)[parentTimelineIds indexOfObject:spatial.parentTimelineId] : INSKAMCompressedNoParent);
+        key->zIndex = (int16_t)spatial.zIndex;
+        
+        key->flags = 0;
+        if (spatial.hidden) {
+            key->flags |= INSKAMCompressedFlagHidden;
+        }
+        if (spatial.spin == INSKAMSpinTypeClockwise) {
+            key->flags |= INSKAMCompressedFlagSpinClockwise;
+        } else if (spatial.spin == INSKAMSpinTypeCounterclockwise) {
+            key->flags |= INSKAMCompressedFlagSpinCounterclockwise;
+        }
+    }
+    
+    // replace the spatials with the compressed form
+    self.compressedSpatialType = firstSpatial.spatialType;
+    self.compressedSize = size;
+    self.compressedNodeName = firstSpatial.nodeName;
+    self.compressedTextures = textures;
+    self.compressedParentNodeNames = parentNodeNames;
+    self.compressedParentTimelineIds = parentTimelineIds;
+    self.compressedKeys = data;
+    self.spatialsByTime = nil;
+    [self createCheckpointTimes];
+    
+    return YES;
+}
+
+// Stores the absolute time of every INSKAMCompressedCheckpointInterval-th compressed keyframe.
+- (void)createCheckpointTimes {
+    NSUInteger keyCount = self.keyCount;
+    NSMutableData *data = [NSMutableData dataWithLength:(keyCount + INSKAMCompressedCheckpointInterval - 1) / INSKAMCompressedCheckpointInterval * sizeof(INSKAMTicks)];
+    INSKAMTicks *checkpointTimes = data.mutableBytes;
+    const INSKAMCompressedKey *keys = self.compressedKeys.bytes;
+    INSKAMTicks time = 0;
+    for (NSUInteger keyIndex = 0; keyIndex < keyCount; ++keyIndex) {
+        time += keys[keyIndex].timeDelta;
+        if (keyIndex % INSKAMCompressedCheckpointInterval == 0) {
+            checkpointTimes[keyIndex / INSKAMCompressedCheckpointInterval] = time;
+        }
+    }
+    self.compressedCheckpointTimes = data;
+}
+
+- (void)decodeKeyAtIndex:(NSUInteger)index intoSpatial:(INSKAMSpatial *)spatial {
+    NSAssert(self.compressed, @"only a compressed timeline can be decoded");
+    NSAssert(index < self.keyCount, @"key index out of bounds");
+    
+    // sum up the key time from the last checkpoint
+    const INSKAMCompressedKey *keys = self.compressedKeys.bytes;
+    const INSKAMTicks *checkpointTimes = self.compressedCheckpointTimes.bytes;
+    NSUInteger checkpointIndex = index - index % INSKAMCompressedCheckpointInterval;
+    INSKAMTicks time = checkpointTimes[checkpointIndex / INSKAMCompressedCheckpointInterval];
+    for (NSUInteger keyIndex = checkpointIndex + 1; keyIndex <= index; ++keyIndex) {
+        time += keys[keyIndex].timeDelta;
+    }
+    const INSKAMCompressedKey *key = &keys[index];
+    
+    spatial.spatialId = nil;
+    spatial.time = time;
+    spatial.spatialType = self.compressedSpatialType;
+    spatial.nodeName = self.compressedNodeName;
+    if (key->parentIndex == INSKAMCompressedNoParent) {
+        spatial.parentNodeName = nil;
+        spatial.parentTimelineId = nil;
+    } else {
+        spatial.parentNodeName = self.compressedParentNodeNames[key->parentIndex];
+        spatial.parentTimelineId = self.compressedParentTimelineIds[key->parentIndex];
+    }
+    spatial.hidden = (key->flags & INSKAMCompressedFlagHidden) != 0;
+    spatial.zIndex = key->zIndex;
+    
+    spatial.positionX = _channelMinimum[INSKAMCompressedChannelPositionX] + key->channels[INSKAMCompressedChannelPositionX] * _channelStep[INSKAMCompressedChannelPositionX];
+    spatial.positionY = _channelMinimum[INSKAMCompressedChannelPositionY] + key->channels[INSKAMCompressedChannelPositionY] * _channelStep[INSKAMCompressedChannelPositionY];
+    spatial.scaleX = _channelMinimum[INSKAMCompressedChannelScaleX] + key->channels[INSKAMCompressedChannelScaleX] * _channelStep[INSKAMCompressedChannelScaleX];
+    spatial.scaleY = _channelMinimum[INSKAMCompressedChannelScaleY] + key->channels[INSKAMCompressedChannelScaleY] * _channelStep[INSKAMCompressedChannelScaleY];
+    spatial.alpha = _channelMinimum[INSKAMCompressedChannelAlpha] + key->channels[INSKAMCompressedChannelAlpha] * _channelStep[INSKAMCompressedChannelAlpha];
+    spatial.angle = key->angle * (M_PI_X_2 / INSKAMCompressedAngleSteps);
+    if ((key->flags & INSKAMCompressedFlagSpinClockwise) != 0) {
+        spatial.spin = INSKAMSpinTypeClockwise;
+    } else if ((key->flags & INSKAMCompressedFlagSpinCounterclockwise) != 0) {
+        spatial.spin = INSKAMSpinTypeCounterclockwise;
+    } else {
+        spatial.spin = INSKAMSpinTypeNone;
+    }
+    
+    spatial.texture = (key->textureIndex == INSKAMCompressedNoTexture ? nil : self.compressedTextures[key->textureIndex]);
+    spatial.width = (spatial.texture != nil ? spatial.texture.width : self.compressedSize.width);
+    spatial.height = (spatial.texture != nil ? spatial.texture.height : self.compressedSize.height);
+    spatial.pivotX = _channelMinimum[INSKAMCompressedChannelPivotX] + key->channels[INSKAMCompressedChannelPivotX] * _channelStep[INSKAMCompressedChannelPivotX];
+    spatial.pivotY = _channelMinimum[INSKAMCompressedChannelPivotY] + key->channels[INSKAMCompressedChannelPivotY] * _channelStep[INSKAMCompressedChannelPivotY];
+}
+
+- (NSUInteger)keyframeMemorySize {
+    if (self.compressed) {
+        return self.compressedKeys.length + self.compressedCheckpointTimes.length + sizeof(_channelMinimum) + sizeof(_channelStep);
+    }
+    return self.spatialsByTime.count * (class_getInstanceSize([INSKAMSpatial class]) + sizeof(id));
+}
+
+
+#pragma mark - Archiving
+
+- (void)encodeWithArchive:(INSKAMArchive *)archive {
+    [archive encodeString:self.timelineId];
+    [archive encodeString:self.name];
+    [archive encodeInteger:self.objectIndex];
+    [archive encodeInteger:self.compressed];
+    if (!self.compressed) {
+        [archive encodeInteger:self.spatialsByTime.count];
+        for (INSKAMSpatial *spatial in self.spatialsByTime) {
+            [spatial encodeWithArchive:archive];
+        }
+        return;
+    }
+    
+    [archive encodeData:self.compressedKeys];
+    [archive encodeInteger:self.compressedSpatialType];
+    [archive encodeString:self.compressedNodeName];
+    [archive encodeFloat:self.compressedSize.width];
+    [archive encodeFloat:self.compressedSize.height];
+    [archive encodeInteger:self.compressedTextures.count];
+    for (INSKAMTexture *texture in self.compressedTextures) {
+        [archive encodeTexture:texture];
+    }
+    [archive encodeInteger:self.compressedParentTimelineIds.count];
+    for (NSUInteger index = 0; index < self.compressedParentTimelineIds.count; ++index) {
+        [archive encodeString:self.compressedParentTimelineIds[index]];
+        [archive encodeString:self.compressedParentNodeNames[index]];
+    }
+    for (NSUInteger channel = 0; channel < INSKAMCompressedChannelCount; ++channel) {
+        [archive encodeFloat:_channelMinimum[channel]];
+        [archive encodeFloat:_channelStep[channel]];
+    }
+}
+
+- (instancetype)initWithArchive:(INSKAMArchive *)archive {
+    self = [super init];
+    if (self == nil) return self;
+    
+    self.timelineId = [archive decodeString];
+    self.name = [archive decodeString];
+    self.objectIndex = [archive decodeInteger];
+    if ([archive decodeInteger] == 0) {
+        NSUInteger spatialCount = [archive decodeCount];
+        self.spatialsByTime = [NSMutableArray arrayWithCapacity:spatialCount];
+        for (NSUInteger index = 0; index < spatialCount && !archive.failed; ++index) {
+            [self.spatialsByTime addObject:[[INSKAMSpatial alloc] initWithArchive:archive]];
+        }
+        if (archive.failed || spatialCount == 0) {
+            return nil;
+        }
+        
+        // the links follow the order of the spatials and the last one is connected with the first
+        for (NSUInteger index = 0; index < spatialCount; ++index) {
+            INSKAMSpatial *spatial = self.spatialsByTime[index];
+            spatial.nextSpatial = self.spatialsByTime[(index + 1) % spatialCount];
+        }
+        return self;
+    }
+    
+    self.compressedKeys = [archive decodeData];
+    self.compressedSpatialType = [archive decodeInteger];
+    self.compressedNodeName = [archive decodeString];
+    CGFloat width = [archive decodeFloat];
+    CGFloat height = [archive decodeFloat];
+    self.compressedSize = CGSizeMake(width, height);
+    NSUInteger textureCount = [archive decodeCount];
+    NSMutableArray *textures = [NSMutableArray arrayWithCapacity:textureCount];
+    for (NSUInteger index = 0; index < textureCount && !archive.failed; ++index) {
+        INSKAMTexture *texture = [archive decodeTexture];
+        if (texture != nil) {
+            [textures addObject:texture];
+        }
+    }
+    self.compressedTextures = textures;
+    NSUInteger parentCount = [archive decodeCount];
+    NSMutableArray *parentTimelineIds = [NSMutableArray arrayWithCapacity:parentCount];
+    NSMutableArray *parentNodeNames = [NSMutableArray arrayWithCapacity:parentCount];
+    for (NSUInteger index = 0; index < parentCount && !archive.failed; ++index) {
+        NSString *parentTimelineId = [archive decodeString];
+        NSString *parentNodeName = [archive decodeString];
+        if (parentTimelineId != nil && parentNodeName != nil) {
+            [parentTimelineIds addObject:parentTimelineId];
+            [parentNodeNames addObject:parentNodeName];
+        }
+    }
+    self.compressedParentTimelineIds = parentTimelineIds;
+    self.compressedParentNodeNames = parentNodeNames;
+    for (NSUInteger channel = 0; channel < INSKAMCompressedChannelCount; ++channel) {
+        _channelMinimum[channel] = [archive decodeFloat];
+        _channelStep[channel] = [archive decodeFloat];
+    }
+    if (archive.failed || self.compressedKeys.length == 0 || self.compressedKeys.length % sizeof(INSKAMCompressedKey) != 0 || textures.count != textureCount || parentTimelineIds.count != parentCount) {
+        return nil;
+    }
+    
+    // the keys index into the tables without checks during playback
+    const INSKAMCompressedKey *keys = self.compressedKeys.bytes;
+    for (NSUInteger keyIndex = 0; keyIndex < self.keyCount; ++keyIndex) {
+        if ((keys[keyIndex].textureIndex != INSKAMCompressedNoTexture && keys[keyIndex].textureIndex >= textureCount)
+            || (keys[keyIndex].parentIndex != INSKAMCompressedNoParent && keys[keyIndex].parentIndex >= parentCount)) {
+            return nil;
         }
     }
+    [self createCheckpointTimes];
     
-    return spatial;
+    return self;
 }
 
 
@@ -0,0 +1,79 @@
+// INSKAMTimelineCursor.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "INSKAMTypes.h"
+
+
+@class INSKAMTimeline;
+@class INSKAMSpatial;
+
+
+/**
+ A per instance playhead on a timeline which caches the current keyframe.
+ 
+ A cursor remembers the keyframe of the last lookup so a lookup for a time inside the same keyframe span costs only a comparison.
+ For a compressed timeline the cursor is also the decode cache: the current and the next keyframe are decoded into spatial objects owned by the cursor
+ and only decoded again when the time leaves the current keyframe span.
+ The spatials returned by a cursor for a compressed timeline are reused and must not be stored.
+ */
+@interface INSKAMTimelineCursor : NSObject
+
+/// The timeline this cursor walks on.
+@property (nonatomic, strong, readonly) INSKAMTimeline *timeline;
+/// The index of the current keyframe or NSNotFound if there was no lookup yet.
+@property (nonatomic, assign, readonly) NSUInteger keyIndex;
+
+
+/**
+ Initializes a cursor for a timeline.
+ 
+ @param timeline The timeline to walk on.
+ @return A new cursor instance.
+ */
+- (instancetype)initWithTimeline:(INSKAMTimeline *)timeline;
+
+
+/**
+ Moves the cursor onto another timeline, i.e. when an animation node switches to another animation.
+ 
+ The decode buffers are kept, so resetting a cursor which has walked on a compressed timeline before allocates nothing.
+ 
+ @param timeline The timeline to walk on.
+ */
+- (void)resetWithTimeline:(INSKAMTimeline *)timeline;
+
+
+/**
+ Returns the spatial for a given time or the nearest with less time.
+ 
+ The same as INSKAMTimeline's spatialForTime:, but also works for compressed timelines and uses the cached keyframe.
+ The returned spatial's nextSpatial is always set.
+ 
+ @param time The keyframe's time in ticks.
+ @return The corresponding spatial for the time stamp or nil if the timeline has no keyframes.
+ */
+- (INSKAMSpatial *)spatialForTime:(INSKAMTicks)time;
+
+
+@end
@@ -0,0 +1,101 @@
+// INSKAMTimelineCursor.m
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "INSKAMTimelineCursor.h"
+#import "INSKAMTimeline.h"
+#import "INSKAMSpatial.h"
+
+
+@interface INSKAMTimelineCursor ()
+
+@property (nonatomic, strong, readwrite) INSKAMTimeline *timeline;
+@property (nonatomic, assign, readwrite) NSUInteger keyIndex;
+// The spatial for the current keyframe, either from the timeline or the decoded one.
+@property (nonatomic, strong) INSKAMSpatial *spatial;
+// The decode buffer for the current keyframe of a compressed timeline.
+@property (nonatomic, strong) INSKAMSpatial *decodedSpatial;
+// The decode buffer for the next keyframe of a compressed timeline.
+@property (nonatomic, strong) INSKAMSpatial *decodedNextSpatial;
+
+@end
+
+
+@implementation INSKAMTimelineCursor
+
+- (instancetype)initWithTimeline:(INSKAMTimeline *)timeline {
+    self = [super init];
+    if (self == nil) return self;
+    
+    [self resetWithTimeline:timeline];
+    
+    return self;
+}
+
+- (void)resetWithTimeline:(INSKAMTimeline *)timeline {
+    self.timeline = timeline;
+    self.keyIndex = NSNotFound;
+    self.spatial = nil;
+    if (timeline.compressed && self.decodedSpatial == nil) {
+        self.decodedSpatial = [[INSKAMSpatial alloc] init];
+        self.decodedNextSpatial = [[INSKAMSpatial alloc] init];
+        self.decodedSpatial.nextSpatial = self.decodedNextSpatial;
+    }
+}
+
+- (INSKAMSpatial *)spatialForTime:(INSKAMTicks)time {
+    // the cached keyframe is still valid if the time lays within its span
+    if (self.spatial != nil && time >= self.spatial.time) {
+        BOOL lastKey = (self.keyIndex + 1 == self.timeline.keyCount);
+        if (lastKey || time < self.spatial.nextSpatial.time) {
+            return self.spatial;
+        }
+    }
+    
+    // search the keyframe
+    NSUInteger keyIndex = [self.timeline keyIndexForTime:time];
+    if (keyIndex == NSNotFound) {
+        self.spatial = nil;
+        self.keyIndex = NSNotFound;
+        return nil;
+    }
+    if (keyIndex == self.keyIndex) {
+        return self.spatial;
+    }
+    self.keyIndex = keyIndex;
+    
+    if (self.timeline.compressed) {
+        // decode the keyframe and its successor into the buffers
+        NSUInteger nextKeyIndex = (keyIndex + 1) % self.timeline.keyCount;
+        [self.timeline decodeKeyAtIndex:keyIndex intoSpatial:self.decodedSpatial];
+        [self.timeline decodeKeyAtIndex:nextKeyIndex intoSpatial:self.decodedNextSpatial];
+        self.spatial = self.decodedSpatial;
+    } else {
+        self.spatial = self.timeline.spatialsByTime[keyIndex];
+    }
+    
+    return self.spatial;
+}
+
+
+@end
@@ -21,6 +21,33 @@
 // THE SOFTWARE.
 
 
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+
+/// A time value in ticks which is Spriter's time unit of milliseconds.
+typedef NSInteger INSKAMTicks;
+
+/// The number of ticks per second.
+static INSKAMTicks const INSKAMTicksPerSecond = 1000;
+
+/// Converts ticks into seconds.
+static inline NSTimeInterval INSKAMSecondsFromTicks(INSKAMTicks ticks) {
+    return ticks / (NSTimeInterval)INSKAMTicksPerSecond;
+}
+
+
+/**
+ An event of an animation's eventline, e.g. a footstep.
+ */
+typedef struct {
+    /// The time of the event in ticks.
+    INSKAMTicks time;
+    /// The index of the event's eventline, which is the index of the event's name in the animation's eventNames.
+    NSUInteger eventlineIndex;
+} INSKAMEvent;
+
+
 typedef NS_ENUM(NSUInteger, INSKAMCurveType) {
     INSKAMCurveTypeInstant = 0,
     INSKAMCurveTypeLinear,
@@ -22,7 +22,11 @@
 
 
 #import "INSKScmlParser.h"
+#import "INSKSconParser.h"
 
 #import "INSKAMTextureLoader.h"
 #import "INSKAnimationManager.h"
 #import "INSKAnimationNode.h"
+#import "INSKAnimationStatistics.h"
+#import "INSKAnimationTrace.h"
+#import "INSKAnimationNodeState.h"
@@ -37,6 +37,8 @@
 @property (nonatomic, strong) SpriterMainline *mainline;
 /// An array with SpriterTimeline objects.
 @property (nonatomic, strong) NSArray *timelines;
+/// An array with SpriterEventline objects.
+@property (nonatomic, strong) NSArray *eventlines;
 
 // TODO soundline
 
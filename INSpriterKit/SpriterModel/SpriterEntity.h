@@ -29,8 +29,10 @@
 @property (nonatomic, copy) NSString *name;
 /// An array with SpriterAnimation objects.
 @property (nonatomic, strong) NSArray *animations;
+/// An array with SpriterObjectInfo objects in the order of the file, timelines reference them by their index.
+@property (nonatomic, strong) NSArray *objectInfos;
 
-// TODO character_map, obj_info
+// TODO character_map
 
 
 @end
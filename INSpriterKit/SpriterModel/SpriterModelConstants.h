@@ -28,3 +28,17 @@ static NSString * const SpriterRefNoParentValue = @"-1";
 /// Use this value if there is no pivot value for a SpriterObject so it will retrieved from the SpriterFile.
 static CGFloat const SpriterObjectNoPivotValue = CGFLOAT_MIN;
 
+
+/// The type of objects a SpriterTimeline animates.
+typedef NS_ENUM(NSUInteger, SpriterObjectType) {
+    /// A sprite with a texture, the default if a timeline has no type.
+    SpriterObjectTypeSprite,
+    /// A bone.
+    SpriterObjectTypeBone,
+    /// A collision box with a size defined by a SpriterObjectInfo.
+    SpriterObjectTypeBox,
+    /// An action point.
+    SpriterObjectTypePoint,
+    /// Any other type not supported by this library, i.e. sounds, sub entities or variables.
+    SpriterObjectTypeUnsupported,
+};
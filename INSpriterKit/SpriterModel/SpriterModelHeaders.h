@@ -26,11 +26,14 @@
 #import "SpriterBone.h"
 #import "SpriterBoneRef.h"
 #import "SpriterEntity.h"
+#import "SpriterEventline.h"
+#import "SpriterEventlineKey.h"
 #import "SpriterFile.h"
 #import "SpriterFolder.h"
 #import "SpriterMainline.h"
 #import "SpriterMainlineKey.h"
 #import "SpriterObject.h"
+#import "SpriterObjectInfo.h"
 #import "SpriterObjectRef.h"
 #import "SpriterTimeline.h"
 #import "SpriterTimelineKey.h"
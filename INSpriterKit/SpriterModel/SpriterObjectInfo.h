@@ -0,0 +1,43 @@
+// SpriterObjectInfo.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "SpriterModelConstants.h"
+
+
+@interface SpriterObjectInfo : NSObject
+
+/// The object's name.
+@property (nonatomic, copy) NSString *name;
+/// The type of the object.
+@property (nonatomic, assign) SpriterObjectType objectType;
+/// The width of a box or the length of a bone.
+@property (nonatomic, assign) CGFloat width;
+/// The height of a box or the width of a bone.
+@property (nonatomic, assign) CGFloat height;
+/// The default X pivot of a box.
+@property (nonatomic, assign) CGFloat pivotX;
+/// The default Y pivot of a box.
+@property (nonatomic, assign) CGFloat pivotY;
+
+@end
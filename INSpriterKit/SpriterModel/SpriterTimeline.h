@@ -21,6 +21,8 @@
 // THE SOFTWARE.
 
 
+#import "SpriterModelConstants.h"
+
 
 @interface SpriterTimeline : NSObject
 
@@ -29,8 +31,10 @@
 // The timeline's name.
 @property (nonatomic, copy) NSString *name;
 
-// TODO
-//@property (nonatomic, assign) SpriterObjectType objectType;
+/// The type of the animated object.
+@property (nonatomic, assign) SpriterObjectType objectType;
+/// The index of the entity's SpriterObjectInfo for this timeline or NSNotFound if there is none.
+@property (nonatomic, assign) NSUInteger objectInfoIndex;
 
 /// An array with SpriterTimelineKey objects.
 @property (nonatomic, strong) NSArray *keys;
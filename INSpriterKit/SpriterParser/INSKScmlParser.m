@@ -97,6 +97,22 @@
         element.entityId = [xmlElement attribute:@"id"];
         element.name = [xmlElement attribute:@"name"];
         element.animations = [self parseAnimations:[xmlElement children:@"animation"]];
+        element.objectInfos = [self parseObjectInfos:[xmlElement children:@"obj_info"]];
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (NSArray *)parseObjectInfos:(NSArray *)xmlRoot {
+    NSMutableArray *array = [[NSMutableArray alloc] initWithCapacity:xmlRoot.count];
+    for (RXMLElement *xmlElement in xmlRoot) {
+        SpriterObjectInfo *element = [[SpriterObjectInfo alloc] init];
+        element.name = [xmlElement attribute:@"name"];
+        element.objectType = [self objectTypeForString:[xmlElement attribute:@"type"]];
+        element.width = [[xmlElement attribute:@"w"] floatValue];
+        element.height = [[xmlElement attribute:@"h"] floatValue];
+        element.pivotX = [[xmlElement attribute:@"pivot_x"] floatValue];
+        element.pivotY = [[xmlElement attribute:@"pivot_y"] floatValue];
         [array addObject:element];
     }
     return array;
@@ -113,6 +129,7 @@
         element.looping = looping ? [looping boolValue] : YES;
         element.mainline = [self parseMainline:[xmlElement child:@"mainline"]];
         element.timelines = [self parseTimelines:[xmlElement children:@"timeline"]];
+        element.eventlines = [self parseEventlines:[xmlElement children:@"eventline"]];
         [array addObject:element];
     }
     return array;
@@ -176,6 +193,9 @@
         SpriterTimeline *element = [[SpriterTimeline alloc] init];
         element.timelineId = [xmlElement attribute:@"id"];
         element.name = [xmlElement attribute:@"name"];
+        element.objectType = [self objectTypeForString:[xmlElement attribute:@"object_type"]];
+        NSString *objectInfoIndex = [xmlElement attribute:@"obj"];
+        element.objectInfoIndex = objectInfoIndex ? [objectInfoIndex integerValue] : NSNotFound;
         element.keys = [self parseTimelineKeys:[xmlElement children:@"key"]];
         [array addObject:element];
     }
@@ -197,6 +217,42 @@
     return array;
 }
 
+- (NSArray *)parseEventlines:(NSArray *)xmlRoot {
+    NSMutableArray *array = [[NSMutableArray alloc] initWithCapacity:xmlRoot.count];
+    for (RXMLElement *xmlElement in xmlRoot) {
+        SpriterEventline *element = [[SpriterEventline alloc] init];
+        element.eventlineId = [xmlElement attribute:@"id"];
+        element.name = [xmlElement attribute:@"name"];
+        element.keys = [self parseEventlineKeys:[xmlElement children:@"key"]];
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (NSArray *)parseEventlineKeys:(NSArray *)xmlRoot {
+    NSMutableArray *array = [[NSMutableArray alloc] initWithCapacity:xmlRoot.count];
+    for (RXMLElement *xmlElement in xmlRoot) {
+        SpriterEventlineKey *element = [[SpriterEventlineKey alloc] init];
+        element.keyId = [xmlElement attribute:@"id"];
+        element.time = [[xmlElement attribute:@"time"] integerValue];
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (SpriterObjectType)objectTypeForString:(NSString *)type {
+    if (type == nil || [type isEqualToString:@"sprite"]) {
+        return SpriterObjectTypeSprite;
+    } else if ([type isEqualToString:@"bone"]) {
+        return SpriterObjectTypeBone;
+    } else if ([type isEqualToString:@"box"]) {
+        return SpriterObjectTypeBox;
+    } else if ([type isEqualToString:@"point"]) {
+        return SpriterObjectTypePoint;
+    }
+    return SpriterObjectTypeUnsupported;
+}
+
 - (SpriterObject *)parseObject:(RXMLElement *)xmlElement {
     if (xmlElement == nil) {
         return nil;
@@ -0,0 +1,45 @@
+// INSKSconParser.h
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "INSKSpriterParser.h"
+
+
+/// The scon file version supported by this parser, currently 1.0 and should be compatible up to 1.1 excluding.
+static NSString * const SCONFileVersionSupported = @"1.0";
+
+
+/**
+ A concrete implementation of a INSKSpriterParser which loads and parses a scon file.
+ 
+ A scon file is created by the Spriter tool like a scml file, but has a JSON structure with the same element and attribute names.
+ The parser reads the file content in one forward pass with a streaming tokenizer, so no intermediate JSON objects are created and only the strings stored in the Spriter data tree are allocated.
+ The resulting SpriterData tree is the same as the one INSKScmlParser creates for an equivalent scml file.
+ 
+ @see INSKSpriterParser
+ @see INSKScmlParser
+ */
+@interface INSKSconParser : INSKSpriterParser
+
+
+@end
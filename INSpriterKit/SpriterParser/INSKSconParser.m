@@ -0,0 +1,917 @@
+// INSKSconParser.m
+//
+// Copyright (c) 2014 Sven Korset
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "INSKSconParser.h"
+#import "SpriterModelHeaders.h"
+
+
+#pragma mark - Tokenizer
+
+// The maximum length of a number's text, longer numbers fail the parse.
+#define INSKSconNumberBufferSize 64
+
+
+// A forward only tokenizer reading the values of a JSON document in place.
+typedef struct {
+    // The document's bytes which are not copied.
+    const uint8_t *bytes;
+    // The number of bytes.
+    NSUInteger length;
+    // The index of the next byte to read.
+    NSUInteger position;
+    // Set when the document is malformed, every further read returns no value.
+    BOOL failed;
+} INSKSconTokenizer;
+
+// A raw token pointing into the document's bytes.
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+} INSKSconToken;
+
+
+// Skips any whitespace and returns the next byte without consuming it or 0 at the end of the document.
+static inline uint8_t INSKSconPeek(INSKSconTokenizer *tokenizer) {
+    while (tokenizer->position < tokenizer->length) {
+        uint8_t character = tokenizer->bytes[tokenizer->position];
+        if (character != ' ' && character != '\n' && character != '\r' && character != '\t') {
+            return character;
+        }
+        tokenizer->position++;
+    }
+    return 0;
+}
+
+// Consumes the next byte if it is the expected one, otherwise the tokenizer fails.
+static inline BOOL INSKSconExpect(INSKSconTokenizer *tokenizer, uint8_t character) {
+    if (tokenizer->failed || INSKSconPeek(tokenizer) != character) {
+        tokenizer->failed = YES;
+        return NO;
+    }
+    tokenizer->position++;
+    return YES;
+}
+
+// Compares a token with a C string without creating any object.
+static inline BOOL INSKSconTokenIs(INSKSconToken token, const char *string) {
+    size_t length = strlen(string);
+    return (token.length == length && memcmp(token.bytes, string, length) == 0);
+}
+
+// Scans a string and returns its bytes without the quotes, escaped is set if the string contains any escape sequences.
+static BOOL INSKSconScanString(INSKSconTokenizer *tokenizer, INSKSconToken *token, BOOL *escaped) {
+    if (!INSKSconExpect(tokenizer, '"')) {
+        return NO;
+    }
+    
+    NSUInteger start = tokenizer->position;
+    *escaped = NO;
+    while (tokenizer->position < tokenizer->length) {
+        uint8_t character = tokenizer->bytes[tokenizer->position];
+        if (character == '"') {
+            token->bytes = tokenizer->bytes + start;
+            token->length = tokenizer->position - start;
+            tokenizer->position++;
+            return YES;
+        }
+        if (character == '\\') {
+            *escaped = YES;
+            tokenizer->position++;
+        }
+        tokenizer->position++;
+    }
+    tokenizer->failed = YES;
+    return NO;
+}
+
+// Scans a number or one of the literals true, false and null.
+static BOOL INSKSconScanLiteral(INSKSconTokenizer *tokenizer, INSKSconToken *token) {
+    INSKSconPeek(tokenizer);
+    NSUInteger start = tokenizer->position;
+    while (tokenizer->position < tokenizer->length) {
+        uint8_t character = tokenizer->bytes[tokenizer->position];
+        if (character == ',' || character == '}' || character == ']' || character == ':' || character == '"'
+            || character == '{' || character == '[' || character == ' ' || character == '\n' || character == '\r' || character == '\t') {
+            break;
+        }
+        tokenizer->position++;
+    }
+    if (tokenizer->failed || tokenizer->position == start) {
+        tokenizer->failed = YES;
+        return NO;
+    }
+    token->bytes = tokenizer->bytes + start;
+    token->length = tokenizer->position - start;
+    return YES;
+}
+
+// Advances to the next member of an object and reads its key, returns false after consuming the object's end.
+static BOOL INSKSconNextMember(INSKSconTokenizer *tokenizer, BOOL *first, INSKSconToken *key) {
+    if (tokenizer->failed) {
+        return NO;
+    }
+    if (INSKSconPeek(tokenizer) == '}') {
+        tokenizer->position++;
+        return NO;
+    }
+    if (!*first && !INSKSconExpect(tokenizer, ',')) {
+        return NO;
+    }
+    *first = NO;
+    
+    BOOL escaped;
+    return INSKSconScanString(tokenizer, key, &escaped) && INSKSconExpect(tokenizer, ':');
+}
+
+// Advances to the next element of an array, returns false after consuming the array's end.
+static BOOL INSKSconNextElement(INSKSconTokenizer *tokenizer, BOOL *first) {
+    if (tokenizer->failed) {
+        return NO;
+    }
+    if (INSKSconPeek(tokenizer) == ']') {
+        tokenizer->position++;
+        return NO;
+    }
+    if (!*first && !INSKSconExpect(tokenizer, ',')) {
+        return NO;
+    }
+    *first = NO;
+    return YES;
+}
+
+// Skips the next value including all nested objects and arrays.
+static void INSKSconSkipValue(INSKSconTokenizer *tokenizer) {
+    INSKSconToken token;
+    uint8_t character = INSKSconPeek(tokenizer);
+    if (character == '{') {
+        tokenizer->position++;
+        BOOL first = YES;
+        while (INSKSconNextMember(tokenizer, &first, &token)) {
+            INSKSconSkipValue(tokenizer);
+        }
+    } else if (character == '[') {
+        tokenizer->position++;
+        BOOL first = YES;
+        while (INSKSconNextElement(tokenizer, &first)) {
+            INSKSconSkipValue(tokenizer);
+        }
+    } else if (character == '"') {
+        BOOL escaped;
+        INSKSconScanString(tokenizer, &token, &escaped);
+    } else {
+        INSKSconScanLiteral(tokenizer, &token);
+    }
+}
+
+// Returns the value of a hex digit or -1 for any other character.
+static inline int INSKSconHexValue(uint8_t character) {
+    if (character >= '0' && character <= '9') return character - '0';
+    if (character >= 'a' && character <= 'f') return character - 'a' + 10;
+    if (character >= 'A' && character <= 'F') return character - 'A' + 10;
+    return -1;
+}
+
+// Reads the four hex digits of an \u escape sequence starting at index, returns -1 on malformed digits.
+static int32_t INSKSconReadUnicodeEscape(INSKSconToken token, NSUInteger index) {
+    if (index + 4 > token.length) {
+        return -1;
+    }
+    int32_t value = 0;
+    for (NSUInteger i = index; i < index + 4; ++i) {
+        int digit = INSKSconHexValue(token.bytes[i]);
+        if (digit < 0) {
+            return -1;
+        }
+        value = (value << 4) | digit;
+    }
+    return value;
+}
+
+// Creates a string from a string token containing escape sequences, returns nil for malformed sequences.
+static NSString *INSKSconUnescapedString(INSKSconToken token) {
+    NSMutableData *buffer = [NSMutableData dataWithCapacity:token.length];
+    NSUInteger index = 0;
+    while (index < token.length) {
+        uint8_t character = token.bytes[index++];
+        if (character != '\\') {
+            [buffer appendBytes:&character length:1];
+            continue;
+        }
+        if (index >= token.length) {
+            return nil;
+        }
+        
+        uint8_t escape = token.bytes[index++];
+        uint8_t replacement;
+        switch (escape) {
+            case '"': replacement = '"'; break;
+            case '\\': replacement = '\\'; break;
+            case '/': replacement = '/'; break;
+            case 'b': replacement = '\b'; break;
+            case 'f': replacement = '\f'; break;
+            case 'n': replacement = '\n'; break;
+            case 'r': replacement = '\r'; break;
+            case 't': replacement = '\t'; break;
+            case 'u': {
+                int32_t codePoint = INSKSconReadUnicodeEscape(token, index);
+                if (codePoint < 0) {
+                    return nil;
+                }
+                index += 4;
+                // combine a surrogate pair into one code point
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+                    if (index + 2 > token.length || token.bytes[index] != '\\' || token.bytes[index + 1] != 'u') {
+                        return nil;
+                    }
+                    int32_t lowSurrogate = INSKSconReadUnicodeEscape(token, index + 2);
+                    if (lowSurrogate < 0xDC00 || lowSurrogate > 0xDFFF) {
+                        return nil;
+                    }
+                    index += 6;
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+                } else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF) {
+                    return nil;
+                }
+                // encode as UTF-8
+                uint8_t encoded[4];
+                NSUInteger encodedLength;
+                if (codePoint < 0x80) {
+                    encoded[0] = codePoint;
+                    encodedLength = 1;
+                } else if (codePoint < 0x800) {
+                    encoded[0] = 0xC0 | (codePoint >> 6);
+                    encoded[1] = 0x80 | (codePoint & 0x3F);
+                    encodedLength = 2;
+                } else if (codePoint < 0x10000) {
+                    encoded[0] = 0xE0 | (codePoint >> 12);
+                    encoded[1] = 0x80 | ((codePoint >> 6) & 0x3F);
+                    encoded[2] = 0x80 | (codePoint & 0x3F);
+                    encodedLength = 3;
+                } else {
+                    encoded[0] = 0xF0 | (codePoint >> 18);
+                    encoded[1] = 0x80 | ((codePoint >> 12) & 0x3F);
+                    encoded[2] = 0x80 | ((codePoint >> 6) & 0x3F);
+                    encoded[3] = 0x80 | (codePoint & 0x3F);
+                    encodedLength = 4;
+                }
+                [buffer appendBytes:encoded length:encodedLength];
+                continue;
+            }
+            default:
+                return nil;
+        }
+        [buffer appendBytes:&replacement length:1];
+    }
+    return [[NSString alloc] initWithData:buffer encoding:NSUTF8StringEncoding];
+}
+
+// Reads a value as string like an attribute of a scml file, so numbers keep their text. Null, objects and arrays return nil.
+static NSString *INSKSconReadString(INSKSconTokenizer *tokenizer) {
+    INSKSconToken token;
+    uint8_t character = INSKSconPeek(tokenizer);
+    if (character == '"') {
+        BOOL escaped;
+        if (!INSKSconScanString(tokenizer, &token, &escaped)) {
+            return nil;
+        }
+        if (escaped) {
+            NSString *string = INSKSconUnescapedString(token);
+            if (string == nil) {
+                tokenizer->failed = YES;
+            }
+            return string;
+        }
+    } else if (character == '{' || character == '[') {
+        INSKSconSkipValue(tokenizer);
+        return nil;
+    } else if (!INSKSconScanLiteral(tokenizer, &token) || INSKSconTokenIs(token, "null")) {
+        return nil;
+    }
+    return [[NSString alloc] initWithBytes:token.bytes length:token.length encoding:NSUTF8StringEncoding];
+}
+
+// Copies a number's text into a zero terminated buffer, numbers given as strings are accepted, too.
+static BOOL INSKSconReadNumberText(INSKSconTokenizer *tokenizer, char *buffer) {
+    INSKSconToken token;
+    BOOL scanned;
+    if (INSKSconPeek(tokenizer) == '"') {
+        BOOL escaped;
+        scanned = INSKSconScanString(tokenizer, &token, &escaped) && !escaped;
+    } else {
+        scanned = INSKSconScanLiteral(tokenizer, &token);
+    }
+    if (!scanned || token.length >= INSKSconNumberBufferSize) {
+        tokenizer->failed = YES;
+        return NO;
+    }
+    memcpy(buffer, token.bytes, token.length);
+    buffer[token.length] = 0;
+    return YES;
+}
+
+// Reads a number as float the same way NSString's floatValue does.
+static CGFloat INSKSconReadFloat(INSKSconTokenizer *tokenizer) {
+    char buffer[INSKSconNumberBufferSize];
+    if (!INSKSconReadNumberText(tokenizer, buffer)) {
+        return 0;
+    }
+    return strtof(buffer, NULL);
+}
+
+// Reads a number as integer the same way NSString's integerValue does.
+static NSInteger INSKSconReadInteger(INSKSconTokenizer *tokenizer) {
+    char buffer[INSKSconNumberBufferSize];
+    if (!INSKSconReadNumberText(tokenizer, buffer)) {
+        return 0;
+    }
+    return (NSInteger)strtoll(buffer, NULL, 10);
+}
+
+// Reads the literals true and false, strings and numbers are interpreted like NSString's boolValue does.
+static BOOL INSKSconReadBool(INSKSconTokenizer *tokenizer) {
+    INSKSconToken token;
+    if (INSKSconPeek(tokenizer) == '"') {
+        BOOL escaped;
+        if (!INSKSconScanString(tokenizer, &token, &escaped)) {
+            return NO;
+        }
+    } else if (!INSKSconScanLiteral(tokenizer, &token)) {
+        return NO;
+    } else if (INSKSconTokenIs(token, "true")) {
+        return YES;
+    } else if (INSKSconTokenIs(token, "false") || INSKSconTokenIs(token, "null")) {
+        return NO;
+    }
+    
+    // skip any sign and leading zeros of a number
+    NSUInteger index = 0;
+    while (index < token.length && (token.bytes[index] == '+' || token.bytes[index] == '-' || token.bytes[index] == '0')) {
+        index++;
+    }
+    if (index == token.length) {
+        return NO;
+    }
+    uint8_t character = token.bytes[index];
+    return (character == 'Y' || character == 'y' || character == 'T' || character == 't' || (character >= '1' && character <= '9'));
+}
+
+
+@implementation INSKSconParser
+
+#pragma mark - parser methods
+
+- (NSString *)filenameExtension {
+    return @"scon";
+}
+
+- (BOOL)parseFileContent:(NSData *)content {
+    INSKSconTokenizer tokenizer = {content.bytes, content.length, 0, NO};
+    if (!INSKSconExpect(&tokenizer, '{')) {
+        return NO;
+    }
+    
+    // parse the tree in one pass, the meta data may be placed anywhere in the root object
+    SpriterData *spriterData = [[SpriterData alloc] init];
+    spriterData.folders = @[];
+    spriterData.entities = @[];
+    NSString *fileVersion = nil;
+    NSString *generator = nil;
+    NSString *generatorVersion = nil;
+    BOOL first = YES;
+    INSKSconToken key;
+    while (INSKSconNextMember(&tokenizer, &first, &key)) {
+        if (INSKSconTokenIs(key, "scon_version")) {
+            fileVersion = INSKSconReadString(&tokenizer);
+            // check for file version before parsing any more
+            if (![self parserForVersion:SCONFileVersionSupported shouldBeCompatibleToFileVersion:fileVersion]) {
+                break;
+            }
+        } else if (INSKSconTokenIs(key, "generator")) {
+            generator = INSKSconReadString(&tokenizer);
+        } else if (INSKSconTokenIs(key, "generator_version")) {
+            generatorVersion = INSKSconReadString(&tokenizer);
+        } else if (INSKSconTokenIs(key, "folder")) {
+            spriterData.folders = [self parseFolders:&tokenizer];
+        } else if (INSKSconTokenIs(key, "entity")) {
+            spriterData.entities = [self parseEntities:&tokenizer];
+        } else {
+            INSKSconSkipValue(&tokenizer);
+        }
+    }
+    
+    // check for file version
+    self.fileVersion = fileVersion;
+    if (![self parserForVersion:SCONFileVersionSupported shouldBeCompatibleToFileVersion:self.fileVersion]) {
+        NSLog(@"Warning: The scon file '%@' is of version %@, but the parser is designed for v%@!", self.filename, self.fileVersion, SCONFileVersionSupported);
+        return NO;
+    }
+    if (tokenizer.failed) {
+        NSLog(@"Warning: The scon file '%@' is malformed near byte %lu!", self.filename, (unsigned long)tokenizer.position);
+        return NO;
+    }
+    
+    // save the meta data and the tree
+    self.generator = generator;
+    self.generatorVersion = generatorVersion;
+    self.spriterData = spriterData;
+    
+    return YES;
+}
+
+
+#pragma mark - parsing methods
+
+- (NSArray *)parseFolders:(INSKSconTokenizer *)tokenizer {
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    BOOL first = YES;
+    if (!INSKSconExpect(tokenizer, '[')) {
+        return array;
+    }
+    while (INSKSconNextElement(tokenizer, &first) && INSKSconExpect(tokenizer, '{')) {
+        SpriterFolder *element = [[SpriterFolder alloc] init];
+        element.files = @[];
+        BOOL firstMember = YES;
+        INSKSconToken key;
+        while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+            if (INSKSconTokenIs(key, "id")) {
+                element.folderId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "name")) {
+                element.name = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "file")) {
+                element.files = [self parseFiles:tokenizer];
+            } else {
+                INSKSconSkipValue(tokenizer);
+            }
+        }
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (NSArray *)parseFiles:(INSKSconTokenizer *)tokenizer {
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    BOOL first = YES;
+    if (!INSKSconExpect(tokenizer, '[')) {
+        return array;
+    }
+    while (INSKSconNextElement(tokenizer, &first) && INSKSconExpect(tokenizer, '{')) {
+        SpriterFile *element = [[SpriterFile alloc] init];
+        BOOL firstMember = YES;
+        INSKSconToken key;
+        while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+            if (INSKSconTokenIs(key, "id")) {
+                element.fileId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "name")) {
+                element.name = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "width")) {
+                element.width = INSKSconReadFloat(tokenizer);
+            } else if (INSKSconTokenIs(key, "height")) {
+                element.height = INSKSconReadFloat(tokenizer);
+            } else if (INSKSconTokenIs(key, "pivot_x")) {
+                element.pivotX = INSKSconReadFloat(tokenizer);
+            } else if (INSKSconTokenIs(key, "pivot_y")) {
+                element.pivotY = INSKSconReadFloat(tokenizer);
+            } else {
+                INSKSconSkipValue(tokenizer);
+            }
+        }
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (NSArray *)parseEntities:(INSKSconTokenizer *)tokenizer {
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    BOOL first = YES;
+    if (!INSKSconExpect(tokenizer, '[')) {
+        return array;
+    }
+    while (INSKSconNextElement(tokenizer, &first) && INSKSconExpect(tokenizer, '{')) {
+        SpriterEntity *element = [[SpriterEntity alloc] init];
+        element.animations = @[];
+        element.objectInfos = @[];
+        BOOL firstMember = YES;
+        INSKSconToken key;
+        while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+            if (INSKSconTokenIs(key, "id")) {
+                element.entityId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "name")) {
+                element.name = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "animation")) {
+                element.animations = [self parseAnimations:tokenizer];
+            } else if (INSKSconTokenIs(key, "obj_info")) {
+                element.objectInfos = [self parseObjectInfos:tokenizer];
+            } else {
+                INSKSconSkipValue(tokenizer);
+            }
+        }
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (NSArray *)parseObjectInfos:(INSKSconTokenizer *)tokenizer {
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    BOOL first = YES;
+    if (!INSKSconExpect(tokenizer, '[')) {
+        return array;
+    }
+    while (INSKSconNextElement(tokenizer, &first) && INSKSconExpect(tokenizer, '{')) {
+        SpriterObjectInfo *element = [[SpriterObjectInfo alloc] init];
+        element.objectType = [self objectTypeForString:nil];
+        BOOL firstMember = YES;
+        INSKSconToken key;
+        while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+            if (INSKSconTokenIs(key, "name")) {
+                element.name = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "type")) {
+                element.objectType = [self objectTypeForString:INSKSconReadString(tokenizer)];
+            } else if (INSKSconTokenIs(key, "w")) {
+                element.width = INSKSconReadFloat(tokenizer);
+            } else if (INSKSconTokenIs(key, "h")) {
+                element.height = INSKSconReadFloat(tokenizer);
+            } else if (INSKSconTokenIs(key, "pivot_x")) {
+                element.pivotX = INSKSconReadFloat(tokenizer);
+            } else if (INSKSconTokenIs(key, "pivot_y")) {
+                element.pivotY = INSKSconReadFloat(tokenizer);
+            } else {
+                INSKSconSkipValue(tokenizer);
+            }
+        }
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (NSArray *)parseAnimations:(INSKSconTokenizer *)tokenizer {
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    BOOL first = YES;
+    if (!INSKSconExpect(tokenizer, '[')) {
+        return array;
+    }
+    while (INSKSconNextElement(tokenizer, &first) && INSKSconExpect(tokenizer, '{')) {
+        SpriterAnimation *element = [[SpriterAnimation alloc] init];
+        element.looping = YES;
+        element.mainline = [[SpriterMainline alloc] init];
+        element.mainline.keys = @[];
+        element.timelines = @[];
+        element.eventlines = @[];
+        BOOL firstMember = YES;
+        INSKSconToken key;
+        while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+            if (INSKSconTokenIs(key, "id")) {
+                element.animationId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "name")) {
+                element.name = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "length")) {
+                element.length = INSKSconReadInteger(tokenizer);
+            } else if (INSKSconTokenIs(key, "looping")) {
+                element.looping = INSKSconReadBool(tokenizer);
+            } else if (INSKSconTokenIs(key, "mainline")) {
+                element.mainline = [self parseMainline:tokenizer];
+            } else if (INSKSconTokenIs(key, "timeline")) {
+                element.timelines = [self parseTimelines:tokenizer];
+            } else if (INSKSconTokenIs(key, "eventline")) {
+                element.eventlines = [self parseEventlines:tokenizer];
+            } else {
+                INSKSconSkipValue(tokenizer);
+            }
+        }
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (SpriterMainline *)parseMainline:(INSKSconTokenizer *)tokenizer {
+    SpriterMainline *element = [[SpriterMainline alloc] init];
+    element.keys = @[];
+    if (!INSKSconExpect(tokenizer, '{')) {
+        return element;
+    }
+    BOOL firstMember = YES;
+    INSKSconToken key;
+    while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+        if (INSKSconTokenIs(key, "key")) {
+            element.keys = [self parseMainlineKeys:tokenizer];
+        } else {
+            INSKSconSkipValue(tokenizer);
+        }
+    }
+    return element;
+}
+
+- (NSArray *)parseMainlineKeys:(INSKSconTokenizer *)tokenizer {
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    BOOL first = YES;
+    if (!INSKSconExpect(tokenizer, '[')) {
+        return array;
+    }
+    while (INSKSconNextElement(tokenizer, &first) && INSKSconExpect(tokenizer, '{')) {
+        SpriterMainlineKey *element = [[SpriterMainlineKey alloc] init];
+        element.objectRefs = @[];
+        element.boneRefs = @[];
+        BOOL firstMember = YES;
+        INSKSconToken key;
+        while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+            if (INSKSconTokenIs(key, "id")) {
+                element.keyId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "time")) {
+                element.time = INSKSconReadInteger(tokenizer);
+            } else if (INSKSconTokenIs(key, "object_ref")) {
+                element.objectRefs = [self parseObjectRefs:tokenizer];
+            } else if (INSKSconTokenIs(key, "bone_ref")) {
+                element.boneRefs = [self parseBoneRefs:tokenizer];
+            } else {
+                INSKSconSkipValue(tokenizer);
+            }
+        }
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (NSArray *)parseObjectRefs:(INSKSconTokenizer *)tokenizer {
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    BOOL first = YES;
+    if (!INSKSconExpect(tokenizer, '[')) {
+        return array;
+    }
+    while (INSKSconNextElement(tokenizer, &first) && INSKSconExpect(tokenizer, '{')) {
+        SpriterObjectRef *element = [[SpriterObjectRef alloc] init];
+        BOOL firstMember = YES;
+        INSKSconToken key;
+        while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+            if (INSKSconTokenIs(key, "id")) {
+                element.refId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "timeline")) {
+                element.timelineId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "key")) {
+                element.keyId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "z_index")) {
+                element.zIndex = INSKSconReadInteger(tokenizer);
+            } else if (INSKSconTokenIs(key, "parent")) {
+                element.parentId = INSKSconReadString(tokenizer);
+            } else {
+                INSKSconSkipValue(tokenizer);
+            }
+        }
+        if (element.parentId == nil) {
+            element.parentId = SpriterRefNoParentValue;
+        }
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (NSArray *)parseBoneRefs:(INSKSconTokenizer *)tokenizer {
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    BOOL first = YES;
+    if (!INSKSconExpect(tokenizer, '[')) {
+        return array;
+    }
+    while (INSKSconNextElement(tokenizer, &first) && INSKSconExpect(tokenizer, '{')) {
+        SpriterBoneRef *element = [[SpriterBoneRef alloc] init];
+        BOOL firstMember = YES;
+        INSKSconToken key;
+        while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+            if (INSKSconTokenIs(key, "id")) {
+                element.refId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "timeline")) {
+                element.timelineId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "key")) {
+                element.keyId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "parent")) {
+                element.parentId = INSKSconReadString(tokenizer);
+            } else {
+                INSKSconSkipValue(tokenizer);
+            }
+        }
+        if (element.parentId == nil) {
+            element.parentId = SpriterRefNoParentValue;
+        }
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (NSArray *)parseTimelines:(INSKSconTokenizer *)tokenizer {
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    BOOL first = YES;
+    if (!INSKSconExpect(tokenizer, '[')) {
+        return array;
+    }
+    while (INSKSconNextElement(tokenizer, &first) && INSKSconExpect(tokenizer, '{')) {
+        SpriterTimeline *element = [[SpriterTimeline alloc] init];
+        element.objectType = [self objectTypeForString:nil];
+        element.objectInfoIndex = NSNotFound;
+        element.keys = @[];
+        BOOL firstMember = YES;
+        INSKSconToken key;
+        while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+            if (INSKSconTokenIs(key, "id")) {
+                element.timelineId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "name")) {
+                element.name = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "object_type")) {
+                element.objectType = [self objectTypeForString:INSKSconReadString(tokenizer)];
+            } else if (INSKSconTokenIs(key, "obj")) {
+                element.objectInfoIndex = INSKSconReadInteger(tokenizer);
+            } else if (INSKSconTokenIs(key, "key")) {
+                element.keys = [self parseTimelineKeys:tokenizer];
+            } else {
+                INSKSconSkipValue(tokenizer);
+            }
+        }
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (NSArray *)parseTimelineKeys:(INSKSconTokenizer *)tokenizer {
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    BOOL first = YES;
+    if (!INSKSconExpect(tokenizer, '[')) {
+        return array;
+    }
+    while (INSKSconNextElement(tokenizer, &first) && INSKSconExpect(tokenizer, '{')) {
+        SpriterTimelineKey *element = [[SpriterTimelineKey alloc] init];
+        element.spin = 1;
+        BOOL firstMember = YES;
+        INSKSconToken key;
+        while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+            if (INSKSconTokenIs(key, "id")) {
+                element.keyId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "time")) {
+                element.time = INSKSconReadInteger(tokenizer);
+            } else if (INSKSconTokenIs(key, "spin")) {
+                element.spin = INSKSconReadInteger(tokenizer);
+            } else if (INSKSconTokenIs(key, "object")) {
+                element.object = [self parseObject:tokenizer];
+            } else if (INSKSconTokenIs(key, "bone")) {
+                element.bone = [self parseBone:tokenizer];
+            } else {
+                INSKSconSkipValue(tokenizer);
+            }
+        }
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (NSArray *)parseEventlines:(INSKSconTokenizer *)tokenizer {
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    BOOL first = YES;
+    if (!INSKSconExpect(tokenizer, '[')) {
+        return array;
+    }
+    while (INSKSconNextElement(tokenizer, &first) && INSKSconExpect(tokenizer, '{')) {
+        SpriterEventline *element = [[SpriterEventline alloc] init];
+        element.keys = @[];
+        BOOL firstMember = YES;
+        INSKSconToken key;
+        while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+            if (INSKSconTokenIs(key, "id")) {
+                element.eventlineId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "name")) {
+                element.name = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "key")) {
+                element.keys = [self parseEventlineKeys:tokenizer];
+            } else {
+                INSKSconSkipValue(tokenizer);
+            }
+        }
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (NSArray *)parseEventlineKeys:(INSKSconTokenizer *)tokenizer {
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    BOOL first = YES;
+    if (!INSKSconExpect(tokenizer, '[')) {
+        return array;
+    }
+    while (INSKSconNextElement(tokenizer, &first) && INSKSconExpect(tokenizer, '{')) {
+        SpriterEventlineKey *element = [[SpriterEventlineKey alloc] init];
+        BOOL firstMember = YES;
+        INSKSconToken key;
+        while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+            if (INSKSconTokenIs(key, "id")) {
+                element.keyId = INSKSconReadString(tokenizer);
+            } else if (INSKSconTokenIs(key, "time")) {
+                element.time = INSKSconReadInteger(tokenizer);
+            } else {
+                INSKSconSkipValue(tokenizer);
+            }
+        }
+        [array addObject:element];
+    }
+    return array;
+}
+
+- (SpriterObjectType)objectTypeForString:(NSString *)type {
+    if (type == nil || [type isEqualToString:@"sprite"]) {
+        return SpriterObjectTypeSprite;
+    } else if ([type isEqualToString:@"bone"]) {
+        return SpriterObjectTypeBone;
+    } else if ([type isEqualToString:@"box"]) {
+        return SpriterObjectTypeBox;
+    } else if ([type isEqualToString:@"point"]) {
+        return SpriterObjectTypePoint;
+    }
+    return SpriterObjectTypeUnsupported;
+}
+
+- (SpriterObject *)parseObject:(INSKSconTokenizer *)tokenizer {
+    SpriterObject *element = [[SpriterObject alloc] init];
+    element.scaleX = 1.0;
+    element.scaleY = 1.0;
+    element.pivotX = SpriterObjectNoPivotValue;
+    element.pivotY = SpriterObjectNoPivotValue;
+    element.alpha = 1.0;
+    if (!INSKSconExpect(tokenizer, '{')) {
+        return element;
+    }
+    BOOL firstMember = YES;
+    INSKSconToken key;
+    while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+        if (INSKSconTokenIs(key, "folder")) {
+            element.folderId = INSKSconReadString(tokenizer);
+        } else if (INSKSconTokenIs(key, "file")) {
+            element.fileId = INSKSconReadString(tokenizer);
+        } else if (INSKSconTokenIs(key, "x")) {
+            element.positionX = INSKSconReadFloat(tokenizer);
+        } else if (INSKSconTokenIs(key, "y")) {
+            element.positionY = INSKSconReadFloat(tokenizer);
+        } else if (INSKSconTokenIs(key, "angle")) {
+            element.angle = INSKSconReadFloat(tokenizer);
+        } else if (INSKSconTokenIs(key, "scale_x")) {
+            element.scaleX = INSKSconReadFloat(tokenizer);
+        } else if (INSKSconTokenIs(key, "scale_y")) {
+            element.scaleY = INSKSconReadFloat(tokenizer);
+        } else if (INSKSconTokenIs(key, "pivot_x")) {
+            element.pivotX = INSKSconReadFloat(tokenizer);
+        } else if (INSKSconTokenIs(key, "pivot_y")) {
+            element.pivotY = INSKSconReadFloat(tokenizer);
+        } else if (INSKSconTokenIs(key, "a")) {
+            element.alpha = INSKSconReadFloat(tokenizer);
+        } else {
+            INSKSconSkipValue(tokenizer);
+        }
+    }
+    return element;
+}
+
+- (SpriterBone *)parseBone:(INSKSconTokenizer *)tokenizer {
+    SpriterBone *element = [[SpriterBone alloc] init];
+    element.scaleX = 1.0;
+    element.scaleY = 1.0;
+    element.alpha = 1.0;
+    if (!INSKSconExpect(tokenizer, '{')) {
+        return element;
+    }
+    BOOL firstMember = YES;
+    INSKSconToken key;
+    while (INSKSconNextMember(tokenizer, &firstMember, &key)) {
+        if (INSKSconTokenIs(key, "x")) {
+            element.positionX = INSKSconReadFloat(tokenizer);
+        } else if (INSKSconTokenIs(key, "y")) {
+            element.positionY = INSKSconReadFloat(tokenizer);
+        } else if (INSKSconTokenIs(key, "angle")) {
+            element.angle = INSKSconReadFloat(tokenizer);
+        } else if (INSKSconTokenIs(key, "scale_x")) {
+            element.scaleX = INSKSconReadFloat(tokenizer);
+        } else if (INSKSconTokenIs(key, "scale_y")) {
+            element.scaleY = INSKSconReadFloat(tokenizer);
+        } else if (INSKSconTokenIs(key, "a")) {
+            element.alpha = INSKSconReadFloat(tokenizer);
+        } else {
+            INSKSconSkipValue(tokenizer);
+        }
+    }
+    return element;
+}
+
+
+@end
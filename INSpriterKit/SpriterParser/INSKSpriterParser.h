@@ -31,6 +31,23 @@
 static NSString * const SpriterFileVersionSupported = @"1.0";
 
 
+/**
+ A block which is informed about the progress of an asynchronous parse.
+ 
+ @param entityName The name of the entity whose animation has just been converted.
+ @param animationName The name of the converted animation.
+ @param fractionCompleted The completed part of the whole parse and conversion in the range of 0 to 1.
+ */
+typedef void (^INSKSpriterParserProgressHandler)(NSString *entityName, NSString *animationName, double fractionCompleted);
+
+/**
+ A block which receives the result of an asynchronous parse.
+ 
+ @param animationData The converted animation data or nil if the parse has failed or has been cancelled.
+ */
+typedef void (^INSKSpriterParserCompletionHandler)(INSKAMData *animationData);
+
+
 /**
  An abstract class for parsing files created by the animation tool "Spriter" from BrashMonkey.
 
@@ -47,6 +64,7 @@ static NSString * const SpriterFileVersionSupported = @"1.0";
  A parser implementation will need to create the Spriter data model so a common include will be for SpriterModelHeaders.h.
  
  @see INSKScmlParser
+ @see INSKSconParser
  */
 @interface INSKSpriterParser : NSObject
 
@@ -65,6 +83,70 @@ static NSString * const SpriterFileVersionSupported = @"1.0";
 @property (nonatomic, strong) SpriterData *spriterData;
 
 
+#pragma mark - Conversion options
+/// @name Conversion options
+
+/**
+ Flag for storing the keyframes of the created animation data in the compressed form, defaults to false.
+ 
+ Compressed keyframes need less than a quarter of the memory, but have to be decoded during playback
+ and lose some precision, see INSKAMTimeline's compress method for the precision bounds.
+ 
+ @see [INSKAMTimeline compress]
+ */
+@property (nonatomic, assign) BOOL compressKeyframes;
+
+
+/**
+ Flag for converting the animations on their first use instead of in animationData, defaults to false.
+ 
+ In the lazy mode animationData creates only the textures, the entities and the animations with their names, lengths and looping flags.
+ The timelines of an animation are converted when it's played for the first time or prepared with prepareAnimations:ofEntity: of the INSKAnimationManager.
+ The conversion of an animation runs only once and may happen on any thread.
+ Until they are converted the animations keep their parsed Spriter animations and the file's folders alive, but not the parser.
+ 
+ @see [INSKAMAnimation prepare]
+ */
+@property (nonatomic, assign) BOOL lazyConversion;
+
+
+#pragma mark - Caching
+/// @name Caching
+
+/**
+ The directory for caching the converted animation data between launches or nil for no caching, defaults to nil.
+ 
+ With a cache directory each parse hashes the file's content together with the UUID of the binary holding the parser, the compressKeyframes flag and the architecture.
+ If the directory holds an entry for this hash the parse reads it instead of parsing the file, spriterData stays nil
+ and animationData decodes the cached animation data instead of converting it.
+ Otherwise the file is parsed as usual and animationData stores its result in the cache.
+ 
+    scmlParser.cacheDirectory = [INSKSpriterParser defaultCacheDirectory];
+    [scmlParser parseFilename:@"MySpriterFile"];
+ 
+ Stale entries are invalidated automatically: a changed file, a rebuilt parser or another option leads to a different hash,
+ storing a file loaded with parseFilename: deletes the older entries of that file name with the same options and an entry which can't be read is deleted.
+ Nothing is cached if the binary has no UUID.
+ In the lazy conversion mode entries are only read, because animationData doesn't convert the animations.
+ 
+ @see loadedFromCache
+ */
+@property (nonatomic, copy) NSString *cacheDirectory;
+
+
+/// True if the last parse has found its animation data in the cache, so spriterData is nil.
+@property (nonatomic, assign, readonly) BOOL loadedFromCache;
+
+
+/**
+ Returns a directory for the cache in the app's caches directory, which the system may purge when space is low.
+ 
+ @return The path of the directory, which is created when the first entry is stored.
+ @see cacheDirectory
+ */
++ (NSString *)defaultCacheDirectory;
+
+
 #pragma mark - Start parsing a file
 /// @name Start parsing a file
 
@@ -101,6 +183,101 @@ static NSString * const SpriterFileVersionSupported = @"1.0";
 - (INSKAMData *)animationData;
 
 
+#pragma mark - Asynchronous parsing
+/// @name Asynchronous parsing
+
+/**
+ Loads and parses a Spriter file in the main bundle and converts it into a INSKAMData object on a background queue.
+ 
+ The work is done by a new parser of the same class with the same conversion options, so this parser isn't changed
+ and several files can be loaded at the same time.
+ The progress handler is called after each converted animation and the completion handler once at the end, both on the main queue.
+ Cancelling the returned progress stops the work before the next animation is converted and the completion handler gets nil then.
+ The delivered animation data isn't referenced by the parser anymore, so it can be passed to a INSKAnimationManager directly.
+ 
+    self.loadingProgress = [scmlParser parseFilename:@"MySpriterFile" progressHandler:^(NSString *entityName, NSString *animationName, double fractionCompleted) {
+        self.progressBar.progress = fractionCompleted;
+    } completionHandler:^(INSKAMData *animationData) {
+        self.animationManager = [[INSKAnimationManager alloc] initWithAnimationData:animationData textureLoader:self];
+    }];
+ 
+ @param filename The name of a Spriter file without file extension to load.
+ @param progressHandler An optional block called with the progress on the main queue.
+ @param completionHandler A block called with the converted animation data on the main queue.
+ @return A progress object for observing the fractionCompleted and for cancelling.
+ */
+- (NSProgress *)parseFilename:(NSString *)filename progressHandler:(INSKSpriterParserProgressHandler)progressHandler completionHandler:(INSKSpriterParserCompletionHandler)completionHandler;
+
+
+/**
+ Parses a Spriter file's content and converts it into a INSKAMData object on a background queue.
+ 
+ Works like parseFilename:progressHandler:completionHandler: with the file's content passed as a data object.
+ 
+ @param data The data object with a Spriter file's content.
+ @param progressHandler An optional block called with the progress on the main queue.
+ @param completionHandler A block called with the converted animation data on the main queue.
+ @return A progress object for observing the fractionCompleted and for cancelling.
+ */
+- (NSProgress *)parseSpriterdata:(NSData *)data progressHandler:(INSKSpriterParserProgressHandler)progressHandler completionHandler:(INSKSpriterParserCompletionHandler)completionHandler;
+
+
+#pragma mark - Incremental conversion
+/// @name Incremental conversion
+
+/**
+ Starts converting the parsed Spriter data or decoding the cache entry found by the parse in small steps which can be spread across frames.
+ 
+ The conversion is split into steps for the textures of a folder, an entity, a chunk of a timeline's keys, the parent links,
+ the mainline key and the hidden spatials of one mainline key, the completion, the scale fix-ups and the span times of one timeline,
+ a chunk of bounds or hold spans, an eventline and the sorting of the events. Decoding a cache entry is split into steps for the textures,
+ the values of an entity or an animation, one timeline and the mainline keys, spans and events of an animation.
+ Call step: once per frame with the time the frame may spend on it until it returns true,
+ then take the result out of incrementalAnimationData.
+ 
+    - (void)update:(NSTimeInterval)currentTime {
+        if (self.scmlParser.isConverting && [self.scmlParser step:0.004]) {
+            self.animationManager = [[INSKAnimationManager alloc] initWithAnimationData:self.scmlParser.incrementalAnimationData textureLoader:self];
+        } else if (self.scmlParser.incrementalConversionFailed) {
+            // handle the error
+        }
+    }
+ 
+ The file has to be parsed before, which isn't split into steps, so parse a big file on a background queue,
+ e.g. with parseFilename:progressHandler:completionHandler:, or let the cache skip the parse.
+ Calling this method again restarts the conversion and the conversion options are read only here.
+ In the lazy conversion mode the animations are not converted by the steps, but on their first use.
+ 
+ @return True if the conversion has been started, false if there is no parsed Spriter data.
+ @see lazyConversion
+ */
+- (BOOL)startIncrementalConversion;
+
+
+/**
+ Runs the next steps of an incremental conversion until the time budget is used up.
+ 
+ At least one step is run on each call, so the conversion advances even with a budget of zero.
+ A step is never interrupted, so the budget is exceeded by the duration of the last step.
+ Most steps handle a bounded number of keys or spans, but a step handling a single timeline, mainline key or eventline
+ takes as long as that one needs, e.g. a timeline with many keys decoded from the cache.
+ 
+ @param budget The time in seconds which may be spent on the conversion during this call.
+ @return True if the conversion has finished successfully, false if there are steps left, the conversion has failed or none has been started.
+ @see incrementalAnimationData
+ @see incrementalConversionFailed
+ */
+- (BOOL)step:(NSTimeInterval)budget;
+
+
+/// True while an incremental conversion has steps left.
+@property (nonatomic, readonly, getter=isConverting) BOOL converting;
+/// The animation data of the last finished incremental conversion or nil if it hasn't finished or has failed.
+@property (nonatomic, strong, readonly) INSKAMData *incrementalAnimationData;
+/// True if the last incremental conversion has failed, e.g. because the cache entry was malformed and has been removed, so there is no animation data.
+@property (nonatomic, assign, readonly) BOOL incrementalConversionFailed;
+
+
 #pragma mark - Methods for subclasses
 /// @name Methods for subclasses
 
@@ -24,13 +24,105 @@
 #import "INSKSpriterParser.h"
 #import "SpriterModelHeaders.h"
 #import "INSKAMHeaders.h"
+#import "INSKAnimationTrace.h"
 #import <INLib/INLib.h>
+#import <QuartzCore/QuartzCore.h>
+#import <CommonCrypto/CommonDigest.h>
+#import <dlfcn.h>
+#import <mach-o/loader.h>
 #import <INSpriteKit/INSKMath.h>
 
 
+// Orders events by their time and events at the same time by their eventline.
+static int INSKSpriterParserCompareEvents(const void *a, const void *b) {
+    const INSKAMEvent *event1 = a;
+    const INSKAMEvent *event2 = b;
+    if (event1->time != event2->time) {
+        return (event1->time < event2->time ? -1 : 1);
+    }
+    if (event1->eventlineIndex != event2->eventlineIndex) {
+        return (event1->eventlineIndex < event2->eventlineIndex ? -1 : 1);
+    }
+    return 0;
+}
+
+
+// The number of timeline keys converted by one step of an incremental conversion.
+static const NSUInteger INSKSpriterParserKeysPerStep = 256;
+
+
+// A part of a conversion, returns false if the conversion failed.
+typedef BOOL (^INSKSpriterParserConversionStep)(void);
+
+
+// The file extension of the cache entries.
+static NSString * const INSKSpriterParserCacheExtension = @"inskam";
+// The magic number at the start of a cache entry.
+static uint32_t const INSKSpriterParserCacheMagic = 'ISKC';
+
+// The header of a cache entry followed by the archived animation data.
+typedef struct {
+    uint32_t magic;
+    uint32_t headerLength;
+    uint64_t archiveLength;
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+} INSKSpriterParserCacheHeader;
+
+
+// Returns the UUID of the binary image holding the parser, which the linker changes whenever the conversion or the archive code is rebuilt, or nil if it has none.
+static NSData *INSKSpriterParserImageUUID(void) {
+    Dl_info info;
+    if (dladdr((const void *)&INSKSpriterParserImageUUID, &info) == 0 || info.dli_fbase == NULL) {
+        return nil;
+    }
+    const struct mach_header *header = info.dli_fbase;
+    const uint8_t *command;
+    if (header->magic == MH_MAGIC_64) {
+        command = (const uint8_t *)info.dli_fbase + sizeof(struct mach_header_64);
+    } else if (header->magic == MH_MAGIC) {
+        command = (const uint8_t *)info.dli_fbase + sizeof(struct mach_header);
+    } else {
+        return nil;
+    }
+    for (uint32_t index = 0; index < header->ncmds; ++index) {
+        const struct load_command *loadCommand = (const struct load_command *)command;
+        if (loadCommand->cmd == LC_UUID) {
+            const struct uuid_command *uuidCommand = (const struct uuid_command *)command;
+            return [NSData dataWithBytes:uuidCommand->uuid length:sizeof(uuidCommand->uuid)];
+        }
+        command += loadCommand->cmdsize;
+    }
+    return nil;
+}
+
+// Returns the key of the format of the cached animation data, nil if there is none and nothing can be cached.
+static NSData *INSKSpriterParserCacheFormatKey(void) {
+    static NSData *formatKey = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        formatKey = INSKSpriterParserImageUUID();
+    });
+    return formatKey;
+}
+
+
 @interface INSKSpriterParser ()
 
 @property (nonatomic, copy, readwrite) NSString *filename;
+@property (nonatomic, strong, readwrite) INSKAMData *incrementalAnimationData;
+@property (nonatomic, assign, readwrite) BOOL incrementalConversionFailed;
+// The animation data filled by the pending steps of an incremental conversion.
+@property (nonatomic, strong) INSKAMData *incrementalData;
+// The pending steps of an incremental conversion, nil if none is running.
+@property (nonatomic, strong) NSMutableArray *conversionSteps;
+@property (nonatomic, assign, readwrite) BOOL loadedFromCache;
+// The hash of the parsed content which names its cache entry, nil without a cache directory.
+@property (nonatomic, strong) NSData *cacheDigest;
+// The archive of a cache entry found by the last parse, nil if there was none.
+@property (nonatomic, strong) NSData *cachedArchive;
+
+// Converts the parsed Spriter data and calls the handler after each animation, returning nil if the handler returns false.
+- (INSKAMData *)animationDataWithAnimationHandler:(BOOL (^)(NSString *entityName, NSString *animationName))animationHandler;
 
 @end
 
@@ -58,11 +150,260 @@
     self.generatorVersion = nil;
     self.spriterData = nil;
     self.filename = nil;
+    self.loadedFromCache = NO;
+    self.cacheDigest = nil;
+    self.cachedArchive = nil;
+}
+
+// Returns the part of an entry's name which stands for the parser options the converted data depends on.
+- (NSString *)cacheOptionsName {
+    return (self.compressKeyframes ? @"compressed" : @"plain");
+}
+
+// Returns the prefix shared by all entries of the last parsed file with the current options, nil if the file name isn't known.
+- (NSString *)cachePrefix {
+    if (self.filename == nil) {
+        return nil;
+    }
+    return [NSString stringWithFormat:@"%@-%@-", self.filename.lastPathComponent, [self cacheOptionsName]];
+}
+
+// Returns the path of the cache entry for the last parsed content, named by its hash and prefixed with the file name and options if known.
+- (NSString *)cachePath {
+    NSMutableString *key = [NSMutableString stringWithCapacity:self.cacheDigest.length * 2];
+    const uint8_t *digestBytes = self.cacheDigest.bytes;
+    for (NSUInteger index = 0; index < self.cacheDigest.length; ++index) {
+        [key appendFormat:@"%02x", digestBytes[index]];
+    }
+    NSString *prefix = [self cachePrefix];
+    NSString *entryName = (prefix != nil ? [prefix stringByAppendingString:key] : key);
+    return [[self.cacheDirectory stringByAppendingPathComponent:entryName] stringByAppendingPathExtension:INSKSpriterParserCacheExtension];
+}
+
+// Hashes the content with everything else the converted data depends on.
+- (NSData *)cacheDigestForContent:(NSData *)content formatKey:(NSData *)formatKey {
+    uint32_t parserValues[] = {self.compressKeyframes, sizeof(CGFloat), sizeof(NSInteger), sizeof(INSKSpriterParserCacheHeader)};
+    NSData *fileVersion = [SpriterFileVersionSupported dataUsingEncoding:NSUTF8StringEncoding];
+    CC_SHA256_CTX context;
+    CC_SHA256_Init(&context);
+    CC_SHA256_Update(&context, formatKey.bytes, (CC_LONG)formatKey.length);
+    CC_SHA256_Update(&context, parserValues, sizeof(parserValues));
+    CC_SHA256_Update(&context, fileVersion.bytes, (CC_LONG)fileVersion.length);
+    
+    // hash big files in pieces, because the length is limited to 32 bit
+    const uint8_t *bytes = content.bytes;
+    NSUInteger remainingLength = content.length;
+    while (remainingLength > 0) {
+        CC_LONG length = (CC_LONG)MIN(remainingLength, (NSUInteger)UINT32_MAX);
+        CC_SHA256_Update(&context, bytes, length);
+        bytes += length;
+        remainingLength -= length;
+    }
+    NSMutableData *digest = [NSMutableData dataWithLength:CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final(digest.mutableBytes, &context);
+    return digest;
+}
+
+// Looks up the cache entry for the content, returns true on a hit with the parsed properties restored.
+- (BOOL)readCacheForContent:(NSData *)content {
+    NSData *formatKey = INSKSpriterParserCacheFormatKey();
+    if (self.cacheDirectory == nil || formatKey == nil) {
+        return NO;
+    }
+    INSKAnimationTraceScoped("read cache");
+    
+    NSData *digest = [self cacheDigestForContent:content formatKey:formatKey];
+    self.cacheDigest = digest;
+    NSString *path = [self cachePath];
+    NSData *entry = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:NULL];
+    if (entry == nil) {
+        return NO;
+    }
+    
+    // an entry which doesn't match its name is broken and removed
+    INSKSpriterParserCacheHeader header;
+    BOOL valid = (entry.length >= sizeof(header));
+    if (valid) {
+        memcpy(&header, entry.bytes, sizeof(header));
+        valid = (header.magic == INSKSpriterParserCacheMagic && header.headerLength == sizeof(header)
+                 && header.archiveLength == entry.length - sizeof(header) && memcmp(header.digest, digest.bytes, sizeof(header.digest)) == 0);
+    }
+    if (!valid) {
+        [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+        return NO;
+    }
+    
+    // the file's properties are archived in front of the animation data
+    NSData *archive = [entry subdataWithRange:NSMakeRange(sizeof(header), (NSUInteger)header.archiveLength)];
+    INSKAMArchive *archiveReader = [[INSKAMArchive alloc] initWithArchivedData:archive];
+    NSString *fileVersion = [archiveReader decodeString];
+    NSString *generator = [archiveReader decodeString];
+    NSString *generatorVersion = [archiveReader decodeString];
+    if (archiveReader.failed) {
+        [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+        return NO;
+    }
+    self.fileVersion = fileVersion;
+    self.generator = generator;
+    self.generatorVersion = generatorVersion;
+    self.cachedArchive = archive;
+    self.loadedFromCache = YES;
+    return YES;
+}
+
+// Decodes the animation data of the cache entry found by the last parse, removing the entry if it's malformed.
+- (INSKAMData *)animationDataFromCache {
+    INSKAnimationTraceScoped("decode cache");
+    
+    // the steps are run at once
+    __block INSKAMData *decodedData = nil;
+    NSMutableArray *steps = [NSMutableArray array];
+    [self addCacheDecodingStepsToSteps:steps resultHandler:^(INSKAMData *data) {
+        decodedData = data;
+    }];
+    while (steps.count > 0) {
+        if (![[self class] runFirstConversionStep:steps]) {
+            return nil;
+        }
+    }
+    return decodedData;
+}
+
+// Removes the cache entry found by the last parse because it can't be decoded.
+- (void)removeMalformedCacheEntry {
+    NSLog(@"Warning: The cached animation data of '%@' is malformed and has been removed, parse the file again!", self.filename);
+    [[NSFileManager defaultManager] removeItemAtPath:[self cachePath] error:NULL];
+    self.cachedArchive = nil;
+}
+
+// Adds the steps decoding the cache entry found by the last parse, each step decodes the textures, the values of an entity or an animation,
+// a timeline or the rest of an animation. The last step passes the animation data to the handler.
+- (void)addCacheDecodingStepsToSteps:(NSMutableArray *)steps resultHandler:(void (^)(INSKAMData *data))resultHandler {
+    INSKAMArchive *archive = [[INSKAMArchive alloc] initWithArchivedData:self.cachedArchive];
+    __weak INSKSpriterParser *weakSelf = self;
+    __weak NSMutableArray *weakSteps = steps;
+    INSKSpriterParserConversionStep malformedStep = ^BOOL {
+        [weakSelf removeMalformedCacheEntry];
+        return NO;
+    };
+    Class parserClass = [self class];
+    
+    [steps addObject:^BOOL {
+        // the file's properties are archived in front of the animation data
+        [archive decodeString];
+        [archive decodeString];
+        [archive decodeString];
+        NSUInteger entityCount = 0;
+        INSKAMData *data = [[INSKAMData alloc] initWithArchiveHeader:archive entityCount:&entityCount];
+        if (data == nil) {
+            return malformedStep();
+        }
+        
+        // the steps of an entity insert the steps of its animations and those insert the steps of their timelines
+        NSMutableArray *entitySteps = [NSMutableArray arrayWithCapacity:entityCount + 1];
+        for (NSUInteger entityIndex = 0; entityIndex < entityCount; ++entityIndex) {
+            [entitySteps addObject:^BOOL {
+                NSUInteger animationCount = 0;
+                INSKAMEntity *entity = [[INSKAMEntity alloc] initWithArchiveHeader:archive animationCount:&animationCount];
+                if (![data addDecodedEntity:entity]) {
+                    return malformedStep();
+                }
+                NSMutableArray *animationSteps = [NSMutableArray arrayWithCapacity:animationCount];
+                for (NSUInteger animationIndex = 0; animationIndex < animationCount; ++animationIndex) {
+                    [animationSteps addObject:[parserClass animationDecodingStepWithArchive:archive entity:entity steps:weakSteps malformedStep:malformedStep]];
+                }
+                [parserClass insertConversionSteps:animationSteps intoSteps:weakSteps];
+                return YES;
+            }];
+        }
+        [entitySteps addObject:^BOOL {
+            if (archive.failed || !archive.atEnd) {
+                return malformedStep();
+            }
+            resultHandler(data);
+            return YES;
+        }];
+        [parserClass insertConversionSteps:entitySteps intoSteps:weakSteps];
+        return YES;
+    }];
+}
+
+// Returns a step which decodes the values of the next animation of an entity and inserts the steps for its timelines and the rest of it.
++ (INSKSpriterParserConversionStep)animationDecodingStepWithArchive:(INSKAMArchive *)archive entity:(INSKAMEntity *)entity steps:(NSMutableArray *)steps malformedStep:(INSKSpriterParserConversionStep)malformedStep {
+    __weak NSMutableArray *weakSteps = steps;
+    return ^BOOL {
+        NSUInteger timelineCount = 0;
+        INSKAMAnimation *animation = [[INSKAMAnimation alloc] initWithArchiveHeader:archive timelineCount:&timelineCount];
+        if (![entity addDecodedAnimation:animation]) {
+            return malformedStep();
+        }
+        NSMutableArray *timelineSteps = [NSMutableArray arrayWithCapacity:timelineCount + 1];
+        for (NSUInteger timelineIndex = 0; timelineIndex < timelineCount; ++timelineIndex) {
+            [timelineSteps addObject:^BOOL {
+                return ([animation decodeTimelineFromArchive:archive] || malformedStep());
+            }];
+        }
+        [timelineSteps addObject:^BOOL {
+            return ([animation decodeRemainderFromArchive:archive] || malformedStep());
+        }];
+        [self insertConversionSteps:timelineSteps intoSteps:weakSteps];
+        return YES;
+    };
+}
+
+// Stores converted animation data in the cache and removes older entries of the same file.
+- (void)storeAnimationDataInCache:(INSKAMData *)data {
+    if (self.cacheDigest == nil || self.loadedFromCache || self.lazyConversion || data == nil) {
+        return;
+    }
+    INSKAnimationTraceScoped("write cache");
+    
+    INSKAMArchive *archive = [[INSKAMArchive alloc] init];
+    [archive encodeString:self.fileVersion];
+    [archive encodeString:self.generator];
+    [archive encodeString:self.generatorVersion];
+    [data encodeWithArchive:archive];
+    NSData *archivedData = [archive archivedData];
+    
+    // the padding is written to disk, too
+    INSKSpriterParserCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = INSKSpriterParserCacheMagic;
+    header.headerLength = sizeof(header);
+    header.archiveLength = archivedData.length;
+    memcpy(header.digest, self.cacheDigest.bytes, sizeof(header.digest));
+    NSMutableData *entry = [NSMutableData dataWithCapacity:sizeof(header) + archivedData.length];
+    [entry appendBytes:&header length:sizeof(header)];
+    [entry appendData:archivedData];
+    
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    [fileManager createDirectoryAtPath:self.cacheDirectory withIntermediateDirectories:YES attributes:nil error:NULL];
+    NSString *path = [self cachePath];
+    if (![entry writeToFile:path atomically:YES]) {
+        NSLog(@"Warning: The animation data couldn't be cached at '%@'!", path);
+        return;
+    }
+    
+    // the older entries of a file with the same options have the same prefix, but another hash, the entries of other options are kept
+    NSString *prefix = [self cachePrefix];
+    if (prefix != nil) {
+        NSString *entryName = path.lastPathComponent;
+        for (NSString *name in [fileManager contentsOfDirectoryAtPath:self.cacheDirectory error:NULL]) {
+            if ([name hasPrefix:prefix] && name.length == entryName.length && [name.pathExtension isEqualToString:INSKSpriterParserCacheExtension] && ![name isEqualToString:entryName]) {
+                [fileManager removeItemAtPath:[self.cacheDirectory stringByAppendingPathComponent:name] error:NULL];
+            }
+        }
+    }
 }
 
 
 #pragma mark - public methods
 
++ (NSString *)defaultCacheDirectory {
+    NSString *cachesDirectory = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+    return [cachesDirectory stringByAppendingPathComponent:@"INSpriterKit"];
+}
+
 - (NSString *)description {
     if (self.spriterData) {
         return [NSString stringWithFormat:@"Spriter file '%@.%@' v%@", self.filename, [self filenameExtension], self.fileVersion];
@@ -81,6 +422,8 @@
 }
 
 - (BOOL)parseFilename:(NSString *)filename {
+    INSKAnimationTraceScoped("parse file");
+    
     // reset values
     [self resetProperties];
     self.filename = filename;
@@ -92,6 +435,11 @@
         return NO;
     }
     
+    // a cached conversion makes parsing unnecessary
+    if ([self readCacheForContent:data]) {
+        return YES;
+    }
+    
     // parse the file's content
     BOOL success = [self parseFileContent:data];
     if (!success) {
@@ -111,6 +459,8 @@
 }
 
 - (BOOL)parseSpriterdata:(NSData *)data {
+    INSKAnimationTraceScoped("parse data");
+    
     // reset values
     [self resetProperties];
 
@@ -119,6 +469,11 @@
         return NO;
     }
     
+    // a cached conversion makes parsing unnecessary
+    if ([self readCacheForContent:data]) {
+        return YES;
+    }
+    
     // parse the file's content
     BOOL success = [self parseFileContent:data];
     if (!success) {
@@ -137,225 +492,626 @@
     return YES;
 }
 
+- (NSProgress *)parseFilename:(NSString *)filename progressHandler:(INSKSpriterParserProgressHandler)progressHandler completionHandler:(INSKSpriterParserCompletionHandler)completionHandler {
+    return [self parseInBackgroundWithBlock:^BOOL(INSKSpriterParser *parser) {
+        return [parser parseFilename:filename];
+    } progressHandler:progressHandler completionHandler:completionHandler];
+}
+
+- (NSProgress *)parseSpriterdata:(NSData *)data progressHandler:(INSKSpriterParserProgressHandler)progressHandler completionHandler:(INSKSpriterParserCompletionHandler)completionHandler {
+    NSData *content = [data copy];
+    return [self parseInBackgroundWithBlock:^BOOL(INSKSpriterParser *parser) {
+        return [parser parseSpriterdata:content];
+    } progressHandler:progressHandler completionHandler:completionHandler];
+}
+
+// Runs a parse block and the conversion with a new parser of the same class and options on a background queue.
+- (NSProgress *)parseInBackgroundWithBlock:(BOOL (^)(INSKSpriterParser *parser))parseBlock progressHandler:(INSKSpriterParserProgressHandler)progressHandler completionHandler:(INSKSpriterParserCompletionHandler)completionHandler {
+    INSKSpriterParser *parser = [[[self class] alloc] init];
+    parser.compressKeyframes = self.compressKeyframes;
+    parser.lazyConversion = self.lazyConversion;
+    parser.cacheDirectory = self.cacheDirectory;
+    
+    // parsing is one unit, each animation another one
+    NSProgress *progress = [NSProgress progressWithTotalUnitCount:1];
+    progress.cancellable = YES;
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        INSKAMData *animationData = nil;
+        if (!progress.cancelled && parseBlock(parser) && !progress.cancelled) {
+            NSUInteger animationCount = 0;
+            for (SpriterEntity *spriterEntity in parser.spriterData.entities) {
+                animationCount += spriterEntity.animations.count;
+            }
+            progress.totalUnitCount = 1 + animationCount;
+            progress.completedUnitCount = 1;
+            
+            animationData = [parser animationDataWithAnimationHandler:^BOOL(NSString *entityName, NSString *animationName) {
+                progress.completedUnitCount += 1;
+                if (progressHandler != nil) {
+                    double fractionCompleted = progress.fractionCompleted;
+                    dispatch_async(dispatch_get_main_queue(), ^{
+                        progressHandler(entityName, animationName, fractionCompleted);
+                    });
+                }
+                return !progress.cancelled;
+            }];
+        }
+        if (progress.cancelled) {
+            animationData = nil;
+        }
+        
+        // the parser is released here, so the data isn't referenced by it anymore unless converted lazily
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (completionHandler != nil) {
+                completionHandler(animationData);
+            }
+        });
+    });
+    return progress;
+}
+
 - (INSKAMData *)animationData {
-    if (self.spriterData == nil) {
+    return [self animationDataWithAnimationHandler:nil];
+}
+
+- (INSKAMData *)animationDataWithAnimationHandler:(BOOL (^)(NSString *entityName, NSString *animationName))animationHandler {
+    if (self.cachedArchive != nil) {
+        return [self animationDataFromCache];
+    }
+    SpriterData *spriterData = self.spriterData;
+    if (spriterData == nil) {
         return nil;
     }
+    INSKAnimationTraceScoped("convert animation data");
     
+    // the steps are run at once
+    NSMutableArray *steps = [NSMutableArray array];
+    INSKAMData *data = [self animationDataForSpriterData:spriterData steps:steps animationHandler:animationHandler];
+    while (steps.count > 0) {
+        if (![[self class] runFirstConversionStep:steps]) {
+            return nil;
+        }
+    }
+    [self storeAnimationDataInCache:data];
+    return data;
+}
+
+- (BOOL)startIncrementalConversion {
+    SpriterData *spriterData = self.spriterData;
+    self.incrementalAnimationData = nil;
+    self.incrementalData = nil;
+    self.conversionSteps = nil;
+    self.incrementalConversionFailed = NO;
+    __weak INSKSpriterParser *weakSelf = self;
+    if (self.cachedArchive != nil) {
+        // a cache entry is decoded in steps, too
+        self.conversionSteps = [NSMutableArray array];
+        [self addCacheDecodingStepsToSteps:self.conversionSteps resultHandler:^(INSKAMData *data) {
+            weakSelf.incrementalData = data;
+        }];
+        return YES;
+    }
+    if (spriterData == nil) {
+        return NO;
+    }
+    self.conversionSteps = [NSMutableArray array];
+    INSKAMData *data = [self animationDataForSpriterData:spriterData steps:self.conversionSteps animationHandler:nil];
+    self.incrementalData = data;
+    
+    // the cache is written after all other steps
+    [self.conversionSteps addObject:^BOOL {
+        [weakSelf storeAnimationDataInCache:data];
+        return YES;
+    }];
+    return YES;
+}
+
+- (BOOL)step:(NSTimeInterval)budget {
+    NSMutableArray *steps = self.conversionSteps;
+    if (steps == nil) {
+        return (self.incrementalAnimationData != nil);
+    }
+    INSKAnimationTraceScoped("conversion steps");
+    
+    // at least one step is run, so the conversion advances with any budget
+    CFTimeInterval deadline = CACurrentMediaTime() + budget;
+    do {
+        if (![[self class] runFirstConversionStep:steps]) {
+            // failed
+            self.conversionSteps = nil;
+            self.incrementalData = nil;
+            self.incrementalConversionFailed = YES;
+            return NO;
+        }
+    } while (steps.count > 0 && CACurrentMediaTime() < deadline);
+    
+    if (steps.count == 0) {
+        self.conversionSteps = nil;
+        self.incrementalAnimationData = self.incrementalData;
+        self.incrementalData = nil;
+        return YES;
+    }
+    return NO;
+}
+
+- (BOOL)isConverting {
+    return (self.conversionSteps != nil);
+}
+
+// Removes the first step of a conversion and runs it, returns false if the step failed.
++ (BOOL)runFirstConversionStep:(NSMutableArray *)steps {
+    INSKSpriterParserConversionStep step = steps.firstObject;
+    [steps removeObjectAtIndex:0];
+    return step();
+}
+
+// Inserts steps before the remaining steps of a conversion, so a step can split its work into smaller ones.
++ (void)insertConversionSteps:(NSArray *)newSteps intoSteps:(NSMutableArray *)steps {
+    [steps insertObjects:newSteps atIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, newSteps.count)]];
+}
+
+// Creates the animation data object and the steps which fill it, the handler is called by a step after each animation.
+- (INSKAMData *)animationDataForSpriterData:(SpriterData *)spriterData steps:(NSMutableArray *)steps animationHandler:(BOOL (^)(NSString *entityName, NSString *animationName))animationHandler {
     // create animation data
     INSKAMData *data = [[INSKAMData alloc] init];
+    data.texturesById = [NSMutableDictionary dictionary];
+    data.entitiesByName = [NSMutableDictionary dictionary];
+    NSDictionary *texturesById = data.texturesById;
+    NSArray *spriterFolders = spriterData.folders;
+    BOOL compressKeyframes = self.compressKeyframes;
+    BOOL lazyConversion = self.lazyConversion;
+    Class parserClass = [self class];
     
     // create textures
-    data.texturesById = [NSMutableDictionary dictionary];
-    for (SpriterFolder *spriterFolder in self.spriterData.folders) {
-        for (SpriterFile *spriterFile in spriterFolder.files) {
-            INSKAMTexture *texture = [[INSKAMTexture alloc] init];
-            texture.textureId = [NSString stringWithFormat:@"%@_%@", spriterFolder.folderId, spriterFile.fileId];
-            [data.texturesById setObject:texture forKey:texture.textureId];
-            texture.width = spriterFile.width;
-            texture.height = spriterFile.height;
-            texture.relativePath = spriterFolder.name;
-            NSAssert(spriterFolder.name.length < spriterFile.name.length, @"The file name normally includes the folder");
-            texture.fileName = [spriterFile.name substringFromIndex:spriterFolder.name.length + 1];
-        }
+    for (SpriterFolder *spriterFolder in spriterData.folders) {
+        [steps addObject:^BOOL {
+            for (SpriterFile *spriterFile in spriterFolder.files) {
+                INSKAMTexture *texture = [[INSKAMTexture alloc] init];
+                texture.textureId = [NSString stringWithFormat:@"%@_%@", spriterFolder.folderId, spriterFile.fileId];
+                [data.texturesById setObject:texture forKey:texture.textureId];
+                texture.width = spriterFile.width;
+                texture.height = spriterFile.height;
+                texture.relativePath = spriterFolder.name;
+                NSAssert(spriterFolder.name.length < spriterFile.name.length, @"The file name normally includes the folder");
+                texture.fileName = [spriterFile.name substringFromIndex:spriterFolder.name.length + 1];
+            }
+            return YES;
+        }];
     }
     
-    // create entities
-    data.entitiesByName = [NSMutableDictionary dictionary];
-    for (SpriterEntity *spriterEntity in self.spriterData.entities) {
-        // create entity
-        INSKAMEntity *entity = [[INSKAMEntity alloc] init];
-        entity.name = spriterEntity.name;
-        [data.entitiesByName setObject:entity forKey:entity.name];
-        
-        // create animations
-        entity.animationsByName = [NSMutableDictionary dictionary];
-        for (SpriterAnimation *spriterAnimation in spriterEntity.animations) {
-            INSKAMAnimation *animation = [[INSKAMAnimation alloc] init];
-            animation.name = spriterAnimation.name;
-            [entity.animationsByName setObject:animation forKey:animation.name];
+    // create entities, the steps for their animations are inserted when an entity is created
+    __weak NSMutableArray *weakSteps = steps;
+    for (SpriterEntity *spriterEntity in spriterData.entities) {
+        [steps addObject:^BOOL {
+            // create entity
+            INSKAMEntity *entity = [[INSKAMEntity alloc] init];
+            entity.name = spriterEntity.name;
+            [data.entitiesByName setObject:entity forKey:entity.name];
             
-            animation.length = spriterAnimation.length / 1000.0; // convert from milliseconds to seconds
-            animation.looping = spriterAnimation.looping;
-            
-            // create timelines
-            animation.timelinesById = [NSMutableDictionary dictionary];
-            for (SpriterTimeline *spriterTimeline in spriterAnimation.timelines) {
-                INSKAMTimeline *timeline = [[INSKAMTimeline alloc] init];
-                timeline.timelineId = spriterTimeline.timelineId;
-                [animation.timelinesById setObject:timeline forKey:timeline.timelineId];
-                
-                // create spatial name for this timeline
-                NSString *spatialName = [INSKAMSpatial composeNameWithTimelineId:spriterTimeline.timelineId animationId:spriterAnimation.animationId entityId:spriterEntity.entityId];
-                
-                // create spatials
-                NSMutableArray *spatialsByTime = [NSMutableArray array];
-                // spatials in the timeline
-                for (SpriterTimelineKey *spriterTimelineKey in spriterTimeline.keys) {
-                    // create spatial of key
-                    INSKAMSpatial *spatial = [[INSKAMSpatial alloc] init];
-                    [spatialsByTime addObject:spatial];
-                    spatial.spatialId = spriterTimelineKey.keyId;
-                    spatial.nodeName = spatialName;
-                    spatial.time = spriterTimelineKey.time / 1000.0; // convert from milliseconds to seconds
-                    spatial.hidden = NO;
-                    if (spriterTimelineKey.object != nil) {
-                        spatial.spatialType = INSKAMSpatialTypeSprite;
-                        SpriterObject *object = spriterTimelineKey.object;
-                        // node data
-                        spatial.positionX = object.positionX;
-                        spatial.positionY = object.positionY;
-                        spatial.scaleX = object.scaleX;
-                        spatial.scaleY = object.scaleY;
-                        spatial.alpha = object.alpha;
-                        spatial.angle = DegreesToRadians(object.angle);
-                        spatial.spin = spriterTimelineKey.spin;
-                        // sprite data
-                        spatial.texture = [data.texturesById objectForKey:[NSString stringWithFormat:@"%@_%@", object.folderId, object.fileId]];
-                        SpriterFile *spriterFile = [self spriterFileWithId:object.fileId folderId:object.folderId];
-                        NSAssert(spriterFile != nil, @"spriterFile should exist");
-                        spatial.pivotX = object.pivotX;
-                        if (object.pivotX == SpriterObjectNoPivotValue) {
-                            spatial.pivotX = spriterFile.pivotX;
-                        }
-                        spatial.pivotY = object.pivotY;
-                        if (object.pivotY == SpriterObjectNoPivotValue) {
-                            spatial.pivotY = spriterFile.pivotY;
-                        }
-                    } else if (spriterTimelineKey.bone != nil) {
-                        spatial.spatialType = INSKAMSpatialTypeNode;
-                        SpriterBone *object = spriterTimelineKey.bone;
-                        spatial.positionX = object.positionX;
-                        spatial.positionY = object.positionY;
-                        spatial.scaleX = object.scaleX;
-                        spatial.scaleY = object.scaleY;
-                        spatial.alpha = object.alpha;
-                        spatial.angle = DegreesToRadians(object.angle);
-                        spatial.spin = spriterTimelineKey.spin;
-                    } else {
-                        NSAssert(false, @"Unsupported Spatial type?");
-                        return nil;
-                    }
+            // identify the objects across the animations for blending, known before any animation is converted
+            for (SpriterAnimation *spriterAnimation in spriterEntity.animations) {
+                for (SpriterTimeline *spriterTimeline in spriterAnimation.timelines) {
+                    // unnamed timelines can only be identified by their ID
+                    [entity registerObjectNamed:(spriterTimeline.name != nil ? spriterTimeline.name : spriterTimeline.timelineId)];
                 }
-                NSAssert(spatialsByTime.count > 0, @"There should be at least one spatial in each timeline");
-                timeline.spatialsByTime = spatialsByTime;
             }
-            NSAssert(animation.timelinesById.count > 0, @"no timelines");
             
-            // update the parent names of all timeline's spatials
-            for (SpriterMainlineKey *spriterMainlineKey in spriterAnimation.mainline.keys) {
-                for (SpriterObjectRef *spriterObjectRef in spriterMainlineKey.objectRefs) {
-                    [self updateSpatialForMainlineKey:spriterMainlineKey spriterTimelineId:spriterObjectRef.timelineId spriterParentId:spriterObjectRef.parentId timelinesById:animation.timelinesById];
+            // create animations
+            NSMutableArray *animationSteps = [NSMutableArray array];
+            entity.animationsByName = [NSMutableDictionary dictionary];
+            entity.animations = [NSMutableArray arrayWithCapacity:spriterEntity.animations.count];
+            for (SpriterAnimation *spriterAnimation in spriterEntity.animations) {
+                INSKAMAnimation *animation = [[INSKAMAnimation alloc] init];
+                animation.name = spriterAnimation.name;
+                animation.animationIndex = entity.animations.count;
+                [entity.animationsByName setObject:animation forKey:animation.name];
+                [entity.animations addObject:animation];
+                
+                animation.length = spriterAnimation.length; // Spriter's milliseconds are the ticks
+                animation.looping = spriterAnimation.looping;
+                
+                if (lazyConversion) {
+                    // the timelines are converted when the animation is prepared for the first time,
+                    // the converter keeps neither the parser nor the other parts of the Spriter data alive
+                    __weak INSKAMEntity *weakEntity = entity;
+                    NSString *spriterEntityId = spriterEntity.entityId;
+                    NSArray *spriterObjectInfos = spriterEntity.objectInfos;
+                    animation.converter = ^(INSKAMAnimation *convertedAnimation) {
+                        [parserClass convertAnimation:convertedAnimation entity:weakEntity spriterAnimation:spriterAnimation spriterEntityId:spriterEntityId spriterObjectInfos:spriterObjectInfos spriterFolders:spriterFolders texturesById:texturesById compressKeyframes:compressKeyframes];
+                    };
+                } else {
+                    [parserClass addConversionStepsForAnimation:animation entity:entity spriterAnimation:spriterAnimation spriterEntityId:spriterEntity.entityId spriterObjectInfos:spriterEntity.objectInfos spriterFolders:spriterFolders texturesById:texturesById compressKeyframes:compressKeyframes toSteps:animationSteps];
                 }
-                for (SpriterBoneRef *spriterBoneRef in spriterMainlineKey.boneRefs) {
-                    [self updateSpatialForMainlineKey:spriterMainlineKey spriterTimelineId:spriterBoneRef.timelineId spriterParentId:spriterBoneRef.parentId timelinesById:animation.timelinesById];
+                if (animationHandler != nil) {
+                    [animationSteps addObject:^BOOL {
+                        return animationHandler(entity.name, animation.name);
+                    }];
                 }
             }
+            NSCAssert(entity.animationsByName.count > 0, @"no animations");
+            [parserClass insertConversionSteps:animationSteps intoSteps:weakSteps];
+            return YES;
+        }];
+    }
+    NSAssert(spriterData.entities.count > 0, @"no entities");
+    
+    return data;
+}
 
-            // add any missing spatials for all timelines and create shortcut links
-            for (INSKAMTimeline *timeline in animation.timelinesById.allValues) {
-                // make sure there is a spatial for time 0 and on the end frame
-                INSKAMSpatial *firstSpatial = timeline.spatialsByTime[0];
-                if (![firstSpatial equalsTime:0.0]) {
-                    // insert a hidden spatial for time 0
-                    INSKAMSpatial *zeroSpatial = firstSpatial.copy;
-                    zeroSpatial.time = 0.0;
-                    zeroSpatial.hidden = YES;
-                    [timeline.spatialsByTime insertObject:zeroSpatial atIndex:0];
-                    firstSpatial = zeroSpatial;
-                }
-                INSKAMSpatial *endSpatial = [timeline.spatialsByTime lastObject];
-                if (![endSpatial equalsTime:animation.length]) {
-                    if (animation.looping) {
-                        // insert a copy of the first as the last frame
-                        INSKAMSpatial *spatial = firstSpatial.copy;
-                        spatial.time = animation.length;
-                        [timeline.spatialsByTime addObject:spatial];
-                        
-                        // if pivot changes the pivot of the first keyframe is not correct
-                        spatial.pivotX = endSpatial.pivotX;
-                        spatial.pivotY = endSpatial.pivotY;
-                    } else {
-                        // insert a copy of the last frame as a new frame
-                        INSKAMSpatial *spatial = endSpatial.copy;
-                        spatial.time = animation.length;
-                        [timeline.spatialsByTime addObject:spatial];
-                    }
-                }
-                
-                // create shortcut links between spatials
-                for (NSUInteger index = 0; index < timeline.spatialsByTime.count - 1; ++index) {
-                    INSKAMSpatial *spatial = timeline.spatialsByTime[index];
-                    spatial.nextSpatial = timeline.spatialsByTime[index + 1];
-                }
-                // always connect the last with the first spatial regardless of the current looping state
-                INSKAMSpatial *lastSpatial = timeline.spatialsByTime.lastObject;
-                lastSpatial.nextSpatial = timeline.spatialsByTime[0];
+// Converts the timelines, mainline keys and events of a Spriter animation into an animation which has only its name, length and looping flag set.
++ (BOOL)convertAnimation:(INSKAMAnimation *)animation entity:(INSKAMEntity *)entity spriterAnimation:(SpriterAnimation *)spriterAnimation spriterEntityId:(NSString *)spriterEntityId spriterObjectInfos:(NSArray *)spriterObjectInfos spriterFolders:(NSArray *)spriterFolders texturesById:(NSDictionary *)texturesById compressKeyframes:(BOOL)compressKeyframes {
+    INSKAnimationTraceScoped("convert animation");
+    NSMutableArray *steps = [NSMutableArray array];
+    [self addConversionStepsForAnimation:animation entity:entity spriterAnimation:spriterAnimation spriterEntityId:spriterEntityId spriterObjectInfos:spriterObjectInfos spriterFolders:spriterFolders texturesById:texturesById compressKeyframes:compressKeyframes toSteps:steps];
+    while (steps.count > 0) {
+        if (![self runFirstConversionStep:steps]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+// Adds the steps for converting a Spriter animation, each step handles one timeline, one mainline key or a part of a long timeline.
++ (void)addConversionStepsForAnimation:(INSKAMAnimation *)animation entity:(INSKAMEntity *)entity spriterAnimation:(SpriterAnimation *)spriterAnimation spriterEntityId:(NSString *)spriterEntityId spriterObjectInfos:(NSArray *)spriterObjectInfos spriterFolders:(NSArray *)spriterFolders texturesById:(NSDictionary *)texturesById compressKeyframes:(BOOL)compressKeyframes toSteps:(NSMutableArray *)steps {
+    NSArray *spriterMainlineKeys = spriterAnimation.mainline.keys;
+    NSUInteger timelineCount = spriterAnimation.timelines.count;
+    
+    // create timelines
+    [steps addObject:^BOOL {
+        animation.timelinesById = [NSMutableDictionary dictionary];
+        animation.timelines = [NSMutableArray arrayWithCapacity:timelineCount];
+        return YES;
+    }];
+    for (SpriterTimeline *spriterTimeline in spriterAnimation.timelines) {
+        NSUInteger keyCount = spriterTimeline.keys.count;
+        NSUInteger keyIndex = 0;
+        do {
+            NSRange range = NSMakeRange(keyIndex, MIN(INSKSpriterParserKeysPerStep, keyCount - keyIndex));
+            [steps addObject:^BOOL {
+                return [self convertKeysInRange:range ofSpriterTimeline:spriterTimeline animation:animation spriterAnimation:spriterAnimation spriterEntityId:spriterEntityId spriterObjectInfos:spriterObjectInfos spriterFolders:spriterFolders texturesById:texturesById];
+            }];
+            keyIndex += INSKSpriterParserKeysPerStep;
+        } while (keyIndex < keyCount);
+    }
+    
+    // update the parent names of all timeline's spatials
+    for (SpriterMainlineKey *spriterMainlineKey in spriterMainlineKeys) {
+        [steps addObject:^BOOL {
+            NSAssert(animation.timelinesById.count > 0, @"no timelines");
+            for (SpriterObjectRef *spriterObjectRef in spriterMainlineKey.objectRefs) {
+                [self updateSpatialForMainlineKey:spriterMainlineKey spriterTimelineId:spriterObjectRef.timelineId spriterParentId:spriterObjectRef.parentId zIndex:spriterObjectRef.zIndex timelinesById:animation.timelinesById];
+            }
+            for (SpriterBoneRef *spriterBoneRef in spriterMainlineKey.boneRefs) {
+                [self updateSpatialForMainlineKey:spriterMainlineKey spriterTimelineId:spriterBoneRef.timelineId spriterParentId:spriterBoneRef.parentId zIndex:0 timelinesById:animation.timelinesById];
             }
+            return YES;
+        }];
+    }
+    
+    // create the mainline keys with the hierarchy and visibility tables
+    [steps addObject:^BOOL {
+        animation.mainlineKeys = [NSMutableArray arrayWithCapacity:spriterMainlineKeys.count];
+        return YES;
+    }];
+    for (SpriterMainlineKey *spriterMainlineKey in spriterMainlineKeys) {
+        [steps addObject:^BOOL {
+            [animation.mainlineKeys addObject:[self mainlineKeyForSpriterMainlineKey:spriterMainlineKey timelines:animation.timelines]];
+            return YES;
+        }];
+    }
+    
+    // add any missing spatials for all timelines and create shortcut links
+    for (NSUInteger timelineIndex = 0; timelineIndex < timelineCount; ++timelineIndex) {
+        [steps addObject:^BOOL {
+            [self completeTimeline:animation.timelines[timelineIndex] ofAnimation:animation];
+            return YES;
+        }];
+    }
+    
+    // add any hiding spatials
+    for (SpriterMainlineKey *spriterMainlineKey in spriterMainlineKeys) {
+        [steps addObject:^BOOL {
+            [self addHiddenSpatialsForSpriterMainlineKey:spriterMainlineKey animation:animation];
+            return YES;
+        }];
+    }
+    
+    // update position and scale values, parents first
+    NSMutableSet *updatedSpatials = [NSMutableSet set];
+    for (NSUInteger timelineIndex = 0; timelineIndex < timelineCount; ++timelineIndex) {
+        [steps addObject:^BOOL {
+            INSKAMTimeline *timeline = animation.timelines[timelineIndex];
+            for (INSKAMSpatial *spatial in timeline.spatialsByTime) {
+                [self scaleSpatial:spatial ofAnimation:animation updatedSpatials:updatedSpatials];
+            }
+            return YES;
+        }];
+    }
+    
+    // collect the start times of the spans, the sprite bounds and the hold spans share theirs
+    NSMutableIndexSet *collisionTypes = [NSMutableIndexSet indexSetWithIndex:INSKAMSpatialTypeCollisionbox];
+    [collisionTypes addIndex:INSKAMSpatialTypePoint];
+    NSIndexSet *spriteTypes = [NSIndexSet indexSetWithIndex:INSKAMSpatialTypeSprite];
+    NSMutableIndexSet *collisionSpanTimes = [NSMutableIndexSet indexSet];
+    NSMutableIndexSet *spriteSpanTimes = [NSMutableIndexSet indexSet];
+    [steps addObject:^BOOL {
+        [updatedSpatials removeAllObjects];
+        [animation addMainlineKeyTimesToSpanTimes:collisionSpanTimes];
+        [animation addMainlineKeyTimesToSpanTimes:spriteSpanTimes];
+        return YES;
+    }];
+    for (NSUInteger timelineIndex = 0; timelineIndex < timelineCount; ++timelineIndex) {
+        [steps addObject:^BOOL {
+            [animation addKeyframeTimesOfTimelineAtIndex:timelineIndex spatialTypes:collisionTypes toSpanTimes:collisionSpanTimes];
+            [animation addKeyframeTimesOfTimelineAtIndex:timelineIndex spatialTypes:spriteTypes toSpanTimes:spriteSpanTimes];
+            return YES;
+        }];
+    }
+    
+    // precompute the bounds of collision boxes and points for broad phase tests, of the sprites for culling
+    // and the spans without visible changes for letting animation nodes sleep, the number of spans is known only now
+    __weak NSMutableArray *weakSteps = steps;
+    [steps addObject:^BOOL {
+        // each span evaluates all timelines, so a step handles about as many evaluations as keys are converted in one
+        NSUInteger spansPerStep = MAX(INSKSpriterParserKeysPerStep / MAX(timelineCount, (NSUInteger)1), (NSUInteger)1);
+        NSMutableArray *spanSteps = [NSMutableArray array];
+        if ([animation timelineCountOfSpatialType:INSKAMSpatialTypeCollisionbox] + [animation timelineCountOfSpatialType:INSKAMSpatialTypePoint] > 0) {
+            NSMutableData *collisionSpans = [NSMutableData data];
+            [self addSpanStepsForSpanTimes:collisionSpanTimes spansPerStep:spansPerStep toSteps:spanSteps spanHandler:^NSUInteger(NSUInteger spanTime, NSUInteger maxCount) {
+                return [animation appendBoundsSpansForSpatialTypes:collisionTypes spanTimes:collisionSpanTimes fromTime:spanTime maxCount:maxCount toSpans:collisionSpans];
+            }];
+            [spanSteps addObject:^BOOL {
+                animation.collisionSpans = collisionSpans;
+                return YES;
+            }];
+        }
+        NSMutableData *spriteSpans = [NSMutableData data];
+        [self addSpanStepsForSpanTimes:spriteSpanTimes spansPerStep:spansPerStep toSteps:spanSteps spanHandler:^NSUInteger(NSUInteger spanTime, NSUInteger maxCount) {
+            return [animation appendBoundsSpansForSpatialTypes:spriteTypes spanTimes:spriteSpanTimes fromTime:spanTime maxCount:maxCount toSpans:spriteSpans];
+        }];
+        NSMutableData *holdSpans = [NSMutableData data];
+        [self addSpanStepsForSpanTimes:spriteSpanTimes spansPerStep:spansPerStep toSteps:spanSteps spanHandler:^NSUInteger(NSUInteger spanTime, NSUInteger maxCount) {
+            return [animation appendHoldSpansWithSpanTimes:spriteSpanTimes fromTime:spanTime maxCount:maxCount toSpans:holdSpans];
+        }];
+        [spanSteps addObject:^BOOL {
+            animation.spriteSpans = spriteSpans;
+            animation.holdSpans = holdSpans;
+            return YES;
+        }];
+        [self insertConversionSteps:spanSteps intoSteps:weakSteps];
+        return YES;
+    }];
+    
+    // merge the eventlines into one list of events ordered by time
+    NSMutableArray *eventNames = [NSMutableArray arrayWithCapacity:spriterAnimation.eventlines.count];
+    NSMutableData *events = [NSMutableData data];
+    for (SpriterEventline *spriterEventline in spriterAnimation.eventlines) {
+        [steps addObject:^BOOL {
+            INSKAMEvent event = {0, eventNames.count};
+            [eventNames addObject:(spriterEventline.name != nil ? spriterEventline.name : @"")];
+            for (SpriterEventlineKey *spriterEventlineKey in spriterEventline.keys) {
+                event.time = spriterEventlineKey.time;
+                [events appendBytes:&event length:sizeof(INSKAMEvent)];
+            }
+            return YES;
+        }];
+    }
+    [steps addObject:^BOOL {
+        qsort(events.mutableBytes, events.length / sizeof(INSKAMEvent), sizeof(INSKAMEvent), INSKSpriterParserCompareEvents);
+        animation.events = events;
+        animation.eventNames = eventNames;
+        
+        // the objects are registered at the entity already
+        [entity assignObjectIndexesOfAnimation:animation];
+        return YES;
+    }];
+    
+    // pack the keyframes if wanted
+    if (compressKeyframes) {
+        for (NSUInteger timelineIndex = 0; timelineIndex < timelineCount; ++timelineIndex) {
+            [steps addObject:^BOOL {
+                [animation.timelines[timelineIndex] compress];
+                return YES;
+            }];
+        }
+    }
+}
 
-            // add any hiding spatials.
-            NSArray *timelineIds = animation.timelinesById.allKeys;
-            for (SpriterMainlineKey *spriterMainlineKey in spriterAnimation.mainline.keys) {
-                // collect timeline IDs which are not in the mainline
-                NSMutableArray *unusedTimelineIds = timelineIds.mutableCopy;
-                for (SpriterObjectRef *spriterObjectRef in spriterMainlineKey.objectRefs) {
-                    [unusedTimelineIds removeObject:spriterObjectRef.timelineId];
-                }
-                for (SpriterBoneRef *spriterBoneRef in spriterMainlineKey.boneRefs) {
-                    [unusedTimelineIds removeObject:spriterBoneRef.timelineId];
-                }
-                
-                // add hiding spatials for the unused IDs
-                for (NSString *timelineId in unusedTimelineIds) {
-                    [self addHiddenSpatialToTimeline:[animation.timelinesById objectForKey:timelineId] atSpriterTime:spriterMainlineKey.time];
-                }
+// Adds steps computing spans in chunks, each calls the handler with the start time of its first span, which returns the start time following the chunk.
++ (void)addSpanStepsForSpanTimes:(NSIndexSet *)spanTimes spansPerStep:(NSUInteger)spansPerStep toSteps:(NSMutableArray *)steps spanHandler:(NSUInteger (^)(NSUInteger spanTime, NSUInteger maxCount))spanHandler {
+    // the times from the animation's length on start no span, so the last steps may have nothing left to do
+    __block NSUInteger nextSpanTime = spanTimes.firstIndex;
+    for (NSUInteger spanIndex = 0; spanIndex < spanTimes.count; spanIndex += spansPerStep) {
+        [steps addObject:^BOOL {
+            if (nextSpanTime != NSNotFound) {
+                nextSpanTime = spanHandler(nextSpanTime, spansPerStep);
             }
+            return YES;
+        }];
+    }
+}
 
-            // update position and scale values
-            // TODO optimize cycle
-            NSMutableSet *updatedSpatials = [NSMutableSet set];
-            BOOL cycle = YES; // cycle while there are any spatials updated
-            while (cycle) {
-                cycle = NO;
-                for (INSKAMTimeline *timeline in animation.timelinesById.allValues) {
-                    for (INSKAMSpatial *spatial in timeline.spatialsByTime) {
-                        if ([updatedSpatials containsObject:spatial]) {
-                            // already updated
-                        } else if (spatial.parentNodeName == nil) {
-                            // no parent, no update needed
-                            [updatedSpatials addObject:spatial];
-                            cycle = YES;
-                        } else {
-                            INSKAMTimeline *parentTimeline = [animation.timelinesById objectForKey:spatial.parentTimelineId];
-                            INSKAMSpatial *parentSpatial = [parentTimeline spatialForTime:spatial.time];
-                            NSAssert(parentSpatial != nil, @"There should always be a parent spatial");
-                            if (![updatedSpatials containsObject:parentSpatial]) {
-                                // parent not yet updated
-                                continue;
-                            }
-                            
-                            // parent updated, so update this spatial
-                            spatial.positionX *= parentSpatial.scaleX;
-                            spatial.positionY *= parentSpatial.scaleY;
-                            spatial.scaleX *= parentSpatial.scaleX;
-                            spatial.scaleY *= parentSpatial.scaleY;
-                            [updatedSpatials addObject:spatial];
-                            cycle = YES;
-                        }
-                    }
-                }
+// Creates the spatials of a range of a Spriter timeline's keys, the timeline is created with the first range.
++ (BOOL)convertKeysInRange:(NSRange)range ofSpriterTimeline:(SpriterTimeline *)spriterTimeline animation:(INSKAMAnimation *)animation spriterAnimation:(SpriterAnimation *)spriterAnimation spriterEntityId:(NSString *)spriterEntityId spriterObjectInfos:(NSArray *)spriterObjectInfos spriterFolders:(NSArray *)spriterFolders texturesById:(NSDictionary *)texturesById {
+    INSKAMTimeline *timeline = nil;
+    if (range.location == 0) {
+        timeline = [[INSKAMTimeline alloc] init];
+        timeline.timelineId = spriterTimeline.timelineId;
+        timeline.name = spriterTimeline.name;
+        timeline.spatialsByTime = [NSMutableArray arrayWithCapacity:spriterTimeline.keys.count];
+        [animation.timelinesById setObject:timeline forKey:timeline.timelineId];
+        [animation.timelines addObject:timeline];
+    } else {
+        timeline = [animation.timelinesById objectForKey:spriterTimeline.timelineId];
+    }
+    
+    // create spatial name for this timeline
+    NSString *spatialName = [INSKAMSpatial composeNameWithTimelineId:spriterTimeline.timelineId animationId:spriterAnimation.animationId entityId:spriterEntityId];
+    
+    // the object info holds the size of collision boxes
+    SpriterObjectInfo *spriterObjectInfo = nil;
+    if (spriterTimeline.objectInfoIndex < spriterObjectInfos.count) {
+        spriterObjectInfo = spriterObjectInfos[spriterTimeline.objectInfoIndex];
+    }
+    
+    // create spatials
+    NSMutableArray *spatialsByTime = timeline.spatialsByTime;
+    NSArray *spriterTimelineKeys = spriterTimeline.keys;
+    for (NSUInteger keyIndex = range.location; keyIndex < NSMaxRange(range); ++keyIndex) {
+        SpriterTimelineKey *spriterTimelineKey = spriterTimelineKeys[keyIndex];
+        // create spatial of key
+        INSKAMSpatial *spatial = [[INSKAMSpatial alloc] init];
+        [spatialsByTime addObject:spatial];
+        spatial.spatialId = spriterTimelineKey.keyId;
+        spatial.nodeName = spatialName;
+        spatial.time = spriterTimelineKey.time;
+        spatial.hidden = NO;
+        if (spriterTimelineKey.object != nil && spriterTimeline.objectType == SpriterObjectTypeSprite) {
+            spatial.spatialType = INSKAMSpatialTypeSprite;
+            SpriterObject *object = spriterTimelineKey.object;
+            // node data
+            spatial.positionX = object.positionX;
+            spatial.positionY = object.positionY;
+            spatial.scaleX = object.scaleX;
+            spatial.scaleY = object.scaleY;
+            spatial.alpha = object.alpha;
+            spatial.angle = DegreesToRadians(object.angle);
+            spatial.spin = spriterTimelineKey.spin;
+            // sprite data
+            spatial.texture = [texturesById objectForKey:[NSString stringWithFormat:@"%@_%@", object.folderId, object.fileId]];
+            SpriterFile *spriterFile = [self spriterFileWithId:object.fileId folderId:object.folderId spriterFolders:spriterFolders];
+            NSAssert(spriterFile != nil, @"spriterFile should exist");
+            spatial.pivotX = object.pivotX;
+            if (object.pivotX == SpriterObjectNoPivotValue) {
+                spatial.pivotX = spriterFile.pivotX;
+            }
+            spatial.pivotY = object.pivotY;
+            if (object.pivotY == SpriterObjectNoPivotValue) {
+                spatial.pivotY = spriterFile.pivotY;
             }
+            spatial.width = spatial.texture.width;
+            spatial.height = spatial.texture.height;
+        } else if (spriterTimelineKey.object != nil && (spriterTimeline.objectType == SpriterObjectTypeBox || spriterTimeline.objectType == SpriterObjectTypePoint)) {
+            SpriterObject *object = spriterTimelineKey.object;
+            spatial.positionX = object.positionX;
+            spatial.positionY = object.positionY;
+            spatial.scaleX = object.scaleX;
+            spatial.scaleY = object.scaleY;
+            spatial.alpha = object.alpha;
+            spatial.angle = DegreesToRadians(object.angle);
+            spatial.spin = spriterTimelineKey.spin;
+            if (spriterTimeline.objectType == SpriterObjectTypeBox) {
+                // collision box data
+                spatial.spatialType = INSKAMSpatialTypeCollisionbox;
+                NSAssert(spriterObjectInfo != nil, @"a box needs an object info for its size");
+                spatial.width = spriterObjectInfo.width;
+                spatial.height = spriterObjectInfo.height;
+                spatial.pivotX = (object.pivotX == SpriterObjectNoPivotValue ? spriterObjectInfo.pivotX : object.pivotX);
+                spatial.pivotY = (object.pivotY == SpriterObjectNoPivotValue ? spriterObjectInfo.pivotY : object.pivotY);
+            } else {
+                spatial.spatialType = INSKAMSpatialTypePoint;
+            }
+        } else if (spriterTimelineKey.bone != nil) {
+            spatial.spatialType = INSKAMSpatialTypeNode;
+            SpriterBone *object = spriterTimelineKey.bone;
+            spatial.positionX = object.positionX;
+            spatial.positionY = object.positionY;
+            spatial.scaleX = object.scaleX;
+            spatial.scaleY = object.scaleY;
+            spatial.alpha = object.alpha;
+            spatial.angle = DegreesToRadians(object.angle);
+            spatial.spin = spriterTimelineKey.spin;
+        } else {
+            NSAssert(false, @"Unsupported Spatial type?");
+            return NO;
+        }
+    }
+    NSAssert(NSMaxRange(range) < spriterTimelineKeys.count || spatialsByTime.count > 0, @"There should be at least one spatial in each timeline");
+    return YES;
+}
+
+// Makes sure there is a spatial for time 0 and on the end frame and links each spatial to the next one.
++ (void)completeTimeline:(INSKAMTimeline *)timeline ofAnimation:(INSKAMAnimation *)animation {
+    // make sure there is a spatial for time 0 and on the end frame
+    INSKAMSpatial *firstSpatial = timeline.spatialsByTime[0];
+    if (firstSpatial.time != 0) {
+        // insert a hidden spatial for time 0
+        INSKAMSpatial *zeroSpatial = firstSpatial.copy;
+        zeroSpatial.time = 0;
+        zeroSpatial.hidden = YES;
+        [timeline.spatialsByTime insertObject:zeroSpatial atIndex:0];
+        firstSpatial = zeroSpatial;
+    }
+    INSKAMSpatial *endSpatial = [timeline.spatialsByTime lastObject];
+    if (endSpatial.time != animation.length) {
+        if (animation.looping) {
+            // insert a copy of the first as the last frame
+            INSKAMSpatial *spatial = firstSpatial.copy;
+            spatial.time = animation.length;
+            [timeline.spatialsByTime addObject:spatial];
+            
+            // if pivot changes the pivot of the first keyframe is not correct
+            spatial.pivotX = endSpatial.pivotX;
+            spatial.pivotY = endSpatial.pivotY;
+        } else {
+            // insert a copy of the last frame as a new frame
+            INSKAMSpatial *spatial = endSpatial.copy;
+            spatial.time = animation.length;
+            [timeline.spatialsByTime addObject:spatial];
         }
-        NSAssert(entity.animationsByName.count > 0, @"no animations");
     }
-    NSAssert(data.entitiesByName.count > 0, @"no entities");
     
-    return data;
+    // create shortcut links between spatials
+    for (NSUInteger index = 0; index < timeline.spatialsByTime.count - 1; ++index) {
+        INSKAMSpatial *spatial = timeline.spatialsByTime[index];
+        spatial.nextSpatial = timeline.spatialsByTime[index + 1];
+    }
+    // always connect the last with the first spatial regardless of the current looping state
+    INSKAMSpatial *lastSpatial = timeline.spatialsByTime.lastObject;
+    lastSpatial.nextSpatial = timeline.spatialsByTime[0];
+}
+
+// Adds hiding spatials to the timelines which are not in a mainline key.
++ (void)addHiddenSpatialsForSpriterMainlineKey:(SpriterMainlineKey *)spriterMainlineKey animation:(INSKAMAnimation *)animation {
+    // collect timeline IDs which are not in the mainline
+    NSMutableArray *unusedTimelineIds = animation.timelinesById.allKeys.mutableCopy;
+    for (SpriterObjectRef *spriterObjectRef in spriterMainlineKey.objectRefs) {
+        [unusedTimelineIds removeObject:spriterObjectRef.timelineId];
+    }
+    for (SpriterBoneRef *spriterBoneRef in spriterMainlineKey.boneRefs) {
+        [unusedTimelineIds removeObject:spriterBoneRef.timelineId];
+    }
+    
+    // add hiding spatials for the unused IDs
+    for (NSString *timelineId in unusedTimelineIds) {
+        [self addHiddenSpatialToTimeline:[animation.timelinesById objectForKey:timelineId] atSpriterTime:spriterMainlineKey.time];
+    }
+}
+
+// Scales the position and scale of a spatial by its parent's scale after scaling the parent.
++ (void)scaleSpatial:(INSKAMSpatial *)spatial ofAnimation:(INSKAMAnimation *)animation updatedSpatials:(NSMutableSet *)updatedSpatials {
+    if ([updatedSpatials containsObject:spatial]) {
+        // already updated
+        return;
+    }
+    if (spatial.parentNodeName != nil) {
+        INSKAMTimeline *parentTimeline = [animation.timelinesById objectForKey:spatial.parentTimelineId];
+        INSKAMSpatial *parentSpatial = [parentTimeline spatialForTime:spatial.time];
+        NSAssert(parentSpatial != nil, @"There should always be a parent spatial");
+        [self scaleSpatial:parentSpatial ofAnimation:animation updatedSpatials:updatedSpatials];
+        
+        // parent updated, so update this spatial
+        spatial.positionX *= parentSpatial.scaleX;
+        spatial.positionY *= parentSpatial.scaleY;
+        spatial.scaleX *= parentSpatial.scaleX;
+        spatial.scaleY *= parentSpatial.scaleY;
+    }
+    [updatedSpatials addObject:spatial];
 }
 
 // Returns a spriter file for the file and folder id.
-- (SpriterFile *)spriterFileWithId:(NSString *)fileId folderId:(NSString *)folderId {
-    SpriterFolder *folder = [self.spriterData.folders firstObjectPassingTest:^BOOL(SpriterFolder *folder) {
++ (SpriterFile *)spriterFileWithId:(NSString *)fileId folderId:(NSString *)folderId spriterFolders:(NSArray *)spriterFolders {
+    SpriterFolder *folder = [spriterFolders firstObjectPassingTest:^BOOL(SpriterFolder *folder) {
         return [folder.folderId isEqualToString:folderId];
     }];
     SpriterFile *file = [folder.files firstObjectPassingTest:^BOOL(SpriterFile *file) {
@@ -365,11 +1121,10 @@
 }
 
 // Add spatials which hides the nodes when there is no key in the mainline.
-- (void)addHiddenSpatialToTimeline:(INSKAMTimeline *)timeline atSpriterTime:(NSInteger)spriterTime {
-    NSTimeInterval time = spriterTime / 1000.0;
++ (void)addHiddenSpatialToTimeline:(INSKAMTimeline *)timeline atSpriterTime:(INSKAMTicks)time {
     INSKAMSpatial *spatial = [timeline spatialForTime:time];
     NSAssert(spatial != nil, @"a spatial expected");
-    if ([spatial equalsTime:time]) {
+    if (spatial.time == time) {
         return;
     }
     
@@ -382,14 +1137,57 @@
     [timeline.spatialsByTime insertObject:newSpatial atIndex:spatialIndex + 1];
 }
 
-// Updates the parent links.
-- (void)updateSpatialForMainlineKey:(SpriterMainlineKey *)spriterMainlineKey spriterTimelineId:(NSString *)spriterTimelineId spriterParentId:(NSString *)spriterParentId timelinesById:(NSDictionary *)timelinesById {
+// Creates a mainline key with a slot for each timeline.
++ (INSKAMMainlineKey *)mainlineKeyForSpriterMainlineKey:(SpriterMainlineKey *)spriterMainlineKey timelines:(NSArray *)timelines {
+    INSKAMMainlineKey *mainlineKey = [[INSKAMMainlineKey alloc] initWithSlotCount:timelines.count];
+    mainlineKey.time = spriterMainlineKey.time;
+    for (SpriterObjectRef *spriterObjectRef in spriterMainlineKey.objectRefs) {
+        NSUInteger timelineIndex = [self indexOfTimelineWithId:spriterObjectRef.timelineId timelines:timelines];
+        INSKAMMainlineSlot *slot = &mainlineKey.slots[timelineIndex];
+        slot->active = YES;
+        slot->zIndex = spriterObjectRef.zIndex;
+        slot->parentIndex = [self timelineIndexForSpriterParentId:spriterObjectRef.parentId spriterMainlineKey:spriterMainlineKey timelines:timelines];
+    }
+    for (SpriterBoneRef *spriterBoneRef in spriterMainlineKey.boneRefs) {
+        NSUInteger timelineIndex = [self indexOfTimelineWithId:spriterBoneRef.timelineId timelines:timelines];
+        INSKAMMainlineSlot *slot = &mainlineKey.slots[timelineIndex];
+        slot->active = YES;
+        slot->parentIndex = [self timelineIndexForSpriterParentId:spriterBoneRef.parentId spriterMainlineKey:spriterMainlineKey timelines:timelines];
+    }
+    [mainlineKey buildEvaluationOrder];
+    return mainlineKey;
+}
+
+// Returns the index of the timeline with the given ID.
++ (NSUInteger)indexOfTimelineWithId:(NSString *)timelineId timelines:(NSArray *)timelines {
+    NSUInteger index = [timelines indexOfObjectPassingTest:^BOOL(INSKAMTimeline *timeline, NSUInteger index, BOOL *stop) {
+        return [timeline.timelineId isEqualToString:timelineId];
+    }];
+    NSAssert(index != NSNotFound, @"available timeline expected");
+    return index;
+}
+
+// Returns the timeline index of the parent bone reference or INSKAMMainlineNoParent.
++ (NSInteger)timelineIndexForSpriterParentId:(NSString *)spriterParentId spriterMainlineKey:(SpriterMainlineKey *)spriterMainlineKey timelines:(NSArray *)timelines {
+    if ([spriterParentId isEqualToString:SpriterRefNoParentValue]) {
+        return INSKAMMainlineNoParent;
+    }
+    SpriterBoneRef *parentRef = [spriterMainlineKey.boneRefs firstObjectPassingTest:^BOOL(SpriterBoneRef *ref) {
+        return [ref.refId isEqualToString:spriterParentId];
+    }];
+    NSAssert(parentRef != nil, @"the reference should point to a bone");
+    return [self indexOfTimelineWithId:parentRef.timelineId timelines:timelines];
+}
+
+// Updates the parent links and the Z-index.
++ (void)updateSpatialForMainlineKey:(SpriterMainlineKey *)spriterMainlineKey spriterTimelineId:(NSString *)spriterTimelineId spriterParentId:(NSString *)spriterParentId zIndex:(NSInteger)zIndex timelinesById:(NSDictionary *)timelinesById {
     // find corresponding spatial
     INSKAMTimeline *timeline = [timelinesById objectForKey:spriterTimelineId];
     NSAssert(timeline != nil, @"available timeline expected");
-    NSTimeInterval time = spriterMainlineKey.time / 1000.0; // convert Spriter's time in milliseconds to seconds
+    INSKAMTicks time = spriterMainlineKey.time;
     INSKAMSpatial *spatial = [timeline spatialForTime:time];
     NSAssert(spatial != nil, @"spatial expected");
+    spatial.zIndex = zIndex;
     
     // update parent
     if ([spriterParentId isEqualToString:SpriterRefNoParentValue]) {